@@ -34,6 +34,11 @@
 #include "GenDefs.h"
 #include "Sleep.h"
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <emmintrin.h>
+#endif
+
 /** A collector of functions that are executed atomically even on multiprocessor machines. */
 class Atomic{
 
@@ -518,6 +523,42 @@ public:
 #endif
     }
 
+    /**
+     * Atomic addition returning the updated value.
+     * Allows reference counters to be handled without an external lock.
+     */
+    static inline int32 AddAndFetch (volatile int32 *p, int32 value) {
+#if (defined(_RTAI) || defined(_LINUX) || defined(_MACOSX))
+        int32 out = value;
+        asm volatile (
+                "lock xaddl %0, (%1)"
+                : "+r" (out)
+                : "r" (p)
+                : "memory"
+        );
+        return out + value;
+#elif defined(_SOLARIS)
+// This is not appropriate .... but works for the moment...
+    int32 out;
+    Atomic::PrivateLock();
+    *p = *p + value;
+    out = *p;
+    Atomic::PrivateUnLock();
+    return out;
+#elif defined(_WIN32)
+    int32 out;
+    __asm  {
+        mov   ebx,p
+        mov   eax,value
+        lock xadd DWORD PTR[ebx], eax
+        mov   out,eax
+    }
+    return out + value;
+#else
+    #error not available in this O.S. Contributions are welcome
+#endif
+    }
+
     /**
      * Atomic addition
      */
@@ -570,6 +611,35 @@ public:
 #endif
     }
 
+    /**
+     * Prevents the compiler and the processor from moving loads across
+     * loads and stores across stores (e.g. the data and the sequence
+     * counter of a single writer ring). A store followed by a load may
+     * still be reordered: use FullBarrier for that.
+     * On x86 the processor keeps these orders and only the compiler is stopped.
+     */
+    static inline void Barrier(){
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+        __asm__ __volatile__("" ::: "memory");
+#elif defined(__GNUC__)
+        __sync_synchronize();
+#elif defined(_MSC_VER)
+        _ReadWriteBarrier();
+#endif
+    }
+
+    /**
+     * Barrier which also orders a store before a later load, as needed
+     * when two threads each write a flag and then read the other one.
+     */
+    static inline void FullBarrier(){
+#if defined(__GNUC__)
+        __sync_synchronize();
+#elif defined(_MSC_VER)
+        _mm_mfence();
+#endif
+    }
+
 };
 
 #endif
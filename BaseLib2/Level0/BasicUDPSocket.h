@@ -32,6 +32,10 @@
 #include "BasicSocket.h"
 #include "Sleep.h"
 
+#if (defined(_LINUX) || (defined _SOLARIS) || defined(_MACOSX))
+#include <sys/uio.h>
+#endif
+
 #define BasicUDPSocketVersion "$Id$"
 
 class BasicUDPSocket: public BasicSocket {
@@ -68,6 +72,21 @@ public:
         return (ret >0);
     }
 
+#if (defined(_LINUX) || (defined _SOLARIS) || defined(_MACOSX))
+    /** Writes a single datagram gathered from nOfParts buffers, without copying them */
+    bool BasicWriteGather(const struct iovec *parts, int32 nOfParts, uint32 &size){
+        struct msghdr message;
+        memset(&message, 0, sizeof(message));
+        message.msg_name    = (void *)destination.Address();
+        message.msg_namelen = destination.Size();
+        message.msg_iov     = (struct iovec *)parts;
+        message.msg_iovlen  = nOfParts;
+        int32 ret = sendmsg(connectionSocket, &message, 0);
+        size = ret;
+        return (ret > 0);
+    }
+#endif
+
 // class specific functions
     /** a constructor */
     BasicUDPSocket(int32 socket = 0){
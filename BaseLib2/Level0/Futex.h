@@ -0,0 +1,114 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Wrappers of the Linux futex system call used by FutexMutexSem and FutexEventSem.
+ * A thread sleeps in the kernel only while a 32 bit word has an expected value,
+ * so that the uncontended operations never leave user space.
+ * The timeouts are in microseconds. FUTEX_INFINITE_WAIT waits forever.
+ */
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include "GenDefs.h"
+#include "TimeoutType.h"
+
+/** Waits without a timeout */
+#define FUTEX_INFINITE_WAIT     ((int64)-1)
+
+/** Number of polls of the word before sleeping in the kernel on a multi core
+    machine. A lock is usually held for less than a microsecond in BaseLib2 */
+#define FUTEX_SPIN_COUNT        100
+
+#if defined(_LINUX)
+
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <limits.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#if !defined(FUTEX_PRIVATE_FLAG)
+#define FUTEX_WAIT_PRIVATE      FUTEX_WAIT
+#define FUTEX_WAKE_PRIVATE      FUTEX_WAKE
+#endif
+
+/** True where the futex primitives are available */
+#define FUTEX_SUPPORTED
+
+/** Hint to the processor that the thread is polling */
+static inline void FutexCPURelax(){
+#if defined(__i386__) || defined(__x86_64__)
+    __asm__ __volatile__("pause" ::: "memory");
+#else
+    __asm__ __volatile__("" ::: "memory");
+#endif
+}
+
+/** FUTEX_SPIN_COUNT, or 0 on a single core where polling only delays the
+    thread which is to release the word */
+static inline int32 FutexSpinCount(){
+    static int32 spinCount = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? FUTEX_SPIN_COUNT : 0;
+    return spinCount;
+}
+
+/** The monotonic time in microseconds */
+static inline int64 FutexUsecTime(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+/** Converts a TimeoutType to microseconds */
+static inline int64 FutexTimeoutUsec(const TimeoutType &msecTimeout){
+    if(msecTimeout.msecTimeout == TTInfiniteWait.msecTimeout) return FUTEX_INFINITE_WAIT;
+    return (int64)msecTimeout.msecTimeout * 1000;
+}
+
+/** Sleeps while *address == value.
+    @param usecTimeout Relative timeout or FUTEX_INFINITE_WAIT
+    @return 0 if woken (or if *address != value), ETIMEDOUT, EINTR */
+static inline int32 FutexWait(volatile int32 *address, int32 value, int64 usecTimeout){
+    struct timespec  timeout;
+    struct timespec *timeoutPtr = NULL;
+    if(usecTimeout >= 0){
+        timeout.tv_sec  = usecTimeout / 1000000;
+        timeout.tv_nsec = (usecTimeout % 1000000) * 1000;
+        timeoutPtr      = &timeout;
+    }
+    if(syscall(SYS_futex, (int32 *)address, FUTEX_WAIT_PRIVATE, value, timeoutPtr, NULL, 0) == 0) return 0;
+    if(errno == EAGAIN) return 0;
+    return errno;
+}
+
+/** Wakes up to nOfThreads threads sleeping on address (INT_MAX for all) */
+static inline void FutexWake(volatile int32 *address, int32 nOfThreads){
+    syscall(SYS_futex, (int32 *)address, FUTEX_WAKE_PRIVATE, nOfThreads, NULL, NULL, 0);
+}
+
+#endif
+
+#endif
@@ -0,0 +1,180 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * An event semaphore built on a futex, with the EventSem interface.
+ * Post does not take any lock and only enters the kernel when a thread
+ * is sleeping on the semaphore, in which case all the waiters are woken.
+ * A waiter polls for a short time before sleeping. The timeouts can be
+ * given in microseconds. A waiter is released by any Post following the
+ * start of its Wait, even if the semaphore is Reset before it runs again.
+ * Only works within a process (there is no CreateShared). Where the futex
+ * is not available it is an EventSem.
+ */
+#ifndef FUTEX_EVENT_SEM
+#define FUTEX_EVENT_SEM
+
+#include "GenDefs.h"
+#include "Futex.h"
+#include "EventSem.h"
+#include "Atomic.h"
+
+#if defined(FUTEX_SUPPORTED)
+
+class FutexEventSem {
+private:
+    /** 1 after a Post, 0 after a Reset */
+    volatile int32 posted;
+
+    /** Incremented by each Post. The waiters sleep on this word */
+    volatile int32 sequence;
+
+    /** Number of threads which may be sleeping */
+    volatile int32 waiters;
+
+public:
+    /** The constructor */
+    FutexEventSem(){
+        posted   = 0;
+        sequence = 0;
+        waiters  = 0;
+    }
+
+    /** Closes and releases the waiters */
+    ~FutexEventSem(){
+        Close();
+    }
+
+    /** Readies the semaphore (reset) */
+    bool Create(){
+        posted = 0;
+        return True;
+    }
+
+    /** Releases the waiters */
+    bool Close(void){
+        return Post();
+    }
+
+    /** Waits for a Post.
+        @param usecTimeout Microseconds, FUTEX_INFINITE_WAIT or 0 to only poll
+        @return False if the timeout expired */
+    bool WaitUsec(int64 usecTimeout){
+        int32 start = sequence;
+        Atomic::Barrier();
+        if(posted != 0) return True;
+        for(int32 i = FutexSpinCount(); i > 0; i--){
+            FutexCPURelax();
+            if((posted != 0) || (sequence != start)) return True;
+        }
+        if(usecTimeout == 0) return False;
+
+        int64 deadline = 0;
+        if(usecTimeout != FUTEX_INFINITE_WAIT) deadline = FutexUsecTime() + usecTimeout;
+        // Post reads waiters after changing sequence
+        __sync_fetch_and_add(&waiters, 1);
+        bool ret = True;
+        while(sequence == start){
+            int64 remaining = FUTEX_INFINITE_WAIT;
+            if(usecTimeout != FUTEX_INFINITE_WAIT){
+                remaining = deadline - FutexUsecTime();
+                if(remaining <= 0){
+                    ret = False;
+                    break;
+                }
+            }
+            FutexWait(&sequence, start, remaining);
+        }
+        __sync_fetch_and_sub(&waiters, 1);
+        return ret;
+    }
+
+    /** Waits for a Post. Returns False if the timeout expired */
+    bool Wait(TimeoutType msecTimeout = TTInfiniteWait){
+        return WaitUsec(FutexTimeoutUsec(msecTimeout));
+    }
+
+    /** Resets the semaphore and then waits */
+    bool ResetWait(TimeoutType msecTimeout = TTInfiniteWait){
+        Reset();
+        return Wait(msecTimeout);
+    }
+
+    /** Resets the semaphore and then waits */
+    bool ResetWaitUsec(int64 usecTimeout){
+        Reset();
+        return WaitUsec(usecTimeout);
+    }
+
+    /** Releases all the waiters. The semaphore stays posted until Reset */
+    bool Post(void){
+        if(posted != 0) return True;
+        posted = 1;
+        __sync_fetch_and_add(&sequence, 1);
+        if(waiters > 0) FutexWake(&sequence, INT_MAX);
+        return True;
+    }
+
+    /** Makes the following Wait calls block */
+    bool Reset(void){
+        posted = 0;
+        return True;
+    }
+
+    /** EventSem interface */
+    inline bool fastWait(TimeoutType msecTimeout = TTInfiniteWait){
+        return Wait(msecTimeout);
+    }
+
+    /** EventSem interface */
+    inline bool fastPost(void){
+        return Post();
+    }
+
+    /** EventSem interface */
+    inline bool fastReset(void){
+        return Reset();
+    }
+};
+
+#else
+
+/** An EventSem where the futex is not available */
+class FutexEventSem: public EventSem {
+public:
+    bool WaitUsec(int64 usecTimeout){
+        if(usecTimeout == FUTEX_INFINITE_WAIT) return Wait(TTInfiniteWait);
+        return Wait(TimeoutType((uint32)((usecTimeout + 999) / 1000)));
+    }
+
+    bool ResetWaitUsec(int64 usecTimeout){
+        Reset();
+        return WaitUsec(usecTimeout);
+    }
+};
+
+#endif
+
+#endif
@@ -0,0 +1,167 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * A mutual exclusion semaphore which polls for a short time and then
+ * sleeps in the kernel (futex) until the owner releases it.
+ * Unlike FastPollingMutexSem a contended waiter does not sleep for a
+ * full millisecond and the owner wakes exactly one waiter. Locking and
+ * unlocking an uncontended semaphore are a single atomic instruction.
+ * The semaphore is not recursive and only works within a process.
+ * It offers both the FastPollingMutexSem and the MutexSem interfaces, so
+ * that a user can switch with a typedef. Where the futex is not available
+ * it is a FastPollingMutexSem.
+ */
+#ifndef FUTEX_MUTEX_SEM
+#define FUTEX_MUTEX_SEM
+
+#include "GenDefs.h"
+#include "Futex.h"
+#include "FastPollingMutexSem.h"
+
+#if defined(FUTEX_SUPPORTED)
+
+class FutexMutexSem {
+private:
+    /** 0 unlocked, 1 locked, 2 locked and some thread may be sleeping */
+    volatile int32 state;
+
+public:
+    /** The constructor */
+    FutexMutexSem(){
+        state = 0;
+    }
+
+    /** Initializes the semaphore and readies it. */
+    bool Create(bool locked = False){
+        state = (locked == True) ? 1 : 0;
+        return True;
+    }
+
+    /** Undo semaphore initialization. */
+    bool Close(){
+        return True;
+    }
+
+    /** returns the status of the semaphore */
+    inline bool Locked(){
+        return (state != 0);
+    }
+
+    /** Locks the semaphore.
+        @param usecTimeout Microseconds, FUTEX_INFINITE_WAIT or 0 to only poll
+        @return False if the timeout expired */
+    inline bool FastLockUsec(int64 usecTimeout){
+        if(__sync_bool_compare_and_swap(&state, 0, 1)) return True;
+        for(int32 i = FutexSpinCount(); i > 0; i--){
+            FutexCPURelax();
+            if((state == 0) && __sync_bool_compare_and_swap(&state, 0, 1)) return True;
+        }
+        if(usecTimeout == 0) return False;
+
+        int64 deadline = 0;
+        if(usecTimeout != FUTEX_INFINITE_WAIT) deadline = FutexUsecTime() + usecTimeout;
+        // Setting 2 makes the owner wake a waiter on unlock
+        while(__sync_lock_test_and_set(&state, 2) != 0){
+            int64 remaining = FUTEX_INFINITE_WAIT;
+            if(usecTimeout != FUTEX_INFINITE_WAIT){
+                remaining = deadline - FutexUsecTime();
+                if(remaining <= 0) return False;
+            }
+            FutexWait(&state, 2, remaining);
+        }
+        return True;
+    }
+
+    /** Locks the semaphore. Returns False if the timeout expired */
+    inline bool FastLock(TimeoutType msecTimeout = TTInfiniteWait){
+        return FastLockUsec(FutexTimeoutUsec(msecTimeout));
+    }
+
+    /** Tries without waiting. */
+    inline bool FastTryLock(){
+        return __sync_bool_compare_and_swap(&state, 0, 1);
+    }
+
+    /** Unlocks the semaphore and wakes one waiter, if any */
+    inline bool FastUnLock(void){
+        if(__sync_fetch_and_sub(&state, 1) != 1){
+            state = 0;
+            FutexWake(&state, 1);
+        }
+        return True;
+    }
+
+    /** MutexSem interface */
+    inline bool Lock(TimeoutType msecTimeout = TTInfiniteWait){
+        return FastLock(msecTimeout);
+    }
+
+    /** MutexSem interface */
+    inline bool LockUsec(int64 usecTimeout){
+        return FastLockUsec(usecTimeout);
+    }
+
+    /** MutexSem interface */
+    inline bool TryLock(){
+        return FastTryLock();
+    }
+
+    /** MutexSem interface */
+    inline bool UnLock(void){
+        return FastUnLock();
+    }
+};
+
+#else
+
+/** Polls with a millisecond sleep where the futex is not available */
+class FutexMutexSem: public FastPollingMutexSem {
+public:
+    inline bool FastLockUsec(int64 usecTimeout){
+        if(usecTimeout == FUTEX_INFINITE_WAIT) return FastLock(TTInfiniteWait);
+        return FastLock(TimeoutType((uint32)((usecTimeout + 999) / 1000)));
+    }
+
+    inline bool Lock(TimeoutType msecTimeout = TTInfiniteWait){
+        return FastLock(msecTimeout);
+    }
+
+    inline bool LockUsec(int64 usecTimeout){
+        return FastLockUsec(usecTimeout);
+    }
+
+    inline bool TryLock(){
+        return FastTryLock();
+    }
+
+    inline bool UnLock(void){
+        return FastUnLock();
+    }
+};
+
+#endif
+
+#endif
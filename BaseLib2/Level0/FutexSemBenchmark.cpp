@@ -0,0 +1,211 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Compares FutexMutexSem with FastPollingMutexSem and MutexSem, and
+ * FutexEventSem with EventSem:
+ * - lock throughput of 1 to 8 threads incrementing a shared counter;
+ * - round trip time of two threads waking each other with two events;
+ * - cost of a Post without waiters;
+ * - accuracy of a short timed wait.
+ * Usage: FutexSemBenchmark.ex [locksPerTest] [roundTrips]
+ */
+
+#include "System.h"
+#include "FastPollingMutexSem.h"
+#include "MutexSem.h"
+#include "EventSem.h"
+#include "FutexMutexSem.h"
+#include "FutexEventSem.h"
+#include "Threads.h"
+#include "HRT.h"
+#include "Sleep.h"
+#include "Atomic.h"
+
+/** State shared by the threads of a lock test */
+template <class Mutex>
+struct LockContext{
+    Mutex          *mutex;
+    int32           locksPerThread;
+    volatile int32  started;
+    volatile int32  go;
+    volatile int32  finished;
+    /** Protected by mutex */
+    int32           counter;
+};
+
+template <class Mutex>
+void LockThread(void *arg){
+    LockContext<Mutex> *context = (LockContext<Mutex> *)arg;
+    Atomic::Increment(&context->started);
+    while (!context->go) SleepMsec(0);
+    for (int32 i = 0; i < context->locksPerThread; i++){
+        context->mutex->FastLock();
+        context->counter++;
+        context->mutex->FastUnLock();
+    }
+    Atomic::Increment(&context->finished);
+}
+
+/** Increments a counter from nOfThreads threads */
+template <class Mutex>
+void RunLockTest(const char *name, int32 nOfThreads, int32 nOfLocks){
+    Mutex mutex;
+    mutex.Create();
+    LockContext<Mutex> context;
+    context.mutex          = &mutex;
+    context.locksPerThread = nOfLocks / nOfThreads;
+    context.started        = 0;
+    context.go             = 0;
+    context.finished       = 0;
+    context.counter        = 0;
+    int32 total = context.locksPerThread * nOfThreads;
+
+    for (int32 i = 0; i < nOfThreads; i++){
+        Threads::BeginThread(LockThread<Mutex>, &context, THREADS_DEFAULT_STACKSIZE, "Locker");
+    }
+    while (context.started < nOfThreads) SleepMsec(1);
+
+    int64 start = HRT::HRTCounter();
+    context.go = 1;
+    while (context.finished < nOfThreads) SleepMsec(1);
+    double elapsed = (HRT::HRTCounter() - start) * HRT::HRTPeriod();
+
+    printf("%-20s threads = %d: %10.0f locks/s %s\n", name, nOfThreads, total / elapsed, (context.counter == total) ? "" : "COUNTER MISMATCH");
+    mutex.Close();
+}
+
+/** State shared by the two threads of a ping pong test */
+template <class Event>
+struct PingPongContext{
+    Event           ping;
+    Event           pong;
+    int32           roundTrips;
+    volatile int32  finished;
+};
+
+template <class Event>
+void PongThread(void *arg){
+    PingPongContext<Event> *context = (PingPongContext<Event> *)arg;
+    for (int32 i = 0; i < context->roundTrips; i++){
+        if (!context->ping.Wait(1000)) break;
+        context->ping.Reset();
+        context->pong.Post();
+    }
+    Atomic::Increment(&context->finished);
+}
+
+/** Measures the time taken to wake a thread and to be woken back */
+template <class Event>
+void RunPingPongTest(const char *name, int32 roundTrips){
+    PingPongContext<Event> context;
+    context.ping.Create();
+    context.pong.Create();
+    context.ping.Reset();
+    context.pong.Reset();
+    context.roundTrips = roundTrips;
+    context.finished   = 0;
+
+    Threads::BeginThread(PongThread<Event>, &context, THREADS_DEFAULT_STACKSIZE, "Pong");
+    SleepMsec(10);
+
+    double maxUsec = 0.0;
+    int32  done    = 0;
+    int64  start   = HRT::HRTCounter();
+    for (; done < roundTrips; done++){
+        int64 sent = HRT::HRTCounter();
+        context.ping.Post();
+        if (!context.pong.Wait(1000)) break;
+        context.pong.Reset();
+        double usec = (HRT::HRTCounter() - sent) * HRT::HRTPeriod() * 1e6;
+        if (usec > maxUsec) maxUsec = usec;
+    }
+    double elapsed = (HRT::HRTCounter() - start) * HRT::HRTPeriod();
+    while (context.finished == 0) SleepMsec(1);
+
+    printf("%-20s round trips = %d: mean = %8.2f us max = %10.2f us %s\n", name, done, elapsed * 1e6 / done, maxUsec, (done == roundTrips) ? "" : "TIMEOUT");
+    context.ping.Close();
+    context.pong.Close();
+}
+
+/** Measures Post and Reset when nobody is waiting */
+template <class Event>
+void RunPostTest(const char *name, int32 nOfPosts){
+    Event event;
+    event.Create();
+    int64 start = HRT::HRTCounter();
+    for (int32 i = 0; i < nOfPosts; i++){
+        event.Post();
+        event.Reset();
+    }
+    double elapsed = (HRT::HRTCounter() - start) * HRT::HRTPeriod();
+    printf("%-20s Post + Reset without waiters: %8.1f ns\n", name, elapsed * 1e9 / nOfPosts);
+    event.Close();
+}
+
+/** Measures how long a wait on an event which is never posted lasts */
+void RunTimedWaitTest(int32 nOfWaits){
+    EventSem      event;
+    FutexEventSem futexEvent;
+    event.Create();
+    event.Reset();
+    futexEvent.Create();
+
+    int64 start = HRT::HRTCounter();
+    for (int32 i = 0; i < nOfWaits; i++) event.Wait(1);
+    double elapsed = (HRT::HRTCounter() - start) * HRT::HRTPeriod();
+    printf("%-20s Wait(1 ms):         mean = %8.1f us\n", "EventSem", elapsed * 1e6 / nOfWaits);
+
+    start = HRT::HRTCounter();
+    for (int32 i = 0; i < nOfWaits; i++) futexEvent.WaitUsec(100);
+    elapsed = (HRT::HRTCounter() - start) * HRT::HRTPeriod();
+    printf("%-20s WaitUsec(100 us):   mean = %8.1f us\n", "FutexEventSem", elapsed * 1e6 / nOfWaits);
+    event.Close();
+}
+
+int main(int argc, char **argv){
+    int32 nOfLocks   = (argc > 1) ? atoi(argv[1]) : 2000000;
+    int32 roundTrips = (argc > 2) ? atoi(argv[2]) : 20000;
+    if ((nOfLocks < 8) || (roundTrips < 1)){
+        printf("Usage: FutexSemBenchmark.ex [locksPerTest] [roundTrips]\n");
+        return -1;
+    }
+
+    const int32 threads[] = {1, 2, 4, 8};
+    for (uint32 i = 0; i < sizeof(threads) / sizeof(threads[0]); i++){
+        RunLockTest<FastPollingMutexSem>("FastPollingMutexSem", threads[i], nOfLocks);
+        RunLockTest<MutexSem>("MutexSem", threads[i], nOfLocks);
+        RunLockTest<FutexMutexSem>("FutexMutexSem", threads[i], nOfLocks);
+    }
+
+    RunPingPongTest<EventSem>("EventSem", roundTrips);
+    RunPingPongTest<FutexEventSem>("FutexEventSem", roundTrips);
+
+    RunPostTest<EventSem>("EventSem", nOfLocks);
+    RunPostTest<FutexEventSem>("FutexEventSem", nOfLocks);
+
+    RunTimedWaitTest(200);
+    return 0;
+}
@@ -38,3 +38,13 @@ void ProcessorTypeSetDefaultCPUs(uint32 mask){
     ProcessorType::defaultCPUs = mask;
 }
 
+uint32 ProcessorType::reservedCPUs = 0;
+
+uint32 ProcessorTypeGetReservedCPUs(){
+    return ProcessorType::reservedCPUs;
+}
+
+void ProcessorTypeSetReservedCPUs(uint32 mask){
+    ProcessorType::reservedCPUs = mask;
+}
+
@@ -36,6 +36,8 @@ extern "C"
 {
     uint32 ProcessorTypeGetDefaultCPUs();
     void   ProcessorTypeSetDefaultCPUs(uint32 defaultMask);
+    uint32 ProcessorTypeGetReservedCPUs();
+    void   ProcessorTypeSetReservedCPUs(uint32 reservedMask);
 }
 
 class ProcessorType{
@@ -46,9 +48,14 @@ public:
     /** The default CPU mask. Initialised to zero.*/
     static uint32 defaultCPUs;
 
+    /** The CPUs reserved to the real time threads. Initialised to zero.*/
+    static uint32 reservedCPUs;
+
 public:
     friend uint32 ProcessorTypeGetDefaultCPUs();
     friend void   ProcessorTypeSetDefaultCPUs(uint32 mask);
+    friend uint32 ProcessorTypeGetReservedCPUs();
+    friend void   ProcessorTypeSetReservedCPUs(uint32 mask);
 
 #if !defined (_CINT)
     /** Constructor from integer
@@ -111,6 +118,25 @@ public:
     static void SetDefaultCPUs(const uint32 mask){
         ProcessorTypeSetDefaultCPUs(mask);
     }
+
+    static uint32 GetReservedCPUs(){
+        return ProcessorTypeGetReservedCPUs();
+    }
+
+    /** The threads started with Threads::BeginThread are kept off these CPUs,
+        unless they are explicitly started only on reserved CPUs */
+    static void SetReservedCPUs(const uint32 mask){
+        ProcessorTypeSetReservedCPUs(mask);
+    }
+
+    /** Removes the reserved CPUs from a mask which also contains non reserved CPUs */
+    static uint32 ExcludeReservedCPUs(const uint32 mask){
+        uint32 reserved = ProcessorTypeGetReservedCPUs();
+        if((mask & ~reserved) == 0){
+            return mask;
+        }
+        return (mask & ~reserved);
+    }
 };
 
 /** Declares that the number of CPUs is undefined or there is no interest
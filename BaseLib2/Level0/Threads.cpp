@@ -383,6 +383,7 @@ TID  ThreadsBeginThread(ThreadFunctionType function,
             runOnCPUs = 0xff;
         }
     }
+    runOnCPUs = ProcessorType::ExcludeReservedCPUs(runOnCPUs.processorMask);
 
     if (threadInitialisationInterfaceConstructor == NULL){
         CStaticAssertErrorCondition(ParametersError,"Threads::ThreadsBeginThread (%s) threadInitialisationInterfaceConstructor is NULL",name);
@@ -614,6 +615,25 @@ int32 ThreadsGetCPUs(TID tid){
     return cpus;
 }
 
+void ThreadsApplyReservedCPUs(){
+#if defined(_LINUX) && defined(USE_PTHREAD)
+    TDB_Lock();
+    int n = TDB_NumberOfThreads();
+    for(int i = 0; i < n; i++){
+        TID   tid  = TDB_GetThreadID(i);
+        int32 cpus = ThreadsGetCPUs(tid);
+        if(cpus == -1){
+            continue;
+        }
+        uint32 allowed = ProcessorType::ExcludeReservedCPUs((uint32)cpus);
+        if(allowed != (uint32)cpus){
+            pthread_setaffinity_np(tid, sizeof(allowed), (cpu_set_t *)&allowed);
+        }
+    }
+    TDB_UnLock();
+#endif
+}
+
 int ThreadsGetPriority(TID tid){
     int priority = -1;
 #if defined(_RTAI)
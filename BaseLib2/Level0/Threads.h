@@ -97,6 +97,9 @@ extern "C"
     /** Returns the a mask with the CPU(s) where the task is running*/
     int32 ThreadsGetCPUs(TID tid);
 
+    /** Moves the running threads off the CPUs reserved with ProcessorType::SetReservedCPUs */
+    void ThreadsApplyReservedCPUs();
+
     /**
      * Returns the task state. This can be a masked combination of any of the
      * defined THREAD_STATE. So for instance a value of "6" means:
@@ -258,6 +261,12 @@ public:
         return TDB_GetName();
     }
 
+    /** Moves the running threads off the reserved CPUs. The threads
+        running only on reserved CPUs are not moved */
+    static void ApplyReservedCPUs(){
+        ThreadsApplyReservedCPUs();
+    }
+
 }; // end class Thread
 
 #undef THREADS_LOCAL
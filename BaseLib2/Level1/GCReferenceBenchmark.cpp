@@ -0,0 +1,168 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Copies GCReferences from 1 to 8 threads and reports, for each number of
+ * threads, the mean cost of a copy (one increment and one decrement of the
+ * reference counter) and the worst copy seen by any thread:
+ * - all the threads copying a reference to the same object;
+ * - each thread copying a reference to its own object;
+ * - the former scheme, a process-wide FastPollingMutexSem around the counter.
+ * Usage: GCReferenceBenchmark.ex [copiesPerThread]
+ */
+
+#include "System.h"
+#include "GCRTemplate.h"
+#include "GCNamedObject.h"
+#include "FastPollingMutexSem.h"
+#include "Threads.h"
+#include "HRT.h"
+#include "Sleep.h"
+#include "Atomic.h"
+
+/** Largest number of threads tested */
+static const int32 maxThreads = 8;
+
+/** The process-wide lock of the former GCIncrement and GCDecrement */
+static FastPollingMutexSem globalLock;
+
+/** State shared by the threads of a test */
+struct CopyContext{
+    /** The reference copied by each thread */
+    GCReference     references[maxThreads];
+    /** Counter updated under globalLock when lockedCounter is True */
+    volatile int32  counter;
+    bool            lockedCounter;
+    int32           copiesPerThread;
+    volatile int32  started;
+    volatile int32  go;
+    volatile int32  finished;
+    /** Longest copy of each thread, in HRT ticks */
+    int64           worstTicks[maxThreads];
+    /** Used to give each thread its index */
+    volatile int32  nextIndex;
+};
+
+/** Emulates one increment and one decrement under the former global lock */
+static inline void LockedCopy(volatile int32 &counter){
+    globalLock.FastLock();
+    ++counter;
+    globalLock.FastUnLock();
+    globalLock.FastLock();
+    --counter;
+    globalLock.FastUnLock();
+}
+
+void CopyThread(void *arg){
+    CopyContext *context = (CopyContext *)arg;
+    int32 index = Atomic::AddAndFetch(&context->nextIndex, 1) - 1;
+    int64 worst = 0;
+    Atomic::Increment(&context->started);
+    while (!context->go) SleepMsec(0);
+    for (int32 i = 0; i < context->copiesPerThread; i++){
+        int64 start = HRT::HRTCounter();
+        if (context->lockedCounter){
+            LockedCopy(context->counter);
+        }
+        else{
+            GCReference copy(context->references[index]);
+        }
+        int64 ticks = HRT::HRTCounter() - start;
+        if (ticks > worst) worst = ticks;
+    }
+    context->worstTicks[index] = worst;
+    Atomic::Increment(&context->finished);
+}
+
+/**
+ * Runs nOfThreads threads copying the references of context.
+ * The mean includes the two HRT reads taken around each copy.
+ */
+void RunCopyTest(const char *name, CopyContext &context, int32 nOfThreads, int32 copiesPerThread){
+    context.copiesPerThread = copiesPerThread;
+    context.counter         = 0;
+    context.started         = 0;
+    context.go              = 0;
+    context.finished        = 0;
+    context.nextIndex       = 0;
+
+    for (int32 i = 0; i < nOfThreads; i++){
+        Threads::BeginThread(CopyThread, &context, THREADS_DEFAULT_STACKSIZE, "Copier");
+    }
+    while (context.started < nOfThreads) SleepMsec(1);
+
+    int64 start = HRT::HRTCounter();
+    context.go = 1;
+    while (context.finished < nOfThreads) SleepMsec(1);
+    double elapsed = (HRT::HRTCounter() - start) * HRT::HRTPeriod();
+
+    int64 worst = 0;
+    for (int32 i = 0; i < nOfThreads; i++){
+        if (context.worstTicks[i] > worst) worst = context.worstTicks[i];
+    }
+    // the threads run concurrently: the cost per copy is seen by each of them
+    double nsPerCopy = elapsed * 1e9 / copiesPerThread;
+    printf("%-20s threads = %d: %8.1f ns/copy worst = %10.2f us\n", name, nOfThreads, nsPerCopy, worst * HRT::HRTPeriod() * 1e6);
+}
+
+int main(int argc, char **argv){
+    int32 copiesPerThread = (argc > 1) ? atoi(argv[1]) : 1000000;
+    if (copiesPerThread < 1){
+        printf("Usage: GCReferenceBenchmark.ex [copiesPerThread]\n");
+        return -1;
+    }
+    globalLock.Create();
+
+    GCRTemplate<GCNamedObject> shared(GCFT_Create);
+    CopyContext sharedContext;
+    sharedContext.lockedCounter = False;
+
+    CopyContext privateContext;
+    privateContext.lockedCounter = False;
+
+    CopyContext lockedContext;
+    lockedContext.lockedCounter = True;
+
+    for (int32 i = 0; i < maxThreads; i++){
+        sharedContext.references[i] = shared;
+        GCRTemplate<GCNamedObject> own(GCFT_Create);
+        privateContext.references[i] = own;
+    }
+
+    const int32 threads[] = {1, 2, 4, 8};
+    for (uint32 i = 0; i < sizeof(threads) / sizeof(threads[0]); i++){
+        RunCopyTest("Shared object", sharedContext, threads[i], copiesPerThread);
+        RunCopyTest("Private objects", privateContext, threads[i], copiesPerThread);
+        RunCopyTest("Global lock", lockedContext, threads[i], copiesPerThread);
+    }
+
+    int32 expected = maxThreads + 1;
+    if (shared.NumberOfReferences() != expected){
+        printf("REFERENCE COUNT MISMATCH: %d instead of %d\n", shared.NumberOfReferences(), expected);
+        return -1;
+    }
+    globalLock.Close();
+    return 0;
+}
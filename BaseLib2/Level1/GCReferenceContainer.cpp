@@ -46,7 +46,8 @@ bool GCRCFind(
             int                             index,
             bool                            remove,
             bool                            recurse,
-            const char **                   unMatched){
+            const char **                   unMatched,
+            bool                            pathCached){
 
     LinkedListable *ll = NULL;
 
@@ -64,6 +65,7 @@ bool GCRCFind(
         // get the LinkedListable;
         if (remove){
             ll = gcrc.list.ListExtract(index);
+            if ((ll != NULL) && gcrc.nameIndexed) GODBPathCacheInvalidate();
         } else {
             ll = gcrc.list.ListPeek(index);
         }
@@ -106,6 +108,9 @@ bool GCRCFind(
 
         bool isUniqueName = (name[0] == '(');
 
+        // the cached result of the search now depends on the content of this container
+        if (pathCached) gcrc.nameIndexed = True;
+
 //        if (!isUniqueName){
             // separate name
             int index = 0;
@@ -176,7 +181,7 @@ bool GCRCFind(
                                 /* recurse is set to False because we already have matched part of the string and the rest must follow */
                                 gc = gcrtgcrc->_Remove(extraName/*.Buffer()*/, NULL, -1 , /*recurse*/False);
                             } else {
-                                gc = gcrtgcrc->_Find(extraName/*.Buffer()*/, NULL, -1 , /*recurse*/ False,unMatched);
+                                gc = gcrtgcrc->_Find(extraName/*.Buffer()*/, NULL, -1 , /*recurse*/ False,unMatched,pathCached);
                             }
                             // exit if found
                             if (gc.IsValid()) return True;
@@ -206,7 +211,7 @@ bool GCRCFind(
                         if (remove) {
                             ref = gcrtgcrc->_Remove(name, NULL, -1 , recurse);
                         } else {
-                            ref = gcrtgcrc->_Find(name, NULL, -1 , recurse);
+                            ref = gcrtgcrc->_Find(name, NULL, -1 , recurse, NULL, pathCached);
                         }
 
                         // exit if found
@@ -665,6 +670,7 @@ GCRCInsert(
     }
     if (position == -1) gcrc.list.ListAdd(ll);
     else                gcrc.list.ListInsert(ll,position);
+    if (gcrc.nameIndexed) GODBPathCacheInvalidate();
     return True;
 }
 
@@ -119,6 +119,8 @@ extern "C" {
             way back out of recursion by returning SFTTFound in this last case
         @param partialMatch if not NULL then a partial match will be accepted i.e. xxx.yyy
             a partial match xxx.yyy will take priority over a recursive one if @param recursive is True
+        @param pathCached set by the GODB path cache: the containers searched by name
+            are marked so that their changes invalidate the cache
         */
 
     bool GCRCFind(              GCReferenceContainer &          gcrc,
@@ -128,7 +130,8 @@ extern "C" {
                                 int                             index       =   -1,
                                 bool                            remove      =   False,
                                 bool                            recurse     =   False,
-                                const char **                   unMatched   =   NULL);
+                                const char **                   unMatched   =   NULL,
+                                bool                            pathCached  =   False);
 
     /** */
     bool GCRCObjectLoadSetup(GCReferenceContainer &gcrc,ConfigurationDataBase &info,StreamInterface *err);
@@ -142,6 +145,10 @@ extern "C" {
     /** */
     bool GCRCIterate(GCReferenceContainer &gcrc,IteratorT<GCReference> * iterator,bool recurse);
 
+    /** Discards the paths cached by GODBFindByName. Called when a container
+        which has been searched by name changes. See GlobalObjectDataBase.h */
+    void GODBPathCacheInvalidate();
+
 }
 
 
@@ -152,7 +159,7 @@ OBJECT_DLL(GCReferenceContainer)
     they can be accessed by name */
 class GCReferenceContainer: public GCNamedObject{
 
-    friend bool GCRCFind(GCReferenceContainer &gcrc,GCReference &gc,const char *name,SearchFilterT<GCReference> * selector,int index,bool remove,bool recurse,const char **unMatched);
+    friend bool GCRCFind(GCReferenceContainer &gcrc,GCReference &gc,const char *name,SearchFilterT<GCReference> * selector,int index,bool remove,bool recurse,const char **unMatched,bool pathCached);
 
     friend bool GCRCObjectLoadSetup(GCReferenceContainer &gcrc,ConfigurationDataBase &info,StreamInterface *err);
 
@@ -169,9 +176,10 @@ OBJECT_DLL_STUFF(GCReferenceContainer)
                                 SearchFilterT<GCReference> *    selector    =   NULL,
                                 int                             index       =   -1,
                                 bool                            recurse     =   False,
-                                const char **                   unMatched   =   NULL){
+                                const char **                   unMatched   =   NULL,
+                                bool                            pathCached  =   False){
         GCReference gc;
-        GCRCFind(*this,gc,name,selector,index,False,recurse,unMatched);
+        GCRCFind(*this,gc,name,selector,index,False,recurse,unMatched,pathCached);
         return gc;
     }
 
@@ -196,6 +204,10 @@ protected:
     /** timeout  */
     TimeoutType                     msecTimeout;
 
+    /** True once the container has been searched by the GODB path cache:
+        from then on any change invalidates the cache */
+    bool                            nameIndexed;
+
     /**  */
     LinkedListable *  CreateListElement(
                         const char *                objectPath,
@@ -208,6 +220,7 @@ public:
     {
         mux.Create();
         msecTimeout = TTInfiniteWait;
+        nameIndexed = False;
     }
 
     /** */
@@ -279,6 +292,7 @@ public:
     inline      bool                CleanUp()
     {
         list.CleanUp();
+        if (nameIndexed) GODBPathCacheInvalidate();
         return True;
     }
 
@@ -23,25 +23,16 @@
 **/
 
 #include "GarbageCollectable.h"
-#include "MutexSem.h"
+#include "Atomic.h"
 
-static FastPollingMutexSem lock;
+/* The counters are updated with a locked fetch-and-add so that
+   copying references from several threads never serialises on a
+   process-wide semaphore (which would sleep when contended). */
 
 int32 GCDecrement(GarbageCollectable &gc){
-    int32 ret;
-    lock.FastLock();
-//    Atomic::Decrement(&(gc.referenceCounter));
-    ret = --gc.referenceCounter;
-    lock.FastUnLock();
-    return ret;
+    return Atomic::AddAndFetch(&(gc.referenceCounter), -1);
 }
 
 int32 GCIncrement(GarbageCollectable &gc){
-    int32 ret;
-    lock.FastLock();
-//    Atomic::Decrement(&(gc.referenceCounter));
-    ret = ++gc.referenceCounter;
-    lock.FastUnLock();
-    return ret;
+    return Atomic::AddAndFetch(&(gc.referenceCounter), 1);
 }
-
@@ -72,13 +72,11 @@ public:
     /** Used to atomically increment the reference counter. */
     int32 Increment(){
         return GCIncrement(*this);
-        //Atomic::Increment(&referenceCounter);};
     }
 
     /** Used to atomically decrement the reference counter. */
     int32 Decrement(){
         return GCDecrement(*this);
-        //Atomic::Decrement(&referenceCounter);
     };
 
     /** To allow cloning of objects using references the final class must implement clone. */
@@ -24,6 +24,7 @@
 
 #include "GlobalObjectDataBase.h"
 #include "FastPollingMutexSem.h"
+#include "MutexSem.h"
 
 class GlobalObjectDataBase: public GCReferenceContainer{
 
@@ -44,6 +45,269 @@ public:
 
 };
 
+/** Number of buckets of the path cache. A power of 2 */
+static const uint32 GODB_PATH_CACHE_BUCKETS     = 1024;
+
+/** When the cache reaches this size it is emptied */
+static const uint32 GODB_PATH_CACHE_MAX_ENTRIES = 4096;
+
+/** A path resolved by GODBFindByName */
+class GODBPathCacheItem{
+public:
+    /** Hash of name, recurse and partial */
+    uint32              hash;
+
+    /** The name searched */
+    char *              name;
+
+    /** The search was recursive */
+    bool                recurse;
+
+    /** A partial match was allowed */
+    bool                partial;
+
+    /** Position in name of the unmatched part. -1 if fully matched */
+    int32               unMatchedOffset;
+
+    /** The object found */
+    GCReference         reference;
+
+    /** Lookups answered by this item */
+    uint32              hits;
+
+    /** Next item in the bucket */
+    GODBPathCacheItem * next;
+
+    GODBPathCacheItem(){
+        hash            = 0;
+        name            = NULL;
+        recurse         = False;
+        partial         = False;
+        unMatchedOffset = -1;
+        hits            = 0;
+        next            = NULL;
+    }
+
+    ~GODBPathCacheItem(){
+        if (name != NULL) free((void *&)name);
+    }
+};
+
+/** Hash table of the paths of the GlobalObjectDataBase */
+class GODBPathCache{
+private:
+    /** The chains of items */
+    GODBPathCacheItem * buckets[GODB_PATH_CACHE_BUCKETS];
+
+    /** Protects the table and the counters */
+    MutexSem            mux;
+
+    /** Incremented at each invalidation. A lookup which walked the tree
+        stores its result only if no invalidation happened meanwhile */
+    uint32              generation;
+
+    /** The counters */
+    GODBPathCacheStatistics statistics;
+
+    /** FNV-1a */
+    static uint32 Hash(const char *name,bool recurse,bool partial){
+        uint32 hash = 2166136261u;
+        while (*name != 0){
+            hash ^= (uint8)*name++;
+            hash *= 16777619u;
+        }
+        if (recurse) hash ^= 0x1;
+        if (partial) hash ^= 0x2;
+        return hash;
+    }
+
+    /** Searches the table. To be called with mux locked */
+    GODBPathCacheItem *Search(uint32 hash,const char *name,bool recurse,bool partial){
+        GODBPathCacheItem *item = buckets[hash & (GODB_PATH_CACHE_BUCKETS - 1)];
+        while (item != NULL){
+            if ((item->hash == hash) && (item->recurse == recurse) && (item->partial == partial) && (strcmp(item->name,name) == 0)) return item;
+            item = item->next;
+        }
+        return NULL;
+    }
+
+    /** Removes all the items from the table and returns them as a list.
+        To be called with mux locked */
+    GODBPathCacheItem *Detach(){
+        GODBPathCacheItem *list = NULL;
+        for (uint32 i = 0; i < GODB_PATH_CACHE_BUCKETS; i++){
+            while (buckets[i] != NULL){
+                GODBPathCacheItem *item = buckets[i];
+                buckets[i] = item->next;
+                item->next = list;
+                list = item;
+            }
+        }
+        statistics.entries = 0;
+        return list;
+    }
+
+    /** Deletes a detached list. Called without the lock, as releasing
+        the references may destroy objects and containers */
+    static void Release(GODBPathCacheItem *list){
+        while (list != NULL){
+            GODBPathCacheItem *item = list;
+            list = list->next;
+            delete item;
+        }
+    }
+
+public:
+
+    GODBPathCache(){
+        for (uint32 i = 0; i < GODB_PATH_CACHE_BUCKETS; i++) buckets[i] = NULL;
+        generation               = 0;
+        statistics.lookups       = 0;
+        statistics.hits          = 0;
+        statistics.misses        = 0;
+        statistics.invalidations = 0;
+        statistics.entries       = 0;
+        statistics.enabled       = True;
+        mux.Create();
+    }
+
+    ~GODBPathCache(){
+        Release(Detach());
+        mux.Close();
+    }
+
+    /** See GODBPathCacheFind */
+    bool Find(const char *name,GCReference &gc,bool recurse,const char **unMatched){
+        bool   partial = (unMatched != NULL);
+        uint32 hash    = Hash(name,recurse,partial);
+        uint32 startGeneration;
+
+        if (!mux.Lock()) {
+            CStaticAssertErrorCondition(Timeout,"GODBPathCacheFind(%s): timeout on resource sharing",name);
+            return False;
+        }
+        statistics.lookups++;
+        bool enabled = statistics.enabled;
+        if (enabled){
+            GODBPathCacheItem *item = Search(hash,name,recurse,partial);
+            if (item != NULL){
+                item->hits++;
+                statistics.hits++;
+                gc = item->reference;
+                if (item->unMatchedOffset >= 0) *unMatched = name + item->unMatchedOffset;
+                mux.UnLock();
+                return True;
+            }
+        }
+        statistics.misses++;
+        startGeneration = generation;
+        mux.UnLock();
+
+        const char *unMatchedPart = NULL;
+        // marks the containers searched, whose changes must invalidate the cache
+        GCRTemplate<GCReferenceContainer> godb = GetGlobalObjectDataBase();
+        if (!godb.IsValid()) return False;
+        GCRCFind(*(godb.operator->()),gc,name,NULL,-1,False,recurse,(partial ? &unMatchedPart : NULL),True);
+        if (!gc.IsValid()) return False;
+        if (unMatchedPart != NULL) *unMatched = unMatchedPart;
+        if (!enabled) return True;
+
+        GODBPathCacheItem *item = new GODBPathCacheItem;
+        item->name = strdup(name);
+        if (item->name == NULL){
+            delete item;
+            return True;
+        }
+        item->hash            = hash;
+        item->recurse         = recurse;
+        item->partial         = partial;
+        item->unMatchedOffset = (unMatchedPart != NULL) ? (int32)(unMatchedPart - name) : -1;
+        item->reference       = gc;
+
+        GODBPathCacheItem *discarded = NULL;
+        if (!mux.Lock()) {
+            delete item;
+            return True;
+        }
+        // the tree changed while it was searched or another thread got there first
+        if ((generation != startGeneration) || !statistics.enabled || (Search(hash,name,recurse,partial) != NULL)){
+            discarded = item;
+        } else {
+            if (statistics.entries >= GODB_PATH_CACHE_MAX_ENTRIES){
+                discarded = Detach();
+                statistics.invalidations++;
+            }
+            GODBPathCacheItem **bucket = &buckets[hash & (GODB_PATH_CACHE_BUCKETS - 1)];
+            item->next = *bucket;
+            *bucket    = item;
+            statistics.entries++;
+        }
+        mux.UnLock();
+        Release(discarded);
+        return True;
+    }
+
+    /** See GODBPathCacheInvalidate */
+    void Invalidate(){
+        if (!mux.Lock()) {
+            CStaticAssertErrorCondition(Timeout,"GODBPathCacheInvalidate: timeout on resource sharing");
+            return;
+        }
+        generation++;
+        GODBPathCacheItem *discarded = NULL;
+        if (statistics.entries > 0){
+            discarded = Detach();
+            statistics.invalidations++;
+        }
+        mux.UnLock();
+        Release(discarded);
+    }
+
+    /** See GODBPathCacheEnable */
+    void Enable(bool enable){
+        if (!mux.Lock()) return;
+        statistics.enabled = enable;
+        generation++;
+        GODBPathCacheItem *discarded = NULL;
+        if (!enable) discarded = Detach();
+        mux.UnLock();
+        Release(discarded);
+    }
+
+    /** See GODBPathCacheGetStatistics */
+    void GetStatistics(GODBPathCacheStatistics &copy){
+        if (!mux.Lock()) return;
+        copy = statistics;
+        mux.UnLock();
+    }
+
+    /** See GODBPathCacheGetEntries */
+    uint32 GetEntries(GODBPathCacheEntry *entries,uint32 maxEntries){
+        if (!mux.Lock()) return 0;
+        uint32 n = 0;
+        for (uint32 i = 0; (i < GODB_PATH_CACHE_BUCKETS) && (n < maxEntries); i++){
+            GODBPathCacheItem *item = buckets[i];
+            while ((item != NULL) && (n < maxEntries)){
+                strncpy(entries[n].path,item->name,GODB_PATH_CACHE_NAME_SIZE - 1);
+                entries[n].path[GODB_PATH_CACHE_NAME_SIZE - 1] = 0;
+                GCRTemplate<GCNamedObject> gcno = item->reference;
+                const char *className = gcno.IsValid() ? gcno->ClassName() : "?";
+                strncpy(entries[n].className,className,GODB_PATH_CACHE_NAME_SIZE - 1);
+                entries[n].className[GODB_PATH_CACHE_NAME_SIZE - 1] = 0;
+                entries[n].hits = item->hits;
+                n++;
+                item = item->next;
+            }
+        }
+        mux.UnLock();
+        return n;
+    }
+
+};
+
+/** Declared before godbDestructor so that it is destroyed after it */
+static GODBPathCache godbPathCache;
+
 static FastPollingMutexSem godbInitMux;
 GCRTemplate<GlobalObjectDataBase> globalObjectDataBase;
 
@@ -56,6 +320,8 @@ static class GODBDestructor{
 
 public:
     ~GODBDestructor(){
+        // the cached references would keep the objects alive
+        godbPathCache.Enable(False);
         if (globalObjectDataBase.IsValid()){
 	    printf("Potentially Destroying globalObjectDataBase \n");
             globalObjectDataBase.RemoveReference();
@@ -88,3 +354,24 @@ void GlobalObjectDataBaseEnableDebugging(bool enable){
     }
 }
 
+bool GODBPathCacheFind(const char *name,GCReference &gc,bool recurse,const char **unMatched){
+    if (name == NULL) return False;
+    return godbPathCache.Find(name,gc,recurse,unMatched);
+}
+
+void GODBPathCacheInvalidate(){
+    godbPathCache.Invalidate();
+}
+
+void GODBPathCacheEnable(bool enable){
+    godbPathCache.Enable(enable);
+}
+
+void GODBPathCacheGetStatistics(GODBPathCacheStatistics &statistics){
+    godbPathCache.GetStatistics(statistics);
+}
+
+uint32 GODBPathCacheGetEntries(GODBPathCacheEntry *entries,uint32 maxEntries){
+    if (entries == NULL) return 0;
+    return godbPathCache.GetEntries(entries,maxEntries);
+}
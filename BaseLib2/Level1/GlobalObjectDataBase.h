@@ -28,6 +28,12 @@
  *
  * Only a single GlobalObjectData exists per application, if loaded with a configuration 
  * file it will to navigate, search and retrieve a reference anywhere in the tree
+ *
+ * The references found by GODBFindByName are kept in a hash table indexed by
+ * the path, so that repeated lookups of the same name (e.g. the destination of
+ * the messages) do not walk the tree. The table is emptied when any container
+ * which has been searched by name is modified (Insert, Remove, CleanUp).
+ * Renaming an object already in the tree is not detected.
  */
 
 #if !defined (GLOBAL_OBJECT_DATABASE_H)
@@ -38,7 +44,34 @@
 #include "BString.h"
 #include "Iterators.h"
 
-
+/** Counters of the GODB path cache */
+struct GODBPathCacheStatistics{
+    /** Number of GODBFindByName lookups */
+    uint32  lookups;
+    /** Lookups answered by the cache */
+    uint32  hits;
+    /** Lookups which walked the tree */
+    uint32  misses;
+    /** Number of times the cache was emptied */
+    uint32  invalidations;
+    /** Paths in the cache */
+    uint32  entries;
+    /** False if the cache is bypassed */
+    bool    enabled;
+};
+
+/** Size of the strings of GODBPathCacheEntry including the terminator */
+#define GODB_PATH_CACHE_NAME_SIZE 128
+
+/** A cached path as returned by GODBPathCacheGetEntries */
+struct GODBPathCacheEntry{
+    /** The name searched (truncated) */
+    char    path[GODB_PATH_CACHE_NAME_SIZE];
+    /** The class of the object found */
+    char    className[GODB_PATH_CACHE_NAME_SIZE];
+    /** Number of lookups answered by this entry */
+    uint32  hits;
+};
 
 extern "C" {
 
@@ -54,6 +87,20 @@ extern "C" {
         left-over objects at database destruction*/
     void GlobalObjectDataBaseEnableDebugging(bool enable);
 
+    /** Finds @param name in the GlobalObjectDataBase using the path cache.
+        Same as GetGlobalObjectDataBase()->Find(name,recurse,unMatched) */
+    bool GODBPathCacheFind(const char *name,GCReference &gc,bool recurse,const char **unMatched);
+
+    /** @param enable False empties the cache and bypasses it */
+    void GODBPathCacheEnable(bool enable);
+
+    /** Copies the counters of the cache */
+    void GODBPathCacheGetStatistics(GODBPathCacheStatistics &statistics);
+
+    /** Copies up to @param maxEntries cached paths in @param entries.
+        @return the number of entries copied */
+    uint32 GODBPathCacheGetEntries(GODBPathCacheEntry *entries,uint32 maxEntries);
+
 }
 
 /** retrieve reference to database
@@ -99,7 +146,9 @@ static inline GCReference GODBFindByName(
     // in case of unique name search the whole tree not just the root
     // the logic here was inverted and then the line was commented out...
     if ((name[0] == '(') || forceRecurseSearch) gcft = GCFT_Recurse;
-    return GetGlobalObjectDataBase()->Find(name,gcft,unMatched);
+    GCReference gc;
+    GODBPathCacheFind(name,gc,(gcft == GCFT_Recurse),unMatched);
+    return gc;
 }
 
 /** returns the global name of an object in  @param name, if there is one.
@@ -0,0 +1,390 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+#include "CDBSnapshot.h"
+#include "CDBDataTypes.h"
+#include "FString.h"
+#include "BString.h"
+
+#if defined(_LINUX) || defined(_MACOSX) || defined(_SOLARIS)
+#define CDBS_USE_MMAP
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/** A growable array of plain structures */
+template <class T>
+class CDBSArray{
+public:
+    /** The entries */
+    T      *data;
+    /** Number of entries used */
+    uint32  size;
+    /** Number of entries allocated */
+    uint32  capacity;
+
+    CDBSArray(){
+        data     = NULL;
+        size     = 0;
+        capacity = 0;
+    }
+
+    ~CDBSArray(){
+        if(data != NULL) free((void *&)data);
+    }
+
+    /** Ensures that n more entries can be added */
+    bool Reserve(uint32 n){
+        if(size + n <= capacity) return True;
+        uint32 newCapacity = (capacity < 256) ? 256 : capacity;
+        while(newCapacity < size + n) newCapacity *= 2;
+        void *oldData = (void *)data;
+        T *newData = (T *)realloc(oldData, sizeof(T) * newCapacity);
+        if(newData == NULL) return False;
+        data     = newData;
+        capacity = newCapacity;
+        return True;
+    }
+
+    /** Appends n entries */
+    bool Add(const T *entries, uint32 n){
+        if(!Reserve(n)) return False;
+        memcpy(data + size, entries, sizeof(T) * n);
+        size += n;
+        return True;
+    }
+};
+
+/** The tables of a snapshot being saved */
+struct CDBSBuilder{
+    CDBSArray<CDBSNodeEntry> nodes;
+    CDBSArray<uint32>        elements;
+    CDBSArray<char>          strings;
+    uint32                   maxElements;
+
+    CDBSBuilder(){
+        maxElements = 0;
+    }
+
+    /** Appends a string and returns its offset */
+    bool AddString(const char *s, uint32 &offset){
+        offset = strings.size;
+        return strings.Add(s, strlen(s) + 1);
+    }
+};
+
+static bool CDBSSaveChildren(ConfigurationDataBase &cdb, CDBSBuilder &builder);
+
+/** Adds the current node of cdb and its subtree to the tables */
+static bool CDBSSaveNode(ConfigurationDataBase &cdb, CDBSBuilder &builder){
+    BString name;
+    BString type;
+    if(!cdb->NodeName(name) || !cdb->NodeType(type)) return False;
+
+    CDBSNodeEntry entry;
+    entry.type         = 0;
+    entry.size         = 0;
+    entry.firstElement = builder.elements.size;
+    entry.reserved     = 0;
+    if(!builder.AddString(name.Buffer(), entry.name)) return False;
+
+    if(type == "CDBGroupNode"){
+        int32 nOfChildren = cdb->NumberOfChildren();
+        entry.type = CDBS_GROUP_NODE;
+        entry.size = (nOfChildren > 0) ? nOfChildren : 0;
+        if(!builder.nodes.Add(&entry, 1)) return False;
+        if(entry.size == 0) return True;
+        return CDBSSaveChildren(cdb, builder);
+    }
+
+    int size[1] = {1};
+    if(type == "CDBLinkNode"){
+        entry.type = CDBS_LINK_NODE;
+    } else
+    if(type == "CDBStringDataNode"){
+        int maxDim = 1;
+        if(!cdb->GetArrayDims(size, maxDim, "")) return False;
+        entry.type = CDBS_LEAF_NODE;
+    } else {
+        CStaticAssertErrorCondition(Warning, "CDBSnapshot::Save: node %s of type %s cannot be saved", name.Buffer(), type.Buffer());
+        return False;
+    }
+
+    entry.size = size[0];
+    if(entry.size > builder.maxElements) builder.maxElements = entry.size;
+    if(entry.size == 0) return builder.nodes.Add(&entry, 1);
+
+    FString *text = new FString[entry.size];
+    if(text == NULL) return False;
+    bool ok = cdb->ReadArray(text, CDBTYPE_FString, size, 1, "");
+    uint32 offset;
+    for(uint32 i = 0; ok && (i < entry.size); i++){
+        ok = builder.AddString(text[i].Buffer(), offset);
+        ok = ok && builder.elements.Add(&offset, 1);
+    }
+    delete []text;
+
+    return ok && builder.nodes.Add(&entry, 1);
+}
+
+/** Adds the children of the current node of cdb. The position is not changed */
+static bool CDBSSaveChildren(ConfigurationDataBase &cdb, CDBSBuilder &builder){
+    int32 nOfChildren = cdb->NumberOfChildren();
+    if(nOfChildren <= 0) return True;
+    if(!cdb->MoveToChildren(0)) return False;
+    bool ok = True;
+    for(int32 i = 0; ok && (i < nOfChildren); i++){
+        if(i > 0) ok = cdb->MoveToBrother(1);
+        ok = ok && CDBSSaveNode(cdb, builder);
+    }
+    cdb->MoveToFather();
+    return ok;
+}
+
+uint64 CDBSnapshot::Checksum(const char *text, uint32 size){
+    uint64 hash = 0xcbf29ce484222325ULL;
+    for(uint32 i = 0; i < size; i++){
+        hash ^= (uint8)text[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+#if defined(CDBS_USE_MMAP)
+
+/** Rounds up to a multiple of 8 */
+static inline int64 CDBSAlign(int64 offset){
+    return (offset + 7) & ~((int64)7);
+}
+
+/** Writes at a position of the file */
+static bool CDBSWrite(int fd, int64 offset, const void *data, int64 size){
+    const char *p = (const char *)data;
+    while(size > 0){
+        ssize_t written = pwrite(fd, p, (size_t)size, (off_t)offset);
+        if(written <= 0) return False;
+        p      += written;
+        offset += written;
+        size   -= written;
+    }
+    return True;
+}
+
+bool CDBSnapshot::Save(ConfigurationDataBase &cdb, const char *fileName, uint64 sourceChecksum, uint64 sourceSize){
+    CDBSBuilder builder;
+    if(!CDBSSaveChildren(cdb, builder)){
+        CStaticAssertErrorCondition(Warning, "CDBSnapshot::Save: the database cannot be saved in %s", fileName);
+        return False;
+    }
+
+    CDBSFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CDBS_MAGIC, sizeof(header.magic));
+    header.version            = CDBS_VERSION;
+    header.headerSize         = sizeof(CDBSFileHeader);
+    header.sourceChecksum     = sourceChecksum;
+    header.sourceSize         = sourceSize;
+    header.nOfNodes           = builder.nodes.size;
+    header.nOfElements        = builder.elements.size;
+    header.maxElements        = builder.maxElements;
+    header.nodeTableOffset    = CDBSAlign(sizeof(CDBSFileHeader));
+    header.elementTableOffset = CDBSAlign(header.nodeTableOffset    + (int64)sizeof(CDBSNodeEntry) * header.nOfNodes);
+    header.stringTableOffset  = header.elementTableOffset + (int64)sizeof(uint32) * header.nOfElements;
+    header.fileSize           = header.stringTableOffset + builder.strings.size;
+
+    FString tempFileName;
+    tempFileName.Printf("%s.tmp", fileName);
+    int fd = open(tempFileName.Buffer(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0){
+        CStaticAssertErrorCondition(Warning, "CDBSnapshot::Save: failed creating %s: %s", tempFileName.Buffer(), strerror(errno));
+        return False;
+    }
+
+    bool ok = (ftruncate(fd, (off_t)header.fileSize) == 0);
+    ok = ok && CDBSWrite(fd, 0, &header, sizeof(header));
+    ok = ok && CDBSWrite(fd, header.nodeTableOffset,    builder.nodes.data,    (int64)sizeof(CDBSNodeEntry) * header.nOfNodes);
+    ok = ok && CDBSWrite(fd, header.elementTableOffset, builder.elements.data, (int64)sizeof(uint32)        * header.nOfElements);
+    ok = ok && CDBSWrite(fd, header.stringTableOffset,  builder.strings.data,  builder.strings.size);
+    if(close(fd) != 0) ok = False;
+    if(!ok){
+        CStaticAssertErrorCondition(Warning, "CDBSnapshot::Save: failed writing %s: %s", tempFileName.Buffer(), strerror(errno));
+    }
+
+    if(ok && (rename(tempFileName.Buffer(), fileName) != 0)){
+        CStaticAssertErrorCondition(Warning, "CDBSnapshot::Save: failed renaming %s: %s", tempFileName.Buffer(), strerror(errno));
+        ok = False;
+    }
+    if(!ok) unlink(tempFileName.Buffer());
+
+    return ok;
+}
+
+bool CDBSnapshot::Open(const char *fileName, uint64 sourceChecksum, uint64 sourceSize){
+    Close();
+
+    int fd = open(fileName, O_RDONLY);
+    if(fd < 0) return False;
+
+    struct stat fileStat;
+    if((fstat(fd, &fileStat) != 0) || (fileStat.st_size < (off_t)sizeof(CDBSFileHeader))){
+        CStaticAssertErrorCondition(Warning, "CDBSnapshot::Open: %s is not a snapshot", fileName);
+        close(fd);
+        return False;
+    }
+
+    void *map = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED){
+        CStaticAssertErrorCondition(Warning, "CDBSnapshot::Open: failed mapping %s: %s", fileName, strerror(errno));
+        return False;
+    }
+
+    mappedFile = (char *)map;
+    mappedSize = fileStat.st_size;
+    header     = (const CDBSFileHeader *)mappedFile;
+
+    bool ok = (memcmp(header->magic, CDBS_MAGIC, sizeof(header->magic)) == 0);
+    ok = ok && (header->version    == CDBS_VERSION);
+    ok = ok && (header->headerSize == sizeof(CDBSFileHeader));
+    ok = ok && (header->fileSize   == mappedSize);
+    // The tables follow the header in this order: compared as int64 so
+    // that a corrupted (negative) offset cannot wrap around
+    ok = ok && ((int64)header->headerSize <= header->nodeTableOffset);
+    ok = ok && (header->nodeTableOffset    + (int64)header->nOfNodes    * (int64)sizeof(CDBSNodeEntry) <= header->elementTableOffset);
+    ok = ok && (header->elementTableOffset + (int64)header->nOfElements * (int64)sizeof(uint32)        <= header->stringTableOffset);
+    ok = ok && (header->stringTableOffset < mappedSize) && (mappedFile[mappedSize - 1] == 0);
+    if(!ok){
+        CStaticAssertErrorCondition(Warning, "CDBSnapshot::Open: %s has an invalid or incomplete header", fileName);
+        Close();
+        return False;
+    }
+
+    if((header->sourceChecksum != sourceChecksum) || (header->sourceSize != sourceSize)){
+        CStaticAssertErrorCondition(Information, "CDBSnapshot::Open: %s was created from a different configuration", fileName);
+        Close();
+        return False;
+    }
+
+    nodes    = (const CDBSNodeEntry *)(mappedFile + header->nodeTableOffset);
+    elements = (const uint32 *)(mappedFile + header->elementTableOffset);
+    strings  = mappedFile + header->stringTableOffset;
+
+    int64 stringTableSize = mappedSize - header->stringTableOffset;
+    for(uint32 i = 0; ok && (i < header->nOfNodes); i++){
+        const CDBSNodeEntry &node = nodes[i];
+        ok = ((int64)node.name < stringTableSize);
+        if(node.type == CDBS_GROUP_NODE) continue;
+        ok = ok && ((node.type == CDBS_LEAF_NODE) || ((node.type == CDBS_LINK_NODE) && (node.size == 1)));
+        ok = ok && (node.size <= header->maxElements);
+        ok = ok && ((uint64)node.firstElement + node.size <= header->nOfElements);
+    }
+    for(uint32 i = 0; ok && (i < header->nOfElements); i++){
+        ok = ((int64)elements[i] < stringTableSize);
+    }
+    if(!ok){
+        CStaticAssertErrorCondition(Warning, "CDBSnapshot::Open: %s has an invalid node table", fileName);
+        Close();
+        return False;
+    }
+    return True;
+}
+
+void CDBSnapshot::Close(){
+    if(mappedFile != NULL) munmap(mappedFile, (size_t)mappedSize);
+    mappedFile = NULL;
+    mappedSize = 0;
+    header     = NULL;
+    nodes      = NULL;
+    elements   = NULL;
+    strings    = NULL;
+}
+
+#else
+
+bool CDBSnapshot::Save(ConfigurationDataBase &cdb, const char *fileName, uint64 sourceChecksum, uint64 sourceSize){
+    CStaticAssertErrorCondition(Warning, "CDBSnapshot::Save: not supported on this platform");
+    return False;
+}
+
+bool CDBSnapshot::Open(const char *fileName, uint64 sourceChecksum, uint64 sourceSize){
+    return False;
+}
+
+void CDBSnapshot::Close(){
+}
+
+#endif
+
+bool CDBSnapshot::LoadNode(ConfigurationDataBase &cdb, uint32 &index, const char **elementList){
+    if(index >= header->nOfNodes) return False;
+    const CDBSNodeEntry &node = nodes[index++];
+    const char *name = strings + node.name;
+
+    if(node.type == CDBS_GROUP_NODE){
+        if(!cdb->AddChildAndMove(name)) return False;
+        bool ok = True;
+        for(uint32 i = 0; ok && (i < node.size); i++){
+            ok = LoadNode(cdb, index, elementList);
+        }
+        cdb->MoveToFather();
+        return ok;
+    }
+
+    if(node.type == CDBS_LINK_NODE){
+        return cdb->Link("", Element(node, 0));
+    }
+
+    if(node.size == 0){
+        const char *empty = "";
+        return cdb->WriteArray(&empty, CDBTYPE_Interpret, NULL, 1, name);
+    }
+
+    for(uint32 i = 0; i < node.size; i++){
+        elementList[i] = Element(node, i);
+    }
+    int size[1];
+    size[0] = node.size;
+    return cdb->WriteArray(elementList, CDBTYPE_String, size, 1, name);
+}
+
+bool CDBSnapshot::Load(ConfigurationDataBase &cdb){
+    if(header == NULL) return False;
+
+    const char **elementList = (const char **)malloc(sizeof(const char *) * (header->maxElements + 1));
+    if(elementList == NULL) return False;
+
+    bool ok = True;
+    uint32 index = 0;
+    while(ok && (index < header->nOfNodes)){
+        ok = LoadNode(cdb, index, elementList);
+    }
+    free((void *&)elementList);
+
+    if(!ok) CStaticAssertErrorCondition(Warning, "CDBSnapshot::Load: failed rebuilding node %d", index);
+    return ok;
+}
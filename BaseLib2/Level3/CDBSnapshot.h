@@ -0,0 +1,198 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Binary snapshot of a configuration database.
+ *
+ * Parsing a large text configuration is dominated by the lexical analysis
+ * and by the quoting and decoding of every array element. The snapshot keeps
+ * the tree already split in nodes and elements, so that it can be rebuilt
+ * from a memory mapped file without tokenising.
+ *
+ * The file is made of:
+ *
+ *   CDBSFileHeader
+ *   CDBSNodeEntry[nOfNodes]   (at nodeTableOffset, depth first, a group is followed by its children)
+ *   uint32[nOfElements]       (at elementTableOffset, offsets of the element strings)
+ *   strings                   (at stringTableOffset, zero terminated)
+ *
+ * The header keeps the checksum and the size of the text it was created from:
+ * a snapshot is only loaded if the text has not changed.
+ * Only group, string and link nodes are supported; Save fails on any other node.
+ * Only available on the platforms supporting mmap.
+ */
+#if !defined (CDB_SNAPSHOT_H)
+#define CDB_SNAPSHOT_H
+
+#include "System.h"
+#include "ConfigurationDataBase.h"
+
+/** Identifies the snapshot files */
+#define CDBS_MAGIC          "MARTeCDB"
+/** Version of the format */
+#define CDBS_VERSION        2
+
+/** A group node, size is the number of children */
+#define CDBS_GROUP_NODE     1
+/** A string data node, size is the number of elements */
+#define CDBS_LEAF_NODE      2
+/** A link node, the only element is the linked path */
+#define CDBS_LINK_NODE      3
+
+/** The file header */
+struct CDBSFileHeader{
+    /** CDBS_MAGIC, not terminated */
+    char   magic[8];
+    /** CDBS_VERSION */
+    uint32 version;
+    /** sizeof(CDBSFileHeader) */
+    uint32 headerSize;
+    /** Checksum of the source text */
+    uint64 sourceChecksum;
+    /** Size of the source text */
+    uint64 sourceSize;
+    /** Number of entries in the node table */
+    uint32 nOfNodes;
+    /** Number of entries in the element table */
+    uint32 nOfElements;
+    /** Largest number of elements of a leaf */
+    uint32 maxElements;
+    /** Not used */
+    uint32 reserved;
+    /** Position of the node table */
+    int64  nodeTableOffset;
+    /** Position of the element table */
+    int64  elementTableOffset;
+    /** Position of the strings */
+    int64  stringTableOffset;
+    /** Size of the complete file */
+    int64  fileSize;
+};
+
+/** A node of the tree */
+struct CDBSNodeEntry{
+    /** CDBS_GROUP_NODE, CDBS_LEAF_NODE or CDBS_LINK_NODE */
+    uint32 type;
+    /** Offset of the name in the strings */
+    uint32 name;
+    /** Number of children of a group or of elements of a leaf */
+    uint32 size;
+    /** Index of the first element in the element table */
+    uint32 firstElement;
+    /** Not used */
+    uint32 reserved;
+};
+
+/** Saves and loads the snapshots */
+class CDBSnapshot{
+private:
+    /** The mapped file */
+    char                 *mappedFile;
+
+    /** Size of the mapped file */
+    int64                 mappedSize;
+
+    /** The header */
+    const CDBSFileHeader *header;
+
+    /** The node table */
+    const CDBSNodeEntry  *nodes;
+
+    /** The element table */
+    const uint32         *elements;
+
+    /** The strings */
+    const char           *strings;
+
+    /** Rebuilds a node and its subtree at the current position of cdb */
+    bool LoadNode(ConfigurationDataBase &cdb, uint32 &index, const char **elementList);
+
+public:
+
+    CDBSnapshot(){
+        mappedFile = NULL;
+        mappedSize = 0;
+        header     = NULL;
+        nodes      = NULL;
+        elements   = NULL;
+        strings    = NULL;
+    }
+
+    ~CDBSnapshot(){
+        Close();
+    }
+
+    /** Checksum (64 bit FNV-1a) of a configuration text */
+    static uint64 Checksum(const char *text, uint32 size);
+
+    /**
+     * Writes the tree below the current node of cdb in a temporary file which is
+     * then renamed to fileName.
+     * @param sourceChecksum Checksum of the text the database was read from
+     * @param sourceSize Size of the text the database was read from
+     * @return True if the snapshot was written
+     */
+    static bool Save(ConfigurationDataBase &cdb, const char *fileName, uint64 sourceChecksum, uint64 sourceSize);
+
+    /**
+     * Maps a snapshot and validates it.
+     * @return False if the file does not exist, is invalid or was created from a different text
+     */
+    bool Open(const char *fileName, uint64 sourceChecksum, uint64 sourceSize);
+
+    /** Unmaps the snapshot */
+    void Close();
+
+    /** True if a snapshot is mapped */
+    bool IsOpen() const{
+        return (mappedFile != NULL);
+    }
+
+    /** Adds the snapshot tree at the current node of cdb */
+    bool Load(ConfigurationDataBase &cdb);
+
+    /** Number of nodes */
+    uint32 NumberOfNodes() const{
+        return (header == NULL) ? 0 : header->nOfNodes;
+    }
+
+    /** A node of the table, NULL if out of range */
+    const CDBSNodeEntry *Node(uint32 index) const{
+        if((header == NULL) || (index >= header->nOfNodes)) return NULL;
+        return &nodes[index];
+    }
+
+    /** The name of a node */
+    const char *NodeName(const CDBSNodeEntry &node) const{
+        return strings + node.name;
+    }
+
+    /** An element of a leaf */
+    const char *Element(const CDBSNodeEntry &node, uint32 index) const{
+        return strings + elements[node.firstElement + index];
+    }
+};
+
+#endif
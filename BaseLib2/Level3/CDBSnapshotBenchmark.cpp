@@ -0,0 +1,142 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Time needed to build the configuration database of a MARTe configuration
+ * file by parsing the text and by loading its binary snapshot.
+ * The two databases are printed and compared to check the snapshot.
+ * Usage: CDBSnapshotBenchmark.ex file.cfg [file2.cfg ...] [-n repetitions]
+ */
+
+#include "System.h"
+#include "File.h"
+#include "FString.h"
+#include "HRT.h"
+#include "ConfigurationDataBase.h"
+#include "CDBSnapshot.h"
+
+/** Reads a whole file */
+static bool ReadText(const char *fileName, FString &text){
+    File file;
+    if(!file.OpenRead(fileName)){
+        printf("Failed opening %s\n", fileName);
+        return False;
+    }
+    text.SetSize(0);
+    file.Seek(0);
+    file.GetToken(text, "");
+    file.Close();
+    text.Seek(0);
+    return True;
+}
+
+/** Prints a database in the text format */
+static void Print(ConfigurationDataBase &cdb, FString &text){
+    text.SetSize(0);
+    cdb->WriteToStream(text);
+}
+
+static void RunTest(const char *fileName, int32 repetitions){
+    FString text;
+    if(!ReadText(fileName, text)) return;
+
+    const char *snapshotFile = "CDBSnapshotBenchmark.cdbs";
+    double period = HRT::HRTPeriod();
+
+    int64 start = HRT::HRTCounter();
+    uint64 checksum = 0;
+    for(int32 i = 0; i < repetitions; i++){
+        checksum = CDBSnapshot::Checksum(text.Buffer(), text.Size());
+    }
+    double checksumTime = (HRT::HRTCounter() - start) * period / repetitions;
+
+    FString parsedText;
+    start = HRT::HRTCounter();
+    for(int32 i = 0; i < repetitions; i++){
+        ConfigurationDataBase cdb;
+        text.Seek(0);
+        cdb->ReadFromStream(text);
+        if(i == 0) Print(cdb, parsedText);
+    }
+    double parseTime = (HRT::HRTCounter() - start) * period / repetitions;
+
+    {
+        ConfigurationDataBase cdb;
+        text.Seek(0);
+        cdb->ReadFromStream(text);
+        if(!CDBSnapshot::Save(cdb, snapshotFile, checksum, text.Size())){
+            printf("%s: the snapshot cannot be saved\n", fileName);
+            return;
+        }
+    }
+
+    FString loadedText;
+    bool ok = True;
+    start = HRT::HRTCounter();
+    for(int32 i = 0; ok && (i < repetitions); i++){
+        ConfigurationDataBase cdb;
+        CDBSnapshot snapshot;
+        ok = snapshot.Open(snapshotFile, checksum, text.Size()) && snapshot.Load(cdb);
+        if(ok && (i == 0)) Print(cdb, loadedText);
+    }
+    double loadTime = (HRT::HRTCounter() - start) * period / repetitions;
+    unlink(snapshotFile);
+
+    if(!ok){
+        printf("%s: the snapshot cannot be loaded\n", fileName);
+        return;
+    }
+
+    printf("%s (%lld bytes)\n", fileName, (long long)text.Size());
+    printf("    checksum %10.3f ms\n", checksumTime * 1e3);
+    printf("    parse    %10.3f ms\n", parseTime * 1e3);
+    printf("    snapshot %10.3f ms (%.1fx)\n", loadTime * 1e3, parseTime / loadTime);
+    printf("    content  %s\n", (parsedText == loadedText) ? "identical" : "DIFFERENT");
+}
+
+int main(int argc, char **argv){
+    int32 repetitions = 20;
+    int32 nOfFiles    = 0;
+    for(int32 i = 1; i < argc; i++){
+        if((strcmp(argv[i], "-n") == 0) && (i + 1 < argc)){
+            repetitions = atoi(argv[++i]);
+        } else {
+            nOfFiles++;
+        }
+    }
+    if((nOfFiles == 0) || (repetitions < 1)){
+        printf("Usage: CDBSnapshotBenchmark.ex file.cfg [file2.cfg ...] [-n repetitions]\n");
+        return -1;
+    }
+
+    for(int32 i = 1; i < argc; i++){
+        if(strcmp(argv[i], "-n") == 0){
+            i++;
+            continue;
+        }
+        RunTest(argv[i], repetitions);
+    }
+    return 0;
+}
@@ -404,6 +404,29 @@ void CDBDataNode::CleanUp(){
     }
     elements            = NULL;
     numberOfElements    = 0;
+    if (typedValues) free((void *&)typedValues);
+    typedValues         = NULL;
+    typedValuesType     = CDB_None;
+}
+
+bool CDBDataNode::ReadTypedValues(const CDBDataType &type,void *values,uint32 size) const {
+    if ((typedValues == NULL) || (typedValuesType != type)) return False;
+    if (size > numberOfElements) return False;
+    memcpy(values,typedValues,size * type.ByteSize());
+    return True;
+}
+
+void CDBDataNode::SaveTypedValues(const CDBDataType &type,const void *values){
+    int byteSize = numberOfElements * type.ByteSize();
+    if ((typedValues != NULL) && (typedValuesType.ByteSize() != type.ByteSize())){
+        free((void *&)typedValues);
+    }
+    if (typedValues == NULL){
+        typedValues = malloc(byteSize);
+        if (typedValues == NULL) return;
+    }
+    memcpy(typedValues,values,byteSize);
+    typedValuesType = type;
 }
 
 void CDBDataNode::SetSize(int size){
@@ -771,6 +794,16 @@ bool CDBStringDataNode::ReadContent(void *value,const CDBTYPE &valueType,int siz
 
     CDBDataType cdbdt = valueType.dataType;
 
+    // large numeric arrays are converted once and then copied
+    bool typedCache = (NumberOfElements() >= CDBDN_TYPED_CACHE_MIN_ELEMENTS) &&
+                      ((cdbdt == CDB_double) || (cdbdt == CDB_float) ||
+                       (cdbdt == CDB_int32)  || (cdbdt == CDB_uint32) ||
+                       (cdbdt == CDB_int64));
+    if (typedCache && ReadTypedValues(cdbdt,value,size)){
+        memset((char *)value + size * cdbdt.ByteSize(),0,fillSize * cdbdt.ByteSize());
+        return True;
+    }
+
     if (cdbdt == CDB_double){
             double *dv = (double *)value;
             ret = ReadDouble(dv,size);
@@ -867,6 +900,10 @@ bool CDBStringDataNode::ReadContent(void *value,const CDBTYPE &valueType,int siz
             if (!ret) AssertErrorCondition(ParametersError,"ReadContent:unknown data type %i",valueType.dataType.Value());
             return ret;
         }
+
+    if (typedCache && ret && (size == NumberOfElements())){
+        SaveTypedValues(cdbdt,value);
+    }
     return ret;
 }
 
@@ -28,11 +28,20 @@
 /** 
  * @file
  * Abstraction of all nodes containing data
+ *
+ * The elements are kept as strings. The nodes with at least
+ * CDBDN_TYPED_CACHE_MIN_ELEMENTS elements also keep the values converted
+ * by the last numeric read of the whole node, so that reading again the
+ * same type is a copy. The converted values are discarded when the node
+ * is written.
  */
 #include "CDBNode.h"
 #include "CDBTypes.h"
 #include "System.h"
 
+/** smallest number of elements of a node whose converted values are kept */
+#define CDBDN_TYPED_CACHE_MIN_ELEMENTS 16
+
 class CDBDataNode;
 OBJECT_DLL(CDBDataNode)
 
@@ -53,12 +62,21 @@ protected:
         > 1 it is a vector of pointers     */
             char **     elements;
 
+    /** the values converted by the last numeric read of the whole node.
+        NULL if the node has not been read as a number since it was written */
+            void *      typedValues;
+
+    /** the type of typedValues */
+            CDBDataType typedValuesType;
+
 protected:
 
     /** constructor */
                         CDBDataNode()                   {
                                                             elements            = NULL;
                                                             numberOfElements    = 0;
+                                                            typedValues         = NULL;
+                                                            typedValuesType     = CDB_None;
                                                         }
 
     /** destructor */
@@ -72,6 +90,15 @@ protected:
     /** resize to 0*/
             void        CleanUp();
 
+    /** copies the first size converted values if they are of the requested type */
+            bool        ReadTypedValues(const CDBDataType &type,
+                                        void *          values,
+                                        uint32          size) const;
+
+    /** keeps a copy of the values converted from all the elements */
+            void        SaveTypedValues(const CDBDataType &type,
+                                        const void *    values);
+
 
     /** False if the element was already set */
             bool        WriteElement(   uint32          elementNumber,
@@ -0,0 +1,91 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Time needed to read a large numeric array from a configuration database.
+ * The first read converts the strings, the following reads of the same type
+ * copy the values kept by the node.
+ * Usage: CDBTypedReadBenchmark.ex [numberOfElements] [repetitions]
+ */
+
+#include "System.h"
+#include "HRT.h"
+#include "ConfigurationDataBase.h"
+#include "CDBExtended.h"
+
+/** Reads the array and returns the time in ms */
+static double TimedRead(CDBExtended &cdbx, float *values, int32 nOfElements){
+    int size[1];
+    size[0] = nOfElements;
+    int64 start = HRT::HRTCounter();
+    if(!cdbx.ReadFloatArray(values, size, 1, "Waveform")){
+        printf("ReadFloatArray failed\n");
+    }
+    return (HRT::HRTCounter() - start) * HRT::HRTPeriod() * 1e3;
+}
+
+int main(int argc, char **argv){
+    int32 nOfElements = (argc > 1) ? atoi(argv[1]) : 1000000;
+    int32 repetitions = (argc > 2) ? atoi(argv[2]) : 10;
+    if((nOfElements < 1) || (repetitions < 1)){
+        printf("Usage: CDBTypedReadBenchmark.ex [numberOfElements] [repetitions]\n");
+        return -1;
+    }
+
+    float *values = (float *)malloc(sizeof(float) * nOfElements);
+    for(int32 i = 0; i < nOfElements; i++) values[i] = i * 0.001f;
+
+    ConfigurationDataBase cdb;
+    CDBExtended cdbx(cdb);
+    int size[1];
+    size[0] = nOfElements;
+    cdbx.WriteFloatArray(values, size, 1, "Waveform");
+
+    // the copies must be identical to the converted values
+    float *converted = (float *)malloc(sizeof(float) * nOfElements);
+    double first = TimedRead(cdbx, converted, nOfElements);
+    double cached = 0.0;
+    bool ok = True;
+    for(int32 i = 0; i < repetitions; i++){
+        cached += TimedRead(cdbx, values, nOfElements);
+        ok = ok && (memcmp(values, converted, sizeof(float) * nOfElements) == 0);
+    }
+    cached /= repetitions;
+
+    // writing the node discards the converted values
+    cdbx.WriteFloatArray(values, size, 1, "Waveform");
+    double rewritten = TimedRead(cdbx, values, nOfElements);
+    ok = ok && (memcmp(values, converted, sizeof(float) * nOfElements) == 0);
+
+    printf("float array of %d elements\n", nOfElements);
+    printf("    first read      %10.3f ms\n", first);
+    printf("    following reads %10.3f ms (%.0fx)\n", cached, first / cached);
+    printf("    after a write   %10.3f ms\n", rewritten);
+    printf("    values          %s\n", ok ? "identical to the conversion" : "DIFFERENT");
+
+    free((void *&)converted);
+    free((void *&)values);
+    return 0;
+}
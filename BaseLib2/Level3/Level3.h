@@ -41,6 +41,7 @@
 #include "CDBStringDataNode.h"
 #include "CDBOS.h"
 #include "CDBOSStream.h"
+#include "CDBSnapshot.h"
 #include "EAFile.h"
 #include "LexicalAnalyzer.h"
 #include "ObjectIOTools.h"
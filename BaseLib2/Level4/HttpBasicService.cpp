@@ -31,6 +31,7 @@
 #include "HttpInterface.h"
 #include "HttpClient.h"
 #include "Processes.h"
+#include "HttpEventLoop.h"
 
 
 class HSSearchFilter: public SearchFilterT<GCReference>{
@@ -141,109 +142,110 @@ public:
 
 };
 
-MCCExitType HSUserServiceThreadEx(HttpBasicService &hs,MultiClientClassConnectionInfo *info){
-    TCPSocket  *clientSocket = ((HttpBasicServiceConnectionInfo *)info)->socket;
-    if (clientSocket == NULL) return MCCTerminate;
-
-    clientSocket->SetBlocking(True);
-    HttpStream hstream(clientSocket);
-
-    while(1){
-        SocketSelect sel;
-        sel.AddWaitOnReadReady(clientSocket);//TODO ADD EXCEPT
-        bool ret = sel.WaitRead(1000);
-        if (ret == False) {
-            return MCCContinue;
-        }
-
-        if (!hstream.ReadHeader()){
-            hs.AssertErrorCondition(CommunicationError,"HSUserServiceThread:Error while reading http header\n");
-            clientSocket->Close();
-            break;
-        }
+bool HSServeRequest(HttpBasicService &hs,TCPSocket *clientSocket,HttpStream &hstream){
+    if (!hstream.ReadHeader()){
+        hs.AssertErrorCondition(CommunicationError,"HSUserServiceThread:Error while reading http header\n");
+        return False;
+    }
 
-        if (hs.verboseLevel >=10){
-            hs.AssertErrorCondition(Information,"Processing request [%s]",hstream.path.Buffer());
-        }
+    if (hs.verboseLevel >=10){
+        hs.AssertErrorCondition(Information,"Processing request [%s]",hstream.path.Buffer());
+    }
 
-        GCRTemplate<HttpInterface>hi;
-        GCRTemplate<HttpRealm> realm;
+    GCRTemplate<HttpInterface>hi;
+    GCRTemplate<HttpRealm> realm;
 
-        if (hstream.path.Size()>0){
-            // search for destination
-            HSSearchFilter searchFilter(hstream.path.Buffer());
-            hi = hs.webRoot->Find(&searchFilter,GCFT_Recurse);
-            realm = searchFilter.GetRealm();
+    if (hstream.path.Size()>0){
+        // search for destination
+        HSSearchFilter searchFilter(hstream.path.Buffer());
+        hi = hs.webRoot->Find(&searchFilter,GCFT_Recurse);
+        realm = searchFilter.GetRealm();
 
-            // save remainder of address
-            hstream.unMatchedUrl = hstream.url.Buffer()+searchFilter.NameIndex();
-            if (hstream.unMatchedUrl.Buffer()[hstream.unMatchedUrl.Size()-1] == '/') {
-                hstream.unMatchedUrl.SetSize(hstream.unMatchedUrl.Size()-1);
-            }
+        // save remainder of address
+        hstream.unMatchedUrl = hstream.url.Buffer()+searchFilter.NameIndex();
+        if (hstream.unMatchedUrl.Buffer()[hstream.unMatchedUrl.Size()-1] == '/') {
+            hstream.unMatchedUrl.SetSize(hstream.unMatchedUrl.Size()-1);
         }
-        if (!hi.IsValid()){
-            hi = hs.webRoot;
-            if (hi.IsValid()) {
-                if ((hi->Realm()).IsValid()){
-                    realm = hi->Realm();
-                }
+    }
+    if (!hi.IsValid()){
+        hi = hs.webRoot;
+        if (hi.IsValid()) {
+            if ((hi->Realm()).IsValid()){
+                realm = hi->Realm();
             }
         }
+    }
 
-        bool pagePrepared = False;
-        if (hi.IsValid()){
-            // check security
+    bool pagePrepared = False;
+    if (hi.IsValid()){
+        // check security
 //            GCRTemplate<HttpRealm> realm = searchFilter.GetRealm();
-            if (realm.IsValid()){
-                if (!hstream.SecurityCheck(realm,clientSocket->Source().HostNumber())){
-                    hstream.Printf(
-                             "<HTML><HEAD>\n"
-                             "<TITLE>401 Authorization Required</TITLE>\n"
-                             "</HEAD><BODY>\n"
-                             "<H1>Authorization Required</H1>\n"
-                             "This server could not verify that you\n"
-                             "are authorized to access the document you\n"
-                             "requested.  Either you supplied the wrong\n"
-                             "credentials (e.g., bad password), or your\n"
-                             "browser doesn't understand how to supply\n"
-                             "the credentials required.<P>\n"
-                             "</BODY></HTML>\n"
-                    );
-                    hstream.SSPrintf("OutputHttpOtions.Content-Type","text/html");
-                    FString realmMsg;
-                    realm->GetAuthenticationRequest(realmMsg);
-                    hstream.SSPrintf("OutputHttpOtions.WWW-Authenticate",realmMsg.Buffer());
-
-                    // force reissuing of a new thread
-                    hstream.keepAlive = False;
-                    if (!hstream.WriteReplyHeader(True,401)){
-                        hs.AssertErrorCondition(CommunicationError,"HSUserServiceThread:Error while writing page back\n");
-                        clientSocket->Close();
-                        break;
-                    }
-                    pagePrepared = True;
+        if (realm.IsValid()){
+            if (!hstream.SecurityCheck(realm,clientSocket->Source().HostNumber())){
+                hstream.Printf(
+                         "<HTML><HEAD>\n"
+                         "<TITLE>401 Authorization Required</TITLE>\n"
+                         "</HEAD><BODY>\n"
+                         "<H1>Authorization Required</H1>\n"
+                         "This server could not verify that you\n"
+                         "are authorized to access the document you\n"
+                         "requested.  Either you supplied the wrong\n"
+                         "credentials (e.g., bad password), or your\n"
+                         "browser doesn't understand how to supply\n"
+                         "the credentials required.<P>\n"
+                         "</BODY></HTML>\n"
+                );
+                hstream.SSPrintf("OutputHttpOtions.Content-Type","text/html");
+                FString realmMsg;
+                realm->GetAuthenticationRequest(realmMsg);
+                hstream.SSPrintf("OutputHttpOtions.WWW-Authenticate",realmMsg.Buffer());
+
+                // force reissuing of a new thread
+                hstream.keepAlive = False;
+                if (!hstream.WriteReplyHeader(True,401)){
+                    hs.AssertErrorCondition(CommunicationError,"HSUserServiceThread:Error while writing page back\n");
+                    return False;
                 }
-            }
-
-            if (!pagePrepared){
-                pagePrepared = hi->ProcessHttpMessage(hstream);
+                pagePrepared = True;
             }
         }
 
         if (!pagePrepared){
-            hstream.Printf("<HTML>Page Not Found!</HTML>");
-            hstream.SSPrintf("OutputHttpOtions.Content-Type","text/html");
-            if (!hstream.keepAlive){
-                hstream.SSPrintf("OutputHttpOtions.Connection","Close");
-            }
-            if (!hstream.WriteReplyHeader(True,200)){
-                hs.AssertErrorCondition(CommunicationError,"HSUserServiceThread:Error while writing page back\n");
-                clientSocket->Close();
-                break;
-            }
+            pagePrepared = hi->ProcessHttpMessage(hstream);
         }
+    }
 
-        if (!hstream.keepAlive) break;
+    if (!pagePrepared){
+        hstream.Printf("<HTML>Page Not Found!</HTML>");
+        hstream.SSPrintf("OutputHttpOtions.Content-Type","text/html");
+        if (!hstream.keepAlive){
+            hstream.SSPrintf("OutputHttpOtions.Connection","Close");
+        }
+        if (!hstream.WriteReplyHeader(True,200)){
+            hs.AssertErrorCondition(CommunicationError,"HSUserServiceThread:Error while writing page back\n");
+            return False;
+        }
+    }
+
+    return hstream.keepAlive;
+}
+
+MCCExitType HSUserServiceThreadEx(HttpBasicService &hs,MultiClientClassConnectionInfo *info){
+    TCPSocket  *clientSocket = ((HttpBasicServiceConnectionInfo *)info)->socket;
+    if (clientSocket == NULL) return MCCTerminate;
+
+    clientSocket->SetBlocking(True);
+    HttpStream hstream(clientSocket);
+
+    while(1){
+        SocketSelect sel;
+        sel.AddWaitOnReadReady(clientSocket);//TODO ADD EXCEPT
+        bool ret = sel.WaitRead(1000);
+        if (ret == False) {
+            return MCCContinue;
+        }
+
+        if (!HSServeRequest(hs,clientSocket,hstream)) break;
     }
 
     clientSocket->Close();
@@ -287,10 +289,28 @@ bool HSUserListenerInitialize(HttpBasicService &hs){
         hs.AssertErrorCondition(Information,"port changed from %i to %i as instructed by HttpServiceRelay ",oldPort,hs.port );
     }
 
-    return hs.server.Listen(hs.port,255);
+    if (!hs.server.Listen(hs.port,255)) return False;
+
+    if (hs.useEventLoop){
+        hs.eventLoop = new HttpEventLoop;
+        if (!hs.eventLoop->Initialise(hs,hs.server,hs.numberOfWorkers,hs.workerCPUMask,hs.maxConnections,hs.keepAliveTimeout)){
+            hs.AssertErrorCondition(Warning,"Cannot start the event loop, using a thread per connection");
+            delete hs.eventLoop;
+            hs.eventLoop = NULL;
+        } else
+        if (hs.verboseLevel >=2){
+            hs.AssertErrorCondition(Information,"Serving the connections with %i workers",hs.numberOfWorkers);
+        }
+    }
+    return True;
 }
 
 void HSUserListenerTerminate(HttpBasicService &hs){
+    if (hs.eventLoop != NULL){
+        hs.eventLoop->Finish();
+        delete hs.eventLoop;
+        hs.eventLoop = NULL;
+    }
     hs.server.Close();
     if (hs.verboseLevel >=2){
         hs.AssertErrorCondition(Information,"Server stopping");
@@ -298,6 +318,13 @@ void HSUserListenerTerminate(HttpBasicService &hs){
 }
 
 bool HSUserListenerThread(HttpBasicService &hs,MultiClientClassConnectionInfo *&info){
+    // the connections are handed to the workers of the event loop
+    if (hs.eventLoop != NULL){
+        hs.eventLoop->Poll(200);
+        info = NULL;
+        return True;
+    }
+
     HttpBasicServiceConnectionInfo *sinfo = new HttpBasicServiceConnectionInfo;
 
     sinfo->socket = hs.server.WaitConnection(1000);
@@ -340,6 +367,30 @@ bool HSObjectLoadSetup(
         hs.AssertErrorCondition(Information,"ObjectLoadSetup:using default verboseLevel 0");
     }
 
+    FString serverMode;
+    cdbx.ReadFString(serverMode,"ServerMode","ThreadPerConnection");
+    if (serverMode == "EventLoop"){
+        hs.useEventLoop = True;
+    } else
+    if (serverMode == "ThreadPerConnection"){
+        hs.useEventLoop = False;
+    } else {
+        hs.AssertErrorCondition(ParametersError,"ObjectLoadSetup:unknown ServerMode %s (ThreadPerConnection or EventLoop)",serverMode.Buffer());
+        return False;
+    }
+    if (hs.useEventLoop){
+        int32 cpuMask = 0;
+        cdbx.ReadInt32(hs.numberOfWorkers,"NumberOfWorkers",4);
+        cdbx.ReadInt32(cpuMask,"WorkerCPUMask",0);
+        cdbx.ReadInt32(hs.maxConnections,"MaxConnections",256);
+        cdbx.ReadInt32(hs.keepAliveTimeout,"KeepAliveTimeout",5000);
+        hs.workerCPUMask = cpuMask;
+        if ((hs.numberOfWorkers < 1) || (hs.maxConnections < 1) || (hs.keepAliveTimeout < 1)){
+            hs.AssertErrorCondition(ParametersError,"ObjectLoadSetup:NumberOfWorkers, MaxConnections and KeepAliveTimeout must be positive");
+            return False;
+        }
+    }
+
     FString root;
     if (!cdbx.ReadFString(root,"Root","")){
         hs.AssertErrorCondition(Information,"ObjectLoadSetup:mapping web to root of GlobalObjectDataBase");
@@ -56,9 +56,15 @@ public:
 };
 
 class HttpBasicService;
+class HttpEventLoop;
+class HttpStream;
 
 extern "C" {
 
+    /** Reads a request from @param hstream and writes the reply.
+        @return False if the connection must be closed */
+    bool        HSServeRequest(HttpBasicService &hs,TCPSocket *clientSocket,HttpStream &hstream);
+
     /** */
     MCCExitType HSUserServiceThreadEx(HttpBasicService &hs,MultiClientClassConnectionInfo *info);
 
@@ -85,6 +91,7 @@ see MultiClientClass for the activation method
 and HttpGroupResource for the resource installation */
 class HttpBasicService: public GCNamedObject, public MultiClientClass{
 
+    friend bool        HSServeRequest(HttpBasicService &hs,TCPSocket *clientSocket,HttpStream &hstream);
     friend MCCExitType HSUserServiceThreadEx(HttpBasicService &hs,MultiClientClassConnectionInfo *info);
     friend bool        HSUserListenerInitialize(HttpBasicService &hs);
     friend void        HSUserListenerTerminate(HttpBasicService &hs);
@@ -112,6 +119,25 @@ OBJECT_DLL_STUFF(HttpBasicService)
         It will use the URL to search in the container */
     GCRTemplate<GCReferenceContainer>   webRoot;
 
+    /** True to serve the connections with HttpEventLoop instead of
+        a thread per connection */
+    bool                                useEventLoop;
+
+    /** Number of threads of the HttpEventLoop */
+    int32                               numberOfWorkers;
+
+    /** CPUs of the HttpEventLoop threads (0 not set) */
+    uint32                              workerCPUMask;
+
+    /** Maximum number of connections of the HttpEventLoop */
+    int32                               maxConnections;
+
+    /** Idle time (ms) after which the HttpEventLoop closes a connection */
+    int32                               keepAliveTimeout;
+
+    /** Valid while the server is running in event loop mode */
+    HttpEventLoop *                     eventLoop;
+
 
 public:
 
@@ -140,6 +166,12 @@ public:
     /** CDB parameters are "Port= <the port listening to> ,
         VerboseLevel = <value for verboseLevel member>
         Root = an object reference within GlobalObjectDataBase
+        ServerMode = ThreadPerConnection (default) or EventLoop (Linux only)
+        The following apply to the EventLoop mode:
+        NumberOfWorkers = <threads serving the requests> (4)
+        WorkerCPUMask = <CPUs where the workers run> (not set)
+        MaxConnections = <connections kept open> (256)
+        KeepAliveTimeout = <ms after which an idle connection is closed> (5000)
         */
     virtual     bool        ObjectLoadSetup(
             ConfigurationDataBase & info,
@@ -161,6 +193,27 @@ public:
         port = 0;
         verboseLevel = 0;
         httpRelayURL = GetHttpRelayURL();
+        useEventLoop     = False;
+        numberOfWorkers  = 4;
+        workerCPUMask    = 0;
+        maxConnections   = 256;
+        keepAliveTimeout = 5000;
+        eventLoop        = NULL;
+    }
+
+    /** Selects the event loop mode. To be called before Start */
+                void        SetEventLoop(
+            bool                                enable,
+            int32                               numberOfWorkers  = 4,
+            uint32                              workerCPUMask    = 0,
+            int32                               maxConnections   = 256,
+            int32                               keepAliveTimeout = 5000)
+    {
+        this->useEventLoop     = enable;
+        this->numberOfWorkers  = numberOfWorkers;
+        this->workerCPUMask    = workerCPUMask;
+        this->maxConnections   = maxConnections;
+        this->keepAliveTimeout = keepAliveTimeout;
     }
     
     /**
@@ -0,0 +1,337 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+#include "HttpEventLoop.h"
+#include "HttpBasicService.h"
+#include "HRT.h"
+#include "Sleep.h"
+
+#if defined(_LINUX)
+#include <sys/epoll.h>
+#include <netinet/tcp.h>
+#endif
+
+/** Maximum number of events processed at each Poll */
+static const int32 HEL_MAX_EVENTS = 64;
+
+/** Period of the scan for idle connections */
+static const int32 HEL_SCAN_PERIOD_MSEC = 100;
+
+void HttpEventLoopWorkerThread(HttpEventLoopWorker &worker){
+    HttpEventLoop &loop = *(worker.loop);
+    worker.isThreadRunning = True;
+    while(!loop.stopWorkers){
+        HttpEventLoopConnection *connection = loop.NextReady(HEL_SCAN_PERIOD_MSEC);
+        if (connection != NULL){
+            loop.Serve(connection);
+            worker.requests++;
+        }
+    }
+    worker.isThreadRunning = False;
+}
+
+HttpEventLoop::HttpEventLoop(){
+    service        = NULL;
+    server         = NULL;
+    epollFd        = -1;
+    workers        = NULL;
+    nOfWorkers     = 0;
+    connections    = NULL;
+    nOfConnections = 0;
+    maxConnections = 0;
+    keepAliveMsec  = 0;
+    readyQueue     = NULL;
+    readyFirst     = 0;
+    readySize      = 0;
+    stopWorkers    = False;
+    lastScan       = 0;
+    accepted       = 0;
+    refused        = 0;
+    expired        = 0;
+    mux.Create();
+    readyEvent.Create();
+    readyEvent.Reset();
+}
+
+bool HttpEventLoop::Initialise(HttpBasicService &hs, TCPSocket &listeningSocket, int32 numberOfWorkers, uint32 workerCPUMask, int32 maximumConnections, int32 keepAliveTimeout){
+#if defined(_LINUX)
+    Finish();
+    if (numberOfWorkers < 1)    numberOfWorkers    = 1;
+    if (maximumConnections < 1) maximumConnections = 1;
+    service        = &hs;
+    server         = &listeningSocket;
+    maxConnections = maximumConnections;
+    keepAliveMsec  = keepAliveTimeout;
+    accepted       = 0;
+    refused        = 0;
+    expired        = 0;
+    lastScan       = HRT::HRTCounter();
+
+    epollFd = epoll_create(maxConnections + 1);
+    if (epollFd < 0){
+        CStaticAssertPlatformErrorCondition(OSError,"HttpEventLoop::Initialise: epoll_create failed");
+        return False;
+    }
+    struct epoll_event event;
+    event.events   = EPOLLIN;
+    event.data.ptr = NULL;
+    if (epoll_ctl(epollFd,EPOLL_CTL_ADD,server->Socket(),&event) != 0){
+        CStaticAssertPlatformErrorCondition(OSError,"HttpEventLoop::Initialise: cannot add the listening socket to epoll");
+        Finish();
+        return False;
+    }
+
+    readyQueue  = new HttpEventLoopConnection *[maxConnections];
+    readyFirst  = 0;
+    readySize   = 0;
+    stopWorkers = False;
+
+    ProcessorType cpus = PTUndefinedCPUs;
+    if (workerCPUMask != 0) cpus = ProcessorType(workerCPUMask);
+    workers    = new HttpEventLoopWorker[numberOfWorkers];
+    nOfWorkers = numberOfWorkers;
+    for (int32 w = 0; w < nOfWorkers; w++){
+        FString threadName;
+        threadName.Printf("%sWorker%d",hs.Name(),w + 1);
+        workers[w].loop     = this;
+        workers[w].threadID = Threads::BeginThread((void (__thread_decl *)(void *))HttpEventLoopWorkerThread,&workers[w],THREADS_DEFAULT_STACKSIZE,threadName.Buffer(),XH_NotHandled,cpus);
+        int32 sleepCount = 0;
+        while ((!workers[w].isThreadRunning) && (sleepCount++ < 100)) SleepMsec(10);
+        if (!workers[w].isThreadRunning){
+            CStaticAssertErrorCondition(InitialisationError,"HttpEventLoop::Initialise: %s: failed starting worker %d",hs.Name(),w + 1);
+            Finish();
+            return False;
+        }
+    }
+    return True;
+#else
+    CStaticAssertErrorCondition(InitialisationError,"HttpEventLoop::Initialise: not supported on this platform");
+    return False;
+#endif
+}
+
+void HttpEventLoop::Finish(){
+    if (workers != NULL){
+        stopWorkers = True;
+        readyEvent.Post();
+        for (int32 w = 0; w < nOfWorkers; w++){
+            for (int i = 0; ((i < 100) && (workers[w].isThreadRunning)); i++) SleepMsec(10);
+            if (workers[w].isThreadRunning) Threads::Kill(workers[w].threadID);
+        }
+        delete[] workers;
+        workers    = NULL;
+        nOfWorkers = 0;
+    }
+    Scan(True);
+    if (readyQueue != NULL) delete[] readyQueue;
+    readyQueue = NULL;
+    readySize  = 0;
+#if defined(_LINUX)
+    if (epollFd >= 0) close(epollFd);
+#endif
+    epollFd = -1;
+    server  = NULL;
+}
+
+bool HttpEventLoop::Poll(int32 msecTimeout){
+#if defined(_LINUX)
+    if (epollFd < 0) return False;
+    struct epoll_event events[HEL_MAX_EVENTS];
+    int32 n = epoll_wait(epollFd,events,HEL_MAX_EVENTS,msecTimeout);
+    for (int32 i = 0; i < n; i++){
+        HttpEventLoopConnection *connection = (HttpEventLoopConnection *)events[i].data.ptr;
+        if (connection == NULL){
+            Accept();
+        } else
+        if (((events[i].events & EPOLLIN) != 0) && !PeerClosed(connection,events[i].events)){
+            Dispatch(connection);
+        } else {
+            // error or hang up without data: the connection is disarmed, nobody else owns it
+            Close(connection);
+        }
+    }
+    int64 now = HRT::HRTCounter();
+    if ((now - lastScan) * HRT::HRTPeriod() * 1000.0 >= HEL_SCAN_PERIOD_MSEC){
+        lastScan = now;
+        Scan(False);
+    }
+    return (n >= 0);
+#else
+    return False;
+#endif
+}
+
+bool HttpEventLoop::PeerClosed(HttpEventLoopConnection *connection,uint32 events){
+#if defined(_LINUX)
+    if ((events & EPOLLRDHUP) == 0) return False;
+    // a last request may still be waiting to be read
+    char c;
+    return (recv(connection->socket->Socket(),&c,1,MSG_PEEK | MSG_DONTWAIT) == 0);
+#else
+    return False;
+#endif
+}
+
+void HttpEventLoop::Accept(){
+#if defined(_LINUX)
+    while (True){
+        TCPSocket *client = server->WaitConnection(TTDefault);
+        if (client == NULL) return;
+        // the connections closed by the workers are still counted until the next scan
+        if (nOfConnections >= maxConnections) Scan(False);
+        if (nOfConnections >= maxConnections){
+            refused++;
+            client->Close();
+            delete client;
+            continue;
+        }
+        client->SetBlocking(True);
+        // a worker must not be blocked forever by a client sending half a request
+        struct timeval tv;
+        tv.tv_sec  = keepAliveMsec / 1000;
+        tv.tv_usec = (keepAliveMsec % 1000) * 1000;
+        setsockopt(client->Socket(),SOL_SOCKET,SO_RCVTIMEO,&tv,sizeof(tv));
+        // the header and the body are written separately
+        int flag = 1;
+        setsockopt(client->Socket(),IPPROTO_TCP,TCP_NODELAY,&flag,sizeof(flag));
+
+        HttpEventLoopConnection *connection = new HttpEventLoopConnection;
+        connection->socket       = client;
+        connection->stream       = new HttpStream(client);
+        connection->lastActivity = HRT::HRTCounter();
+        connection->state        = HEL_CONNECTION_IDLE;
+
+        struct epoll_event event;
+        event.events   = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+        event.data.ptr = connection;
+        if (epoll_ctl(epollFd,EPOLL_CTL_ADD,client->Socket(),&event) != 0){
+            CStaticAssertPlatformErrorCondition(OSError,"HttpEventLoop::Accept: cannot add a connection to epoll");
+            client->Close();
+            delete connection;
+            continue;
+        }
+        connection->next = connections;
+        connections      = connection;
+        nOfConnections++;
+        accepted++;
+    }
+#endif
+}
+
+void HttpEventLoop::Dispatch(HttpEventLoopConnection *connection){
+    mux.Lock();
+    connection->state = HEL_CONNECTION_BUSY;
+    // each connection is queued at most once: the queue cannot overflow
+    readyQueue[(readyFirst + readySize) % maxConnections] = connection;
+    readySize++;
+    mux.UnLock();
+    readyEvent.Post();
+}
+
+HttpEventLoopConnection *HttpEventLoop::NextReady(int32 msecTimeout){
+    for (int32 attempt = 0; attempt < 2; attempt++){
+        HttpEventLoopConnection *connection = NULL;
+        mux.Lock();
+        if (readySize > 0){
+            connection = readyQueue[readyFirst];
+            readyFirst = (readyFirst + 1) % maxConnections;
+            readySize--;
+        } else {
+            // a Dispatch after this point posts the event again
+            readyEvent.Reset();
+        }
+        mux.UnLock();
+        if (connection != NULL) return connection;
+        if (attempt == 0) readyEvent.Wait(msecTimeout);
+    }
+    return NULL;
+}
+
+void HttpEventLoop::Serve(HttpEventLoopConnection *connection){
+#if defined(_LINUX)
+    bool keepOpen = HSServeRequest(*service,connection->socket,*connection->stream);
+    if ((!keepOpen) || stopWorkers){
+        Close(connection);
+        return;
+    }
+    mux.Lock();
+    connection->lastActivity = HRT::HRTCounter();
+    connection->state        = HEL_CONNECTION_IDLE;
+    mux.UnLock();
+
+    struct epoll_event event;
+    event.events   = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    event.data.ptr = connection;
+    if (epoll_ctl(epollFd,EPOLL_CTL_MOD,connection->socket->Socket(),&event) != 0){
+        mux.Lock();
+        bool owned = (connection->state == HEL_CONNECTION_IDLE);
+        if (owned) connection->state = HEL_CONNECTION_BUSY;
+        mux.UnLock();
+        if (owned) Close(connection);
+    }
+#endif
+}
+
+void HttpEventLoop::Close(HttpEventLoopConnection *connection){
+#if defined(_LINUX)
+    struct epoll_event event;
+    epoll_ctl(epollFd,EPOLL_CTL_DEL,connection->socket->Socket(),&event);
+#endif
+    connection->socket->Close();
+    mux.Lock();
+    connection->state = HEL_CONNECTION_CLOSED;
+    mux.UnLock();
+}
+
+void HttpEventLoop::Scan(bool closeAll){
+    int64 now = HRT::HRTCounter();
+    HttpEventLoopConnection **previous = &connections;
+    mux.Lock();
+    while (*previous != NULL){
+        HttpEventLoopConnection *connection = *previous;
+        bool remove = (connection->state == HEL_CONNECTION_CLOSED);
+        if (!remove){
+            // when closing all the workers are already stopped
+            bool idle = (connection->state == HEL_CONNECTION_IDLE);
+            if (closeAll || (idle && ((now - connection->lastActivity) * HRT::HRTPeriod() * 1000.0 > keepAliveMsec))){
+#if defined(_LINUX)
+                struct epoll_event event;
+                epoll_ctl(epollFd,EPOLL_CTL_DEL,connection->socket->Socket(),&event);
+#endif
+                connection->socket->Close();
+                if (!closeAll) expired++;
+                remove = True;
+            }
+        }
+        if (remove){
+            *previous = connection->next;
+            delete connection;
+            nOfConnections--;
+        } else {
+            previous = &connection->next;
+        }
+    }
+    mux.UnLock();
+}
+
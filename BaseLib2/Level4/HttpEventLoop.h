@@ -0,0 +1,246 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Serves the connections of an HttpBasicService with a fixed pool of threads.
+ * The listener thread waits with epoll for new connections and for requests
+ * on the open (keep-alive) connections and hands the connections with a
+ * pending request to the workers. A connection is armed in epoll only while
+ * it is idle (EPOLLONESHOT), so that a request is processed by one worker at
+ * a time. Idle connections are closed after keepAliveMsec.
+ * The requests are processed by HSServeRequest exactly as in the thread per
+ * connection mode, hence the HttpInterface resources do not change.
+ * Only available on Linux.
+ */
+#if !defined (HTTP_EVENT_LOOP)
+#define HTTP_EVENT_LOOP
+
+#include "System.h"
+#include "TCPSocket.h"
+#include "HttpStream.h"
+#include "MutexSem.h"
+#include "EventSem.h"
+
+class HttpBasicService;
+class HttpEventLoop;
+
+/** The connection is armed in epoll */
+#define HEL_CONNECTION_IDLE   0
+/** The connection is queued or being served by a worker */
+#define HEL_CONNECTION_BUSY   1
+/** The connection was closed and waits to be deleted by the listener */
+#define HEL_CONNECTION_CLOSED 2
+
+/** An open connection */
+class HttpEventLoopConnection{
+public:
+    /** The client */
+    TCPSocket *                 socket;
+
+    /** The http stream of the connection, kept for its whole life like in the thread per connection mode */
+    HttpStream *                stream;
+
+    /** HEL_CONNECTION_IDLE, HEL_CONNECTION_BUSY or HEL_CONNECTION_CLOSED */
+    volatile int32              state;
+
+    /** HRT counter of the last completed request */
+    int64                       lastActivity;
+
+    /** Next in the list of the connections */
+    HttpEventLoopConnection *   next;
+
+    HttpEventLoopConnection(){
+        socket       = NULL;
+        stream       = NULL;
+        state        = HEL_CONNECTION_IDLE;
+        lastActivity = 0;
+        next         = NULL;
+    }
+
+    ~HttpEventLoopConnection(){
+        if (stream != NULL) delete stream;
+        if (socket != NULL) delete socket;
+    }
+};
+
+/** A thread of the pool */
+class HttpEventLoopWorker{
+public:
+    /** The owner */
+    HttpEventLoop * loop;
+
+    /** The thread identifier */
+    TID             threadID;
+
+    /** True while the thread is alive */
+    volatile bool   isThreadRunning;
+
+    /** Number of requests served */
+    uint32          requests;
+
+    HttpEventLoopWorker(){
+        loop            = NULL;
+        threadID        = 0;
+        isThreadRunning = False;
+        requests        = 0;
+    }
+};
+
+extern "C" {
+    /** The worker thread */
+    void HttpEventLoopWorkerThread(HttpEventLoopWorker &worker);
+}
+
+class HttpEventLoop{
+
+    friend void HttpEventLoopWorkerThread(HttpEventLoopWorker &worker);
+
+private:
+    /** The owner of the connections */
+    HttpBasicService *          service;
+
+    /** The listening socket of the service */
+    TCPSocket *                 server;
+
+    /** The epoll descriptor */
+    int32                       epollFd;
+
+    /** The pool */
+    HttpEventLoopWorker *       workers;
+
+    /** Number of workers */
+    int32                       nOfWorkers;
+
+    /** The open connections. Listener thread only */
+    HttpEventLoopConnection *   connections;
+
+    /** Number of open connections */
+    int32                       nOfConnections;
+
+    /** Beyond this number the new connections are refused */
+    int32                       maxConnections;
+
+    /** Idle connections are closed after this time */
+    int32                       keepAliveMsec;
+
+    /** The connections waiting for a worker (a ring of maxConnections) */
+    HttpEventLoopConnection **  readyQueue;
+
+    /** Position of the first connection in readyQueue */
+    int32                       readyFirst;
+
+    /** Number of connections in readyQueue */
+    int32                       readySize;
+
+    /** Protects readyQueue and the state of the connections */
+    MutexSem                    mux;
+
+    /** Posted when a connection is queued */
+    EventSem                    readyEvent;
+
+    /** Asks the workers to exit */
+    volatile bool               stopWorkers;
+
+    /** HRT counter of the last scan for idle connections */
+    int64                       lastScan;
+
+    /** Connections accepted */
+    uint32                      accepted;
+
+    /** Connections refused because of maxConnections */
+    uint32                      refused;
+
+    /** Connections closed because idle */
+    uint32                      expired;
+
+    /** Accepts all the pending connections */
+    void Accept();
+
+    /** True if the client has closed the connection and there is nothing left to read */
+    bool PeerClosed(HttpEventLoopConnection *connection, uint32 events);
+
+    /** Queues a connection for the workers */
+    void Dispatch(HttpEventLoopConnection *connection);
+
+    /** Deletes the closed connections and closes the idle ones */
+    void Scan(bool closeAll);
+
+    /** Closes a connection. Called by the thread owning it */
+    void Close(HttpEventLoopConnection *connection);
+
+    /** Serves the requests of a connection and rearms it. Worker threads */
+    void Serve(HttpEventLoopConnection *connection);
+
+    /** Takes the next connection from readyQueue, waiting up to msecTimeout */
+    HttpEventLoopConnection *NextReady(int32 msecTimeout);
+
+public:
+
+    HttpEventLoop();
+
+    ~HttpEventLoop(){
+        Finish();
+    }
+
+    /**
+     * Creates the epoll descriptor and starts the workers
+     * @param hs The service whose requests are processed
+     * @param listeningSocket The non blocking listening socket of the service
+     * @param numberOfWorkers The size of the pool
+     * @param workerCPUMask The CPUs where the workers may run (0 not set)
+     * @param maximumConnections Maximum number of open connections
+     * @param keepAliveTimeout Idle connections are closed after this time (ms)
+     */
+    bool Initialise(HttpBasicService &hs, TCPSocket &listeningSocket, int32 numberOfWorkers, uint32 workerCPUMask, int32 maximumConnections, int32 keepAliveTimeout);
+
+    /** Waits for the events and dispatches them. Called in loop by the listener thread */
+    bool Poll(int32 msecTimeout);
+
+    /** Stops the workers and closes all the connections */
+    void Finish();
+
+    /** Number of open connections */
+    int32 NumberOfConnections() const{
+        return nOfConnections;
+    }
+
+    /** Connections accepted since Initialise */
+    uint32 Accepted() const{
+        return accepted;
+    }
+
+    /** Connections refused since Initialise */
+    uint32 Refused() const{
+        return refused;
+    }
+
+    /** Idle connections closed since Initialise */
+    uint32 Expired() const{
+        return expired;
+    }
+};
+
+#endif
+
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+#include "HttpPathCacheResource.h"
+#include "GlobalObjectDataBase.h"
+#include "CDBExtended.h"
+
+OBJECTLOADREGISTER(HttpPathCacheResource,"$Id$")
+
+/** Sorts the entries by decreasing number of hits */
+static int HPCRCompareHits(const void *a,const void *b){
+    uint32 hitsA = ((const GODBPathCacheEntry *)a)->hits;
+    uint32 hitsB = ((const GODBPathCacheEntry *)b)->hits;
+    if (hitsA > hitsB) return -1;
+    if (hitsA < hitsB) return 1;
+    return 0;
+}
+
+bool HttpPathCacheResource::ObjectLoadSetup(ConfigurationDataBase &info,StreamInterface *err){
+    bool ret = GCNamedObject::ObjectLoadSetup(info,err);
+    ret = ret && HttpInterface::ObjectLoadSetup(info,err);
+
+    CDBExtended cdb(info);
+    int32 entries = 256;
+    cdb.ReadInt32(entries,"MaxEntries",256);
+    if (entries < 0) entries = 0;
+    maxEntries = entries;
+    return ret;
+}
+
+bool HttpPathCacheResource::ProcessHttpMessage(HttpStream &hStream) {
+
+    FString command;
+    if (hStream.Switch("InputCommands.Cache")){
+        hStream.Seek(0);
+        uint32 size = hStream.Size();
+        command.SetSize(size);
+        hStream.Read(command.BufferReference(),size);
+    }
+    hStream.Switch(NormalStreamMode);
+    if (command == "Enable")  GODBPathCacheEnable(True);
+    if (command == "Disable") GODBPathCacheEnable(False);
+
+    GODBPathCacheStatistics statistics;
+    GODBPathCacheGetStatistics(statistics);
+
+    hStream.Printf( "<html><head>" );
+    hStream.Printf( "<style type=\"text/css\">\n" );
+    hStream.Printf("%s\n", css);
+    hStream.Printf( "</style>\n" );
+    hStream.Printf("<TITLE>GODB path cache</TITLE>\n");
+    hStream.Printf("</head>");
+    hStream.Printf("<BODY BGCOLOR=\"#ffffff\">""<H1>GODB path cache</H1>\n");
+    hStream.SSPrintf("OutputHttpOtions.Content-Type","text/html");
+    HtmlStream hmStream(hStream);
+
+    hmStream.SSPrintf(HtmlTagStreamMode,"P");
+    if (statistics.enabled){
+        hmStream.Printf("Enabled ");
+        hmStream.SSPrintf(HtmlTagStreamMode,"A HREF=\"?Cache=Disable\"");
+        hmStream.Printf("(disable)");
+    } else {
+        hmStream.Printf("Disabled ");
+        hmStream.SSPrintf(HtmlTagStreamMode,"A HREF=\"?Cache=Enable\"");
+        hmStream.Printf("(enable)");
+    }
+    hmStream.SSPrintf(HtmlTagStreamMode,"/A");
+    hmStream.SSPrintf(HtmlTagStreamMode,"/P");
+
+    hmStream.SSPrintf(HtmlTagStreamMode,"TABLE CLASS=\"bltable\"");
+    const char *labels[] = {"Lookups","Hits","Misses","Hit rate (%)","Invalidations","Entries"};
+    double hitRate = (statistics.lookups > 0) ? (100.0 * statistics.hits / statistics.lookups) : 0.0;
+    for (uint32 i = 0; i < sizeof(labels) / sizeof(labels[0]); i++){
+        hmStream.SSPrintf(HtmlTagStreamMode,"TR");
+        hmStream.SSPrintf(HtmlTagStreamMode,"TH");
+        hmStream.Printf("%s", labels[i]);
+        hmStream.SSPrintf(HtmlTagStreamMode,"/TH");
+        hmStream.SSPrintf(HtmlTagStreamMode,"TD");
+        switch(i){
+            case 0: hmStream.Printf("%u", statistics.lookups);       break;
+            case 1: hmStream.Printf("%u", statistics.hits);          break;
+            case 2: hmStream.Printf("%u", statistics.misses);        break;
+            case 3: hmStream.Printf("%.1f", hitRate);                break;
+            case 4: hmStream.Printf("%u", statistics.invalidations); break;
+            case 5: hmStream.Printf("%u", statistics.entries);       break;
+        }
+        hmStream.SSPrintf(HtmlTagStreamMode,"/TD");
+        hmStream.SSPrintf(HtmlTagStreamMode,"/TR");
+    }
+    hmStream.SSPrintf(HtmlTagStreamMode,"/TABLE");
+
+    GODBPathCacheEntry *entries = NULL;
+    uint32 nOfEntries = 0;
+    if (maxEntries > 0){
+        entries = (GODBPathCacheEntry *)malloc(maxEntries * sizeof(GODBPathCacheEntry));
+    }
+    if (entries != NULL){
+        nOfEntries = GODBPathCacheGetEntries(entries,maxEntries);
+        qsort(entries,nOfEntries,sizeof(GODBPathCacheEntry),HPCRCompareHits);
+    }
+
+    hmStream.SSPrintf(HtmlTagStreamMode,"TABLE CLASS=\"bltable\"");
+    hmStream.SSPrintf(HtmlTagStreamMode,"TR");
+    hmStream.SSPrintf(HtmlTagStreamMode,"TH");
+    hmStream.Printf("Path");
+    hmStream.SSPrintf(HtmlTagStreamMode,"/TH");
+    hmStream.SSPrintf(HtmlTagStreamMode,"TH");
+    hmStream.Printf("Class");
+    hmStream.SSPrintf(HtmlTagStreamMode,"/TH");
+    hmStream.SSPrintf(HtmlTagStreamMode,"TH");
+    hmStream.Printf("Hits");
+    hmStream.SSPrintf(HtmlTagStreamMode,"/TH");
+    hmStream.SSPrintf(HtmlTagStreamMode,"/TR");
+    for (uint32 i = 0; i < nOfEntries; i++){
+        hmStream.SSPrintf(HtmlTagStreamMode,"TR");
+        hmStream.SSPrintf(HtmlTagStreamMode,"TD");
+        hmStream.Printf("%s", entries[i].path);
+        hmStream.SSPrintf(HtmlTagStreamMode,"/TD");
+        hmStream.SSPrintf(HtmlTagStreamMode,"TD");
+        hmStream.Printf("%s", entries[i].className);
+        hmStream.SSPrintf(HtmlTagStreamMode,"/TD");
+        hmStream.SSPrintf(HtmlTagStreamMode,"TD");
+        hmStream.Printf("%u", entries[i].hits);
+        hmStream.SSPrintf(HtmlTagStreamMode,"/TD");
+        hmStream.SSPrintf(HtmlTagStreamMode,"/TR");
+    }
+    hmStream.SSPrintf(HtmlTagStreamMode,"/TABLE");
+    if (entries != NULL) free((void *&)entries);
+
+    //copy to the client
+    hStream.WriteReplyHeader(True);
+    return True;
+}
+
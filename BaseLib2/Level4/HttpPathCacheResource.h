@@ -0,0 +1,91 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Renders the counters and the content of the path cache of the GlobalObjectDataBase
+ */
+
+#if !defined (HTTP_PATH_CACHE_RESOURCE)
+#define HTTP_PATH_CACHE_RESOURCE
+
+#include "System.h"
+#include "HttpStream.h"
+#include "HttpInterface.h"
+#include "HtmlStream.h"
+
+
+OBJECT_DLL(HttpPathCacheResource)
+/** a HTTP node showing the lookups of GODBFindByName.
+    The page accepts Cache=Enable and Cache=Disable */
+class HttpPathCacheResource: public GCNamedObject,public HttpInterface{
+    OBJECT_DLL_STUFF(HttpPathCacheResource)
+private:
+    const char *css;
+
+    /** Maximum number of cached paths listed */
+    uint32      maxEntries;
+
+public:
+
+    /** the main entry point for HttpInterface */
+    virtual     bool                ProcessHttpMessage(HttpStream &hStream);
+
+    /** the default constructor */
+    HttpPathCacheResource(){
+         maxEntries = 256;
+         css = "table.bltable {"
+                 "margin: 1em 1em 1em 2em;"
+                 "background: whitesmoke;"
+                 "border-collapse: collapse;"
+               "}"
+               "table.bltable th, table.bltable td {"
+                 "border: 1px silver solid;"
+                 "padding: 0.2em;"
+               "}"
+               "table.bltable th {"
+                  "background: gainsboro;"
+                  "text-align: left;"
+               "}";
+    }
+
+    /** save an object content into a set of configs */
+    virtual     bool                ObjectSaveSetup(
+            ConfigurationDataBase &     info,
+            StreamInterface *           err){
+
+        GCNamedObject::ObjectSaveSetup(info,err);
+        return HttpInterface::ObjectSaveSetup(info,err);
+    }
+
+    /**  initialise an object from a set of configs
+         MaxEntries = number of cached paths listed (256) */
+    virtual     bool                ObjectLoadSetup(
+            ConfigurationDataBase &     info,
+            StreamInterface *           err);
+
+};
+
+#endif
+
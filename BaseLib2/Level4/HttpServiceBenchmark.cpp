@@ -0,0 +1,239 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Load test of HttpBasicService on localhost. A server with a single small
+ * page is started in the selected mode and a number of client threads
+ * request the page as fast as possible, either opening a new connection for
+ * each request or reusing a keep-alive connection.
+ * Reports the connections/s, the requests/s and the latency percentiles.
+ *
+ * Usage: HttpServiceBenchmark.ex [ThreadPerConnection|EventLoop] [clients] [requestsPerClient] [close|keepalive] [workers] [port]
+ */
+
+#include "System.h"
+#include "HttpBasicService.h"
+#include "HttpInterface.h"
+#include "HttpStream.h"
+#include "TCPSocket.h"
+#include "HRT.h"
+#include "Sleep.h"
+#include "Threads.h"
+#include "Atomic.h"
+
+/** The page served */
+class HSBPage: public GCNamedObject, public HttpInterface{
+public:
+    virtual bool ProcessHttpMessage(HttpStream &hStream){
+        hStream.SSPrintf("OutputHttpOtions.Content-Type","text/plain");
+        hStream.Printf("MARTe HttpServiceBenchmark\n");
+        hStream.WriteReplyHeader(True);
+        return True;
+    }
+};
+
+/** Shared by the client threads */
+struct HSBContext{
+    int32           port;
+    int32           requestsPerClient;
+    bool            keepAlive;
+    volatile int32  started;
+    volatile int32  go;
+    volatile int32  finished;
+    volatile int32  failures;
+    volatile int32  connections;
+};
+
+/** One client */
+struct HSBClient{
+    HSBContext *    context;
+    /** Latency of each request in HRT ticks */
+    int64 *         latencies;
+    int32           completed;
+};
+
+/** Reads a whole reply: the header and Content-Length bytes of body */
+static bool HSBReadReply(TCPSocket &socket, char *buffer, uint32 bufferSize){
+    uint32 filled = 0;
+    int32  headerEnd = -1;
+    int32  contentLength = 0;
+    while (True){
+        uint32 size = bufferSize - filled - 1;
+        if (size == 0) return False;
+        if (!socket.BasicRead(buffer + filled, size) || (size == 0)) return False;
+        filled += size;
+        buffer[filled] = 0;
+        if (headerEnd < 0){
+            char *end = strstr(buffer, "\r\n\r\n");
+            if (end == NULL) continue;
+            headerEnd = (end - buffer) + 4;
+            const char *length = strstr(buffer, "Content-Length:");
+            if ((length != NULL) && (length < end)) contentLength = atoi(length + 15);
+        }
+        if (filled >= (uint32)(headerEnd + contentLength)) return True;
+    }
+}
+
+static void HSBClientThread(void *arg){
+    HSBClient  *client  = (HSBClient *)arg;
+    HSBContext *context = client->context;
+    char request[256];
+    char reply[4096];
+    sprintf(request, "GET /page HTTP/1.1\r\nHost: localhost\r\nConnection: %s\r\n\r\n", context->keepAlive ? "keep-alive" : "close");
+
+    Atomic::Increment(&context->started);
+    while (!context->go) SleepMsec(1);
+
+    TCPSocket *socket = NULL;
+    for (int32 i = 0; i < context->requestsPerClient; i++){
+        int64 start = HRT::HRTCounter();
+        if (socket == NULL){
+            socket = new TCPSocket;
+            if (!socket->Open() || !socket->Connect("localhost", context->port, 5000, 1)){
+                Atomic::Increment(&context->failures);
+                delete socket;
+                socket = NULL;
+                continue;
+            }
+            Atomic::Increment(&context->connections);
+        }
+        uint32 size = strlen(request);
+        bool ok = socket->BasicWrite(request, size) && HSBReadReply(*socket, reply, sizeof(reply));
+        if (ok){
+            client->latencies[client->completed++] = HRT::HRTCounter() - start;
+        } else {
+            Atomic::Increment(&context->failures);
+        }
+        if (!ok || !context->keepAlive){
+            socket->Close();
+            delete socket;
+            socket = NULL;
+        }
+    }
+    if (socket != NULL){
+        socket->Close();
+        delete socket;
+    }
+    Atomic::Increment(&context->finished);
+}
+
+static int HSBCompare(const void *a, const void *b){
+    int64 x = *(const int64 *)a;
+    int64 y = *(const int64 *)b;
+    if (x < y) return -1;
+    if (x > y) return 1;
+    return 0;
+}
+
+int main(int argc, char **argv){
+    const char *mode         = (argc > 1) ? argv[1] : "EventLoop";
+    int32 nOfClients         = (argc > 2) ? atoi(argv[2]) : 16;
+    int32 requestsPerClient  = (argc > 3) ? atoi(argv[3]) : 1000;
+    bool  keepAlive          = (argc > 4) ? (strcmp(argv[4], "keepalive") == 0) : False;
+    int32 nOfWorkers         = (argc > 5) ? atoi(argv[5]) : 4;
+    int32 port               = (argc > 6) ? atoi(argv[6]) : 8765;
+    bool  eventLoop          = (strcmp(mode, "EventLoop") == 0);
+
+    if ((nOfClients < 1) || (requestsPerClient < 1) || (!eventLoop && (strcmp(mode, "ThreadPerConnection") != 0))){
+        printf("Usage: %s [ThreadPerConnection|EventLoop] [clients] [requestsPerClient] [close|keepalive] [workers] [port]\n", argv[0]);
+        return -1;
+    }
+
+    GCRTemplate<GCReferenceContainer> root(GCFT_Create);
+    GCRTemplate<HSBPage> page(GCFT_Create);
+    page->SetObjectName("page");
+    root->Insert(page);
+
+    GCRTemplate<HttpBasicService> service(GCFT_Create);
+    service->SetObjectName("HSB");
+    service->Setup(port, root);
+    service->SetEventLoop(eventLoop, nOfWorkers, 0, nOfClients + 16, 5000);
+    if (!service->Start()){
+        printf("Cannot start the server\n");
+        return -1;
+    }
+    // wait for the listening socket
+    TCPSocket probe;
+    bool listening = False;
+    for (int32 i = 0; (i < 200) && !listening; i++){
+        probe.Open();
+        listening = probe.Connect("localhost", port, 100, 1);
+        probe.Close();
+        if (!listening) SleepMsec(100);
+    }
+    if (!listening){
+        printf("The server is not listening on port %d\n", port);
+        return -1;
+    }
+
+    HSBContext context;
+    context.port              = port;
+    context.requestsPerClient = requestsPerClient;
+    context.keepAlive         = keepAlive;
+    context.started           = 0;
+    context.go                = 0;
+    context.finished          = 0;
+    context.failures          = 0;
+    context.connections       = 0;
+
+    HSBClient *clients = new HSBClient[nOfClients];
+    for (int32 c = 0; c < nOfClients; c++){
+        clients[c].context   = &context;
+        clients[c].latencies = new int64[requestsPerClient];
+        clients[c].completed = 0;
+        Threads::BeginThread(HSBClientThread, &clients[c], THREADS_DEFAULT_STACKSIZE, "HSBClient");
+    }
+    while (context.started < nOfClients) SleepMsec(1);
+    int64 start = HRT::HRTCounter();
+    context.go = 1;
+    while (context.finished < nOfClients) SleepMsec(1);
+    double elapsed = (HRT::HRTCounter() - start) * HRT::HRTPeriod();
+
+    int32 completed = 0;
+    for (int32 c = 0; c < nOfClients; c++) completed += clients[c].completed;
+    int64 *latencies = new int64[completed > 0 ? completed : 1];
+    int32 n = 0;
+    for (int32 c = 0; c < nOfClients; c++){
+        for (int32 i = 0; i < clients[c].completed; i++) latencies[n++] = clients[c].latencies[i];
+        delete[] clients[c].latencies;
+    }
+    delete[] clients;
+    qsort(latencies, n, sizeof(int64), HSBCompare);
+
+    double usec = HRT::HRTPeriod() * 1e6;
+    printf("%s %s clients = %d workers = %d\n", mode, keepAlive ? "keepalive" : "close", nOfClients, eventLoop ? nOfWorkers : nOfClients);
+    printf("requests    = %d (%d failed) in %.3f s\n", completed, context.failures, elapsed);
+    printf("requests/s  = %.0f\n", completed / elapsed);
+    printf("connections/s = %.0f\n", context.connections / elapsed);
+    if (n > 0){
+        printf("latency us: p50 = %.1f p90 = %.1f p99 = %.1f max = %.1f\n",
+               latencies[n / 2] * usec, latencies[(int32)(n * 0.9)] * usec, latencies[(int32)(n * 0.99)] * usec, latencies[n - 1] * usec);
+    }
+    delete[] latencies;
+
+    service->Stop();
+    return 0;
+}
+
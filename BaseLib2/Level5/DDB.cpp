@@ -231,7 +231,11 @@ bool DDB::__CreateLink(DDBInterface& gamInterface){
         signal = signal->Next();
     }
 
-    return gamInterface.CheckConsecutyAndOptimizeInterface();
+    if(!gamInterface.CheckConsecutyAndOptimizeInterface()){
+        return False;
+    }
+
+    return gamInterface.BuildCopyPlan();
 }
 
 bool DDBCreateLinkToGAM(DDB &ddb, GCRTemplate<GAM> gam){
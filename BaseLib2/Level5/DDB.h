@@ -208,6 +208,13 @@ public:
     */
     bool CheckAndAllocate(){return DDBCheckAndAllocate(*this);}
 
+    /** The DDB memory.
+        @return NULL if the memory has not been allocated yet. */
+    char* Buffer(){return buffer;}
+
+    /** The size in bytes of the DDB memory. */
+    int32 BufferSize() const{return totalDDBSize;}
+
     /** Prints the DDB information on the specified stream.
         @param s The stream used in the operation. */
     void Print(Streamable& s){DDBPrint(*this,s);}
@@ -0,0 +1,210 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Compares the copy plan run by DDBInterface::Read() and Write() with the
+ * previous per word loop over the DataBufferPointer list, for interfaces of
+ * 10 and 1000 int32 signals and of 100000 int32 words:
+ * - read in the order in which they are stored in the DDB (one block);
+ * - read in the reverse order (one run per signal).
+ * The DDB links the signals by searching lists by name, which is quadratic
+ * in the number of signals: the 100000 words are 1000 signals of 100 words.
+ * Usage: DDBCopyPlanBenchmark.ex [wordsPerTest]
+ */
+
+#include "System.h"
+#include "DDB.h"
+#include "DDBInterface.h"
+#include "GAM.h"
+#include "HRT.h"
+
+/** Gives access to the protected Read() and Write() */
+class BenchmarkInterface: public DDBInterface {
+public:
+    BenchmarkInterface(const char *interfaceName, DDBInterfaceAccessMode accessMode): DDBInterface("DDBCopyPlanBenchmark", interfaceName, accessMode){
+    }
+
+    void RunRead(){
+        Read();
+    }
+
+    void RunWrite(){
+        Write();
+    }
+};
+
+/** The DataBufferPointer list of an interface, as CheckConsecutyAndOptimizeInterface builds it */
+struct PointerList{
+    DataBufferPointer   *pointers;
+    int32               *buffer;
+
+    PointerList(){
+        pointers = NULL;
+    }
+
+    ~PointerList(){
+        if (pointers != NULL) delete[] pointers;
+    }
+
+    /** Merges the signals which follow each other in the DDB */
+    void Build(int32 * const *signalAddresses, int32 nOfSignals, int32 signalSize, int32 *interfaceBuffer){
+        pointers = new DataBufferPointer[nOfSignals];
+        buffer   = interfaceBuffer;
+        int32 last = 0;
+        pointers[0].SetSignalParameters(signalAddresses[0], signalSize);
+        for (int32 i = 1; i < nOfSignals; i++){
+            if ((pointers[last].GetPointer() + pointers[last].GetSize()) == signalAddresses[i]){
+                pointers[last].SetSignalParameters(pointers[last].GetPointer(), pointers[last].GetSize() + signalSize);
+            }
+            else{
+                last++;
+                pointers[last].SetSignalParameters(signalAddresses[i], signalSize);
+            }
+        }
+    }
+
+    /** The previous DDBInterface::Read() */
+    void Read(const DDBInterface &ddbi){
+        int32* inputBufferIterator = buffer;
+        for (uint32 i = 0; (i < (uint32)ddbi.NumberOfEntries()) && (pointers[i].GetPointer() != NULL); i++){
+            const int32* innerPointersListIterator = pointers[i].GetPointer();
+            const int32* innerPointersListEnd      = innerPointersListIterator + pointers[i].GetSize();
+            while (innerPointersListIterator < innerPointersListEnd){
+                *inputBufferIterator++ = *innerPointersListIterator++;
+            }
+        }
+    }
+
+    /** The previous DDBInterface::Write() */
+    void Write(const DDBInterface &ddbi){
+        int32* inputBufferIterator = buffer;
+        for (uint32 i = 0; (i < (uint32)ddbi.NumberOfEntries()) && (pointers[i].GetPointer() != NULL); i++){
+            int32* innerPointersListIterator = pointers[i].GetPointer();
+            int32* innerPointersListEnd      = innerPointersListIterator + pointers[i].GetSize();
+            while (innerPointersListIterator < innerPointersListEnd){
+                *innerPointersListIterator++ = *inputBufferIterator++;
+            }
+        }
+    }
+};
+
+/**
+ * Links a writer of nOfSignals signals of signalSize words and a reader of
+ * the same signals, in the DDB order or reversed, and times both copy
+ * methods of each.
+ */
+bool RunCopyTest(int32 nOfSignals, int32 signalSize, bool reversed, int32 wordsPerTest){
+    DDB ddb;
+    BenchmarkInterface writer("Writer", DDB_WriteMode);
+    BenchmarkInterface reader("Reader", DDB_ReadMode);
+    int32 i;
+    for (i = 0; i < nOfSignals; i++){
+        FString name;
+        name.Printf("Signal%d[%d]", i, signalSize);
+        writer.AddSignal(name.Buffer(), "int32");
+    }
+    for (i = 0; i < nOfSignals; i++){
+        FString name;
+        name.Printf("Signal%d[%d]", reversed ? (nOfSignals - 1 - i) : i, signalSize);
+        reader.AddSignal(name.Buffer(), "int32");
+    }
+    if (!writer.Finalise() || !reader.Finalise() || !ddb.AddInterface(writer) || !ddb.AddInterface(reader) ||
+        !ddb.CheckAndAllocate() || !ddb.CreateLink(writer) || !ddb.CreateLink(reader)){
+        printf("Failed to build the DDB of %d signals\n", nOfSignals);
+        return False;
+    }
+
+    // Finds where each signal is stored by writing the index of its words
+    int32  nOfInterfaceWords = nOfSignals * signalSize;
+    int32 *ddbWords          = (int32 *)ddb.Buffer();
+    int32  nOfWords          = ddb.BufferSize() / sizeof(int32);
+    int32 **addresses        = new int32*[nOfSignals];
+    for (i = 0; i < nOfInterfaceWords; i++) writer.Buffer()[i] = i;
+    writer.RunWrite();
+    for (i = 0; i < nOfWords; i++){
+        if ((ddbWords[i] >= 0) && (ddbWords[i] < nOfInterfaceWords) && ((ddbWords[i] % signalSize) == 0)){
+            addresses[ddbWords[i] / signalSize] = ddbWords + i;
+        }
+    }
+    int32 **readerAddresses = new int32*[nOfSignals];
+    for (i = 0; i < nOfSignals; i++) readerAddresses[i] = addresses[reversed ? (nOfSignals - 1 - i) : i];
+
+    PointerList oldWriter;
+    PointerList oldReader;
+    oldWriter.Build(addresses, nOfSignals, signalSize, writer.Buffer());
+    oldReader.Build(readerAddresses, nOfSignals, signalSize, reader.Buffer());
+
+    int32 repetitions = wordsPerTest / nOfInterfaceWords;
+    if (repetitions < 10) repetitions = 10;
+    double perCycle = HRT::HRTPeriod() * 1e9 / repetitions;
+    int32 r;
+
+    int64 start = HRT::HRTCounter();
+    for (r = 0; r < repetitions; r++) oldWriter.Write(writer);
+    double oldWriteNs = (HRT::HRTCounter() - start) * perCycle;
+    start = HRT::HRTCounter();
+    for (r = 0; r < repetitions; r++) writer.RunWrite();
+    double newWriteNs = (HRT::HRTCounter() - start) * perCycle;
+
+    start = HRT::HRTCounter();
+    for (r = 0; r < repetitions; r++) oldReader.Read(reader);
+    double oldReadNs = (HRT::HRTCounter() - start) * perCycle;
+    // the reader must see the values written, in its own order
+    memset(reader.Buffer(), 0xff, nOfInterfaceWords * sizeof(int32));
+    start = HRT::HRTCounter();
+    for (r = 0; r < repetitions; r++) reader.RunRead();
+    double newReadNs = (HRT::HRTCounter() - start) * perCycle;
+
+    bool ok = True;
+    for (i = 0; (i < nOfInterfaceWords) && ok; i++){
+        int32 signal = i / signalSize;
+        if (reversed) signal = nOfSignals - 1 - signal;
+        ok = (reader.Buffer()[i] == (signal * signalSize + i % signalSize));
+    }
+
+    printf("signals = %5d x %3d words %-8s Write: old = %10.1f ns new = %10.1f ns  Read: old = %10.1f ns new = %10.1f ns %s\n",
+           nOfSignals, signalSize, reversed ? "reversed" : "ordered", oldWriteNs, newWriteNs, oldReadNs, newReadNs, ok ? "" : "DATA MISMATCH");
+
+    delete[] addresses;
+    delete[] readerAddresses;
+    return ok;
+}
+
+int main(int argc, char **argv){
+    int32 wordsPerTest = (argc > 1) ? atoi(argv[1]) : 10000000;
+    if (wordsPerTest < 1){
+        printf("Usage: DDBCopyPlanBenchmark.ex [wordsPerTest]\n");
+        return -1;
+    }
+
+    const int32 signals[]     = {10, 1000, 1000};
+    const int32 signalSizes[] = {1,  1,    100};
+    bool ok = True;
+    for (uint32 i = 0; i < sizeof(signals) / sizeof(signals[0]); i++){
+        ok = RunCopyTest(signals[i], signalSizes[i], False, wordsPerTest) && ok;
+        ok = RunCopyTest(signals[i], signalSizes[i], True, wordsPerTest) && ok;
+    }
+    return ok ? 0 : -1;
+}
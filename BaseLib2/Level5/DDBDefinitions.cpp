@@ -50,6 +50,9 @@ void DDBStoringProperties::Print(StreamInterface& s) const{
     if (CheckMask(DDB_Consecutive)) s.Write("C ",size);
     else s.Write("  ",size);
 
+    if (CheckMask(DDB_ZeroCopy)) s.Write("Z ",size);
+    else s.Write("  ",size);
+
     size=3;
     if (CheckMask(DDB_Unsized)) s.Write("U |",size);
     else s.Write("  |",size);
@@ -401,4 +401,9 @@ const DDBStoringProperties DDB_Consecutive(0x02);
 /** The dimensions of signal are not fully specified. */
 const DDBStoringProperties DDB_Unsized(0x04);
 
+/** A read only interface accesses the signal directly in the DDB memory
+    instead of copying it to a private buffer. Only honoured if all the
+    signals of the interface have it set and are consecutive in the DDB. */
+const DDBStoringProperties DDB_ZeroCopy(0x08);
+
 #endif
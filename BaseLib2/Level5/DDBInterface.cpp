@@ -203,6 +203,10 @@ bool DDBIObjectLoadSetup(DDBInterface&         ddbi, ConfigurationDataBase&
         cdb.ReadFString(consecutive,"MemoryConsecutive","False");
         if(consecutive == "True") properties |= DDB_Consecutive;
 
+        FString zeroCopy;
+        cdb.ReadFString(zeroCopy,"ZeroCopy","False");
+        if(zeroCopy == "True") properties |= DDB_ZeroCopy;
+
         if(!ddbi.AddSignal(compositeName.Buffer(),signalType.Buffer(),properties)){
             ddbi.AssertErrorCondition(InitialisationError,"DDBInterface::ObjectLoadSetup: failed to add signal %s of type %s to interface",compositeName.Buffer(),signalType.Buffer());
             return False;
@@ -480,6 +484,7 @@ bool DDBIFinalise(DDBInterface&         ddbi){
         }
 
         memset(ddbi.buffer                ,0,totalBufferSize);
+        ddbi.localBuffer = ddbi.buffer;
         ddbi.finalised=True;
 
     }
@@ -590,6 +595,9 @@ bool DDBInterface::ResetPointerList(){
         for(uint32 i = 0; i < listOfSignalDescriptors.ListSize(); i++){
             ddbSignalPointers[i].SetSignalParameters(NULL,ddbSignalPointers[i].GetSize());
         }
+        // Nothing is copied until the interface is linked again
+        numberOfCopyRuns = 0;
+        buffer           = localBuffer;
         return True;
     }
     AssertErrorCondition(InitialisationError,"ResetPointerList: Cannot reinitialize an interface %s which is not finalized",ddbInterfaceDescriptor.InterfaceName());
@@ -691,6 +699,135 @@ bool DDBInterface::CheckConsecutyAndOptimizeInterface(){
     return False;
 }
 
+/** Orders the copy runs by their DDB address. */
+static int DDBCopyRunCompare(const void *a, const void *b){
+    const int32 *pointerA = ((const DDBCopyRun *)a)->DDBPointer();
+    const int32 *pointerB = ((const DDBCopyRun *)b)->DDBPointer();
+    if(pointerA < pointerB) return -1;
+    if(pointerA > pointerB) return 1;
+    return 0;
+}
+
+bool DDBInterface::BuildCopyPlan(){
+    if(!finalised){
+        AssertErrorCondition(InitialisationError,"BuildCopyPlan: Cannot compile the copy plan of interface %s which is not finalized",ddbInterfaceDescriptor.InterfaceName());
+        return False;
+    }
+
+    numberOfCopyRuns = 0;
+    buffer           = localBuffer;
+    if(copyPlan != NULL){
+        delete[] copyPlan;
+        copyPlan = NULL;
+    }
+
+    // The optimized pointer list is terminated by the first NULL entry
+    uint32 numberOfRuns = 0;
+    while((numberOfRuns < listOfSignalDescriptors.ListSize()) && (ddbSignalPointers[numberOfRuns].GetPointer() != NULL)){
+        numberOfRuns++;
+    }
+    if((numberOfRuns == 0) || (buffer == NULL)){
+        return True;
+    }
+
+    DDBCopyRun *plan   = new DDBCopyRun[numberOfRuns];
+    DDBCopyRun *sorted = new DDBCopyRun[numberOfRuns];
+    if((plan == NULL) || (sorted == NULL)){
+        AssertErrorCondition(InitialisationError,"BuildCopyPlan: Failed allocating memory for %d copy runs in interface %s",numberOfRuns,ddbInterfaceDescriptor.InterfaceName());
+        if(plan != NULL)   delete[] plan;
+        if(sorted != NULL) delete[] sorted;
+        return False;
+    }
+
+    int32 *bufferIterator = buffer;
+    uint32 i;
+    for(i = 0; i < numberOfRuns; i++){
+        plan[i].SetRunParameters(ddbSignalPointers[i].GetPointer(),bufferIterator,ddbSignalPointers[i].GetSize());
+        sorted[i] = plan[i];
+        bufferIterator += ddbSignalPointers[i].GetSize();
+    }
+
+    // Sort by DDB address for sequential access. If two runs share DDB
+    // words the order of the writes matters and the list order is kept.
+    qsort(sorted, numberOfRuns, sizeof(DDBCopyRun), DDBCopyRunCompare);
+    bool overlapping = False;
+    for(i = 1; (i < numberOfRuns) && !overlapping; i++){
+        overlapping = ((sorted[i-1].DDBPointer() + sorted[i-1].GetSize()) > sorted[i].DDBPointer());
+    }
+    if(!overlapping){
+        DDBCopyRun *temp = plan;
+        plan   = sorted;
+        sorted = temp;
+    }
+    delete[] sorted;
+
+    // Merge runs which are consecutive both in the DDB and in the buffer
+    uint32 last = 0;
+    for(i = 1; i < numberOfRuns; i++){
+        int32 size = plan[last].GetSize();
+        if(((plan[last].DDBPointer() + size) == plan[i].DDBPointer()) && ((plan[last].BufferPointer() + size) == plan[i].BufferPointer())){
+            plan[last].SetRunParameters(plan[last].DDBPointer(),plan[last].BufferPointer(),size + plan[i].GetSize());
+        }
+        else{
+            last++;
+            plan[last] = plan[i];
+        }
+    }
+
+    copyPlan         = plan;
+    numberOfCopyRuns = last + 1;
+
+    if(!ZeroCopyRequested()){
+        return True;
+    }
+
+    // A read only interface whose signals form a single block in the DDB
+    // can use the DDB memory directly: Read() has nothing left to do.
+    if(!(ddbInterfaceDescriptor.AccessMode() == DDB_ReadMode)){
+        AssertErrorCondition(Warning,"BuildCopyPlan: ZeroCopy ignored for interface %s since it is not read only",ddbInterfaceDescriptor.InterfaceName());
+        return True;
+    }
+    if((numberOfCopyRuns != 1) || (copyPlan[0].BufferPointer() != localBuffer) || (copyPlan[0].GetSize() != bufferWordSize)){
+        AssertErrorCondition(Warning,"BuildCopyPlan: ZeroCopy ignored for interface %s since its signals are not consecutive in the DDB",ddbInterfaceDescriptor.InterfaceName());
+        return True;
+    }
+    buffer           = copyPlan[0].DDBPointer();
+    numberOfCopyRuns = 0;
+    return True;
+}
+
+bool DDBInterface::SharesDDBMemory(const DDBInterface &other) const{
+    if((ddbSignalPointers == NULL) || (other.ddbSignalPointers == NULL)){
+        return False;
+    }
+    for(uint32 i = 0; (i < listOfSignalDescriptors.ListSize()) && (ddbSignalPointers[i].GetPointer() != NULL); i++){
+        const int32 *start = ddbSignalPointers[i].GetPointer();
+        const int32 *end   = start + ddbSignalPointers[i].GetSize();
+        for(uint32 j = 0; (j < other.listOfSignalDescriptors.ListSize()) && (other.ddbSignalPointers[j].GetPointer() != NULL); j++){
+            const int32 *otherStart = other.ddbSignalPointers[j].GetPointer();
+            const int32 *otherEnd   = otherStart + other.ddbSignalPointers[j].GetSize();
+            if((start < otherEnd) && (otherStart < end)){
+                return True;
+            }
+        }
+    }
+    return False;
+}
+
+bool DDBInterface::ZeroCopyRequested() const{
+    if(listOfSignalDescriptors.ListSize() == 0){
+        return False;
+    }
+    const DDBSignalDescriptor *signal = SignalsList();
+    while(signal != NULL){
+        if(!signal->SignalStoringProperties().CheckMask(DDB_ZeroCopy)){
+            return False;
+        }
+        signal = signal->Next();
+    }
+    return True;
+}
+
 DDBSignalDescriptor* DDBInterface::Find(const char* signalName, uint32 &index){
     if(index > listOfSignalDescriptors.ListSize()){
         AssertErrorCondition(FatalError,"Try to access element %s at %d out of the list[%d].",signalName,index,listOfSignalDescriptors.ListSize());
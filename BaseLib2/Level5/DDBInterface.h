@@ -114,6 +114,76 @@ public:
     }
 };
 
+/** Runs shorter than this number of words are copied inline instead of calling memcpy. */
+#define DDB_COPY_SHORT_RUN_WORDS 8
+
+/** Copies size int32 words from source to destination. Short runs are
+    copied word by word, longer ones use the (vectorised) system memcpy. */
+static inline void DDBCopyWords(int32 *destination, const int32 *source, int32 size){
+    if(size <= DDB_COPY_SHORT_RUN_WORDS){
+        const int32 *sourceEnd = source + size;
+        while(source < sourceEnd){
+            *destination++ = *source++;
+        }
+    }
+    else{
+        memcpy(destination, source, size * sizeof(int32));
+    }
+}
+
+/** DDBCopyRun describes one contiguous block copy between the DDB and the
+    interface buffer. The list of DDBCopyRun (the copy plan) is compiled
+    when the interface is linked to the DDB.
+ */
+
+class DDBCopyRun{
+
+private:
+    // Pointer to the first word in the DDB
+    int32     *ddbPointer;
+
+    // Pointer to the first word in the interface buffer
+    int32     *bufferPointer;
+
+    // Number of int32 words to copy
+    int32     runSize;
+public:
+
+    DDBCopyRun(){
+        ddbPointer    = NULL;
+        bufferPointer = NULL;
+        runSize       = 0;
+    }
+
+    void SetRunParameters(int32 *ddbPointer, int32 *bufferPointer, int32 runSize){
+        this->ddbPointer    = ddbPointer;
+        this->bufferPointer = bufferPointer;
+        this->runSize       = runSize;
+    }
+
+    int32* DDBPointer()const{
+        return ddbPointer;
+    }
+
+    int32* BufferPointer()const{
+        return bufferPointer;
+    }
+
+    int32 GetSize()const{
+        return runSize;
+    }
+
+    /** Copies the run from the DDB to the interface buffer. */
+    inline void CopyFromDDB()const{
+        DDBCopyWords(bufferPointer, ddbPointer, runSize);
+    }
+
+    /** Copies the run from the interface buffer to the DDB. */
+    inline void CopyToDDB()const{
+        DDBCopyWords(ddbPointer, bufferPointer, runSize);
+    }
+};
+
 /** The ddbInterface used by GAM. The ddbInterface is build around the access
     method is being used to collect data. Signals with the same access mode
     should be grouped and accessed in a unique operation for efficiency.
@@ -172,12 +242,22 @@ private:
     /** Array of pointers to specific DDB signals. */
     DataBufferPointer            *ddbSignalPointers;
 
-    /** A pointer to the working buffer of this interface. */
+    /** A pointer to the working buffer of this interface. It is either
+        localBuffer or, in zero-copy mode, a pointer into the DDB memory. */
     int32*                        buffer;
 
+    /** The private buffer allocated by Finalise. */
+    int32*                        localBuffer;
+
     /** Buffer Word Size */
     int32                         bufferWordSize;
 
+    /** The copy plan used by Read() and Write(). */
+    DDBCopyRun                   *copyPlan;
+
+    /** Number of entries in the copyPlan. */
+    uint32                        numberOfCopyRuns;
+
     /** This method reset the pointer list. It should only be called by
         a DDB class to allow reinitialization. */
     bool ResetPointerList();
@@ -189,6 +269,16 @@ private:
     */
     bool CheckConsecutyAndOptimizeInterface();
 
+    /** This function should be called by the DDB after CheckConsecutyAndOptimizeInterface.
+        It compiles the ddbSignalPointers array in a flat list of block copies, sorted by
+        DDB address (when the DDB ranges do not overlap) and merged where possible.
+        @return True if everything goes well. False if the interface has not been finalized.
+    */
+    bool BuildCopyPlan();
+
+    /** @return True if all the signals of the interface have the DDB_ZeroCopy property. */
+    bool ZeroCopyRequested() const;
+
 private:
 
     /** A status from where the interface can be linked to the DDB. */
@@ -266,7 +356,10 @@ public:
                  DDBInterfaceAccessMode requestedAccessMode) :ddbInterfaceDescriptor(ownerName, interfaceName, requestedAccessMode){
         ddbSignalPointers      = NULL;
         buffer                 = NULL;
+        localBuffer            = NULL;
         bufferWordSize         = 0;
+        copyPlan               = NULL;
+        numberOfCopyRuns       = 0;
         finalised              = False;
    }
 
@@ -275,8 +368,11 @@ public:
         if (ddbSignalPointers!=NULL){
             delete[] ddbSignalPointers;
         }
-        if(buffer != NULL){
-            free((void*&)buffer);
+        if (copyPlan!=NULL){
+            delete[] copyPlan;
+        }
+        if(localBuffer != NULL){
+            free((void*&)localBuffer);
         }
     };
 
@@ -346,9 +442,21 @@ public:
     */
     bool IsFinalised() const{ return finalised;}
 
-    /** Returns the Interface Buffer */
+    /** Returns the Interface Buffer.
+        For DDB_ZeroCopy interfaces this points directly to the DDB memory
+        and changes when the interface is linked: it must be read after
+        the link and never written to. */
     int32 *Buffer(){return buffer;}
 
+    /** Returns True if the interface Buffer() aliases the DDB memory. */
+    bool IsZeroCopy() const{return (buffer != localBuffer);}
+
+    /** Checks if this interface and other access at least one common DDB word.
+        Only meaningful after both interfaces have been linked to the same DDB.
+        @return True if the DDB areas of the two interfaces overlap.
+    */
+    bool SharesDDBMemory(const DDBInterface &other) const;
+
     /** Returns the number of float/int32 signals that are stored in the buffer.
         If this method is called before the interface has been finalised it
         returns the buffer size of the added signal list. Otherwise it returns
@@ -382,31 +490,21 @@ protected:
 
     /** Fast function to read the databuffer. */
     inline void Read(){
-        if (buffer == NULL) return;
-
-        int32* inputBufferIterator       = buffer;
-
-        for(uint32 i = 0; (i < listOfSignalDescriptors.ListSize()) && (ddbSignalPointers[i].GetPointer() != NULL); i++){
-            const int32* innerPointersListIterator = ddbSignalPointers[i].GetPointer();
-            const int32* innerPointersListEnd      = innerPointersListIterator + ddbSignalPointers[i].GetSize();
-            while (innerPointersListIterator < innerPointersListEnd){
-                *inputBufferIterator++ = *innerPointersListIterator++;
-            }
+        const DDBCopyRun *run    = copyPlan;
+        const DDBCopyRun *runEnd = copyPlan + numberOfCopyRuns;
+        while(run < runEnd){
+            run->CopyFromDDB();
+            run++;
         }
     }
 
     /** Fast function to write the databuffer. */
     inline void  Write(){
-        if (buffer == NULL) return;
-
-        int32* inputBufferIterator   = buffer;
-
-        for(uint32 i = 0; (i < listOfSignalDescriptors.ListSize()) && (ddbSignalPointers[i].GetPointer() != NULL); i++){
-            int32* innerPointersListIterator = ddbSignalPointers[i].GetPointer();
-            int32* innerPointersListEnd      = innerPointersListIterator + ddbSignalPointers[i].GetSize();
-            while (innerPointersListIterator < innerPointersListEnd){
-                *innerPointersListIterator++ = *inputBufferIterator++;
-            }
+        const DDBCopyRun *run    = copyPlan;
+        const DDBCopyRun *runEnd = copyPlan + numberOfCopyRuns;
+        while(run < runEnd){
+            run->CopyToDDB();
+            run++;
         }
     }
 
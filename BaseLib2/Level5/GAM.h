@@ -256,6 +256,14 @@ public:
     */
     LinkedListable *InterfacesList()const {return listOfDDBInterfaces.List();}
 
+    /** Get the acquisition module (driver) read or written by the GAM.
+        Used by the parallel scheduler to keep the GAMs of a driver in order.
+        @return an invalid reference if the GAM does not use a driver.
+    */
+    virtual GCReference AcquisitionModule(){
+        return GCReference();
+    }
+
     /** Destructor. */
     virtual ~GAM(){}
 
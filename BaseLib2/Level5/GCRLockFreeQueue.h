@@ -0,0 +1,296 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * An unbounded FIFO of references with any number of producers and one
+ * consumer at a time. Adding a reference never blocks: it costs one atomic
+ * exchange and, only when the consumer is sleeping, a Post of the event.
+ * The nodes of the list carry the reference (the same object may be queued
+ * in several queues at the same time). They come from a pool owned by the
+ * queue: a node is only allocated when GCRLFQ_POOL_SIZE nodes are queued.
+ * The algorithm is the intrusive MPSC queue of D. Vyukov: the producers swap
+ * the head, the consumer follows the next pointers from the tail.
+ * A producer preempted between the swap and the link hides the nodes behind
+ * its own: Pop then fails and Wait sleeps until that producer completes the
+ * link, so the consumer never spins on a lower priority producer.
+ */
+#if !defined(_GCR_LOCK_FREE_QUEUE_)
+#define _GCR_LOCK_FREE_QUEUE_
+
+#include "System.h"
+#include "GCReference.h"
+#include "EventSem.h"
+#include "FastPollingMutexSem.h"
+#include "HRT.h"
+#include "Atomic.h"
+
+/** Atomic operations which are also full compiler and processor barriers.
+    GCRLFQ_EXCHANGE stores v in *p and returns the previous value */
+#if defined(__GNUC__)
+#define GCRLFQ_EXCHANGE(p,v)  (Atomic::FullBarrier(), __sync_lock_test_and_set(p,v))
+#define GCRLFQ_INCREMENT(p)   __sync_fetch_and_add(p,1)
+#define GCRLFQ_DECREMENT(p)   __sync_fetch_and_sub(p,1)
+#elif defined(_MSC_VER)
+#define GCRLFQ_EXCHANGE(p,v)  InterlockedExchangePointer((PVOID volatile *)(p),(v))
+#define GCRLFQ_INCREMENT(p)   InterlockedIncrement((LONG volatile *)(p))
+#define GCRLFQ_DECREMENT(p)   InterlockedDecrement((LONG volatile *)(p))
+#endif
+
+/** Number of nodes preallocated by each queue */
+#define GCRLFQ_POOL_SIZE      64
+
+/** A node of the queue */
+class GCRLockFreeQueueNode{
+public:
+    /** The next (newer) node */
+    GCRLockFreeQueueNode * volatile next;
+
+    /** The queued object */
+    GCReference                     reference;
+
+    /** True if the node belongs to the pool of a queue */
+    bool                            pooled;
+
+    /** Set while a pooled node is taken */
+    volatile int32                  inUse;
+
+    GCRLockFreeQueueNode(){
+        next   = NULL;
+        pooled = False;
+        inUse  = 0;
+    }
+};
+
+class GCRLockFreeQueue{
+private:
+    /** The newest node. Swapped by the producers */
+    GCRLockFreeQueueNode * volatile head;
+
+    /** The oldest node. Consumer only */
+    GCRLockFreeQueueNode *          tail;
+
+    /** Placeholder keeping the list never empty */
+    GCRLockFreeQueueNode            stub;
+
+    /** Number of queued references */
+    volatile int32                  size;
+
+    /** Set while the consumer sleeps on newData */
+    volatile int32                  consumerWaiting;
+
+    /** Set by Wake, consumed by Wait */
+    volatile int32                  wakeRequest;
+
+    /** Posted when a reference is added to the queue with the consumer sleeping */
+    EventSem                        newData;
+
+    /** Serialises the consumers (one at a time) */
+    FastPollingMutexSem             consumerMux;
+
+    /** The preallocated nodes */
+    GCRLockFreeQueueNode            pool[GCRLFQ_POOL_SIZE];
+
+    /** Next node of the pool to try */
+    volatile int32                  poolNext;
+
+    /** Takes a node of the pool or, if the one in turn is still queued, allocates one */
+    inline GCRLockFreeQueueNode *NewNode(){
+        uint32 index = (uint32)Atomic::AddAndFetch(&poolNext,1) % GCRLFQ_POOL_SIZE;
+        GCRLockFreeQueueNode *node = &pool[index];
+        if (Atomic::TestAndSet(&node->inUse)) return node;
+        return new GCRLockFreeQueueNode;
+    }
+
+    /** Gives back a node removed from the list */
+    inline void DeleteNode(GCRLockFreeQueueNode *node){
+        node->reference.RemoveReference();
+        if (!node->pooled){
+            delete node;
+            return;
+        }
+        // the reference is released before the node can be taken again
+        Atomic::Barrier();
+        node->inUse = 0;
+    }
+
+    /** True if Unlink would return a node. Consumer only */
+    inline bool Ready() const{
+        GCRLockFreeQueueNode *oldest = tail;
+        if (oldest->next != NULL) return True;
+        return ((oldest != &stub) && (oldest == head));
+    }
+
+    /** Links a node */
+    inline void Link(GCRLockFreeQueueNode *node){
+        node->next = NULL;
+        GCRLockFreeQueueNode *previous = (GCRLockFreeQueueNode *)GCRLFQ_EXCHANGE(&head,node);
+        // From here the consumer can see the node
+        previous->next = node;
+    }
+
+    /** Unlinks the oldest node.
+        @return NULL if empty or if a producer has not completed Link yet */
+    inline GCRLockFreeQueueNode *Unlink(){
+        GCRLockFreeQueueNode *oldest = tail;
+        GCRLockFreeQueueNode *next   = oldest->next;
+        if (oldest == &stub){
+            if (next == NULL) return NULL;
+            tail   = next;
+            oldest = next;
+            next   = next->next;
+        }
+        if (next != NULL){
+            tail = next;
+            return oldest;
+        }
+        if (oldest != head) return NULL;
+        // oldest is the last: the stub goes behind it so that it can be removed
+        Link(&stub);
+        next = oldest->next;
+        if (next != NULL){
+            tail = next;
+            return oldest;
+        }
+        return NULL;
+    }
+
+public:
+
+    GCRLockFreeQueue(){
+        head            = &stub;
+        tail            = &stub;
+        size            = 0;
+        consumerWaiting = 0;
+        wakeRequest     = 0;
+        poolNext        = 0;
+        for (uint32 i = 0; i < GCRLFQ_POOL_SIZE; i++) pool[i].pooled = True;
+        newData.Create();
+        newData.Reset();
+        consumerMux.Create();
+    }
+
+    ~GCRLockFreeQueue(){
+        GCReference reference;
+        while (Pop(reference)) reference.RemoveReference();
+        newData.Close();
+        consumerMux.Close();
+    }
+
+    /** Adds a reference at the end of the queue. Any thread.
+        @return False if the reference is not valid or the node cannot be allocated */
+    bool Push(const GCReference &reference){
+        if (!reference.IsValid()) return False;
+        GCRLockFreeQueueNode *node = NewNode();
+        if (node == NULL) return False;
+        node->reference = reference;
+        GCRLFQ_INCREMENT(&size);
+        Link(node);
+        // the consumer either sees the node or is seen waiting
+        Atomic::FullBarrier();
+        if (consumerWaiting) newData.Post();
+        return True;
+    }
+
+    /** Removes the oldest reference without waiting.
+        @return False if the queue is empty or if the oldest reference is still
+        being linked by a producer. In that case Wait returns once it is linked */
+    bool Pop(GCReference &reference){
+        if (size == 0) return False;
+        consumerMux.FastLock();
+        GCRLockFreeQueueNode *node = Unlink();
+        consumerMux.FastUnLock();
+        if (node == NULL) return False;
+        GCRLFQ_DECREMENT(&size);
+        reference = node->reference;
+        DeleteNode(node);
+        return True;
+    }
+
+    /** Removes up to maxReferences references in one go.
+        @return The number of references copied in batch */
+    uint32 Drain(GCReference *batch, uint32 maxReferences){
+        uint32 n = 0;
+        while ((n < maxReferences) && Pop(batch[n])) n++;
+        return n;
+    }
+
+    /** Waits for a reference which Pop can remove
+        @return False on timeout or if woken by Wake */
+    bool Wait(TimeoutType msecTimeout = TTInfiniteWait){
+        if (Ready()) return True;
+        newData.Reset();
+        consumerWaiting = 1;
+        Atomic::FullBarrier();
+        bool ok = Ready();
+        if ((!ok) && (msecTimeout != TTNoWait)){
+            // EventSem::Wait may return early (e.g. a Post consumed by a previous
+            // Wait): keep waiting for the remaining time
+            int64 deadline = HRT::HRTCounter() + (int64)(msecTimeout.msecTimeout * 1e-3 * HRT::HRTFrequency());
+            while ((!ok) && (!wakeRequest)){
+                TimeoutType remaining = msecTimeout;
+                if (msecTimeout != TTInfiniteWait){
+                    int64 left = deadline - HRT::HRTCounter();
+                    if (left <= 0) break;
+                    remaining = TimeoutType((uint32)(left * HRT::HRTPeriod() * 1e3) + 1);
+                }
+                newData.Wait(remaining);
+                ok = Ready();
+                if (!ok){
+                    newData.Reset();
+                    // a Push may have posted between the check and the Reset:
+                    // check again, as after setting consumerWaiting
+                    Atomic::FullBarrier();
+                    ok = Ready();
+                }
+            }
+        }
+        consumerWaiting = 0;
+        wakeRequest     = 0;
+        return ok;
+    }
+
+    /** Removes the oldest reference, waiting up to msecTimeout for one
+        @return False on timeout */
+    bool Get(GCReference &reference, TimeoutType msecTimeout = TTInfiniteWait){
+        while (!Pop(reference)){
+            if (!Wait(msecTimeout)) return Pop(reference);
+        }
+        return True;
+    }
+
+    /** Wakes up the consumer */
+    void Wake(){
+        wakeRequest = 1;
+        Atomic::FullBarrier();
+        newData.Post();
+    }
+
+    /** Number of references in the queue */
+    int32 Size() const{
+        return size;
+    }
+};
+
+#endif
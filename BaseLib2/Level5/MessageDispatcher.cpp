@@ -79,85 +79,66 @@ void MessageDispatcherThreadFN(void *arg){
 }
 
 
+/** number of requests taken from the queue in one go */
+static const uint32 MDRequestBatchSize = 16;
+
 bool MDProcessRequestQueue(MessageDispatcher &md){
     md.threadToContinue = True;
 
+    GCReference batch[MDRequestBatchSize];
+
     // check for any request to abandon ship
     while(md.threadToContinue){
         // synchronise
-        if (md.requestsEvent.Wait(md.globalTimeout)){
-            md.requestsEvent.Reset();
-            // check for any request to abandon ship
-            bool toContinue = md.threadToContinue;
-            while(toContinue){
-
-                // access resources
-                if (md.requestsMux.FastLock(md.globalTimeout)){
-                    // check Q size
-                    if (md.requestsQueue.Size() > 0){
-
-                        GCReference request;
-                        request = md.requestsQueue.Remove(0);
-
-                        // process request here
-                        GCRTemplate<MessageEnvelope> envelope;
-                        envelope = request;
+        if (!md.requestsQueue.Wait(md.globalTimeout)) continue;
+
+        // take all the requests already queued
+        uint32 n;
+        while(md.threadToContinue && ((n = md.requestsQueue.Drain(batch,MDRequestBatchSize)) > 0)){
+
+            for (uint32 i = 0; i < n; i++){
+                GCReference request = batch[i];
+                batch[i].RemoveReference();
+
+                // try to see if it is a simple envelope
+                GCRTemplate<MessageEnvelope> envelope;
+                envelope = request;
+                if (envelope.IsValid()){
+                    MessageHandler::SendMessage(envelope);
+                    continue;
+                }
 
-                        // try to see if it is a simple envelope
-                        if (envelope.IsValid()){
+                // try to see if it is a Message Delivery Request
+                GCRTemplate<MessageDeliveryRequest> delivery;
+                delivery = request;
+                if (delivery.IsValid()){
 
-                            // UnLock Queue
+                    // add this delivery to the wait Q before any reply can arrive
+                    if (delivery->ReplyExpected()){
+                        if (md.requestsMux.FastLock(md.globalTimeout)){
+                            md.waitQueue.Insert(delivery);
                             md.requestsMux.FastUnLock();
-                            MessageHandler::SendMessage(envelope);
                         } else {
+                            md.AssertErrorCondition(Timeout,"ProcessQueue: timeout accessing waitQueue");
+                        }
+                    }
 
-                            // try to see if it is a Message Delivery Request
-                            GCRTemplate<MessageDeliveryRequest> delivery;
-                            delivery = request;
-                            if (delivery.IsValid()){
-
-                                // add this delivery to the wait Q
-                                if (delivery->ReplyExpected()){
-                                    md.waitQueue.Insert(delivery);
-                                }
-
-                                // UnLock Queue after possibly having added
-                                // a new element to the waitQueue
-                                md.requestsMux.FastUnLock();
-
-                                // delegate the job to the Message Delivery Request object
-                                delivery->ProcessMDR(&md);
-
-                            } else { // try to cast to Object simply
-
-                                // UnLock Queue
-                                md.requestsMux.FastUnLock();
-
-                                GCRTemplate<Object> object;
-                                object = request;
-                                if (object.IsValid()){
-                                    md.AssertErrorCondition(FatalError,"ProcessQueue:Object of class %s discarded",object->ClassName());
-                                } else {
-                                    md.AssertErrorCondition(FatalError,"ProcessQueue:Unknown object in queue discarded");
-                                }
-
-                            } // !delivery.IsValid()
-
-                        } // !envelope.IsValid()
-
-                    } else {
-                        md.requestsMux.FastUnLock();
-                        toContinue = False;
-                    } // if md.requestQueue.Size() > 0
-
-                } // if (requestsMux.FastLock(timeout))
-
-                // check for any request to abandon ship
-                toContinue = toContinue && md.threadToContinue;
+                    // delegate the job to the Message Delivery Request object
+                    delivery->ProcessMDR(&md);
+                    continue;
+                }
 
-            } // while(toContinue)
+                // try to cast to Object simply
+                GCRTemplate<Object> object;
+                object = request;
+                if (object.IsValid()){
+                    md.AssertErrorCondition(FatalError,"ProcessQueue:Object of class %s discarded",object->ClassName());
+                } else {
+                    md.AssertErrorCondition(FatalError,"ProcessQueue:Unknown object in queue discarded");
+                }
+            }
 
-        } // eventSem Wait
+        } // while requests
 
     } // while(threadToContinue)
 
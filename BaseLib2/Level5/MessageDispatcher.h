@@ -36,6 +36,7 @@
 #include "MessageEnvelope.h"
 #include "MessageHandler.h"
 #include "FastPollingMutexSem.h"
+#include "GCRLockFreeQueue.h"
 
 
 class MessageDispatcher;
@@ -79,19 +80,16 @@ OBJECT_DLL_STUFF(MessageDispatcher)
 
 protected:
 
-    /** protects access to the requestsQueue */
+    /** protects access to the waitQueue */
             FastPollingMutexSem                         requestsMux;
 
-    /** the message Q */
-            GCReferenceContainer                        requestsQueue;
+    /** the message Q. The senders never block */
+            GCRLockFreeQueue                            requestsQueue;
 
     /** the wait for Acknowledge Q */
             GCReferenceContainer                        waitQueue;
 //            GCRContainerTemplate<MessageDeliveryRequest> waitQueue;
 
-    /** to mark a new request in the list */
-            EventSem                                    requestsEvent;
-
     /** to mark the start of the handling thread */
             EventSem                                    threadStartEvent;
 
@@ -110,14 +108,12 @@ public:
         mDThreadID  = (TID)0;
 
 
-        requestsEvent.Create();
         threadStartEvent.Create();
 
         // will be marked True by the thread itself when starting
         threadToContinue = False;
 
         // remove events
-        requestsEvent.Reset();
         threadStartEvent.Reset();
 
         // label this thread
@@ -132,14 +128,13 @@ public:
             AssertErrorCondition(Timeout,"MessageDispatcher: Request Handling Thread did not start within %i msecs",globalTimeout.msecTimeout);
         }
 
-        requestsEvent.Reset();
-
     }
 
     /** Destructor */
     virtual             ~MessageDispatcher()
     {
         threadToContinue = False;
+        requestsQueue.Wake();
 
         // wait for thread start notification
         if (!threadStartEvent.Wait(globalTimeout)){
@@ -180,12 +175,8 @@ public:
         }
 
 
-        if (requestsMux.FastLock(msecTimeout)){
-            requestsQueue.Insert(messageRequest);
-            requestsEvent.Post();
-            requestsMux.FastUnLock();
-        } else {
-            AssertErrorCondition(Timeout,"GMDSendMessageRequest timeout on queueing");
+        if (!requestsQueue.Push(messageRequest)){
+            AssertErrorCondition(FatalError,"GMDSendMessageRequest failed queueing");
             return False;
         }
 
@@ -217,12 +208,8 @@ public:
                         GCRTemplate<MessageEnvelope>        messageRequest,
                         TimeoutType                         msecTimeout)
     {
-        if (requestsMux.FastLock(msecTimeout)){
-            requestsQueue.Insert(messageRequest);
-            requestsEvent.Post();
-            requestsMux.FastUnLock();
-        } else {
-            AssertErrorCondition(Timeout,"GMDSendMessageRequest timeout on queueing");
+        if (!requestsQueue.Push(messageRequest)){
+            AssertErrorCondition(FatalError,"GMDSendMessageRequest failed queueing");
             return False;
         }
 
@@ -30,6 +30,8 @@
 #include "InternetAddress.h"
 #include "TCPSocket.h"
 #include "MessageServer.h"
+#include "Atomic.h"
+#include "Sleep.h"
 
 bool
 MHConstructor(MessageHandler &mh){
@@ -50,6 +52,11 @@ MHConstructor(MessageHandler &mh){
     mh.messageQueue = myMessageQueue;
     mh.messageQueues.Insert(myMessageQueue);
 
+    mh.topQueue         = myMessageQueue.operator->();
+    mh.activeSenders[0] = 0;
+    mh.activeSenders[1] = 0;
+    mh.senderEpoch      = 0;
+
     mh.event.Create();
     mh.event.Reset();
 
@@ -96,59 +103,89 @@ void  MessageHandlerThreadFN(void *arg){
     }
 }
 
+/** number of envelopes taken from the queue in one go */
+static const uint32 MHMessageBatchSize = 16;
+
 void
 MessageHandler::ProcessMessageQueue(){
 
-    // take a new envelope
-    GCRTemplate<MessageEnvelope> envelope = messageQueue->GetMessage(globalTimeout);
+    GCRTemplate<MessageEnvelope> batch[MHMessageBatchSize];
 
-    // check validity and loop
-    while (envelope.IsValid()){
+    // wait for a new envelope
+    batch[0] = messageQueue->GetMessage(globalTimeout);
+    if (!batch[0].IsValid()) return;
 
-        // automatic reply soon after reading the Q
-        if (envelope->EarlyAutomaticReplyExpected()){
-            GCRTemplate<MessageEnvelope> reply(GCFT_Create);
-            reply->PrepareAutomaticReply(envelope);
-            SendMessage(reply);
-//            envelope->flags = envelope->flags & MDRF_ReplyNMask;
+    // then take all those already queued, without waiting
+    uint32 n = 1 + messageQueue->GetMessages(batch + 1,MHMessageBatchSize - 1);
+    while (n > 0){
+        for (uint32 i = 0;i < n;i++){
+            ProcessEnvelope(batch[i]);
+            batch[i] = GCRTemplate<MessageEnvelope>();
         }
+        n = messageQueue->GetMessages(batch,MHMessageBatchSize);
+    }
+}
 
-        GCRTemplate< GCNOExtender<BString> > subAddressRef = envelope->Remove("SubAddress___!!!");
-        const char *subAddress = NULL;
-        if (subAddressRef.IsValid()){
-            subAddress = subAddressRef->Buffer();
-        }
+void
+MessageHandler::ProcessEnvelope(GCRTemplate<MessageEnvelope> envelope){
+
+    // automatic reply soon after reading the Q
+    if (envelope->EarlyAutomaticReplyExpected()){
+        GCRTemplate<MessageEnvelope> reply(GCFT_Create);
+        reply->PrepareAutomaticReply(envelope);
+        SendMessage(reply);
+//        envelope->flags = envelope->flags & MDRF_ReplyNMask;
+    }
 
-        bool done = False;
-        // no subAddres support for MenuMessages
-        if (!subAddress){
-            GCRTemplate<Message> message = envelope->GetMessage();
-            if (message.IsValid()){
-                if (message->GetMessageCode() == MenuMessage){
-                    MenuInterface *mi = dynamic_cast<MenuInterface *>(this);
-                    if (mi != NULL) {
-                        done = mi->ProcessMenuMessage(envelope);
-                    }
+    GCRTemplate< GCNOExtender<BString> > subAddressRef = envelope->Remove("SubAddress___!!!");
+    const char *subAddress = NULL;
+    if (subAddressRef.IsValid()){
+        subAddress = subAddressRef->Buffer();
+    }
+
+    bool done = False;
+    // no subAddres support for MenuMessages
+    if (!subAddress){
+        GCRTemplate<Message> message = envelope->GetMessage();
+        if (message.IsValid()){
+            if (message->GetMessageCode() == MenuMessage){
+                MenuInterface *mi = dynamic_cast<MenuInterface *>(this);
+                if (mi != NULL) {
+                    done = mi->ProcessMenuMessage(envelope);
                 }
             }
         }
+    }
 
-        if (!done) {
-            done = ProcessMessage2(envelope,subAddress);
-        }
-
-        // automatic reply after processing MSG
-        if (envelope->LateAutomaticReplyExpected()){
-            GCRTemplate<MessageEnvelope> reply(GCFT_Create);
-            reply->PrepareAutomaticReply(envelope);
-            SendMessage(reply);
-        }
+    if (!done) {
+        done = ProcessMessage2(envelope,subAddress);
+    }
 
-        // take a new one
-        envelope = messageQueue->GetMessage(globalTimeout);
+    // automatic reply after processing MSG
+    if (envelope->LateAutomaticReplyExpected()){
+        GCRTemplate<MessageEnvelope> reply(GCFT_Create);
+        reply->PrepareAutomaticReply(envelope);
+        SendMessage(reply);
     }
 }
 
+void
+MessageHandler::PublishTopQueue(){
+    GCRTemplate<MessageQueue> first = messageQueues.Find(0);
+    topQueue = first.operator->();
+
+    // the senders that came after this point use the new topQueue
+    Atomic::FullBarrier();
+    int32 previousEpoch = senderEpoch & 1;
+    Atomic::Increment(&senderEpoch);
+    Atomic::FullBarrier();
+
+    // a sender of the previous epoch may hold the old queue: wait for it.
+    // Sleeping, not yielding, lets a preempted sender of lower priority finish
+    while (activeSenders[previousEpoch] != 0){
+        SleepMsec(1);
+    }
+}
 
 bool
 MHHandleMessage(MessageHandler &mh,GCRTemplate<MessageEnvelope> envelope,const char *subAddress)
@@ -166,52 +203,61 @@ MHHandleMessage(MessageHandler &mh,GCRTemplate<MessageEnvelope> envelope,const c
         envelope->Insert(subAddressRef);
     }
 
-    mh.threadIdMutex.Lock(mh.globalTimeout);
+    // the thread is started once: only the first senders take the mutex
     if (mh.threadID == 0){
+        mh.threadIdMutex.Lock(mh.globalTimeout);
+        if (mh.threadID == 0){
+
+            // label this thread
+            FString threadName;
+            GCNamedObject *gcno = dynamic_cast<GCNamedObject *>(&mh);
+            if (gcno){
+                threadName.Printf("MessageHandlerFor%s",gcno->Name());
+            } else {
+                threadName.Printf("MessageHandlerFor[0x%x]",&mh);
+            }
 
-        // label this thread
-        FString threadName;
-        GCNamedObject *gcno = dynamic_cast<GCNamedObject *>(&mh);
-        if (gcno){
-            threadName.Printf("MessageHandlerFor%s",gcno->Name());
-        } else {
-            threadName.Printf("MessageHandlerFor[0x%x]",&mh);
-        }
-
-        mh.keepAlive = True;
-        // create a new one
-        mh.threadID = Threads::BeginThread(MessageHandlerThreadFN,&mh,THREADS_DEFAULT_STACKSIZE,threadName.Buffer());
-
-        // wait for thread start notification
-        if (!mh.event.Wait(mh.globalTimeout)){
-            CStaticAssertErrorCondition(Timeout,"MHHandleMessage: Message Handling Thread did not start within %i msecs",mh.globalTimeout.msecTimeout);
+            mh.keepAlive = True;
+            // create a new one
+            mh.threadID = Threads::BeginThread(MessageHandlerThreadFN,&mh,THREADS_DEFAULT_STACKSIZE,threadName.Buffer());
 
-            return False;
+            // wait for thread start notification
+            if (!mh.event.Wait(mh.globalTimeout)){
+                CStaticAssertErrorCondition(Timeout,"MHHandleMessage: Message Handling Thread did not start within %i msecs",mh.globalTimeout.msecTimeout);
+                mh.threadIdMutex.UnLock();
+                return False;
+            }
         }
+        mh.threadIdMutex.UnLock();
     }
-    mh.threadIdMutex.UnLock();
 
-    // lock everything!
-    if (!mh.messageQueues.Lock2(mh.globalTimeout)){
-        CStaticAssertErrorCondition(Timeout,"MHHandleMessage messageQueues.Lock() failed");
-        return False;
+    // register as a sender of the present epoch; if PublishTopQueue changed the
+    // epoch meanwhile it may not have seen us: register again in the new one
+    int32 epoch;
+    while (True){
+        epoch = mh.senderEpoch & 1;
+        Atomic::Increment(&mh.activeSenders[epoch]);
+        Atomic::FullBarrier();
+        if ((mh.senderEpoch & 1) == epoch) break;
+        Atomic::Decrement(&mh.activeSenders[epoch]);
     }
 
-    // find top Q
-    GCRTemplate<MessageQueue> topQueue = mh.messageQueues.Find(0);
-
-    if (topQueue.IsValid()){
-    // add new envelope
-        topQueue->SendMessage(envelope,mh.globalTimeout);
-    } else {
-        CStaticAssertErrorCondition(Timeout,"MHHandleMessage cannot get     present top Q (timeout)");
-        mh.messageQueues.UnLock();
-        return False;
+    // the queue stays valid until we deregister
+    MessageQueue *topQueue = mh.topQueue;
+    bool ret = False;
+    if (topQueue != NULL){
+        // add new envelope
+        ret = topQueue->SendMessage(envelope,mh.globalTimeout);
     }
 
-    mh.messageQueues.UnLock();
+    Atomic::FullBarrier();
+    Atomic::Decrement(&mh.activeSenders[epoch]);
 
-    return True;
+    if (topQueue == NULL){
+        CStaticAssertErrorCondition(FatalError,"MHHandleMessage: no top Q present");
+    }
+
+    return ret;
 }
 
 bool
@@ -409,6 +455,8 @@ bool MHSendMessageAndWait(
         return False;
     }
 
+    mh.PublishTopQueue();
+
     mh.messageQueues.UnLock();
 
     if (!envelope->ReplyExpected()){
@@ -454,6 +502,16 @@ bool MHSendMessageAndWait(
         return False;
     }
 
+    GCReference removed = mh.messageQueues.Remove(name.Buffer());
+    if (!removed.IsValid()){
+        CStaticAssertErrorCondition(Timeout,"MessageHandler::SendMessageAndWait waitQueues.Remove(Queue) failed");
+        CStaticAssertErrorCondition(FatalError,"MessageHandler::SendMessageAndWait: handler dead: bad Queue on top!!!");
+        ok =  False;
+    }
+
+    // after this no sender puts envelopes in myQueue
+    mh.PublishTopQueue();
+
     //flush Queue to next
     while (myQueue->Size() > 0){
         // take a new envelope
@@ -472,14 +530,6 @@ bool MHSendMessageAndWait(
         }
     }
 
-
-    GCReference removed = mh.messageQueues.Remove(name.Buffer());
-    if (!removed.IsValid()){
-        CStaticAssertErrorCondition(Timeout,"MessageHandler::SendMessageAndWait waitQueues.Remove(Queue) failed");
-        CStaticAssertErrorCondition(FatalError,"MessageHandler::SendMessageAndWait: handler dead: bad Queue on top!!!");
-        ok =  False;
-    }
-
     mh.messageQueues.UnLock();
 
     return ok;
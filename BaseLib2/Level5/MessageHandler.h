@@ -97,9 +97,19 @@ class MessageHandler: protected MessageInterface{
                         TimeoutType                     timeout
                     );
 
-    /** it is the actual body of the managing thread */
+    /** it is the actual body of the managing thread.
+        Takes the envelopes in batches */
             void        ProcessMessageQueue();
 
+    /** handles one envelope of the queue */
+            void        ProcessEnvelope(
+                            GCRTemplate<MessageEnvelope>    envelope);
+
+    /** makes the first of messageQueues the queue of the senders and
+        waits for the senders still using the previous one.
+        To be called with messageQueues locked */
+            void        PublishTopQueue();
+
 protected:
     /** True means that the message is processed immediately
         Note that the user handler function must be able to
@@ -115,6 +125,16 @@ protected:
     /** the local message Q */
             GCRTemplate<MessageQueue> messageQueue;
 
+    /** the first of messageQueues, where MHHandleMessage puts the envelopes
+        without locking. Changed only by PublishTopQueue */
+            MessageQueue * volatile topQueue;
+
+    /** the number of senders using topQueue, for each parity of senderEpoch */
+            volatile int32          activeSenders[2];
+
+    /** incremented by PublishTopQueue each time topQueue changes */
+            volatile int32          senderEpoch;
+
     /** The thread ID. if not 0 it means a thread is running
         the variable is protected */
             TID                     threadID;
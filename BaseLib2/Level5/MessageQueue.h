@@ -24,32 +24,24 @@
 
 /** 
  * @file
- * A GCRContainerTemplate<MessageEnvelope> with a FIFO only policy and an
- * EventSem to synchronise tasks to new data arrival.
+ * A FIFO of MessageEnvelope with an EventSem to synchronise tasks to new
+ * data arrival. The senders never lock: the envelopes are added to a
+ * GCRLockFreeQueue. It is still a GCReferenceContainer so that it can be
+ * named and stored in the list of queues of a MessageHandler.
  */
 #if !defined(_MESSAGE_QUEUE_)
 #define _MESSAGE_QUEUE_
 
 #include "GCReferenceContainer.h"
 #include "MessageEnvelope.h"
-#include "EventSem.h"
+#include "GCRLockFreeQueue.h"
 
 
-/** a GCRContainerTemplate<MessageEnvelope> with a FIFO only policy  */
+/** a FIFO of MessageEnvelope with any number of senders and one reader at a time */
 class MessageQueue: public GCReferenceContainer {
 private:
-    /** a new message in the Q */
-    EventSem        newMessage;
-
-    /** */
-    bool Lock(TimeoutType tt = TTInfiniteWait){
-        return mux.Lock(tt);
-    }
-
-    /** */
-    bool UnLock(){
-        return mux.UnLock();
-    }
+    /** the envelopes */
+    GCRLockFreeQueue envelopes;
 
     /** Bool to know whether the message handler destructor has been called */
     bool isDying;
@@ -58,7 +50,6 @@ public:
     /** */
     MessageQueue(){
         isDying = False;
-        newMessage.Create();
     }
 
     /** */
@@ -68,53 +59,48 @@ public:
 
     /** */
     virtual ~MessageQueue(){
-        newMessage.Close();
     }
 
-    /** Adds at one side of the Queue */
+    /** Adds at one side of the Queue. Never blocks: the timeout is not used */
     bool SendMessage(GCRTemplate<MessageEnvelope> envelope, TimeoutType tt = TTInfiniteWait){
-        Lock(tt);
-        bool ret = Insert(envelope);
-        newMessage.Post();
-        UnLock();
-        return ret;
+        return envelopes.Push(envelope);
     }
 
     /** */
     GCRTemplate<MessageEnvelope> GetMessage(TimeoutType tt = TTInfiniteWait){
         GCRTemplate<MessageEnvelope> answer;
-        if (Lock(tt)){
-            while (Size() ==0) {
-                newMessage.Reset();
-                UnLock();
-
-                /* timeout waiting for data */
-                if (!newMessage.Wait(tt)) return answer;
-		if (isDying){
-		    return answer;
-		}
-
-                /* timout locking Q */
-                if (!Lock(tt)) return answer;
-
+        GCReference reference;
+        while (!envelopes.Pop(reference)) {
+            /* timeout waiting for data */
+            if (!envelopes.Wait(tt) && (envelopes.Size() == 0)) return answer;
+            if (isDying){
+                return answer;
             }
-
-            answer = Remove((int) 0);
-
-            UnLock();
         }
+        answer = reference;
         return answer;
     }
 
+    /** Takes all the messages already in the queue, up to maxMessages, without waiting.
+        @return the number of envelopes copied in batch */
+    uint32 GetMessages(GCRTemplate<MessageEnvelope> *batch, uint32 maxMessages){
+        uint32 n = 0;
+        GCReference reference;
+        while ((n < maxMessages) && envelopes.Pop(reference)){
+            batch[n++] = reference;
+        }
+        return n;
+    }
+
     /** Number of messages in the queue*/
     int32 Size(){
-        return GCReferenceContainer::Size();
+        return envelopes.Size();
     }
 
     /** Post the synchronisation semaphore. */
     void Reset(){
         isDying = True;
-        newMessage.Post();
+        envelopes.Wake();
     }
 };
 
@@ -0,0 +1,231 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Throughput of MessageQueue with 1 to 16 threads sending envelopes to one
+ * reader, compared with the previous implementation (a GCReferenceContainer
+ * protected by a mutex with an EventSem posted for each message), then the
+ * same through MessageHandler::SendMessage to a MessageHandler in the
+ * GlobalObjectDataBase.
+ * Usage: MessageQueueBenchmark.ex [messagesPerTest]
+ */
+
+#include "System.h"
+#include "MessageQueue.h"
+#include "MutexSem.h"
+#include "Threads.h"
+#include "HRT.h"
+#include "Sleep.h"
+#include "Atomic.h"
+#include "MessageHandler.h"
+#include "MessageEnvelope.h"
+#include "GlobalObjectDataBase.h"
+
+/** The previous MessageQueue, for comparison */
+class LockedMessageQueue: public GCReferenceContainer {
+private:
+    EventSem        newMessage;
+public:
+    LockedMessageQueue(){
+        newMessage.Create();
+    }
+
+    virtual ~LockedMessageQueue(){
+        newMessage.Close();
+    }
+
+    bool SendMessage(GCRTemplate<MessageEnvelope> envelope, TimeoutType tt = TTInfiniteWait){
+        mux.Lock(tt);
+        bool ret = Insert(envelope);
+        newMessage.Post();
+        mux.UnLock();
+        return ret;
+    }
+
+    GCRTemplate<MessageEnvelope> GetMessage(TimeoutType tt = TTInfiniteWait){
+        GCRTemplate<MessageEnvelope> answer;
+        if (mux.Lock(tt)){
+            while (Size() == 0) {
+                newMessage.Reset();
+                mux.UnLock();
+                if (!newMessage.Wait(tt)) return answer;
+                if (!mux.Lock(tt)) return answer;
+            }
+            answer = Remove((int) 0);
+            mux.UnLock();
+        }
+        return answer;
+    }
+};
+
+/** State shared by the threads of a test */
+template <class Queue>
+struct BenchmarkContext{
+    Queue          *queue;
+    int32           messagesPerProducer;
+    volatile int32  started;
+    volatile int32  go;
+    volatile int32  finished;
+    /** Time spent in SendMessage by all the producers */
+    volatile int64  sendTicks;
+};
+
+template <class Queue>
+void ProducerThread(void *arg){
+    BenchmarkContext<Queue> *context = (BenchmarkContext<Queue> *)arg;
+    GCRTemplate<MessageEnvelope> envelope(GCFT_Create);
+    Atomic::Increment(&context->started);
+    while (!context->go) SleepMsec(0);
+    int64 start = HRT::HRTCounter();
+    for (int32 i = 0; i < context->messagesPerProducer; i++){
+        context->queue->SendMessage(envelope);
+    }
+    int64 ticks = HRT::HRTCounter() - start;
+    __sync_fetch_and_add(&context->sendTicks, ticks);
+    Atomic::Increment(&context->finished);
+}
+
+/** Sends messages from nOfProducers threads and reads them in this thread */
+template <class Queue>
+void RunTest(const char *name, int32 nOfProducers, int32 nOfMessages){
+    Queue queue;
+    BenchmarkContext<Queue> context;
+    context.queue               = &queue;
+    context.messagesPerProducer = nOfMessages / nOfProducers;
+    context.started             = 0;
+    context.go                  = 0;
+    context.finished            = 0;
+    context.sendTicks           = 0;
+    int32 total = context.messagesPerProducer * nOfProducers;
+
+    for (int32 i = 0; i < nOfProducers; i++){
+        Threads::BeginThread(ProducerThread<Queue>, &context, THREADS_DEFAULT_STACKSIZE, "Producer");
+    }
+    while (context.started < nOfProducers) SleepMsec(1);
+
+    int64 start = HRT::HRTCounter();
+    context.go = 1;
+    int32 received = 0;
+    while (received < total){
+        GCRTemplate<MessageEnvelope> envelope = queue.GetMessage(1000);
+        if (!envelope.IsValid()){
+            printf("%s: timeout after %d messages\n", name, received);
+            break;
+        }
+        received++;
+    }
+    double elapsed = (HRT::HRTCounter() - start) * HRT::HRTPeriod();
+    while (context.finished < nOfProducers) SleepMsec(1);
+
+    double sendNs = context.sendTicks * HRT::HRTPeriod() * 1e9 / total;
+    printf("%-8s producers = %2d messages = %7d: %10.0f messages/s, SendMessage mean = %8.0f ns\n", name, nOfProducers, received, received / elapsed, sendNs);
+}
+
+/** Counts the messages it handles */
+class BenchmarkHandler: public GCNamedObject, public MessageHandler{
+public:
+    volatile int32  received;
+
+    BenchmarkHandler(){
+        received = 0;
+    }
+
+    virtual bool ProcessMessage(GCRTemplate<MessageEnvelope> envelope){
+        Atomic::Increment(&received);
+        return True;
+    }
+};
+
+/** Same as ProducerThread but through MessageHandler::SendMessage */
+void HandlerProducerThread(void *arg){
+    BenchmarkContext<BenchmarkHandler> *context = (BenchmarkContext<BenchmarkHandler> *)arg;
+    GCRTemplate<Message> message(GCFT_Create);
+    GCRTemplate<MessageEnvelope> envelope(GCFT_Create);
+    envelope->PrepareMessageEnvelope(message, context->queue->Name());
+    Atomic::Increment(&context->started);
+    while (!context->go) SleepMsec(0);
+    int64 start = HRT::HRTCounter();
+    for (int32 i = 0; i < context->messagesPerProducer; i++){
+        MessageHandler::SendMessage(envelope);
+    }
+    int64 ticks = HRT::HRTCounter() - start;
+    __sync_fetch_and_add(&context->sendTicks, ticks);
+    Atomic::Increment(&context->finished);
+}
+
+/** Sends messages from nOfProducers threads to a BenchmarkHandler */
+void RunHandlerTest(int32 nOfProducers, int32 nOfMessages){
+    GCRTemplate<BenchmarkHandler> handler(GCFT_Create);
+    handler->SetObjectName("MessageQueueBenchmarkHandler");
+    GetGlobalObjectDataBase()->Insert(handler);
+
+    BenchmarkContext<BenchmarkHandler> context;
+    context.queue               = handler.operator->();
+    context.messagesPerProducer = nOfMessages / nOfProducers;
+    context.started             = 0;
+    context.go                  = 0;
+    context.finished            = 0;
+    context.sendTicks           = 0;
+    int32 total = context.messagesPerProducer * nOfProducers;
+
+    for (int32 i = 0; i < nOfProducers; i++){
+        Threads::BeginThread(HandlerProducerThread, &context, THREADS_DEFAULT_STACKSIZE, "Producer");
+    }
+    while (context.started < nOfProducers) SleepMsec(1);
+
+    int64 start = HRT::HRTCounter();
+    context.go = 1;
+    int64 timeout = start + (int64)(10.0 / HRT::HRTPeriod());
+    while ((handler->received < total) && (HRT::HRTCounter() < timeout)) SleepMsec(0);
+    double elapsed = (HRT::HRTCounter() - start) * HRT::HRTPeriod();
+    while (context.finished < nOfProducers) SleepMsec(1);
+    if (handler->received < total){
+        printf("handler: timeout after %d messages\n", handler->received);
+    }
+
+    double sendNs = context.sendTicks * HRT::HRTPeriod() * 1e9 / total;
+    printf("%-8s producers = %2d messages = %7d: %10.0f messages/s, SendMessage mean = %8.0f ns\n", "handler", nOfProducers, handler->received, handler->received / elapsed, sendNs);
+
+    GetGlobalObjectDataBase()->Remove(handler->Name());
+}
+
+int main(int argc, char **argv){
+    int32 nOfMessages = (argc > 1) ? atoi(argv[1]) : 200000;
+    if (nOfMessages < 16){
+        printf("Usage: MessageQueueBenchmark.ex [messagesPerTest]\n");
+        return -1;
+    }
+
+    const int32 producers[] = {1, 2, 4, 8, 16};
+    for (uint32 i = 0; i < sizeof(producers) / sizeof(producers[0]); i++){
+        RunTest<LockedMessageQueue>("locked", producers[i], nOfMessages);
+        RunTest<MessageQueue>("lockfree", producers[i], nOfMessages);
+    }
+    for (uint32 i = 0; i < sizeof(producers) / sizeof(producers[0]); i++){
+        RunHandlerTest(producers[i], nOfMessages);
+    }
+    return 0;
+}
+
@@ -144,6 +144,26 @@ public:
         }
     }
 
+    /** number of numerator coefficients */
+    int InputSize() const{
+        return inputSize;
+    }
+
+    /** number of denominator coefficients, including the unused one at location 0 */
+    int OutputSize() const{
+        return outputSize;
+    }
+
+    /** the numerator, normalised to a denominator with b0 = 1 */
+    const double *InputCoefficients() const{
+        return inputCoefficients;
+    }
+
+    /** the negated denominator: output = sum(inputCoefficients[j] * input[-j]) + sum(outputCoefficients[j] * output[-j]) for j > 0 */
+    const double *OutputCoefficients() const{
+        return outputCoefficients;
+    }
+
 #if !defined(_CINT)
     /** */
     inline float Process(float input){
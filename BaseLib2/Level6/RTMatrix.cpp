@@ -28,6 +28,12 @@
 #include "Matrix.h"
 #include "System.h"
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 template <class T>
     inline bool RTM__vecIsNull_T(const T* d,const uint32 sz){
         const T* df=d+sz;
@@ -460,6 +466,131 @@ void RTMVProductAcc_T(RTMatrixT<T> &rtm,Tin *input,Tout *output){
     }
 }
 
+/** Number of columns processed in each pass of the blocked matrix x vector
+    product: the slice of the input vector is reused by all the rows while it
+    is in the L1 cache */
+#define RTMV_COLUMN_BLOCK 2048
+
+#if defined(__AVX__) || defined(__SSE2__)
+#define RTMV_SIMD
+
+/** The vector operations of the blocked matrix x vector product on floats */
+struct RTMVSimdF{
+#if defined(__AVX__)
+    typedef __m256 V;
+    enum { Lanes = 8 };
+    static inline V Zero(){ return _mm256_setzero_ps(); }
+    static inline V Load(const float *p){ return _mm256_loadu_ps(p); }
+    static inline V MulAdd(V acc,V a,V b){ return _mm256_add_ps(acc,_mm256_mul_ps(a,b)); }
+    static inline float Sum(V v){
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(v),_mm256_extractf128_ps(v,1));
+        s = _mm_add_ps(s,_mm_movehl_ps(s,s));
+        s = _mm_add_ss(s,_mm_shuffle_ps(s,s,1));
+        return _mm_cvtss_f32(s);
+    }
+#else
+    typedef __m128 V;
+    enum { Lanes = 4 };
+    static inline V Zero(){ return _mm_setzero_ps(); }
+    static inline V Load(const float *p){ return _mm_loadu_ps(p); }
+    static inline V MulAdd(V acc,V a,V b){ return _mm_add_ps(acc,_mm_mul_ps(a,b)); }
+    static inline float Sum(V v){
+        V s = _mm_add_ps(v,_mm_movehl_ps(v,v));
+        s = _mm_add_ss(s,_mm_shuffle_ps(s,s,1));
+        return _mm_cvtss_f32(s);
+    }
+#endif
+};
+
+/** The vector operations of the blocked matrix x vector product on doubles */
+struct RTMVSimdD{
+#if defined(__AVX__)
+    typedef __m256d V;
+    enum { Lanes = 4 };
+    static inline V Zero(){ return _mm256_setzero_pd(); }
+    static inline V Load(const double *p){ return _mm256_loadu_pd(p); }
+    static inline V MulAdd(V acc,V a,V b){ return _mm256_add_pd(acc,_mm256_mul_pd(a,b)); }
+    static inline double Sum(V v){
+        __m128d s = _mm_add_pd(_mm256_castpd256_pd128(v),_mm256_extractf128_pd(v,1));
+        s = _mm_add_sd(s,_mm_unpackhi_pd(s,s));
+        return _mm_cvtsd_f64(s);
+    }
+#else
+    typedef __m128d V;
+    enum { Lanes = 2 };
+    static inline V Zero(){ return _mm_setzero_pd(); }
+    static inline V Load(const double *p){ return _mm_loadu_pd(p); }
+    static inline V MulAdd(V acc,V a,V b){ return _mm_add_pd(acc,_mm_mul_pd(a,b)); }
+    static inline double Sum(V v){
+        V s = _mm_add_sd(v,_mm_unpackhi_pd(v,v));
+        return _mm_cvtsd_f64(s);
+    }
+#endif
+};
+
+/** Matrix x vector product (output = or += rtm x input) blocked in
+    RTMV_COLUMN_BLOCK columns and in groups of four rows, which share each load
+    of the input. The products of a row are summed in S::Lanes partial sums.
+    The input and the output must not overlap */
+template <class S,class T>
+void RTMVProductBlocked_T(RTMatrixT<T> &rtm,const T *input,T *output,bool accumulate){
+    const uint32 rows    = rtm.n;
+    const uint32 columns = rtm.m;
+    const T     *mat     = rtm.data;
+    uint32 r;
+
+    if (!accumulate) for (r = 0; r < rows; r++) output[r] = 0;
+
+    for (uint32 c0 = 0; c0 < columns; c0 += RTMV_COLUMN_BLOCK){
+        uint32 c1 = c0 + RTMV_COLUMN_BLOCK;
+        if (c1 > columns) c1 = columns;
+        const uint32 cV = c0 + ((c1 - c0) / S::Lanes) * S::Lanes;
+        uint32 c;
+
+        for (r = 0; r + 4 <= rows; r += 4){
+            const T *a0 = mat + r * columns;
+            const T *a1 = a0 + columns;
+            const T *a2 = a1 + columns;
+            const T *a3 = a2 + columns;
+            typename S::V s0 = S::Zero();
+            typename S::V s1 = S::Zero();
+            typename S::V s2 = S::Zero();
+            typename S::V s3 = S::Zero();
+            for (c = c0; c < cV; c += S::Lanes){
+                typename S::V x = S::Load(input + c);
+                s0 = S::MulAdd(s0,S::Load(a0 + c),x);
+                s1 = S::MulAdd(s1,S::Load(a1 + c),x);
+                s2 = S::MulAdd(s2,S::Load(a2 + c),x);
+                s3 = S::MulAdd(s3,S::Load(a3 + c),x);
+            }
+            T t0 = S::Sum(s0);
+            T t1 = S::Sum(s1);
+            T t2 = S::Sum(s2);
+            T t3 = S::Sum(s3);
+            for (; c < c1; c++){
+                t0 += a0[c] * input[c];
+                t1 += a1[c] * input[c];
+                t2 += a2[c] * input[c];
+                t3 += a3[c] * input[c];
+            }
+            output[r    ] += t0;
+            output[r + 1] += t1;
+            output[r + 2] += t2;
+            output[r + 3] += t3;
+        }
+
+        for (; r < rows; r++){
+            const T *a0 = mat + r * columns;
+            typename S::V s0 = S::Zero();
+            for (c = c0; c < cV; c += S::Lanes) s0 = S::MulAdd(s0,S::Load(a0 + c),S::Load(input + c));
+            T t0 = S::Sum(s0);
+            for (; c < c1; c++) t0 += a0[c] * input[c];
+            output[r] += t0;
+        }
+    }
+}
+#endif
+
 template <class T1,class T2>
 void RTMDotProduct_T(RTMatrixT<T1> &rtm,const RTMatrixT<T2> &A){
     T2 *a1= (T2 *)A.data; // beginning of this
@@ -1191,12 +1322,22 @@ void RTMProduct_UFFF(RTMatrixT<float> &rtm,const RTMatrixT<float> &A,const RTMat
 void RTMProduct_UDDD(RTMatrixT<double>&rtm,const RTMatrixT<double>&A,const RTMatrixT<double>&B){   RTMProduct_T(rtm,A,B); }
 
 void RTMVProduct_UIII(RTMatrixT<int> &rtm,int *input,int *output)         { RTMVProduct_T(rtm,input,output); }
+#if defined(RTMV_SIMD)
+void RTMVProduct_UFFF(RTMatrixT<float> &rtm,float *input,float *output)   { RTMVProductBlocked_T<RTMVSimdF>(rtm,input,output,False); }
+void RTMVProduct_UDDD(RTMatrixT<double> &rtm,double *input,double *output){ RTMVProductBlocked_T<RTMVSimdD>(rtm,input,output,False); }
+#else
 void RTMVProduct_UFFF(RTMatrixT<float> &rtm,float *input,float *output)   { RTMVProduct_T(rtm,input,output); }
 void RTMVProduct_UDDD(RTMatrixT<double> &rtm,double *input,double *output){ RTMVProduct_T(rtm,input,output); }
+#endif
 
 void RTMVProductAcc_UIII(RTMatrixT<int> &rtm,int *input,int *output)         { RTMVProductAcc_T(rtm,input,output); }
+#if defined(RTMV_SIMD)
+void RTMVProductAcc_UFFF(RTMatrixT<float> &rtm,float *input,float *output)   { RTMVProductBlocked_T<RTMVSimdF>(rtm,input,output,True); }
+void RTMVProductAcc_UDDD(RTMatrixT<double> &rtm,double *input,double *output){ RTMVProductBlocked_T<RTMVSimdD>(rtm,input,output,True); }
+#else
 void RTMVProductAcc_UFFF(RTMatrixT<float> &rtm,float *input,float *output)   { RTMVProductAcc_T(rtm,input,output); }
 void RTMVProductAcc_UDDD(RTMatrixT<double> &rtm,double *input,double *output){ RTMVProductAcc_T(rtm,input,output); }
+#endif
 
 void RTMDotProduct_UII(RTMatrixT<int   > &rtm,const RTMatrixT<int   > &A){ RTMDotProduct_T(rtm,A); }
 void RTMDotProduct_UFF(RTMatrixT<float > &rtm,const RTMatrixT<float > &A){ RTMDotProduct_T(rtm,A); }
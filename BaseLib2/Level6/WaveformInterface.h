@@ -32,7 +32,20 @@
 #include "System.h"
 
 class WaveformInterface {
+protected:
+    /** The state of the owner of the waveform (e.g. the GAM function number) */
+    uint32                currentState;
+
 public:
+    WaveformInterface() {
+        currentState = 0;
+    }
+
+    /** Informs the waveform of the state of its owner */
+    virtual void          SetState(uint32 state) {
+        currentState = state;
+    }
+
     virtual float         GetValue(int32 usecTime)  = 0;
 
     virtual int32         GetValueInt32(int32 usecTime) {
@@ -0,0 +1,345 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+#include "DeferredLogRing.h"
+#include "Streamable.h"
+
+/** Same limit of the option buffer of VCPrintf */
+static const int32 DLROptionBufferSize = 22;
+
+/**
+ * Walks the format, with the same rules of VCPrintf, up to the next
+ * conversion consuming an argument.
+ * @param format Where to start. On return after the conversion
+ * @param rightJustify The justification state of VCPrintf, which is kept between conversions
+ * @param spec If not NULL receives the conversion to pass to VCPrintf (DLR_MAX_SPEC_SIZE chars)
+ * @param out If not NULL receives the text VCPrintf prints before the conversion
+ * @return DLRNone at the end of the format
+ */
+static DLRArgumentType DLRNextArgument(const char *&format, bool &rightJustify, char *spec, Streamable *out){
+    char desiredPadding = 0;
+    int  desiredSize    = 0;
+    int  status         = 0;
+    int  subFieldStatus = 0;
+    int  longMode       = 0;
+    int  optionSize     = 0;
+    int  specSize       = 0;
+    bool specOverflow   = False;
+
+    char c;
+    while((c = *format++) != 0){
+        if(status == 0){
+            if(c == '%'){
+                status         = 1;
+                desiredPadding = 0;
+                desiredSize    = 0;
+                subFieldStatus = 0;
+                longMode       = 0;
+                optionSize     = 1;
+                specSize       = 0;
+                specOverflow   = False;
+                if(spec != NULL){
+                    spec[specSize++] = '%';
+                    // VCPrintf starts from a right justified state
+                    if(!rightJustify) spec[specSize++] = '-';
+                }
+            }
+            else if(out != NULL) out->PutC(c);
+            continue;
+        }
+
+        DLRArgumentType type = DLRNone;
+        switch(c){
+            case '%':{
+                status = 0;
+                if(out != NULL) out->PutC(c);
+            } break;
+            case '.':{
+                if((subFieldStatus == 0) && (optionSize < DLROptionBufferSize)){
+                    subFieldStatus = 1;
+                    optionSize++;
+                }
+                else{
+                    if(out != NULL) out->PutC(c);
+                    status = 0;
+                }
+            } break;
+            case '0':
+                if((desiredSize == 0) && (optionSize < DLROptionBufferSize)){
+                    desiredPadding = '0';
+                    optionSize++;
+                    break;
+                }
+            case '1':
+            case '2':
+            case '3':
+            case '4':
+            case '5':
+            case '6':
+            case '7':
+            case '8':
+            case '9':{
+                if(optionSize < DLROptionBufferSize){
+                    if(subFieldStatus == 0) desiredSize = desiredSize * 10 + c - '0';
+                    optionSize++;
+                }
+                else{
+                    if(out != NULL) out->PutC(c);
+                    status = 0;
+                }
+            } break;
+            case 'o':
+            case 'd':
+            case 'u':
+            case 'i':
+            case 'X':
+            case 'p':
+            case 'x':{
+                type = (longMode == 2) ? DLRInt64 : DLRInt32;
+            } break;
+            case 'f':
+            case 'e':{
+                type = DLRDouble;
+            } break;
+            case 's':{
+                type = DLRString;
+            } break;
+            case 'c':{
+                type = DLRChar;
+            } break;
+            case 'l':{
+                if(longMode < 2) longMode++;
+                else             longMode = 0;
+            } break;
+            case 'L':{
+                if(!longMode) longMode = 2;
+                else{
+                    if(out != NULL) out->PutC(c);
+                    status = 0;
+                }
+            } break;
+            case '-':{
+                if(rightJustify){
+                    rightJustify = False;
+                }
+                else if(desiredPadding == 0){
+                    desiredPadding = c;
+                }
+                else{
+                    if(out != NULL){
+                        out->PutC('%');
+                        out->PutC(desiredPadding);
+                        out->PutC('-');
+                        out->PutC('-');
+                    }
+                    status = 0;
+                }
+            } break;
+            default:{
+                if(rightJustify && (desiredPadding == 0) && (desiredSize == 0) && (optionSize < DLROptionBufferSize)){
+                    optionSize++;
+                    desiredPadding = c;
+                }
+                else{
+                    if(out != NULL) out->PutC(c);
+                    status = 0;
+                }
+            } break;
+        }
+
+        if((status == 1) && (spec != NULL)){
+            if(specSize < (DLR_MAX_SPEC_SIZE - 1)) spec[specSize++] = c;
+            else                                   specOverflow = True;
+        }
+        if(type != DLRNone){
+            if(spec != NULL){
+                // Only a long run of 'l' can overflow: keep the meaning
+                if(specOverflow){
+                    specSize = 0;
+                    spec[specSize++] = '%';
+                    if(type == DLRInt64){
+                        spec[specSize++] = 'l';
+                        spec[specSize++] = 'l';
+                    }
+                    spec[specSize++] = c;
+                }
+                spec[specSize] = 0;
+            }
+            return type;
+        }
+    }
+    format--;
+    return DLRNone;
+}
+
+/** Appends a value to the arguments */
+static inline bool DLRPut(DeferredLogRecord &record, const void *value, uint32 size){
+    if((record.argumentsSize + size) > sizeof(record.arguments)) return False;
+    memcpy(record.arguments + record.argumentsSize, value, size);
+    record.argumentsSize += size;
+    return True;
+}
+
+/** Reads a value from the arguments */
+static inline bool DLRGet(const DeferredLogRecord &record, uint32 &position, void *value, uint32 size){
+    if((position + size) > record.argumentsSize) return False;
+    memcpy(value, record.arguments + position, size);
+    position += size;
+    return True;
+}
+
+/** Prints one argument through VCPrintf */
+static void DLRPrint(Streamable &out, const char *spec, ...){
+    va_list argList;
+    va_start(argList, spec);
+    out.VPrintf(spec, argList);
+    va_end(argList);
+}
+
+/** Marks a NULL string */
+static const uint16 DLRNullString = 0xFFFF;
+
+const char *DLRBegin(DeferredLogRecord &record, const char *header, const char *description){
+    record.header          = header;
+    record.descriptionSize = 0;
+    record.argumentsSize   = 0;
+    record.truncated       = False;
+    if(description == NULL) return NULL;
+
+    // Leaves at least half of the space to the arguments
+    uint32 length = strlen(description);
+    if(length > (sizeof(record.arguments) / 2 - 1)){
+        length           = sizeof(record.arguments) / 2 - 1;
+        record.truncated = True;
+    }
+    memcpy(record.arguments, description, length);
+    record.arguments[length] = 0;
+    record.descriptionSize   = length + 1;
+    record.argumentsSize     = record.descriptionSize;
+    return record.arguments;
+}
+
+bool DLRCapture(DeferredLogRecord &record, const char *format, va_list argList){
+    if(format == NULL) return True;
+    bool rightJustify = True;
+    DLRArgumentType type;
+    while((type = DLRNextArgument(format, rightJustify, NULL, NULL)) != DLRNone){
+        bool ok = True;
+        switch(type){
+            case DLRInt32:{
+                int32 value = va_arg(argList, int32);
+                ok = DLRPut(record, &value, sizeof(value));
+            } break;
+            case DLRInt64:{
+                int64 value = va_arg(argList, int64);
+                ok = DLRPut(record, &value, sizeof(value));
+            } break;
+            case DLRDouble:{
+                double value = va_arg(argList, double);
+                ok = DLRPut(record, &value, sizeof(value));
+            } break;
+            case DLRChar:{
+                int32 value = va_arg(argList, int);
+                ok = DLRPut(record, &value, sizeof(value));
+            } break;
+            case DLRString:{
+                const char *value = va_arg(argList, const char *);
+                uint16 size = DLRNullString;
+                if(value != NULL){
+                    // Truncated to the space left
+                    uint32 length = strlen(value);
+                    uint32 space  = sizeof(record.arguments) - record.argumentsSize;
+                    space  = (space > sizeof(size)) ? (space - sizeof(size)) : 0;
+                    if(length > space){
+                        length           = space;
+                        record.truncated = True;
+                    }
+                    size = length;
+                }
+                ok = DLRPut(record, &size, sizeof(size));
+                if(ok && (value != NULL)) ok = DLRPut(record, value, size);
+            } break;
+            default: break;
+        }
+        if(!ok){
+            record.truncated = True;
+            return False;
+        }
+    }
+    return True;
+}
+
+/** Formats one of the formats of a record.
+    @return False if the arguments ran out */
+static bool DLRReplayFormat(const DeferredLogRecord &record, uint32 &position, const char *format, Streamable &out){
+    if(format == NULL) return True;
+    bool rightJustify = True;
+    char spec[DLR_MAX_SPEC_SIZE];
+    DLRArgumentType type;
+    while((type = DLRNextArgument(format, rightJustify, spec, &out)) != DLRNone){
+        bool ok = True;
+        switch(type){
+            case DLRInt32:
+            case DLRChar:{
+                int32 value = 0;
+                if((ok = DLRGet(record, position, &value, sizeof(value)))) DLRPrint(out, spec, value);
+            } break;
+            case DLRInt64:{
+                int64 value = 0;
+                if((ok = DLRGet(record, position, &value, sizeof(value)))) DLRPrint(out, spec, value);
+            } break;
+            case DLRDouble:{
+                double value = 0;
+                if((ok = DLRGet(record, position, &value, sizeof(value)))) DLRPrint(out, spec, value);
+            } break;
+            case DLRString:{
+                uint16 size = 0;
+                ok = DLRGet(record, position, &size, sizeof(size));
+                if(ok && (size == DLRNullString)){
+                    DLRPrint(out, spec, (const char *)NULL);
+                }
+                else if(ok){
+                    char value[sizeof(record.arguments) + 1];
+                    if((ok = DLRGet(record, position, value, size))){
+                        value[size] = 0;
+                        DLRPrint(out, spec, value);
+                    }
+                }
+            } break;
+            default: break;
+        }
+        if(!ok) return False;
+    }
+    return True;
+}
+
+void DLRReplay(const DeferredLogRecord &record, Streamable &out){
+    uint32 position = record.descriptionSize;
+    const char *description = (record.descriptionSize > 0) ? record.arguments : NULL;
+    if(DLRReplayFormat(record, position, record.header, out)){
+        if(DLRReplayFormat(record, position, description, out) && !record.truncated) return;
+    }
+    out.Printf(" [truncated]");
+}
+
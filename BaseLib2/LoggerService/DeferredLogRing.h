@@ -0,0 +1,164 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * @brief Records of the deferred logging.
+ * A thread logging in deferred mode does not format its messages: it copies
+ * the format pointers and the raw arguments in a ring which it owns. The
+ * LoggerService thread formats them later with VCPrintf, so the text is the
+ * same produced by the immediate mode. Each ring has a single writer (its
+ * thread) and a single reader (the LoggerService thread) and never blocks.
+ * The header formats must be valid for the lifetime of the program (literals).
+ * The description format, which may be a temporary buffer of the caller, and
+ * the strings passed as arguments (%s) are copied in the record.
+ */
+#if !defined (_DEFERRED_LOG_RING_H)
+#define _DEFERRED_LOG_RING_H
+
+#include "System.h"
+#include "Atomic.h"
+
+class Streamable;
+
+/** Size of a record in bytes */
+#define DLR_RECORD_SIZE        512
+/** Number of records in the ring of each thread */
+#define DLR_NUMBER_OF_RECORDS  64
+/** Largest conversion specification (e.g. %08x) which is replayed */
+#define DLR_MAX_SPEC_SIZE      32
+
+/** Type of the argument consumed by a conversion, as read by VCPrintf */
+enum DLRArgumentType{
+    DLRNone   = 0,
+    DLRInt32  = 1,
+    DLRInt64  = 2,
+    DLRDouble = 3,
+    DLRString = 4,
+    DLRChar   = 5
+};
+
+/** A message waiting to be formatted */
+struct DeferredLogRecord{
+    /** The format of the header (e.g. |TM=%x|...) */
+    const char *header;
+    /** Bytes of arguments used by the copy of the format of the message, including the terminator */
+    uint32      descriptionSize;
+    /** Bytes used in arguments */
+    uint32      argumentsSize;
+    /** True if the format or the arguments did not fit */
+    uint32      truncated;
+    /** The format of the message and then the arguments of header and of description, packed */
+    char        arguments[DLR_RECORD_SIZE - sizeof(const char *) - 3 * sizeof(uint32)];
+};
+
+extern "C" {
+
+    /** Clears the record and copies the format of the message at the beginning
+        of the arguments. A format longer than half of the arguments is truncated.
+        @return The copy, to be passed to DLRCapture */
+    const char *DLRBegin(DeferredLogRecord &record, const char *header, const char *description);
+
+    /** Copies the arguments of a format in the record.
+        @return False if they did not fit (the record is marked as truncated) */
+    bool DLRCapture(DeferredLogRecord &record, const char *format, va_list argList);
+
+    /** Formats a record */
+    void DLRReplay(const DeferredLogRecord &record, Streamable &out);
+
+}
+
+/** The ring of a thread */
+class DeferredLogRing{
+private:
+    /** Incremented by the writer after filling a record */
+    volatile uint32    writeIndex;
+
+    /** Incremented by the reader after formatting a record */
+    volatile uint32    readIndex;
+
+    /** The records */
+    DeferredLogRecord  records[DLR_NUMBER_OF_RECORDS];
+
+public:
+    /** Records lost because the ring was full */
+    volatile uint32    dropped;
+
+    /** Dropped records already reported */
+    uint32             reportedDropped;
+
+    /** 1 while a thread owns the ring */
+    volatile int32     owned;
+
+    /** Set when the owner thread exits: the ring is freed once empty */
+    volatile int32     ownerExited;
+
+    /** The owner thread */
+    TID                tid;
+
+    DeferredLogRing(){
+        writeIndex      = 0;
+        readIndex       = 0;
+        dropped         = 0;
+        reportedDropped = 0;
+        owned           = 0;
+        ownerExited     = 0;
+        tid             = 0;
+    }
+
+    /** The record to fill, NULL if the ring is full. Writer only */
+    inline DeferredLogRecord *BeginWrite(){
+        if((writeIndex - readIndex) >= DLR_NUMBER_OF_RECORDS){
+            dropped++;
+            return NULL;
+        }
+        return &records[writeIndex % DLR_NUMBER_OF_RECORDS];
+    }
+
+    /** Makes the record visible to the reader. Writer only */
+    inline void EndWrite(){
+        Atomic::Barrier();
+        writeIndex++;
+    }
+
+    /** The oldest record, NULL if empty. Reader only */
+    inline const DeferredLogRecord *Peek() const{
+        if(readIndex == writeIndex) return NULL;
+        Atomic::Barrier();
+        return &records[readIndex % DLR_NUMBER_OF_RECORDS];
+    }
+
+    /** Frees the oldest record. Reader only */
+    inline void Release(){
+        Atomic::Barrier();
+        readIndex++;
+    }
+
+    /** True if no records are waiting */
+    inline bool IsEmpty() const{
+        return (readIndex == writeIndex);
+    }
+};
+
+#endif
@@ -36,10 +36,17 @@
 #include "Console.h"
 #include "Sleep.h"
 #include "URL.h"
+#include "DeferredLogRing.h"
+
+#if defined(_LINUX)
+#include <pthread.h>
+#endif
 
 const int32 LSPageSize = 128;
 const int32 LSNOfPages = 512;
 const int32 LSNOfErrors = 64;
+// number of threads which can log in deferred mode at the same time
+const int32 LSNOfDeferredRings = 32;
 
 //
 class LoggerPage:public Queueable{
@@ -67,6 +74,14 @@ void LoggerServiceBufferFN(CStream *cs);
 //
 void LoggerServiceThreadFN(void *arg);
 
+// formats a message in the caller context
+static void LSVAssembleErrorMessage(const char *errorDescription,va_list argList,const char *errorHeader,va_list headerArgList);
+
+#if defined(_LINUX)
+// frees the deferred ring of a thread when it exits
+static void LSDeferredThreadExit(void *ring);
+#endif
+
 
 // ex static
 class LoggerService{
@@ -108,6 +123,22 @@ class LoggerService{
 //    URL                     loggerServerUrl;
     FString                 loggerServerUrl;
 
+// DEFERRED LOGGING
+
+    /** the rings of the threads logging in deferred mode. NULL until enabled */
+    DeferredLogRing         *deferredRings;
+
+    /** the function replaced by the deferred mode */
+    AssembleErrorMessageFunctionType immediateAssembleFunction;
+
+    /** True while the deferred mode is enabled */
+    bool                    deferredEnabled;
+
+#if defined(_LINUX)
+    /** the ring of each thread */
+    pthread_key_t           deferredKey;
+#endif
+
 public:
 
     bool ThreadHasToContinue()
@@ -142,9 +173,23 @@ public:
     /** */
     bool HasPendingErrorEntries()
     {
-        return (logsIndex.Size() > 0);
+        return (logsIndex.Size() > 0) || HasPendingDeferredEntries();
     }
 
+// DEFERRED LOGGING
+
+    /** */
+    bool SetDeferredLogging(bool enable);
+
+    /** the ring of the calling thread. NULL if not available */
+    DeferredLogRing *ThreadRing();
+
+    /** formats the deferred messages. Returns True if any was found */
+    bool ProcessDeferredErrors(FString &errorMsg);
+
+    /** */
+    bool HasPendingDeferredEntries();
+
 // ERROR PROCESSING
 
     /** */
@@ -190,6 +235,9 @@ LoggerService::LoggerService():
     pagesIndex(LSNOfPages,False)
 {
     hasToContinue       = False;
+    deferredRings       = NULL;
+    deferredEnabled     = False;
+    immediateAssembleFunction = NULL;
     pages               = new LoggerPage[LSNOfPages];
     if (pages == NULL){
         printf("FAILED ALLOCATING PAGES FOR LOGGERSERVICE !!!! \n");
@@ -265,6 +313,7 @@ if (pages != NULL)delete []pages;
 if (LSErrors != NULL)delete []LSErrors;
     pages = NULL;
     LSErrors = NULL;
+    // the rings are not freed: other static destructors may still log
 }
 
 
@@ -399,6 +448,116 @@ void LoggerService::ThreadFinished()
     hasToContinue       = False;
 }
 
+//
+bool LoggerService::SetDeferredLogging(bool enable)
+{
+#if defined(_LINUX)
+    if (!enable){
+        if (deferredEnabled) LSSetUserAssembleErrorMessageFunction(immediateAssembleFunction);
+        deferredEnabled = False;
+        return True;
+    }
+    if (deferredEnabled) return True;
+    if (deferredRings == NULL){
+        if (pthread_key_create(&deferredKey,LSDeferredThreadExit) != 0){
+            CStaticAssertErrorCondition(FatalError,"LoggerService::SetDeferredLogging: failed creating the thread key");
+            return False;
+        }
+        deferredRings = new DeferredLogRing[LSNOfDeferredRings];
+        if (deferredRings == NULL){
+            CStaticAssertErrorCondition(FatalError,"LoggerService::SetDeferredLogging: failed allocating the rings");
+            return False;
+        }
+    }
+    LSGetUserAssembleErrorMessageFunction(immediateAssembleFunction);
+    if (immediateAssembleFunction == LSDeferredAssembleErrorMessage) immediateAssembleFunction = LSAssembleErrorMessage;
+    deferredEnabled = True;
+    LSSetUserAssembleErrorMessageFunction(LSDeferredAssembleErrorMessage);
+    return True;
+#else
+    if (!enable) return True;
+    CStaticAssertErrorCondition(Warning,"LoggerService::SetDeferredLogging: not supported on this platform");
+    return False;
+#endif
+}
+
+//
+DeferredLogRing *LoggerService::ThreadRing()
+{
+#if defined(_LINUX)
+    // the messages would not be processed
+    if (!hasToContinue || (deferredRings == NULL)) return NULL;
+
+    DeferredLogRing *ring = (DeferredLogRing *)pthread_getspecific(deferredKey);
+    if (ring != NULL) return ring;
+
+    for (int i=0;i<LSNOfDeferredRings;i++){
+        DeferredLogRing &candidate = deferredRings[i];
+        if ((candidate.owned == 0) && __sync_bool_compare_and_swap(&candidate.owned,0,1)){
+            candidate.ownerExited = 0;
+            candidate.tid         = Threads::ThreadId();
+            pthread_setspecific(deferredKey,&candidate);
+            return &candidate;
+        }
+    }
+#endif
+    return NULL;
+}
+
+//
+bool LoggerService::ProcessDeferredErrors(FString &errorMsg)
+{
+    if (deferredRings == NULL) return False;
+
+    bool found = False;
+    for (int i=0;i<LSNOfDeferredRings;i++){
+        DeferredLogRing &ring = deferredRings[i];
+        if (ring.owned == 0) continue;
+
+        // at most one ring worth per pass, not to starve the others
+        const DeferredLogRecord *record;
+        for (int j=0;(j<DLR_NUMBER_OF_RECORDS) && ((record = ring.Peek()) != NULL);j++){
+            errorMsg = "";
+            DLRReplay(*record,errorMsg);
+            ring.Release();
+            ProcessError(errorMsg);
+            found = True;
+        }
+
+        uint32 dropped = ring.dropped;
+        if (dropped != ring.reportedDropped){
+            CStaticAssertErrorCondition(Warning,"LoggerService: %d deferred messages of thread %08x were lost (ring full)",dropped - ring.reportedDropped,ring.tid);
+            ring.reportedDropped = dropped;
+        }
+
+        if (ring.ownerExited && ring.IsEmpty()){
+            ring.dropped         = 0;
+            ring.reportedDropped = 0;
+            ring.tid             = 0;
+            ring.ownerExited     = 0;
+            Atomic::Barrier();
+            ring.owned           = 0;
+        }
+    }
+    return found;
+}
+
+//
+bool LoggerService::HasPendingDeferredEntries()
+{
+    if (deferredRings == NULL) return False;
+    for (int i=0;i<LSNOfDeferredRings;i++){
+        if (!deferredRings[i].IsEmpty()) return True;
+    }
+    return False;
+}
+
+#if defined(_LINUX)
+static void LSDeferredThreadExit(void *ring){
+    if (ring != NULL) ((DeferredLogRing *)ring)->ownerExited = 1;
+}
+#endif
+
 
 
 void  LoggerServiceThreadFN(void *arg){
@@ -408,10 +567,12 @@ void  LoggerServiceThreadFN(void *arg){
 
     FString errorMsg;
     while(LoggerServiceInstance.ThreadHasToContinue()){
+        bool deferred = LoggerServiceInstance.ProcessDeferredErrors(errorMsg);
+
         LoggerPage *pages = LoggerServiceInstance.GetLogEntry();
 
         if (pages == NULL) {
-            SleepMsec(1);
+            if (!deferred) SleepMsec(1);
         }
         else {
             errorMsg = "";
@@ -489,7 +650,7 @@ bool EndLogStream(CStream *cs){
 
 // Cannot simply write to a stream because of the need of allocating memory
 // which is incompatible with being called by interrupts
-void LSAssembleErrorMessage(const char *errorDescription,va_list argList,const char *errorHeader,...){
+static void LSVAssembleErrorMessage(const char *errorDescription,va_list argList,const char *errorHeader,va_list headerArgList){
 
     CStream cs;
 
@@ -497,10 +658,7 @@ void LSAssembleErrorMessage(const char *errorDescription,va_list argList,const c
     if (!ret) return;
 
     if (errorHeader!=NULL){
-        va_list argList2;
-        va_start(argList2,errorHeader);
-        VCPrintf(&cs,errorHeader,argList2);
-        va_end(argList2);
+        VCPrintf(&cs,errorHeader,headerArgList);
     }
 
     VCPrintf(&cs,errorDescription,argList);
@@ -508,6 +666,37 @@ void LSAssembleErrorMessage(const char *errorDescription,va_list argList,const c
 
 }
 
+void LSAssembleErrorMessage(const char *errorDescription,va_list argList,const char *errorHeader,...){
+    va_list argList2;
+    va_start(argList2,errorHeader);
+    LSVAssembleErrorMessage(errorDescription,argList,errorHeader,argList2);
+    va_end(argList2);
+}
+
+// Only copies the arguments: the LoggerService thread will format them
+void LSDeferredAssembleErrorMessage(const char *errorDescription,va_list argList,const char *errorHeader,...){
+    va_list argList2;
+    va_start(argList2,errorHeader);
+
+    DeferredLogRing *ring = LoggerServiceInstance.ThreadRing();
+    if (ring == NULL){
+        LSVAssembleErrorMessage(errorDescription,argList,errorHeader,argList2);
+        va_end(argList2);
+        return;
+    }
+
+    DeferredLogRecord *record = ring->BeginWrite();
+    if (record != NULL){
+        // The description may be a buffer of the caller: the record keeps a copy
+        const char *description = DLRBegin(*record,errorHeader,errorDescription);
+        if (DLRCapture(*record,errorHeader,argList2)){
+            DLRCapture(*record,description,argList);
+        }
+        ring->EndWrite();
+    }
+    va_end(argList2);
+}
+
 
 void LSProcessPendingErrors(){
     int maxWait = 100;
@@ -527,6 +716,10 @@ void LSStopService(){
     LoggerServiceInstance.StopThread();
 }
 
+bool LSSetDeferredLogging(bool enable){
+    return LoggerServiceInstance.SetDeferredLogging(enable);
+}
+
 bool LSLastError(ErrorSystemInfo &info,int32 index){
     return LoggerServiceInstance.LastError(info,index);
 }
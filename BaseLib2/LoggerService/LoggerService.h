@@ -62,6 +62,15 @@ extern "C" {
     /** the function that handles the errors */
     void LSAssembleErrorMessage(const char *errorDescription,va_list argList,const char *errorHeader,...);
 
+    /** the function that handles the errors in deferred mode: the arguments are
+        copied in a ring of the calling thread and formatted by the logger thread.
+        The formats must be literals. Falls back to LSAssembleErrorMessage if the
+        logger thread is not running or all the rings are taken */
+    void LSDeferredAssembleErrorMessage(const char *errorDescription,va_list argList,const char *errorHeader,...);
+
+    /** installs (or removes) LSDeferredAssembleErrorMessage. Only on linux */
+    bool LSSetDeferredLogging(bool enable);
+
 }
 
 static inline bool LSSetRemoteLogger(const char *serverName,int port){
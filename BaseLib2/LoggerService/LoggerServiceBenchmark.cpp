@@ -0,0 +1,140 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Measures the cost of a log call in the calling thread, with the messages
+ * formatted immediately and with the deferred mode. It first checks that the
+ * deferred mode produces the same text of VCPrintf.
+ * Usage: LoggerServiceBenchmark.ex [nOfBursts] [burstSize]
+ */
+
+#include "System.h"
+#include "FString.h"
+#include "HRT.h"
+#include "Sleep.h"
+#include "LoggerService.h"
+#include "ErrorSystemInfo.h"
+#include "DeferredLogRing.h"
+
+/** Formats with VCPrintf and through a deferred record and compares the results */
+static bool CheckFormat(const char *format, ...){
+    FString immediate;
+    va_list argList;
+    va_start(argList, format);
+    immediate.VPrintf(format, argList);
+    va_end(argList);
+
+    // The format is copied from a buffer which is then overwritten, as the
+    // FString buffers passed by some callers
+    char buffer[128];
+    strncpy(buffer, format, sizeof(buffer) - 1);
+    buffer[sizeof(buffer) - 1] = 0;
+    DeferredLogRecord record;
+    const char *description = DLRBegin(record, NULL, buffer);
+    memset(buffer, '#', sizeof(buffer) - 1);
+    va_start(argList, format);
+    DLRCapture(record, description, argList);
+    va_end(argList);
+    FString deferred;
+    DLRReplay(record, deferred);
+
+    if(immediate == deferred) return True;
+    printf("MISMATCH for \"%s\": \"%s\" != \"%s\"\n", format, immediate.Buffer(), deferred.Buffer());
+    return False;
+}
+
+/** To sort the samples */
+static int CompareDouble(const void *a, const void *b){
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+    return (da < db) ? -1 : ((da > db) ? 1 : 0);
+}
+
+/** Times nOfBursts bursts of log calls. The logger thread empties the backlog between bursts */
+static void TimeLogCalls(const char *mode, int32 nOfBursts, int32 burstSize){
+    uint32  nOfCalls = nOfBursts * burstSize;
+    double *samples  = (double *)malloc(nOfCalls * sizeof(double));
+    double  total    = 0;
+    for(int32 b = 0; b < nOfBursts; b++){
+        for(int32 i = 0; i < burstSize; i++){
+            int64 start = HRT::HRTCounter();
+            CStaticAssertErrorCondition(Warning, "Benchmark: burst %d message %d value %f in %s mode", b, i, 0.5 * i, mode);
+            double elapsed = (HRT::HRTCounter() - start) * HRT::HRTPeriod();
+            samples[b * burstSize + i] = elapsed * 1e9;
+            total += elapsed;
+        }
+        LSProcessPendingErrors();
+    }
+    qsort(samples, nOfCalls, sizeof(double), CompareDouble);
+    printf("%-10s: %6u calls mean = %7.0f ns p50 = %7.0f ns p99 = %7.0f ns max = %8.0f ns\n", mode, nOfCalls, total / nOfCalls * 1e9, samples[nOfCalls / 2], samples[(uint32)(nOfCalls * 0.99)], samples[nOfCalls - 1]);
+    free((void *&)samples);
+
+    ErrorSystemInfo last;
+    if(LSLastError(last, 0)){
+        printf("%-10s: last message \"%s\"\n", mode, last.ErrorMessage());
+    }
+}
+
+int main(int argc, char **argv){
+    int32 nOfBursts = (argc > 1) ? atoi(argv[1]) : 100;
+    int32 burstSize = (argc > 2) ? atoi(argv[2]) : 32;
+    if((nOfBursts < 1) || (burstSize < 1)){
+        printf("Usage: LoggerServiceBenchmark.ex [nOfBursts] [burstSize]\n");
+        return -1;
+    }
+    if(burstSize > DLR_NUMBER_OF_RECORDS){
+        printf("burstSize limited to %d, the size of the deferred ring\n", DLR_NUMBER_OF_RECORDS);
+        burstSize = DLR_NUMBER_OF_RECORDS;
+    }
+
+    bool ok = True;
+    ok = CheckFormat("plain text") && ok;
+    ok = CheckFormat("%d %i %u %x %X %o", -12, 34, 56u, 0xabcd, 0xABCD, 8) && ok;
+    ok = CheckFormat("|%08x|%5d|%-5d|%05d|", 0x1234, 42, 42, 42) && ok;
+    ok = CheckFormat("%lld %llx %Ld", (int64)-1234567890123LL, (int64)0x123456789abLL, (int64)99) && ok;
+    ok = CheckFormat("%f %e %.3f %10.2f", 3.25, 1.5e-7, 2.0 / 3.0, -12.5) && ok;
+    ok = CheckFormat("[%s] [%10s] [%-10s] [%c]", "abc", "right", "left", 'z') && ok;
+    ok = CheckFormat("100%% done %s, then %s", "first", "second") && ok;
+    ok = CheckFormat("|TM=%x|C=%s|O=%08x|T=%08x|E=%08x|D=%s", 0x5f5e100, "GAM", 0xdeadbeef, 1234, 2, "message") && ok;
+    printf("Deferred formatting %s\n", ok ? "matches VCPrintf" : "DIFFERS from VCPrintf");
+
+    LSSetRemoteLogger("localhost", 32767);
+    LSStartService();
+    LSSetUserAssembleErrorMessageFunction(LSAssembleErrorMessage);
+    SleepMsec(100);
+
+    TimeLogCalls("immediate", nOfBursts, burstSize);
+    if(!LSSetDeferredLogging(True)){
+        printf("Deferred logging not available\n");
+    }
+    else{
+        TimeLogCalls("deferred", nOfBursts, burstSize);
+        LSSetDeferredLogging(False);
+    }
+
+    LSStopService();
+    return ok ? 0 : -1;
+}
+
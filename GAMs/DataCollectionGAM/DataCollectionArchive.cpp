@@ -0,0 +1,436 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they
+   will be approved by the European Commission - subsequent
+   versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the
+   Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in
+   writing, software distributed under the Licence is
+   distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+   express or implied.
+ * See the Licence for the specific language governing
+   permissions and limitations under the Licence.
+ *
+ * $Id$
+ *
+**/
+
+#include "DataCollectionArchive.h"
+#include "DataCollectionSignalsTable.h"
+#include "RTCollectionBuffer.h"
+
+#if defined(_LINUX) || defined(_MACOSX) || defined(_SOLARIS)
+#define DCA_USE_MMAP
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/** Number of samples transposed together. The rows of a block stay in the cache
+    while all the columns are filled */
+#define DCA_TRANSPOSE_ROWS 64
+
+/** Position and size of a column in the sample */
+struct DCAColumn{
+    uint32 offset;
+    uint32 wordSize;
+};
+
+static int DCAColumnCompare(const void *a, const void *b){
+    uint32 offsetA = ((const DCAColumn *)a)->offset;
+    uint32 offsetB = ((const DCAColumn *)b)->offset;
+    if(offsetA < offsetB) return -1;
+    if(offsetA > offsetB) return 1;
+    return 0;
+}
+
+static void DCACopyName(char *destination, const char *source, uint32 size){
+    strncpy(destination, source, size - 1);
+    destination[size - 1] = 0;
+}
+
+#if defined(DCA_USE_MMAP)
+
+/** Transposes the rows of a chunk into its columns */
+static void DCAFillChunk(uint32 *chunk, const uint32 **rows, uint32 nOfRows, const DCAColumn *columns, uint32 nOfColumns){
+    uint32 *timeColumn    = chunk;
+    uint32 *triggerColumn = chunk + nOfRows;
+    for(uint32 first = 0; first < nOfRows; first += DCA_TRANSPOSE_ROWS){
+        uint32 last = first + DCA_TRANSPOSE_ROWS;
+        if(last > nOfRows) last = nOfRows;
+
+        uint32 r;
+        for(r = first; r < last; r++){
+            timeColumn[r]    = rows[r][0];
+            triggerColumn[r] = rows[r][1];
+        }
+
+        for(uint32 c = 0; c < nOfColumns; c++){
+            uint32  offset   = columns[c].offset + DCA_HEADER_COLUMNS;
+            uint32  wordSize = columns[c].wordSize;
+            uint32 *dst      = chunk + (uint64)nOfRows * offset + (uint64)first * wordSize;
+            if(wordSize == 1){
+                for(r = first; r < last; r++) *dst++ = rows[r][offset];
+            }
+            else{
+                for(r = first; r < last; r++){
+                    const uint32 *src = rows[r] + offset;
+                    for(uint32 w = 0; w < wordSize; w++) *dst++ = src[w];
+                }
+            }
+        }
+    }
+}
+
+bool DataCollectionArchiveWriter::Write(const char *fileName, RTCollectionBuffer *buffers, uint32 nOfSamples, uint32 sampleWords, DataCollectionSignalsTable &signalTable, uint32 chunkSamples){
+    if((fileName == NULL) || (chunkSamples == 0)){
+        CStaticAssertErrorCondition(FatalError, "DataCollectionArchiveWriter::Write: invalid parameters");
+        return False;
+    }
+
+    uint32 nOfSignals = signalTable.ListSize();
+    uint32 nOfChunks  = (nOfSamples + chunkSamples - 1) / chunkSamples;
+    uint32 rowWords   = DCA_HEADER_COLUMNS + sampleWords;
+
+    int64 dataSize          = (int64)nOfSamples * rowWords * sizeof(uint32);
+    int64 signalTableOffset = sizeof(DCAFileHeader) + dataSize;
+    int64 chunkIndexOffset  = signalTableOffset + (int64)nOfSignals * sizeof(DCASignalEntry);
+    int64 fileSize          = chunkIndexOffset + (int64)nOfChunks * sizeof(DCAChunkEntry);
+    if((int64)(size_t)fileSize != fileSize){
+        CStaticAssertErrorCondition(FatalError, "DataCollectionArchiveWriter::Write: %s: the archive (%lld bytes) cannot be mapped", fileName, fileSize);
+        return False;
+    }
+
+    DCAColumn *columns = (DCAColumn *)malloc(sizeof(DCAColumn) * (nOfSignals + 1));
+    const uint32 **rows = (const uint32 **)malloc(sizeof(uint32 *) * chunkSamples);
+    if((columns == NULL) || (rows == NULL)){
+        CStaticAssertErrorCondition(FatalError, "DataCollectionArchiveWriter::Write: %s: failed allocating the transposition tables", fileName);
+        if(columns != NULL) free((void *&)columns);
+        if(rows != NULL)    free((void *&)rows);
+        return False;
+    }
+
+    FString tempFileName;
+    tempFileName.Printf("%s.tmp", fileName);
+
+    int fd = open(tempFileName.Buffer(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0){
+        CStaticAssertErrorCondition(FatalError, "DataCollectionArchiveWriter::Write: failed creating %s: %s", tempFileName.Buffer(), strerror(errno));
+        free((void *&)columns);
+        free((void *&)rows);
+        return False;
+    }
+
+    char *map = (char *)MAP_FAILED;
+    if(ftruncate(fd, (off_t)fileSize) == 0){
+        map = (char *)mmap(NULL, (size_t)fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if(map == (char *)MAP_FAILED){
+        CStaticAssertErrorCondition(FatalError, "DataCollectionArchiveWriter::Write: failed mapping %lld bytes of %s: %s", fileSize, tempFileName.Buffer(), strerror(errno));
+        close(fd);
+        unlink(tempFileName.Buffer());
+        free((void *&)columns);
+        free((void *&)rows);
+        return False;
+    }
+
+    //////////////////
+    // Signal table //
+    //////////////////
+
+    DCASignalEntry *signalEntries = (DCASignalEntry *)(map + signalTableOffset);
+    uint32 nOfColumns = 0;
+    DataCollectionSignal *sig = (DataCollectionSignal *)signalTable.List();
+    uint32 i;
+    for(i = 0; (i < nOfSignals) && (sig != NULL); i++){
+        DCASignalEntry &entry = signalEntries[i];
+        BasicTypeDescriptor type = sig->Type();
+        FString typeName;
+        type.ConvertToString(typeName);
+
+        DCACopyName(entry.jpfName,  sig->JPFName(),     DCA_NAME_SIZE);
+        DCACopyName(entry.ddbName,  sig->DDBName(),     DCA_NAME_SIZE);
+        DCACopyName(entry.typeName, typeName.Buffer(),  DCA_TYPE_NAME_SIZE);
+        entry.typeCode = *((int32 *)&type);
+        entry.offset   = sig->Offset();
+        entry.wordSize = type.Word32Size();
+        entry.cal0     = sig->Cal0();
+        entry.cal1     = sig->Cal1();
+        entry.reserved = 0;
+
+        if((entry.wordSize > 0) && (entry.offset + entry.wordSize <= sampleWords)){
+            columns[nOfColumns].offset   = entry.offset;
+            columns[nOfColumns].wordSize = entry.wordSize;
+            nOfColumns++;
+        }
+        else{
+            CStaticAssertErrorCondition(Warning, "DataCollectionArchiveWriter::Write: %s: signal %s is outside the collection buffer and is not archived", fileName, sig->JPFName());
+        }
+        sig = sig->Next();
+    }
+    // Reading the rows in order while filling the columns
+    qsort(columns, nOfColumns, sizeof(DCAColumn), DCAColumnCompare);
+
+    ////////////
+    // Chunks //
+    ////////////
+
+    DCAChunkEntry *chunkEntries = (DCAChunkEntry *)(map + chunkIndexOffset);
+    RTCollectionBuffer *buf = buffers;
+    int64 chunkOffset = sizeof(DCAFileHeader);
+    uint32 firstSample = 0;
+    for(uint32 c = 0; c < nOfChunks; c++){
+        uint32 nOfRows = 0;
+        while((nOfRows < chunkSamples) && (firstSample + nOfRows < nOfSamples) && (buf != NULL)){
+            rows[nOfRows++] = buf->Data();
+            buf = buf->Next();
+        }
+        if(nOfRows == 0) break;
+
+        DCAFillChunk((uint32 *)(map + chunkOffset), rows, nOfRows, columns, nOfColumns);
+
+        DCAChunkEntry &entry = chunkEntries[c];
+        entry.offset        = chunkOffset;
+        entry.firstSample   = firstSample;
+        entry.nOfSamples    = nOfRows;
+        entry.firstUsecTime = (int32)rows[0][0];
+        entry.lastUsecTime  = (int32)rows[nOfRows - 1][0];
+
+        chunkOffset += (int64)nOfRows * rowWords * sizeof(uint32);
+        firstSample += nOfRows;
+    }
+
+    ////////////
+    // Header //
+    ////////////
+
+    DCAFileHeader *header = (DCAFileHeader *)map;
+    memcpy(header->magic, DCA_MAGIC, sizeof(header->magic));
+    header->version           = DCA_VERSION;
+    header->headerSize        = sizeof(DCAFileHeader);
+    header->nOfSignals        = nOfSignals;
+    header->nOfSamples        = firstSample;
+    header->chunkSamples      = chunkSamples;
+    header->nOfChunks         = nOfChunks;
+    header->sampleWords       = sampleWords;
+    header->reserved          = 0;
+    header->signalTableOffset = signalTableOffset;
+    header->chunkIndexOffset  = chunkIndexOffset;
+    header->fileSize          = fileSize;
+
+    free((void *&)columns);
+    free((void *&)rows);
+
+    bool ok = (firstSample == nOfSamples);
+    if(!ok){
+        CStaticAssertErrorCondition(FatalError, "DataCollectionArchiveWriter::Write: %s: expected %d samples and found %d", fileName, nOfSamples, firstSample);
+    }
+    if(munmap(map, (size_t)fileSize) != 0) ok = False;
+    if(close(fd) != 0)                     ok = False;
+
+    if(ok && (rename(tempFileName.Buffer(), fileName) != 0)){
+        CStaticAssertErrorCondition(FatalError, "DataCollectionArchiveWriter::Write: failed renaming %s: %s", tempFileName.Buffer(), strerror(errno));
+        ok = False;
+    }
+    if(!ok) unlink(tempFileName.Buffer());
+
+    return ok;
+}
+
+bool DataCollectionArchiveReader::Open(const char *fileName){
+    Close();
+
+    int fd = open(fileName, O_RDONLY);
+    if(fd < 0){
+        CStaticAssertErrorCondition(FatalError, "DataCollectionArchiveReader::Open: failed opening %s: %s", fileName, strerror(errno));
+        return False;
+    }
+
+    struct stat fileStat;
+    if((fstat(fd, &fileStat) != 0) || (fileStat.st_size < (off_t)sizeof(DCAFileHeader))){
+        CStaticAssertErrorCondition(FatalError, "DataCollectionArchiveReader::Open: %s is not an archive", fileName);
+        close(fd);
+        return False;
+    }
+
+    void *map = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED){
+        CStaticAssertErrorCondition(FatalError, "DataCollectionArchiveReader::Open: failed mapping %s: %s", fileName, strerror(errno));
+        return False;
+    }
+
+    mappedFile = (char *)map;
+    mappedSize = fileStat.st_size;
+    header     = (const DCAFileHeader *)mappedFile;
+
+    bool ok = (memcmp(header->magic, DCA_MAGIC, sizeof(header->magic)) == 0);
+    ok = ok && (header->version    == DCA_VERSION);
+    ok = ok && (header->headerSize == sizeof(DCAFileHeader));
+    ok = ok && (header->fileSize   == mappedSize);
+    ok = ok && (header->chunkSamples > 0);
+    // The tables follow the chunks in this order: compared as int64 so
+    // that a corrupted (negative) offset cannot wrap around
+    ok = ok && ((int64)header->headerSize <= header->signalTableOffset);
+    ok = ok && (header->signalTableOffset + (int64)header->nOfSignals * (int64)sizeof(DCASignalEntry) <= header->chunkIndexOffset);
+    ok = ok && (header->chunkIndexOffset  + (int64)header->nOfChunks  * (int64)sizeof(DCAChunkEntry)  <= mappedSize);
+    ok = ok && ((int64)header->nOfChunks * header->chunkSamples >= (int64)header->nOfSamples);
+    if(!ok){
+        CStaticAssertErrorCondition(FatalError, "DataCollectionArchiveReader::Open: %s has an invalid or incomplete header", fileName);
+        Close();
+        return False;
+    }
+
+    signals = (const DCASignalEntry *)(mappedFile + header->signalTableOffset);
+    chunks  = (const DCAChunkEntry  *)(mappedFile + header->chunkIndexOffset);
+
+    // The chunks lie between the header and the signal table
+    // Only the last chunk may be partially filled and together they hold all the samples
+    int64 rowBytes     = (int64)(DCA_HEADER_COLUMNS + header->sampleWords) * (int64)sizeof(uint32);
+    int64 totalSamples = 0;
+    for(uint32 c = 0; ok && (c < header->nOfChunks); c++){
+        const DCAChunkEntry &chunk = chunks[c];
+        ok = ((int64)header->headerSize <= chunk.offset);
+        ok = ok && (chunk.offset + (int64)chunk.nOfSamples * rowBytes <= header->signalTableOffset);
+        if(c + 1 < header->nOfChunks) ok = ok && (chunk.nOfSamples == header->chunkSamples);
+        else                          ok = ok && (chunk.nOfSamples <= header->chunkSamples);
+        ok = ok && ((int64)chunk.firstSample == (int64)c * header->chunkSamples);
+        totalSamples += chunk.nOfSamples;
+    }
+    ok = ok && (totalSamples == (int64)header->nOfSamples);
+    if(!ok){
+        CStaticAssertErrorCondition(FatalError, "DataCollectionArchiveReader::Open: %s has an invalid chunk index", fileName);
+        Close();
+        return False;
+    }
+    return True;
+}
+
+void DataCollectionArchiveReader::Close(){
+    if(mappedFile != NULL) munmap(mappedFile, (size_t)mappedSize);
+    mappedFile = NULL;
+    mappedSize = 0;
+    header     = NULL;
+    signals    = NULL;
+    chunks     = NULL;
+}
+
+#else
+
+bool DataCollectionArchiveWriter::Write(const char *fileName, RTCollectionBuffer *buffers, uint32 nOfSamples, uint32 sampleWords, DataCollectionSignalsTable &signalTable, uint32 chunkSamples){
+    CStaticAssertErrorCondition(FatalError, "DataCollectionArchiveWriter::Write: archives are not supported on this platform");
+    return False;
+}
+
+bool DataCollectionArchiveReader::Open(const char *fileName){
+    CStaticAssertErrorCondition(FatalError, "DataCollectionArchiveReader::Open: archives are not supported on this platform");
+    return False;
+}
+
+void DataCollectionArchiveReader::Close(){
+}
+
+#endif
+
+const DCASignalEntry *DataCollectionArchiveReader::FindSignal(const char *name) const{
+    if((header == NULL) || (name == NULL)) return NULL;
+    for(uint32 i = 0; i < header->nOfSignals; i++){
+        if((strncmp(signals[i].jpfName, name, DCA_NAME_SIZE) == 0) || (strncmp(signals[i].ddbName, name, DCA_NAME_SIZE) == 0)){
+            return &signals[i];
+        }
+    }
+    return NULL;
+}
+
+bool DataCollectionArchiveReader::FindTimeRange(int32 startUsecTime, int32 endUsecTime, uint32 &firstSample, uint32 &nOfSamples) const{
+    firstSample = 0;
+    nOfSamples  = 0;
+    if(header == NULL) return False;
+    if((header->nOfChunks == 0) || (startUsecTime > endUsecTime)) return True;
+
+    // First chunk ending at or after startUsecTime
+    uint32 low  = 0;
+    uint32 high = header->nOfChunks;
+    while(low < high){
+        uint32 mid = (low + high) / 2;
+        if(chunks[mid].lastUsecTime < startUsecTime) low = mid + 1;
+        else                                         high = mid;
+    }
+    if(low == header->nOfChunks) return True;
+    const DCAChunkEntry &startChunk = chunks[low];
+    const int32 *times = (const int32 *)Column(startChunk, 0);
+    uint32 lowSample  = 0;
+    uint32 highSample = startChunk.nOfSamples;
+    while(lowSample < highSample){
+        uint32 mid = (lowSample + highSample) / 2;
+        if(times[mid] < startUsecTime) lowSample = mid + 1;
+        else                           highSample = mid;
+    }
+    uint32 first = startChunk.firstSample + lowSample;
+
+    // First chunk ending after endUsecTime
+    low  = 0;
+    high = header->nOfChunks;
+    while(low < high){
+        uint32 mid = (low + high) / 2;
+        if(chunks[mid].lastUsecTime <= endUsecTime) low = mid + 1;
+        else                                        high = mid;
+    }
+    uint32 end = header->nOfSamples;
+    if(low < header->nOfChunks){
+        const DCAChunkEntry &endChunk = chunks[low];
+        times      = (const int32 *)Column(endChunk, 0);
+        lowSample  = 0;
+        highSample = endChunk.nOfSamples;
+        while(lowSample < highSample){
+            uint32 mid = (lowSample + highSample) / 2;
+            if(times[mid] <= endUsecTime) lowSample = mid + 1;
+            else                          highSample = mid;
+        }
+        end = endChunk.firstSample + lowSample;
+    }
+
+    if(end > first){
+        firstSample = first;
+        nOfSamples  = end - first;
+    }
+    return True;
+}
+
+bool DataCollectionArchiveReader::ReadColumn(uint32 column, uint32 wordSize, uint32 firstSample, uint32 nOfSamples, uint32 *destination) const{
+    if((header == NULL) || (destination == NULL)) return False;
+    if((firstSample > header->nOfSamples) || (nOfSamples > header->nOfSamples - firstSample)){
+        CStaticAssertErrorCondition(FatalError, "DataCollectionArchiveReader::ReadColumn: samples [%d, %d[ out of range [0, %d[", firstSample, firstSample + nOfSamples, header->nOfSamples);
+        return False;
+    }
+    if(column + wordSize > DCA_HEADER_COLUMNS + header->sampleWords){
+        CStaticAssertErrorCondition(FatalError, "DataCollectionArchiveReader::ReadColumn: column %d out of range", column);
+        return False;
+    }
+
+    uint32 sample = firstSample;
+    uint32 end    = firstSample + nOfSamples;
+    while(sample < end){
+        const DCAChunkEntry &chunk = chunks[ChunkOf(sample)];
+        uint32 chunkFirst = sample - chunk.firstSample;
+        uint32 chunkEnd   = chunk.nOfSamples;
+        if(chunk.firstSample + chunkEnd > end) chunkEnd = end - chunk.firstSample;
+        // Cannot happen with an index validated by Open
+        if(chunkFirst >= chunkEnd) return False;
+        uint32 nOfWords   = (chunkEnd - chunkFirst) * wordSize;
+        memcpy(destination, Column(chunk, column) + (uint64)chunkFirst * wordSize, nOfWords * sizeof(uint32));
+        destination += nOfWords;
+        sample      += chunkEnd - chunkFirst;
+    }
+    return True;
+}
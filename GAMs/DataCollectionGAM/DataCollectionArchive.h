@@ -0,0 +1,244 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they
+   will be approved by the European Commission - subsequent
+   versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the
+   Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in
+   writing, software distributed under the Licence is
+   distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+   express or implied.
+ * See the Licence for the specific language governing
+   permissions and limitations under the Licence.
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Columnar binary archive of the data collected in a pulse.
+ *
+ * The file is made of a header, the data chunks and a footer:
+ *
+ *   DCAFileHeader
+ *   chunk 0 | chunk 1 | ... | chunk nOfChunks-1
+ *   DCASignalEntry[nOfSignals]   (at signalTableOffset)
+ *   DCAChunkEntry[nOfChunks]     (at chunkIndexOffset)
+ *
+ * Each chunk holds up to chunkSamples consecutive samples stored column by column:
+ * the usec time column (int32), the fast trigger column (uint32) and then one column
+ * per signal. A signal with offset o in the collection buffer and a size of w 32 bit
+ * words starts at chunkOffset + 4 * chunkSize * (2 + o) and stores its samples
+ * contiguously, w words each. The chunk index keeps the first and last time of each
+ * chunk so that a time range can be located without reading the data.
+ *
+ * The archive is built in memory mapped temporary file which is renamed when
+ * complete, so that a reader never maps a partially written archive.
+ * Only available on the platforms supporting mmap.
+ */
+#if !defined (_DATA_COLLECTION_ARCHIVE_)
+#define _DATA_COLLECTION_ARCHIVE_
+
+#include "System.h"
+#include "FString.h"
+#include "BasicTypes.h"
+
+class RTCollectionBuffer;
+class DataCollectionSignalsTable;
+
+/** Identifies the archive files */
+#define DCA_MAGIC           "MARTeDCA"
+/** Version of the format */
+#define DCA_VERSION         1
+/** Size of the names stored in the signal table, including the terminator */
+#define DCA_NAME_SIZE       64
+/** Size of the type names stored in the signal table, including the terminator */
+#define DCA_TYPE_NAME_SIZE  16
+/** Number of columns preceding the signal columns in a chunk (time and fast trigger) */
+#define DCA_HEADER_COLUMNS  2
+
+/** The file header */
+struct DCAFileHeader{
+    /** DCA_MAGIC, not terminated */
+    char   magic[8];
+    /** DCA_VERSION */
+    uint32 version;
+    /** sizeof(DCAFileHeader) */
+    uint32 headerSize;
+    /** Number of entries in the signal table */
+    uint32 nOfSignals;
+    /** Number of samples of each signal */
+    uint32 nOfSamples;
+    /** Maximum number of samples in a chunk */
+    uint32 chunkSamples;
+    /** Number of chunks */
+    uint32 nOfChunks;
+    /** Number of 32 bit words of the signals in each sample */
+    uint32 sampleWords;
+    /** Not used */
+    uint32 reserved;
+    /** Position of the signal table */
+    int64  signalTableOffset;
+    /** Position of the chunk index */
+    int64  chunkIndexOffset;
+    /** Size of the complete file */
+    int64  fileSize;
+};
+
+/** A signal of the archive */
+struct DCASignalEntry{
+    /** Name of the signal in the JPF database */
+    char   jpfName[DCA_NAME_SIZE];
+    /** Name of the signal in the DDB */
+    char   ddbName[DCA_NAME_SIZE];
+    /** The type as a string (e.g. float) */
+    char   typeName[DCA_TYPE_NAME_SIZE];
+    /** The BasicTypeDescriptor as an int32 */
+    int32  typeCode;
+    /** Offset of the signal in the sample, in 32 bit words */
+    uint32 offset;
+    /** Size of the signal, in 32 bit words */
+    uint32 wordSize;
+    /** Calibration factors */
+    float  cal0;
+    float  cal1;
+    /** Not used */
+    uint32 reserved;
+};
+
+/** An entry of the chunk index */
+struct DCAChunkEntry{
+    /** Position of the chunk */
+    int64  offset;
+    /** Index of the first sample of the chunk */
+    uint32 firstSample;
+    /** Number of samples in the chunk */
+    uint32 nOfSamples;
+    /** Time of the first sample */
+    int32  firstUsecTime;
+    /** Time of the last sample */
+    int32  lastUsecTime;
+};
+
+/** Writes the buffers collected in a pulse as an archive */
+class DataCollectionArchiveWriter{
+public:
+    /**
+     * Writes the archive in a temporary file which is then renamed to fileName,
+     * so that the readers of a previous archive are not disturbed.
+     * @param fileName The archive
+     * @param buffers The list of collected buffers (time ordered)
+     * @param nOfSamples The number of buffers in the list
+     * @param sampleWords The number of signal words in each buffer
+     * @param signalTable The description of the signals
+     * @param chunkSamples The maximum number of samples in each chunk
+     * @return True if the archive was written
+     */
+    static bool Write(const char *fileName, RTCollectionBuffer *buffers, uint32 nOfSamples, uint32 sampleWords, DataCollectionSignalsTable &signalTable, uint32 chunkSamples);
+};
+
+/** Reads an archive through a read only memory map */
+class DataCollectionArchiveReader{
+private:
+    /** The mapped file */
+    char                 *mappedFile;
+
+    /** Size of the mapped file */
+    int64                 mappedSize;
+
+    /** The header */
+    const DCAFileHeader  *header;
+
+    /** The signal table */
+    const DCASignalEntry *signals;
+
+    /** The chunk index */
+    const DCAChunkEntry  *chunks;
+
+    /** Position of a column of a chunk */
+    inline const uint32 *Column(const DCAChunkEntry &chunk, uint32 column) const{
+        return (const uint32 *)(mappedFile + chunk.offset) + (uint64)chunk.nOfSamples * column;
+    }
+
+    /** The chunk containing a sample */
+    inline uint32 ChunkOf(uint32 sample) const{
+        return sample / header->chunkSamples;
+    }
+
+    /** Copies a range of a column */
+    bool ReadColumn(uint32 column, uint32 wordSize, uint32 firstSample, uint32 nOfSamples, uint32 *destination) const;
+
+public:
+
+    DataCollectionArchiveReader(){
+        mappedFile = NULL;
+        mappedSize = 0;
+        header     = NULL;
+        signals    = NULL;
+        chunks     = NULL;
+    }
+
+    ~DataCollectionArchiveReader(){
+        Close();
+    }
+
+    /** Maps the archive and validates the header and the footer */
+    bool Open(const char *fileName);
+
+    /** Unmaps the archive */
+    void Close();
+
+    /** True if an archive is mapped */
+    bool IsOpen() const{
+        return (mappedFile != NULL);
+    }
+
+    /** Number of samples of each signal */
+    uint32 NumberOfSamples() const{
+        return (header == NULL) ? 0 : header->nOfSamples;
+    }
+
+    /** Number of signals */
+    uint32 NumberOfSignals() const{
+        return (header == NULL) ? 0 : header->nOfSignals;
+    }
+
+    /** A signal of the table, NULL if out of range */
+    const DCASignalEntry *Signal(uint32 index) const{
+        if((header == NULL) || (index >= header->nOfSignals)) return NULL;
+        return &signals[index];
+    }
+
+    /** Finds a signal by its JPF or DDB name.
+        @return NULL if not found */
+    const DCASignalEntry *FindSignal(const char *name) const;
+
+    /**
+     * Finds the samples whose time is in [startUsecTime, endUsecTime].
+     * Only the chunk index and the time column of the boundary chunks are read.
+     * @param firstSample The first sample in the range
+     * @param nOfSamples The number of samples in the range (0 if none)
+     */
+    bool FindTimeRange(int32 startUsecTime, int32 endUsecTime, uint32 &firstSample, uint32 &nOfSamples) const;
+
+    /** Copies nOfSamples times starting from firstSample */
+    bool ReadTime(uint32 firstSample, uint32 nOfSamples, int32 *destination) const{
+        return ReadColumn(0, 1, firstSample, nOfSamples, (uint32 *)destination);
+    }
+
+    /** Copies nOfSamples values of a signal starting from firstSample.
+        The destination must hold nOfSamples * signal.wordSize words */
+    bool ReadSignal(const DCASignalEntry &signal, uint32 firstSample, uint32 nOfSamples, void *destination) const{
+        return ReadColumn(DCA_HEADER_COLUMNS + signal.offset, signal.wordSize, firstSample, nOfSamples, (uint32 *)destination);
+    }
+};
+
+#endif
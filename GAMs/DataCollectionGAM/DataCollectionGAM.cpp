@@ -335,12 +335,105 @@ bool DataCollectionGAM::ProcessMessage(GCRTemplate<MessageEnvelope> envelope){
         sendSignal->Insert(signal);
         MessageHandler::SendMessage(sendSignalsEnvelope);
         return True;
+    }else if(messageContent == "GETSIGNALRANGE"){
+        // Reads a time window of a signal from the archive of the last pulse.
+        // The message contains the signal name and the start and end times in usec.
+        // The reply contains the signal and its TIME vector.
+
+        GCRTemplate<Message> sendSignal(GCFT_Create);
+        GCRTemplate<GCNString>  errorMessage(GCFT_Create);
+        GCRTemplate<MessageEnvelope> sendSignalsEnvelope(GCFT_Create);
+        if(!sendSignal.IsValid() || !errorMessage.IsValid() || !sendSignalsEnvelope.IsValid()){
+            AssertErrorCondition(FatalError,"DataCollectionGAM::ProcessMessage: %s: GETSIGNALRANGE: Failed creating the reply", Name());
+            return False;
+        }
+
+        sendSignal->Init(0,"SIGNAL");
+        errorMessage->SetObjectName("ERROR");
+        sendSignalsEnvelope->PrepareReply(envelope, sendSignal);
+
+        GCRTemplate<GCNString>  signalName = message->Find(0);
+        GCRTemplate<GCNString>  startTime  = message->Find(1);
+        GCRTemplate<GCNString>  endTime    = message->Find(2);
+        if(!signalName.IsValid() || !startTime.IsValid() || !endTime.IsValid()){
+            errorMessage->Printf("Expected the signal name, the start and the end time");
+            sendSignal->Insert(errorMessage);
+            MessageHandler::SendMessage(sendSignalsEnvelope);
+            AssertErrorCondition(InitialisationError,"DataCollectionGAM::ProcessMessage: %s: GETSIGNALRANGE: %s", Name(), errorMessage->Buffer());
+            return False;
+        }
+
+        GCRTemplate<SignalInterface>  time;
+        GCRTemplate<SignalInterface>  signal = dataCollector.GetSignalRange(*(signalName.operator->()), atoi(startTime->Buffer()), atoi(endTime->Buffer()), time);
+        if (!signal.IsValid() || !time.IsValid()){
+            errorMessage->Printf("Signal %s not available in the archive of GAM %s", signalName->Buffer(), Name());
+            sendSignal->Insert(errorMessage);
+            MessageHandler::SendMessage(sendSignalsEnvelope);
+            AssertErrorCondition(InitialisationError,"DataCollectionGAM::ProcessMessage: %s: GETSIGNALRANGE: %s ", Name(), errorMessage->Buffer());
+            return False;
+        }
+
+        sendSignal->Insert(signal);
+        sendSignal->Insert(time);
+        MessageHandler::SendMessage(sendSignalsEnvelope);
+        return True;
     }
 
     return False;
 }
 
+bool DataCollectionGAM::ProcessHttpArchiveRequest(HttpStream &hStream, const FString &signalName) {
+    hStream.SSPrintf("OutputHttpOtions.Content-Type","text/plain");
+    hStream.keepAlive = False;
+
+    int32 startTime = -0x7FFFFFFF;
+    int32 endTime   =  0x7FFFFFFF;
+    FString value;
+    if (hStream.Switch("InputCommands.start")){
+        hStream.Seek(0);
+        hStream.GetToken(value, "");
+        hStream.Switch((uint32)0);
+        startTime = atoi(value.Buffer());
+    }
+    value.SetSize(0);
+    if (hStream.Switch("InputCommands.end")){
+        hStream.Seek(0);
+        hStream.GetToken(value, "");
+        hStream.Switch((uint32)0);
+        endTime = atoi(value.Buffer());
+    }
+
+    GCRTemplate<SignalInterface>  time;
+    GCRTemplate<SignalInterface>  signal = dataCollector.GetSignalRange(signalName, startTime, endTime, time);
+    if(signal.IsValid() && time.IsValid()){
+        uint32 nOfSamples = signal->NumberOfSamples();
+        double *values = (double *)malloc(nOfSamples * sizeof(double));
+        if((values != NULL) && BTConvert(nOfSamples, BTDDouble, values, signal->Type(), signal->Buffer())){
+            const int32 *times = (const int32 *)time->Buffer();
+            for(uint32 i = 0; i < nOfSamples; i++){
+                hStream.Printf("%d %e\n", times[i], values[i]);
+            }
+        }
+        if(values != NULL) free((void *&)values);
+    }
+
+    hStream.WriteReplyHeader(True);
+    return True;
+}
+
 bool DataCollectionGAM::ProcessHttpMessage(HttpStream &hStream) {
+    // ?signal=NAME&start=USEC&end=USEC returns a window of the archived signal as text
+    FString signalName;
+    signalName.SetSize(0);
+    if (hStream.Switch("InputCommands.signal")){
+        hStream.Seek(0);
+        hStream.GetToken(signalName, "");
+        hStream.Switch((uint32)0);
+    }
+    if((signalName.Size() > 0) && dataCollector.IsArchiveAvailable()){
+        return ProcessHttpArchiveRequest(hStream, signalName);
+    }
+
     hStream.SSPrintf("OutputHttpOtions.Content-Type","text/html");
     hStream.keepAlive = False;
     //copy to the client
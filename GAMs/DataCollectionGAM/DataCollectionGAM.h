@@ -114,6 +114,9 @@ public:
     * @return False on error, True otherwise.
     */
     virtual bool ProcessHttpMessage(HttpStream &hStream);
+
+    /** Replies with a time window of an archived signal, one "time value" pair per line */
+    bool ProcessHttpArchiveRequest(HttpStream &hStream, const FString &signalName);
     // -- Was missing?
     virtual int GetTotalSamplesCollected();
 
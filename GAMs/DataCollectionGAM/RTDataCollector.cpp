@@ -28,6 +28,7 @@
 #include "FString.h"
 #include "CDBExtended.h"
 #include "DDBInterface.h"
+#include "HRT.h"
 
 
 bool ModifyTimeBase(StreamInterface &in,StreamInterface &out,void *userData){
@@ -67,9 +68,69 @@ bool RTDataCollector::CompleteDataCollection(){
     while((p = dataCollectionDelaySystem.QueueExtract()) != NULL){
         dataStorage.StoreData(*p,False);
     }
+
+    if(archiveFileName.Size() > 0){
+        // The previous archive is replaced
+        archiveReader.Close();
+        int64 startCounter = HRT::HRTCounter();
+        if(!DataCollectionArchiveWriter::Write(archiveFileName.Buffer(), dataStorage.Buffers(), dataStorage.Size(), nOfChannels, signalTable, archiveChunkSamples)){
+            AssertErrorCondition(FatalError,"RTDataCollector::CompleteDataCollection: %s: Failed writing the archive %s",Name(),archiveFileName.Buffer());
+            return True;
+        }
+        archiveWriteTime = (HRT::HRTCounter() - startCounter) * HRT::HRTPeriod();
+        if(!archiveReader.Open(archiveFileName.Buffer())){
+            AssertErrorCondition(FatalError,"RTDataCollector::CompleteDataCollection: %s: Failed opening the archive %s",Name(),archiveFileName.Buffer());
+            return True;
+        }
+        AssertErrorCondition(Information,"RTDataCollector::CompleteDataCollection: %s: Archived %d samples in %s in %f s",Name(),dataStorage.Size(),archiveFileName.Buffer(),archiveWriteTime);
+    }
     return True;
 }
 
+GCRTemplate<SignalInterface> RTDataCollector::GetSignalRange(const FString &signalName, int32 startUsecTime, int32 endUsecTime, GCRTemplate<SignalInterface> &time){
+
+    GCRTemplate<SignalInterface>  signal;
+    if(!archiveReader.IsOpen()){
+        AssertErrorCondition(FatalError,"RTDataCollector::GetSignalRange: %s: No archive is available",Name());
+        return signal;
+    }
+
+    const DCASignalEntry *entry = archiveReader.FindSignal(signalName.Buffer());
+    if(entry == NULL){
+        AssertErrorCondition(FatalError,"RTDataCollector::GetSignalRange: %s: Signal %s is not in the archive",Name(),signalName.Buffer());
+        return signal;
+    }
+
+    uint32 firstSample = 0;
+    uint32 nOfSamples  = 0;
+    if(!archiveReader.FindTimeRange(startUsecTime, endUsecTime, firstSample, nOfSamples) || (nOfSamples == 0)){
+        AssertErrorCondition(Warning,"RTDataCollector::GetSignalRange: %s: No samples of %s in [%d, %d]",Name(),signalName.Buffer(),startUsecTime,endUsecTime);
+        return signal;
+    }
+
+    // Create the signal
+    signal = GCRTemplate<SignalInterface>("Signal");
+    if(!signal.IsValid()) return signal;
+    signal->CopyData(BasicTypeDescriptor(entry->typeCode), nOfSamples, NULL, signalTable.GetUseUpperMemory2CopySignal());
+    if(!archiveReader.ReadSignal(*entry, firstSample, nOfSamples, (void *)signal->Buffer())){
+        signal.RemoveReference();
+        return signal;
+    }
+
+    GCRTemplate<GCNamedObject>    namedSignal = signal;
+    if(namedSignal.IsValid()) namedSignal->SetObjectName(signalName.Buffer());
+
+    time = GCRTemplate<SignalInterface>("Signal");
+    if(time.IsValid()){
+        time->CopyData(BTDInt32, nOfSamples, NULL, signalTable.GetUseUpperMemory2CopySignal());
+        archiveReader.ReadTime(firstSample, nOfSamples, (int32 *)time->Buffer());
+        GCRTemplate<GCNamedObject>    namedTime = time;
+        if(namedTime.IsValid()) namedTime->SetObjectName("TIME");
+    }
+
+    return signal;
+}
+
 bool RTDataCollector::ObjectLoadSetup(ConfigurationDataBase &info,StreamInterface *err, const DDBInterface *jpfInterface){
 
     // CleanUp
@@ -136,6 +197,14 @@ bool RTDataCollector::ObjectLoadSetup(ConfigurationDataBase &info,StreamInterfac
 
     dataCollectionDelaySystem.Init(preTrigger);
 
+    // Optional columnar archive of the pulse
+    cdb.ReadFString(archiveFileName, "ArchiveFile", "");
+    cdb.ReadInt32(archiveChunkSamples, "ArchiveChunkSamples", 8192);
+    if(archiveChunkSamples <= 0){
+        AssertErrorCondition(InitialisationError,"RTDataCollector::ObjectLoadSetup: %s: ArchiveChunkSamples must be > 0",Name());
+        return False;
+    }
+
     // Check if, when calling CopyData() in Level5/Signal.cpp, standard (lower) or extra (upper) memory allcation is required
     int32 tempUseUpperMemory2CopySignal = 0;
     if(!cdb.ReadInt32(tempUseUpperMemory2CopySignal, "UseUpperMemory2CopySignal", 0)){
@@ -262,6 +331,15 @@ bool RTDataCollector::ObjectDescription(StreamInterface &s,bool full,StreamInter
 
 void RTDataCollector::HTMLInfo(HttpStream &hStream) {
     dataStorage.HTMLInfo(hStream);
+    if(archiveFileName.Size() > 0){
+        hStream.Printf("<p>Archive %s: ", archiveFileName.Buffer());
+        if(archiveReader.IsOpen()){
+            hStream.Printf("%d signals x %d samples, written in %f s</p>\n", archiveReader.NumberOfSignals(), archiveReader.NumberOfSamples(), archiveWriteTime);
+        }
+        else{
+            hStream.Printf("not available</p>\n");
+        }
+    }
 }
 
 int RTDataCollector::GetTotalSamplesCollected(){
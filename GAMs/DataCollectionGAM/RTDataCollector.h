@@ -32,6 +32,7 @@
 #include "RTDataStorageSystem.h"
 #include "RTDataPool.h"
 #include "DataCollectionSignalsTable.h"
+#include "DataCollectionArchive.h"
 #include "SignalInterface.h"
 #include "BString.h"
 #include "HttpStream.h"
@@ -66,6 +67,18 @@ private:
     /** SignalTable Database */
     DataCollectionSignalsTable        signalTable;
 
+    /** Columnar archive written at the end of each pulse. Empty if not used */
+    FString                           archiveFileName;
+
+    /** Number of samples in each chunk of the archive */
+    int32                             archiveChunkSamples;
+
+    /** Time spent writing the last archive (in seconds) */
+    double                            archiveWriteTime;
+
+    /** Reads the last archive */
+    DataCollectionArchiveReader       archiveReader;
+
 private:
 
     /** Memory deallocation and list cleaning */
@@ -89,7 +102,7 @@ private:
 public:
 
     /** */
-    RTDataCollector():nOfChannels(0){};
+    RTDataCollector():nOfChannels(0),archiveChunkSamples(0),archiveWriteTime(0.0){};
 
     /** */
     ~RTDataCollector(){CleanUp();}
@@ -144,6 +157,15 @@ public:
         return signal;
     }
 
+    /** Get the data of a signal in a time window from the archive of the last pulse.
+        The times of the samples are returned in time */
+    GCRTemplate<SignalInterface>  GetSignalRange(const FString &signalName, int32 startUsecTime, int32 endUsecTime, GCRTemplate<SignalInterface> &time);
+
+    /** True if the data of the last pulse are available in the archive */
+    bool IsArchiveAvailable() const{
+        return archiveReader.IsOpen();
+    }
+
 public:
 
     void TimeWindowsMenu(StreamInterface &in, StreamInterface &out){
@@ -148,6 +148,9 @@ public:
     /** */
     uint32 Size(){ return ListSize(); }
 
+    /** The first of the stored buffers, in time order */
+    RTCollectionBuffer *Buffers(){ return List(); }
+
     /// Set time windows menu
     void TimeWindowsMenu(StreamInterface &in,StreamInterface &out);
 
@@ -0,0 +1,546 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+#include "BiquadFilterBank.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#if defined(__AVX512F__)
+#define BFB_VECTOR          __m512
+#define BFB_SET1(a)         _mm512_set1_ps(a)
+#define BFB_LOADU(p)        _mm512_loadu_ps(p)
+#define BFB_STOREU(p, a)    _mm512_storeu_ps(p, a)
+#define BFB_ADD(a, b)       _mm512_add_ps(a, b)
+#define BFB_MUL(a, b)       _mm512_mul_ps(a, b)
+#elif defined(__AVX__)
+#define BFB_VECTOR          __m256
+#define BFB_SET1(a)         _mm256_set1_ps(a)
+#define BFB_LOADU(p)        _mm256_loadu_ps(p)
+#define BFB_STOREU(p, a)    _mm256_storeu_ps(p, a)
+#define BFB_ADD(a, b)       _mm256_add_ps(a, b)
+#define BFB_MUL(a, b)       _mm256_mul_ps(a, b)
+#elif defined(__SSE__)
+#define BFB_VECTOR          __m128
+#define BFB_SET1(a)         _mm_set1_ps(a)
+#define BFB_LOADU(p)        _mm_loadu_ps(p)
+#define BFB_STOREU(p, a)    _mm_storeu_ps(p, a)
+#define BFB_ADD(a, b)       _mm_add_ps(a, b)
+#define BFB_MUL(a, b)       _mm_mul_ps(a, b)
+#endif
+
+/** Number of frequencies where the response is checked */
+#define BFB_RESPONSE_POINTS     256
+
+/** Maximum number of iterations of the root finder */
+#define BFB_ROOT_ITERATIONS     500
+
+static const double pi = 3.1415926535897932;
+
+/** A complex number, only used during the initialisation */
+struct BFBComplex{
+    double re;
+    double im;
+};
+
+static inline BFBComplex BFBMake(double re, double im){
+    BFBComplex c;
+    c.re = re;
+    c.im = im;
+    return c;
+}
+
+static inline BFBComplex BFBAdd(BFBComplex a, BFBComplex b){
+    return BFBMake(a.re + b.re, a.im + b.im);
+}
+
+static inline BFBComplex BFBSub(BFBComplex a, BFBComplex b){
+    return BFBMake(a.re - b.re, a.im - b.im);
+}
+
+static inline BFBComplex BFBMul(BFBComplex a, BFBComplex b){
+    return BFBMake(a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re);
+}
+
+static inline BFBComplex BFBDiv(BFBComplex a, BFBComplex b){
+    double den = b.re * b.re + b.im * b.im;
+    return BFBMake((a.re * b.re + a.im * b.im) / den, (a.im * b.re - a.re * b.im) / den);
+}
+
+/** False for NaN and infinity */
+static inline bool BFBIsFinite(double x){
+    return (x - x) == 0.0;
+}
+
+static inline double BFBAbs(BFBComplex a){
+    return sqrt(a.re * a.re + a.im * a.im);
+}
+
+/** Value of sum(c[k] x^k) for k < size */
+static BFBComplex BFBPolynomial(const double *c, int32 size, BFBComplex x){
+    BFBComplex value = BFBMake(0.0, 0.0);
+    for(int32 k = size - 1; k >= 0; k--){
+        value = BFBAdd(BFBMul(value, x), BFBMake(c[k], 0.0));
+    }
+    return value;
+}
+
+/**
+ * Roots of z^degree + monic[1] z^(degree-1) + ... + monic[degree]
+ * with the Aberth-Ehrlich iteration
+ */
+static bool BFBFindRoots(const double *monic, int32 degree, BFBComplex *roots){
+    if(degree == 0) return True;
+    if(degree == 1){
+        roots[0] = BFBMake(-monic[1], 0.0);
+        return True;
+    }
+
+    // Fujiwara bound of the roots
+    double bound = 0.0;
+    for(int32 k = 1; k <= degree; k++){
+        double r = pow(fabs(monic[k]), 1.0 / k);
+        if(r > bound) bound = r;
+    }
+    bound = 2.0 * bound;
+    if(bound == 0.0) bound = 1.0;
+    for(int32 k = 0; k < degree; k++){
+        double angle = 2.0 * pi * k / degree + 0.4;
+        roots[k] = BFBMake(bound * cos(angle), bound * sin(angle));
+    }
+
+    for(int32 iteration = 0; iteration < BFB_ROOT_ITERATIONS; iteration++){
+        double largestStep = 0.0;
+        for(int32 k = 0; k < degree; k++){
+            // Horner for the polynomial and its derivative
+            BFBComplex value      = BFBMake(1.0, 0.0);
+            BFBComplex derivative = BFBMake(0.0, 0.0);
+            for(int32 j = 1; j <= degree; j++){
+                derivative = BFBAdd(BFBMul(derivative, roots[k]), value);
+                value      = BFBAdd(BFBMul(value, roots[k]), BFBMake(monic[j], 0.0));
+            }
+            if(BFBAbs(value) == 0.0) continue;
+            BFBComplex ratio = BFBDiv(value, derivative);
+            BFBComplex sum   = BFBMake(0.0, 0.0);
+            for(int32 j = 0; j < degree; j++){
+                if(j != k) sum = BFBAdd(sum, BFBDiv(BFBMake(1.0, 0.0), BFBSub(roots[k], roots[j])));
+            }
+            BFBComplex step = BFBDiv(ratio, BFBSub(BFBMake(1.0, 0.0), BFBMul(ratio, sum)));
+            roots[k] = BFBSub(roots[k], step);
+            double relativeStep = BFBAbs(step) / (1.0 + BFBAbs(roots[k]));
+            if(relativeStep > largestStep) largestStep = relativeStep;
+        }
+        if(!BFBIsFinite(largestStep)) return False;
+        if(largestStep < 1e-15) break;
+    }
+    for(int32 k = 0; k < degree; k++){
+        if(!BFBIsFinite(roots[k].re) || !BFBIsFinite(roots[k].im)) return False;
+    }
+    return True;
+}
+
+/**
+ * Divides the polynomial by (z - root) while root is one of its roots.
+ * Used for z = -1 and z = 1, the multiple zeros of the filters designed with the
+ * bilinear transform, which the iteration would only find with a large error.
+ * @return the number of roots found
+ */
+static int32 BFBDeflate(double *monic, int32 &degree, double root, BFBComplex *roots){
+    int32 nOfRoots = 0;
+    while(degree > 0){
+        double value = 1.0;
+        double scale = 1.0;
+        int32 k;
+        for(k = 1; k <= degree; k++){
+            value  = value * root + monic[k];
+            scale += fabs(monic[k]);
+        }
+        if(fabs(value) > 1e-12 * scale) break;
+        for(k = 1; k < degree; k++){
+            monic[k] += root * monic[k - 1];
+        }
+        degree--;
+        roots[nOfRoots++] = BFBMake(root, 0.0);
+    }
+    return nOfRoots;
+}
+
+/** A real factor 1 + c1 z^-1 + c2 z^-2 (c2 = 0 for a first order factor) */
+struct BFBFactor{
+    double     c1;
+    double     c2;
+    /** The root with the largest modulus */
+    BFBComplex root;
+    /** 1 or 2 */
+    int32      order;
+};
+
+/**
+ * Groups the roots in real factors: the complex conjugate pairs and the real
+ * roots two by two (sorted by value)
+ * @return the number of factors, -1 if the complex roots are not in pairs
+ */
+static int32 BFBFactorise(BFBComplex *roots, int32 nOfRoots, BFBFactor *factors){
+    int32 nOfFactors = 0;
+    bool *used = (bool *)malloc((nOfRoots + 1) * sizeof(bool));
+    if(used == NULL) return -1;
+    int32 k;
+    for(k = 0; k < nOfRoots; k++) used[k] = False;
+
+    // Complex pairs
+    for(k = 0; k < nOfRoots; k++){
+        if(used[k]) continue;
+        if(fabs(roots[k].im) <= 1e-9 * (1.0 + BFBAbs(roots[k]))) continue;
+        double nearest = -1.0;
+        int32  partner = -1;
+        for(int32 j = 0; j < nOfRoots; j++){
+            if(used[j] || (j == k)) continue;
+            if((roots[j].im > 0) == (roots[k].im > 0)) continue;
+            double distance = BFBAbs(BFBSub(roots[j], BFBMake(roots[k].re, -roots[k].im)));
+            if((partner < 0) || (distance < nearest)){
+                nearest = distance;
+                partner = j;
+            }
+        }
+        if(partner < 0){
+            free((void *&)used);
+            return -1;
+        }
+        used[k]       = True;
+        used[partner] = True;
+        // Average the pair so that the factor is real
+        BFBComplex root = BFBMake(0.5 * (roots[k].re + roots[partner].re), 0.5 * fabs(roots[k].im - roots[partner].im));
+        factors[nOfFactors].c1    = -2.0 * root.re;
+        factors[nOfFactors].c2    = root.re * root.re + root.im * root.im;
+        factors[nOfFactors].root  = root;
+        factors[nOfFactors].order = 2;
+        nOfFactors++;
+    }
+
+    // Real roots, sorted and then taken two by two
+    int32 nOfReals = 0;
+    for(k = 0; k < nOfRoots; k++){
+        if(!used[k]) roots[nOfReals++] = BFBMake(roots[k].re, 0.0);
+    }
+    for(k = 1; k < nOfReals; k++){
+        BFBComplex r = roots[k];
+        int32 j = k - 1;
+        while((j >= 0) && (roots[j].re > r.re)){
+            roots[j + 1] = roots[j];
+            j--;
+        }
+        roots[j + 1] = r;
+    }
+    for(k = 0; k < nOfReals; k += 2){
+        BFBFactor &factor = factors[nOfFactors++];
+        if(k + 1 < nOfReals){
+            factor.c1    = -(roots[k].re + roots[k + 1].re);
+            factor.c2    = roots[k].re * roots[k + 1].re;
+            factor.root  = (fabs(roots[k].re) > fabs(roots[k + 1].re)) ? roots[k] : roots[k + 1];
+            factor.order = 2;
+        }
+        else{
+            factor.c1    = -roots[k].re;
+            factor.c2    = 0.0;
+            factor.root  = roots[k];
+            factor.order = 1;
+        }
+    }
+    free((void *&)used);
+    return nOfFactors;
+}
+
+void BiquadFilterBank::CleanUp(){
+    if(coefficients != NULL) free((void *&)coefficients);
+    if(states       != NULL) free((void *&)states);
+    coefficients     = NULL;
+    states           = NULL;
+    numberOfSections = 0;
+    numberOfChannels = 0;
+    paddedChannels   = 0;
+}
+
+bool BiquadFilterBank::Initialise(const double *numerator, int32 numeratorSize, const double *denominator, int32 denominatorSize, int32 nOfChannels, FString &reason){
+    CleanUp();
+    reason = "";
+
+    if((nOfChannels <= 0) || (numeratorSize <= 0) || (denominatorSize <= 0) || (denominator[0] == 0.0)){
+        reason = "invalid filter";
+        return False;
+    }
+
+    // Without the trailing zeros
+    int32 nb = numeratorSize;
+    while((nb > 0) && (numerator[nb - 1] == 0.0)) nb--;
+    int32 na = denominatorSize;
+    while((na > 1) && (denominator[na - 1] == 0.0)) na--;
+    if(nb == 0){
+        reason = "null numerator";
+        return False;
+    }
+    // The leading zeros of the numerator are delays
+    int32 delays = 0;
+    while(numerator[delays] == 0.0) delays++;
+
+    int32 numeratorOrder   = nb - 1 - delays;
+    int32 denominatorOrder = na - 1;
+    if((numeratorOrder + delays > BFB_MAXIMUM_ORDER) || (denominatorOrder > BFB_MAXIMUM_ORDER)){
+        reason.Printf("order larger than %d", BFB_MAXIMUM_ORDER);
+        return False;
+    }
+
+    double gain = numerator[delays] / denominator[0];
+
+    double      monic[BFB_MAXIMUM_ORDER + 1];
+    BFBComplex  zeros[BFB_MAXIMUM_ORDER];
+    BFBComplex  poles[BFB_MAXIMUM_ORDER];
+    BFBFactor   zeroFactors[BFB_MAXIMUM_ORDER];
+    BFBFactor   poleFactors[BFB_MAXIMUM_ORDER];
+    int32 k;
+    int32 degree;
+    int32 nOfRoots;
+    for(k = 0; k <= numeratorOrder; k++) monic[k] = numerator[delays + k] / numerator[delays];
+    degree   = numeratorOrder;
+    nOfRoots = BFBDeflate(monic, degree, -1.0, zeros);
+    nOfRoots += BFBDeflate(monic, degree, 1.0, zeros + nOfRoots);
+    if(!BFBFindRoots(monic, degree, zeros + nOfRoots)){
+        reason = "the zeros were not found";
+        return False;
+    }
+    for(k = 0; k <= denominatorOrder; k++) monic[k] = denominator[k] / denominator[0];
+    degree   = denominatorOrder;
+    nOfRoots = BFBDeflate(monic, degree, -1.0, poles);
+    nOfRoots += BFBDeflate(monic, degree, 1.0, poles + nOfRoots);
+    if(!BFBFindRoots(monic, degree, poles + nOfRoots)){
+        reason = "the poles were not found";
+        return False;
+    }
+    int32 nOfZeroFactors = BFBFactorise(zeros, numeratorOrder, zeroFactors);
+    int32 nOfPoleFactors = BFBFactorise(poles, denominatorOrder, poleFactors);
+    if((nOfZeroFactors < 0) || (nOfPoleFactors < 0)){
+        reason = "the complex roots are not conjugate";
+        return False;
+    }
+
+    // The sections: first the zeros without poles, then the pole factors, the
+    // ones closer to the unit circle last, each with the nearest zeros
+    int32 maximumSections = nOfZeroFactors + nOfPoleFactors + delays / 2 + 2;
+    double *sections = (double *)malloc(maximumSections * BFB_SECTION_SIZE * sizeof(double));
+    int32  *zeroOrder = (int32 *)malloc(maximumSections * sizeof(int32));
+    bool   *zeroUsed  = (bool *)malloc((nOfZeroFactors + 1) * sizeof(bool));
+    if((sections == NULL) || (zeroOrder == NULL) || (zeroUsed == NULL)){
+        if(sections  != NULL) free((void *&)sections);
+        if(zeroOrder != NULL) free((void *&)zeroOrder);
+        if(zeroUsed  != NULL) free((void *&)zeroUsed);
+        reason = "out of memory";
+        return False;
+    }
+    for(k = 0; k < nOfZeroFactors; k++) zeroUsed[k] = False;
+
+    int32 nOfSections = 0;
+    // Pole factors by decreasing modulus
+    for(k = 1; k < nOfPoleFactors; k++){
+        BFBFactor factor = poleFactors[k];
+        int32 j = k - 1;
+        while((j >= 0) && (BFBAbs(poleFactors[j].root) < BFBAbs(factor.root))){
+            poleFactors[j + 1] = poleFactors[j];
+            j--;
+        }
+        poleFactors[j + 1] = factor;
+    }
+    int32 nOfPoleSections = nOfPoleFactors;
+    int32 nOfFreeZeros    = (nOfZeroFactors > nOfPoleFactors) ? (nOfZeroFactors - nOfPoleFactors) : 0;
+    for(k = 0; k < nOfPoleFactors; k++){
+        // Written from the end
+        double *section = sections + (nOfFreeZeros + nOfPoleSections - 1 - k) * BFB_SECTION_SIZE;
+        section[0] = 1.0;
+        section[1] = 0.0;
+        section[2] = 0.0;
+        section[3] = -poleFactors[k].c1;
+        section[4] = -poleFactors[k].c2;
+        zeroOrder[nOfFreeZeros + nOfPoleSections - 1 - k] = 0;
+        int32  nearest  = -1;
+        double distance = 0.0;
+        for(int32 j = 0; j < nOfZeroFactors; j++){
+            if(zeroUsed[j]) continue;
+            double d = BFBAbs(BFBSub(zeroFactors[j].root, poleFactors[k].root));
+            if((nearest < 0) || (d < distance)){
+                nearest  = j;
+                distance = d;
+            }
+        }
+        if(nearest >= 0){
+            zeroUsed[nearest] = True;
+            section[1] = zeroFactors[nearest].c1;
+            section[2] = zeroFactors[nearest].c2;
+            zeroOrder[nOfFreeZeros + nOfPoleSections - 1 - k] = zeroFactors[nearest].order;
+        }
+    }
+    for(k = 0; k < nOfZeroFactors; k++){
+        if(zeroUsed[k]) continue;
+        double *section = sections + nOfSections * BFB_SECTION_SIZE;
+        section[0] = 1.0;
+        section[1] = zeroFactors[k].c1;
+        section[2] = zeroFactors[k].c2;
+        section[3] = 0.0;
+        section[4] = 0.0;
+        zeroOrder[nOfSections] = zeroFactors[k].order;
+        nOfSections++;
+    }
+    nOfSections += nOfPoleSections;
+    if(nOfSections == 0){
+        // A gain
+        sections[0] = 1.0;
+        sections[1] = 0.0;
+        sections[2] = 0.0;
+        sections[3] = 0.0;
+        sections[4] = 0.0;
+        zeroOrder[0] = 0;
+        nOfSections = 1;
+    }
+
+    // The delays shift the numerators of order lower than 2
+    for(k = 0; (k < nOfSections) && (delays > 0); k++){
+        double *section = sections + k * BFB_SECTION_SIZE;
+        while((zeroOrder[k] < 2) && (delays > 0)){
+            section[2] = section[1];
+            section[1] = section[0];
+            section[0] = 0.0;
+            zeroOrder[k]++;
+            delays--;
+        }
+    }
+    while(delays > 0){
+        double *section = sections + nOfSections * BFB_SECTION_SIZE;
+        section[0] = 0.0;
+        section[1] = (delays == 1) ? 1.0 : 0.0;
+        section[2] = (delays == 1) ? 0.0 : 1.0;
+        section[3] = 0.0;
+        section[4] = 0.0;
+        delays    -= (delays == 1) ? 1 : 2;
+        nOfSections++;
+    }
+
+    // The gain goes in the first section
+    for(k = 0; k < 3; k++) sections[k] *= gain;
+
+    coefficients = (float *)malloc(nOfSections * BFB_SECTION_SIZE * sizeof(float));
+    if(coefficients == NULL){
+        free((void *&)sections);
+        free((void *&)zeroOrder);
+        free((void *&)zeroUsed);
+        reason = "out of memory";
+        return False;
+    }
+    for(k = 0; k < nOfSections * BFB_SECTION_SIZE; k++) coefficients[k] = (float)sections[k];
+    free((void *&)sections);
+    free((void *&)zeroOrder);
+    free((void *&)zeroUsed);
+
+    // Compare the response of the single precision sections with the transfer function
+    double peak     = 0.0;
+    double maxError = 0.0;
+    for(k = 0; k <= BFB_RESPONSE_POINTS; k++){
+        double omega = (k == 0) ? 0.0 : pi * pow(10.0, -4.0 * (BFB_RESPONSE_POINTS - k) / (BFB_RESPONSE_POINTS - 1));
+        BFBComplex q = BFBMake(cos(omega), -sin(omega));
+        BFBComplex reference = BFBDiv(BFBPolynomial(numerator, numeratorSize, q), BFBPolynomial(denominator, denominatorSize, q));
+        BFBComplex response  = BFBMake(1.0, 0.0);
+        for(int32 s = 0; s < nOfSections; s++){
+            const float *c = coefficients + s * BFB_SECTION_SIZE;
+            double num[3] = {c[0], c[1], c[2]};
+            double den[3] = {1.0, -c[3], -c[4]};
+            response = BFBMul(response, BFBDiv(BFBPolynomial(num, 3, q), BFBPolynomial(den, 3, q)));
+        }
+        double magnitude = BFBAbs(reference);
+        double error     = BFBAbs(BFBSub(response, reference));
+        if(!BFBIsFinite(magnitude) || !BFBIsFinite(error)){
+            peak = 0.0;
+            break;
+        }
+        if(magnitude > peak) peak     = magnitude;
+        if(error > maxError) maxError = error;
+    }
+    if((peak == 0.0) || (maxError > BFB_RESPONSE_TOLERANCE * peak)){
+        if(peak == 0.0) reason = "null or infinite frequency response";
+        else            reason.Printf("frequency response error of %e", maxError / peak);
+        CleanUp();
+        return False;
+    }
+
+    numberOfChannels = nOfChannels;
+    numberOfSections = nOfSections;
+    paddedChannels   = ((nOfChannels + BFB_LANES - 1) / BFB_LANES) * BFB_LANES;
+    states = (float *)malloc(2 * numberOfSections * paddedChannels * sizeof(float));
+    if(states == NULL){
+        CleanUp();
+        reason = "out of memory";
+        return False;
+    }
+    Reset();
+    return True;
+}
+
+void BiquadFilterBank::Reset(){
+    if(states == NULL) return;
+    memset(states, 0, 2 * numberOfSections * paddedChannels * sizeof(float));
+}
+
+void BiquadFilterBank::Process(const float *input, float *output){
+    const float *x     = input;
+    float       *state = states;
+    for(int32 s = 0; s < numberOfSections; s++){
+        const float *c  = coefficients + s * BFB_SECTION_SIZE;
+        float       *s1 = state;
+        float       *s2 = state + paddedChannels;
+        int32 i = 0;
+#if BFB_LANES > 1
+        const BFB_VECTOR b0 = BFB_SET1(c[0]);
+        const BFB_VECTOR b1 = BFB_SET1(c[1]);
+        const BFB_VECTOR b2 = BFB_SET1(c[2]);
+        const BFB_VECTOR a1 = BFB_SET1(c[3]);
+        const BFB_VECTOR a2 = BFB_SET1(c[4]);
+        for(; i + BFB_LANES <= numberOfChannels; i += BFB_LANES){
+            BFB_VECTOR in  = BFB_LOADU(x + i);
+            BFB_VECTOR out = BFB_ADD(BFB_MUL(b0, in), BFB_LOADU(s1 + i));
+            BFB_STOREU(s1 + i, BFB_ADD(BFB_ADD(BFB_MUL(b1, in), BFB_MUL(a1, out)), BFB_LOADU(s2 + i)));
+            BFB_STOREU(s2 + i, BFB_ADD(BFB_MUL(b2, in), BFB_MUL(a2, out)));
+            BFB_STOREU(output + i, out);
+        }
+#endif
+        // The same operations, one channel at a time
+        for(; i < numberOfChannels; i++){
+            float in  = x[i];
+            float out = c[0] * in + s1[i];
+            s1[i]     = (c[1] * in + c[3] * out) + s2[i];
+            s2[i]     = c[2] * in + c[4] * out;
+            output[i] = out;
+        }
+        x      = output;
+        state += 2 * paddedChannels;
+    }
+}
+
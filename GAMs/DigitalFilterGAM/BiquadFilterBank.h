@@ -0,0 +1,128 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Applies the same IIR filter to many channels as a cascade of second order
+ * sections (biquads) in transposed direct form II.
+ * The numerator and the denominator are factorised at initialisation and the
+ * state is stored channel-interleaved (all the channels of a section state are
+ * contiguous), so that each vector instruction processes BFB_LANES channels:
+ * 16 with AVX-512, 8 with AVX, 4 with SSE and 1 otherwise. The coefficients
+ * and the states are single precision.
+ * A filter is refused, and should then be run with Filter::Process, if its order
+ * is larger than BFB_MAXIMUM_ORDER, if the roots are not found or if the frequency
+ * response of the single precision sections differs from the response of the
+ * transfer function by more than BFB_RESPONSE_TOLERANCE of its peak.
+ */
+#if !defined (BIQUAD_FILTER_BANK_H)
+#define BIQUAD_FILTER_BANK_H
+
+#include "System.h"
+#include "FString.h"
+
+#if defined(__AVX512F__)
+#define BFB_LANES 16
+#elif defined(__AVX__)
+#define BFB_LANES 8
+#elif defined(__SSE__)
+#define BFB_LANES 4
+#else
+#define BFB_LANES 1
+#endif
+
+/** Largest order of the numerator and of the denominator which is factorised */
+#define BFB_MAXIMUM_ORDER       32
+
+/** Largest error of the frequency response, relative to its peak */
+#define BFB_RESPONSE_TOLERANCE  1e-4
+
+/** Number of coefficients of a section: b0 b1 b2 -a1 -a2 */
+#define BFB_SECTION_SIZE        5
+
+class BiquadFilterBank{
+private:
+    /** BFB_SECTION_SIZE coefficients per section */
+    float *coefficients;
+
+    /** Two states per section, each with paddedChannels values */
+    float *states;
+
+    /** Number of sections */
+    int32  numberOfSections;
+
+    /** Number of channels */
+    int32  numberOfChannels;
+
+    /** numberOfChannels rounded up to BFB_LANES */
+    int32  paddedChannels;
+
+    /** Frees the memory */
+    void   CleanUp();
+
+public:
+
+    BiquadFilterBank(){
+        coefficients     = NULL;
+        states           = NULL;
+        numberOfSections = 0;
+        numberOfChannels = 0;
+        paddedChannels   = 0;
+    }
+
+    ~BiquadFilterBank(){
+        CleanUp();
+    }
+
+    /**
+     * Factorises the filter
+     *          numerator[0] + numerator[1] z^-1 + ...
+     * H(z) = ---------------------------------------
+     *          denominator[0] + denominator[1] z^-1 + ...
+     * into second order sections
+     * @param reason Why the filter was refused
+     * @return True if the filter can be run by the bank
+     */
+    bool Initialise(const double *numerator, int32 numeratorSize, const double *denominator, int32 denominatorSize, int32 nOfChannels, FString &reason);
+
+    /** True if Initialise succeeded */
+    bool IsValid() const{
+        return (coefficients != NULL);
+    }
+
+    /** Number of second order sections */
+    int32 NumberOfSections() const{
+        return numberOfSections;
+    }
+
+    /** Sets all the states to zero */
+    void Reset();
+
+    /** Filters one sample of each channel.
+        input and output hold numberOfChannels values and can be the same buffer */
+    void Process(const float *input, float *output);
+};
+
+#endif
+
@@ -0,0 +1,221 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Runs a FilterContainer with nOfChannels signals with the second order sections
+ * (SecondOrderSections = ON) and with Filter::Process (OFF) for a set of filters,
+ * and compares the time per Execute and the error of both against the same filter
+ * evaluated in double precision. The interfaces are not linked to a DDB.
+ * Usage: DigitalFilterBenchmark.ex [nOfChannels] [nOfCycles]
+ * @return 0 if the second order sections are as accurate as Filter::Process
+ */
+
+#include "System.h"
+#include "FString.h"
+#include "HRT.h"
+#include "ConfigurationDataBase.h"
+#include "DDBInterface.h"
+#include "FilterContainer.h"
+
+/** Number of channels compared with the double precision filter */
+#define CHECKED_CHANNELS    8
+
+/** Accepted error of the sections, relative to the largest output, when Filter::Process is more accurate */
+#define ACCEPTED_ERROR      1e-4
+
+static const double pi = 3.1415926535897932;
+
+static bool Setup(GAM &gam, const char *name, FString &config){
+    config.Seek(0);
+    ConfigurationDataBase cdb;
+    if(!cdb->ReadFromStream(config)){
+        printf("Could not parse the %s configuration\n", name);
+        return False;
+    }
+    gam.SetObjectName(name);
+    return gam.ObjectLoadSetup(cdb, NULL);
+}
+
+static DDBInterface *FindInterface(GAM &gam, const char *name){
+    LinkedListable *interfaces = gam.InterfacesList();
+    while(interfaces != NULL){
+        DDBInterface *ddbi = dynamic_cast<DDBInterface *>(interfaces);
+        interfaces = interfaces->Next();
+        if((ddbi != NULL) && (strcmp(ddbi->InterfaceName(), name) == 0)) return ddbi;
+    }
+    return NULL;
+}
+
+/** Digital Butterworth low pass (bilinear transform) as Numerator and Denominator */
+static void Butterworth(int32 order, double cutoff, FString &config){
+    double num[33];
+    double den[33];
+    double denIm[33];
+    num[0] = 1.0;
+    den[0] = 1.0;
+    denIm[0] = 0.0;
+    for(int32 k = 1; k <= order; k++){
+        num[k]   = 0.0;
+        den[k]   = 0.0;
+        denIm[k] = 0.0;
+    }
+    double warped = 2.0 * tan(pi * cutoff);
+    for(int32 k = 0; k < order; k++){
+        // Analog pole and its image through the bilinear transform
+        double angle = pi * (2 * k + order + 1) / (2 * order);
+        double sRe   = warped * cos(angle) / 2.0;
+        double sIm   = warped * sin(angle) / 2.0;
+        double d     = (1 - sRe) * (1 - sRe) + sIm * sIm;
+        double zRe   = ((1 + sRe) * (1 - sRe) - sIm * sIm) / d;
+        double zIm   = (sIm * (1 - sRe) + (1 + sRe) * sIm) / d;
+        for(int32 j = k + 1; j >= 1; j--){
+            // (1 - z q) and (1 + q)
+            double re = den[j] - (zRe * den[j - 1] - zIm * denIm[j - 1]);
+            double im = denIm[j] - (zRe * denIm[j - 1] + zIm * den[j - 1]);
+            den[j]    = re;
+            denIm[j]  = im;
+            num[j]   += num[j - 1];
+        }
+    }
+    double numSum = 0.0;
+    double denSum = 0.0;
+    for(int32 k = 0; k <= order; k++){
+        numSum += num[k];
+        denSum += den[k];
+    }
+    config.Printf("Numerator = { ");
+    for(int32 k = 0; k <= order; k++) config.Printf("%.16e ", num[k] * denSum / numSum);
+    config.Printf("}\nDenominator = { ");
+    for(int32 k = 0; k <= order; k++) config.Printf("%.16e ", den[k]);
+    config.Printf("}\n");
+}
+
+/** The input of a channel */
+static float Input(int32 channel, int32 cycle, uint32 &seed){
+    seed = seed * 1664525 + 1013904223;
+    float noise = (float)(seed >> 8) / (float)(1 << 24) - 0.5;
+    return sin(2.0 * pi * cycle * (0.001 + 0.0007 * (channel % 64))) + noise;
+}
+
+/** Runs a container and returns the time per cycle in microseconds and the
+    error relative to the largest output on the first CHECKED_CHANNELS channels */
+static bool Run(const char *name, FString &filterConfig, const char *secondOrderSections, int32 nOfChannels, int32 nOfCycles, double &time, double &error){
+    FString config;
+    config.Printf("InputSignals = {\n");
+    for(int32 i = 0; i < nOfChannels; i++) config.Printf("s%d = {\nSignalName = in%d\nSignalType = float\n}\n", i, i);
+    config.Printf("}\nOutputSignals = {\n");
+    for(int32 i = 0; i < nOfChannels; i++) config.Printf("s%d = {\nSignalName = out%d\nSignalType = float\n}\n", i, i);
+    config.Printf("}\nSecondOrderSections = %s\n%s", secondOrderSections, filterConfig.Buffer());
+
+    FilterContainer container;
+    if(!Setup(container, name, config)){
+        printf("Could not setup %s\n", name);
+        return False;
+    }
+    float *input  = (float *)FindInterface(container, "InputInterface")->Buffer();
+    float *output = (float *)FindInterface(container, "OutputInterface")->Buffer();
+
+    /// The reference: the transfer function of Filter in double precision, direct form
+    filterConfig.Seek(0);
+    ConfigurationDataBase cdb;
+    cdb->ReadFromStream(filterConfig);
+    Filter filter;
+    filter.Init(cdb);
+    int32 inputSize  = filter.InputSize();
+    int32 outputSize = filter.OutputSize();
+    double *x = (double *)malloc(CHECKED_CHANNELS * inputSize * sizeof(double));
+    double *y = (double *)malloc(CHECKED_CHANNELS * outputSize * sizeof(double));
+    for(int32 k = 0; k < CHECKED_CHANNELS * inputSize; k++)  x[k] = 0.0;
+    for(int32 k = 0; k < CHECKED_CHANNELS * outputSize; k++) y[k] = 0.0;
+
+    uint32 seed     = 1;
+    int64  ticks    = 0;
+    double maxError = 0.0;
+    double peak     = 0.0;
+    for(int32 c = 0; c < nOfCycles; c++){
+        for(int32 i = 0; i < nOfChannels; i++) input[i] = Input(i, c, seed);
+        int64 start = HRT::HRTCounter();
+        container.Execute((c == 0) ? GAMPrepulse : GAMOnline);
+        ticks += HRT::HRTCounter() - start;
+
+        for(int32 i = 0; (i < CHECKED_CHANNELS) && (i < nOfChannels); i++){
+            double *xi = x + i * inputSize;
+            double *yi = y + i * outputSize;
+            int32 k;
+            for(k = inputSize - 1; k > 0; k--) xi[k] = xi[k - 1];
+            xi[0] = input[i];
+            double reference = 0.0;
+            for(k = 0; k < inputSize; k++) reference += xi[k] * filter.InputCoefficients()[k];
+            for(k = outputSize - 1; k > 0; k--) yi[k] = yi[k - 1];
+            for(k = 1; k < outputSize; k++) reference += yi[k] * filter.OutputCoefficients()[k];
+            yi[0] = reference;
+            if(fabs(reference) > peak) peak = fabs(reference);
+            double e = fabs(output[i] - reference);
+            if(e > maxError) maxError = e;
+        }
+    }
+    free((void *&)x);
+    free((void *&)y);
+    time  = ticks * HRT::HRTPeriod() * 1e6 / nOfCycles;
+    error = maxError / peak;
+    return True;
+}
+
+int main(int argc, char **argv){
+    int32 nOfChannels = (argc > 1) ? atoi(argv[1]) : 1000;
+    int32 nOfCycles   = (argc > 2) ? atoi(argv[2]) : 10000;
+    if((nOfChannels < 1) || (nOfCycles < 1)){
+        printf("Usage: DigitalFilterBenchmark.ex [nOfChannels] [nOfCycles]\n");
+        return -1;
+    }
+
+    const int32 nOfFilters = 7;
+    const char *names[nOfFilters] = {"Butterworth2", "Butterworth4", "Butterworth8", "Butterworth8Low", "PolesZeros", "BoxCar8", "BoxCar64"};
+    FString filters[nOfFilters];
+    Butterworth(2, 0.01,  filters[0]);
+    Butterworth(4, 0.05,  filters[1]);
+    Butterworth(8, 0.1,   filters[2]);
+    Butterworth(8, 0.02,  filters[3]);
+    filters[4].Printf("Poles = { 100 300 1000 }\nZeros = { 2000 }\nSamplingTime = 0.0001\nGain = 1\n");
+    filters[5].Printf("BoxCarNumberOfSamples = 8\n");
+    filters[6].Printf("BoxCarNumberOfSamples = 64\n");
+
+    bool ok = True;
+    printf("%d channels, %d cycles, %d channels per instruction\n", nOfChannels, nOfCycles, BFB_LANES);
+    printf("%-14s %12s %12s %12s %12s\n", "filter", "Process us", "sections us", "Process err", "sections err");
+    for(int32 j = 0; j < nOfFilters; j++){
+        double processTime  = 0.0;
+        double processError = 0.0;
+        double sosTime      = 0.0;
+        double sosError     = 0.0;
+        if(!Run(names[j], filters[j], "OFF", nOfChannels, nOfCycles, processTime, processError)) return -1;
+        if(!Run(names[j], filters[j], "ON",  nOfChannels, nOfCycles, sosTime, sosError)) return -1;
+        printf("%-14s %12.1f %12.1f %12.3e %12.3e\n", names[j], processTime, sosTime, processError, sosError);
+        if((sosError > processError) && (sosError > ACCEPTED_ERROR)){
+            ok = False;
+        }
+    }
+    return ok ? 0 : -1;
+}
@@ -82,14 +82,50 @@ bool FilterContainer::Initialise(ConfigurationDataBase &cdbData) {
 	}
     }
 
+    /* All the filters are initialised from the same configuration: run them as one bank of second order sections */
+    FString secondOrderSections;
+    cdb.ReadFString(secondOrderSections, "SecondOrderSections", "ON");
+    if((secondOrderSections == "ON") && (numberOfFilters > 0)) {
+	int32 denominatorSize = f[0].OutputSize();
+	double *denominator = (double *)malloc(denominatorSize * sizeof(double));
+	if(denominator == NULL) {
+	    AssertErrorCondition(InitialisationError, "FilterContainer::Initialise: %s Unable to allocate the denominator", Name());
+	    return False;
+	}
+	/* Filter stores the negated denominator */
+	denominator[0] = 1.0;
+	for(int i = 1 ; i < denominatorSize ; i++) {
+	    denominator[i] = -f[0].OutputCoefficients()[i];
+	}
+	FString reason;
+	if(biquads.Initialise(f[0].InputCoefficients(), f[0].InputSize(), denominator, denominatorSize, numberOfFilters, reason)) {
+	    AssertErrorCondition(Information, "FilterContainer::Initialise: %s %d filters run as %d second order sections, %d channels per instruction", Name(), numberOfFilters, biquads.NumberOfSections(), BFB_LANES);
+	} else {
+	    AssertErrorCondition(Warning, "FilterContainer::Initialise: %s filters not converted to second order sections (%s)", Name(), reason.Buffer());
+	}
+	free((void *&)denominator);
+    }
+
     return True;
 }
 
+/// Filters one sample of all the signals
+void FilterContainer::Process(const float *inputData, float *outputData) {
+    if(biquads.IsValid()) {
+	biquads.Process(inputData, outputData);
+    } else {
+	for(int i = 0 ; i < numberOfFilters ; i++) {
+	    outputData[i] = f[i].Process(inputData[i]);
+	}
+    }
+}
+
 /// Resets all the filters
 void FilterContainer::Reset() {
     for(int i = 0 ; i < numberOfFilters ; i++) {
 	f[i].Reset();
     }
+    biquads.Reset();
 }
 
 /// Called in every control loop
@@ -106,17 +142,13 @@ bool FilterContainer::Execute(GAM_FunctionNumbers execFlag) {
         case GAMPrepulse:
             // Reset all the filters
             Reset();
-	    for(int i = 0 ; i < numberOfFilters ; i++) {
-		outputData[i] = f[i].Process(inputData[i]);
-	    }
+	    Process(inputData, outputData);
         break;
         
         case GAMOffline:
         case GAMOnline: 
 	    /// Apply filters
-	    for(int i = 0 ; i < numberOfFilters ; i++) {
-		outputData[i] = f[i].Process(inputData[i]);
-	    }
+	    Process(inputData, outputData);
 	break;
     }
 
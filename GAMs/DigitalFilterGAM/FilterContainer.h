@@ -27,6 +27,7 @@
 
 #include "GAM.h"
 #include "Filter.h"
+#include "BiquadFilterBank.h"
 
 OBJECT_DLL(FilterContainer)
 class FilterContainer : public GAM {
@@ -44,12 +45,20 @@ private:
     /// Number of filter objects
     int32                     numberOfFilters;
 
+    /// All the filters as second order sections, unless SecondOrderSections = OFF
+    /// or the filter cannot be converted
+    BiquadFilterBank          biquads;
+
+    /// Filters one sample of all the signals
+    void  Process(const float *inputData, float *outputData);
+
 public:
 
     /// Constructor
     FilterContainer() {
 	input           = NULL;
 	output          = NULL;
+	f               = NULL;
 	numberOfFilters = -1;
     };
 
@@ -29,9 +29,20 @@
 
 ///
 ExpEvalGAM::ExpEvalGAM() {
-    input          = NULL;
-    output         = NULL;
-    executableList = NULL;
+    input                = NULL;
+    output               = NULL;
+    executableList       = NULL;
+    numberOfInputSignals = NULL;
+    tableIndexes         = NULL;
+    compiled             = False;
+    programs             = NULL;
+    nOfPrograms          = 0;
+    scalarProgram        = -1;
+    expressionProgram    = NULL;
+    expressionResult     = NULL;
+    expressionOutput     = NULL;
+    loads                = NULL;
+    nOfLoads             = 0;
 }
 
 ///
@@ -45,17 +56,18 @@ ExpEvalGAM::~ExpEvalGAM(){
     if(numberOfInputSignals) {
         free((void*&)numberOfInputSignals);
     }
-    for(int i = 0 ; i < Size() ; i++) {
-        if(tableIndexes[i]) {
-            free((void*&)tableIndexes[i]);
-        }
-    }
     if(tableIndexes) {
+        for(int i = 0 ; i < Size() ; i++) {
+            if(tableIndexes[i]) {
+                free((void*&)tableIndexes[i]);
+            }
+        }
         free((void*&)tableIndexes);
     }
     if(executableList){
         delete []executableList;
     }
+    CleanCompiled();
 //    printf("ExpEvalGAM: Destructor ended\n");
 }
 
@@ -69,6 +81,23 @@ bool ExpEvalGAM::Initialise(ConfigurationDataBase &cdbData) {
         return False;
     }
 
+    FString compileExpressions;
+    cdb.ReadFString(compileExpressions, "CompileExpressions", "True");
+    compiled = (compileExpressions == "True");
+    CleanCompiled();
+    if(compiled) {
+        programs          = new ExpEvalProgram[Size()];
+        expressionProgram = (int32 *)malloc(Size()*sizeof(int32));
+        expressionResult  = (int32 *)malloc(Size()*sizeof(int32));
+        expressionOutput  = new FString[Size()];
+        if((programs == NULL) || (expressionProgram == NULL) || (expressionResult == NULL) || (expressionOutput == NULL)) {
+            AssertErrorCondition(InitialisationError, "ExpEvalGAM::Initialise: %s failed to allocate the programs", Name());
+            return False;
+        }
+    }
+    /// True if an array signal is used
+    bool arraySignals = False;
+
 //    printf("Size() = %d\n", Size());//DEBUG
 
     numberOfInputSignals = (uint32 *)malloc(Size()*sizeof(uint32));
@@ -102,6 +131,7 @@ bool ExpEvalGAM::Initialise(ConfigurationDataBase &cdbData) {
 	printf("ExpEvalGAM: Initialise(): unble to allocate memory for tableIndexes\n");
 	return False;
     }
+    memset(tableIndexes, 0, Size()*sizeof(int32 *));
     
     executableList = new GCRTemplate<ExpEval>[Size()];
     if(executableList == NULL){
@@ -122,8 +152,12 @@ bool ExpEvalGAM::Initialise(ConfigurationDataBase &cdbData) {
             return False;
         }
         
+        FString  *inputVariables = NULL;
+        uint32   *inputWidths    = NULL;
         if(cdb->Move("InputSignals")) {
             numberOfInputSignals[j] = cdb->NumberOfChildren();
+            inputVariables = new FString[numberOfInputSignals[j]];
+            inputWidths    = new uint32[numberOfInputSignals[j]];
     //	    printf("numberOfInputSignals[%d] = %d\n", j, numberOfInputSignals[j]);//DEBUG
             if((tableIndexes[j] = (int32 *)malloc(numberOfInputSignals[j]*sizeof(int32))) == NULL) {
             printf("ExpEvalGAM: Initialise(): unable to allocate memory for tableIndexes internal members\n");
@@ -144,10 +178,15 @@ bool ExpEvalGAM::Initialise(ConfigurationDataBase &cdbData) {
             cdb.ReadFString(signalName, "SignalName", "");
             cdb.ReadFString(signalType, "SignalType", "");
             input[j]->AddSignal(signalName.Buffer(), signalType.Buffer());
+            if(!SplitSignalName(signalName, inputVariables[i], inputWidths[i])) {
+                AssertErrorCondition(InitialisationError, "ExpEvalGAM::Initialise: %s: invalid signal name %s", Name(), signalName.Buffer());
+                return False;
+            }
+            arraySignals = arraySignals || (inputWidths[i] > 1);
             BasicTypeData none(BTDFloat,1);
             float fNone = 0;
             none.UpdateData(&fNone);
-            tableIndexes[j][i] = gcr->eedt.CreateAndAddDataTableEntry(signalName, none);
+            tableIndexes[j][i] = gcr->eedt.CreateAndAddDataTableEntry(inputVariables[i], none);
             cdb->MoveToFather();
             }
             cdb->MoveToFather();
@@ -170,6 +209,14 @@ bool ExpEvalGAM::Initialise(ConfigurationDataBase &cdbData) {
             return False;
         }
         
+        FString outputVariable;
+        uint32  outputWidth = 1;
+        if(!SplitSignalName(signalName, outputVariable, outputWidth)) {
+            AssertErrorCondition(InitialisationError, "ExpEvalGAM::Initialise: %s: invalid signal name %s", Name(), signalName.Buffer());
+            return False;
+        }
+        arraySignals = arraySignals || (outputWidth > 1);
+        
         cdb->MoveToFather();
         cdb->MoveToFather();
         cdb->MoveToFather();
@@ -177,6 +224,35 @@ bool ExpEvalGAM::Initialise(ConfigurationDataBase &cdbData) {
     //	gcr->eeep.ShowEquation();//DEBUG
         gcr->ParseEquation();
         executableList[j] = gcr;
+
+        if(compiled && !CompileExpression(j, inputVariables, inputWidths, outputVariable, outputWidth)) {
+            AssertErrorCondition(Warning, "ExpEvalGAM::Initialise: %s: expression %s cannot be compiled. Using the interpreter", Name(), gcr->Name());
+            CleanCompiled();
+            compiled = False;
+        }
+        if(inputVariables != NULL) {
+            delete []inputVariables;
+        }
+        if(inputWidths != NULL) {
+            delete []inputWidths;
+        }
+    }
+
+    if(arraySignals && !compiled) {
+        AssertErrorCondition(InitialisationError, "ExpEvalGAM::Initialise: %s: array signals are only supported with CompileExpressions = \"True\"", Name());
+        return False;
+    }
+
+    if(compiled) {
+        int32 nOfInstructions = 0;
+        for(int p = 0 ; p < nOfPrograms ; p++) {
+            if(!programs[p].Finalise()) {
+                AssertErrorCondition(InitialisationError, "ExpEvalGAM::Initialise: %s failed to allocate the registers", Name());
+                return False;
+            }
+            nOfInstructions += programs[p].NumberOfInstructions();
+        }
+        AssertErrorCondition(Information, "ExpEvalGAM::Initialise: %s: %d expressions compiled into %d programs with %d instructions", Name(), Size(), nOfPrograms, nOfInstructions);
     }
 
     data.SetTypeAndLength(BTDFloat, 1);
@@ -186,8 +262,205 @@ bool ExpEvalGAM::Initialise(ConfigurationDataBase &cdbData) {
     return True;
 }
 
+///
+bool ExpEvalGAM::SplitSignalName(FString &signalName, FString &variableName, uint32 &width) {
+    const char *name    = signalName.Buffer();
+    const char *bracket = strchr(name, '[');
+    width        = 1;
+    variableName = name;
+    if(bracket == NULL) {
+        return True;
+    }
+    variableName.SetSize(bracket - name);
+    char *end = NULL;
+    long size = strtol(bracket + 1, &end, 10);
+    if((size <= 0) || (end == NULL) || (*end != ']')) {
+        return False;
+    }
+    width = size;
+    return True;
+}
+
+///
+void ExpEvalGAM::CleanCompiled() {
+    if(programs != NULL) {
+        delete []programs;
+    }
+    if(expressionProgram != NULL) {
+        free((void*&)expressionProgram);
+    }
+    if(expressionResult != NULL) {
+        free((void*&)expressionResult);
+    }
+    if(expressionOutput != NULL) {
+        delete []expressionOutput;
+    }
+    if(loads != NULL) {
+        free((void*&)loads);
+    }
+    programs          = NULL;
+    expressionProgram = NULL;
+    expressionResult  = NULL;
+    expressionOutput  = NULL;
+    loads             = NULL;
+    nOfPrograms       = 0;
+    scalarProgram     = -1;
+    nOfLoads          = 0;
+}
+
+///
+bool ExpEvalGAM::CompileExpression(int32 j, FString *inputVariables, uint32 *inputWidths, FString &outputVariable, uint32 outputWidth) {
+    /// The expressions with the same output size share a program
+    int32 p;
+    for(p = 0 ; p < nOfPrograms ; p++) {
+        if(programs[p].Width() == outputWidth) {
+            break;
+        }
+    }
+    if(p == nOfPrograms) {
+        programs[p].Reset(outputWidth);
+        nOfPrograms++;
+        if(outputWidth == 1) {
+            scalarProgram = p;
+        }
+    }
+    ExpEvalProgram &program = programs[p];
+
+    uint32  tableSize      = executableList[j]->eedt.GetDataTableSize();
+    int32  *tableRegisters = (int32 *)malloc((tableSize > 0 ? tableSize : 1)*sizeof(int32));
+    if(tableRegisters == NULL) {
+        return False;
+    }
+    for(uint32 t = 0 ; t < tableSize ; t++) {
+        tableRegisters[t] = -1;
+    }
+
+    bool   ok     = True;
+    uint32 offset = 0;
+    for(uint32 i = 0 ; (i < numberOfInputSignals[j]) && ok ; i++) {
+        if((inputWidths[i] != 1) && (inputWidths[i] != outputWidth)) {
+            AssertErrorCondition(InitialisationError, "ExpEvalGAM::CompileExpression: %s: input %s has %d elements and the output %s has %d", Name(), inputVariables[i].Buffer(), inputWidths[i], outputVariable.Buffer(), outputWidth);
+            ok = False;
+            break;
+        }
+        /// The last expression before this one writing the variable
+        int32 producer = -1;
+        for(int32 k = j - 1 ; (k >= 0) && (producer < 0) ; k--) {
+            if(expressionOutput[k] == inputVariables[i].Buffer()) {
+                producer = k;
+            }
+        }
+        int32 reg = -1;
+        if((producer >= 0) && (expressionProgram[producer] != p)) {
+            /// Written by another program: the value is taken from its result
+            /// register once that program has run, as the interpreter reads
+            /// the DDB after the previous expressions have written it
+            int32 source = expressionProgram[producer];
+            if(source != scalarProgram) {
+                AssertErrorCondition(InitialisationError, "ExpEvalGAM::CompileExpression: %s: input %s is written by %s with %d elements and read with %d", Name(), inputVariables[i].Buffer(), executableList[producer]->Name(), programs[source].Width(), inputWidths[i]);
+                ok = False;
+                break;
+            }
+            for(int32 l = 0 ; (l < nOfLoads) && (reg < 0) ; l++) {
+                if((loads[l].program == p) && (loads[l].sourceProgram == source) && (loads[l].sourceReg == expressionResult[producer])) {
+                    reg = loads[l].reg;
+                }
+            }
+            if(reg < 0) {
+                reg = program.InputRegister();
+                if((reg < 0) || (realloc((void*&)loads, (nOfLoads + 1)*sizeof(ExpEvalGAMLoad)) == NULL)) {
+                    ok = False;
+                    break;
+                }
+                loads[nOfLoads].expression    = j;
+                loads[nOfLoads].offset        = offset;
+                loads[nOfLoads].width         = 1;
+                loads[nOfLoads].program       = p;
+                loads[nOfLoads].reg           = reg;
+                loads[nOfLoads].sourceProgram = source;
+                loads[nOfLoads].sourceReg     = expressionResult[producer];
+                nOfLoads++;
+            }
+        }
+        else {
+            bool isNew = False;
+            reg = program.Variable(inputVariables[i].Buffer(), isNew);
+            if(reg < 0) {
+                ok = False;
+                break;
+            }
+            if(isNew) {
+                if(realloc((void*&)loads, (nOfLoads + 1)*sizeof(ExpEvalGAMLoad)) == NULL) {
+                    ok = False;
+                    break;
+                }
+                loads[nOfLoads].expression    = j;
+                loads[nOfLoads].offset        = offset;
+                loads[nOfLoads].width         = inputWidths[i];
+                loads[nOfLoads].program       = p;
+                loads[nOfLoads].reg           = reg;
+                loads[nOfLoads].sourceProgram = -1;
+                loads[nOfLoads].sourceReg     = -1;
+                nOfLoads++;
+            }
+        }
+        tableRegisters[tableIndexes[j][i]] = reg;
+        offset += inputWidths[i];
+    }
+
+    int32 result = -1;
+    if(ok) {
+        result = program.Compile(executableList[j]->masterOperationNode, tableRegisters, tableSize);
+    }
+    free((void*&)tableRegisters);
+    if(result < 0) {
+        return False;
+    }
+    expressionProgram[j] = p;
+    expressionResult[j]  = result;
+    expressionOutput[j]  = outputVariable;
+    /// The following expressions reading this output see the new value, as the interpreter does
+    program.BindVariable(outputVariable.Buffer(), result);
+    return True;
+}
+
 ///
 bool ExpEvalGAM::Execute(GAM_FunctionNumbers execFlag) {
+    if(compiled) {
+        for(int j = 0 ; j < Size() ; j++) {
+            if(numberOfInputSignals[j] > 0) {
+                input[j]->Read();
+            }
+        }
+        for(int l = 0 ; l < nOfLoads ; l++) {
+            ExpEvalGAMLoad &load = loads[l];
+            if(load.sourceProgram < 0) {
+                programs[load.program].Load(load.reg, (float *)input[load.expression]->Buffer() + load.offset, load.width);
+            }
+        }
+        /// The scalar results read by the array expressions are loaded once computed
+        if(scalarProgram >= 0) {
+            programs[scalarProgram].Execute();
+        }
+        for(int l = 0 ; l < nOfLoads ; l++) {
+            ExpEvalGAMLoad &load = loads[l];
+            if(load.sourceProgram >= 0) {
+                programs[load.program].Load(load.reg, programs[load.sourceProgram].RegisterData(load.sourceReg), 1);
+            }
+        }
+        for(int p = 0 ; p < nOfPrograms ; p++) {
+            if(p != scalarProgram) {
+                programs[p].Execute();
+            }
+        }
+        for(int j = 0 ; j < Size() ; j++) {
+            ExpEvalProgram &program = programs[expressionProgram[j]];
+            memcpy(output[j]->Buffer(), program.RegisterData(expressionResult[j]), program.Width()*sizeof(float));
+            output[j]->Write();
+        }
+        return True;
+    }
+
     for(int j = 0 ; j < Size() ; j++) {
         float *inputData;
         float *outputData;
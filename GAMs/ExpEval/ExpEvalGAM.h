@@ -29,6 +29,24 @@
 #include "Symbol.h"
 #include "SymbolTemplate.h"
 #include "Node.h"
+#include "ExpEvalBytecode.h"
+
+/// A signal copied into a register before running the programs
+struct ExpEvalGAMLoad {
+    /// The expression owning the input interface
+    int32  expression;
+    /// Offset of the signal in the interface buffer (floats)
+    uint32 offset;
+    /// Number of elements of the signal
+    uint32 width;
+    /// The program and the register to load
+    int32  program;
+    int32  reg;
+    /// If not -1 the value is the result register of an expression of
+    /// another program, which is loaded after that program has run
+    int32  sourceProgram;
+    int32  sourceReg;
+};
 
 OBJECT_DLL(ExpEvalGAM)
 class ExpEvalGAM : public GAM {
@@ -57,6 +75,65 @@ private:
     BasicTypeData data;
     BasicTypeData outBtd;
 
+    /**
+     * True if the expressions are executed as bytecode (CompileExpressions)
+     */
+    bool                   compiled;
+
+    /**
+     * One program per array size of the outputs
+     */
+    ExpEvalProgram        *programs;
+
+    ///
+    int32                  nOfPrograms;
+
+    /**
+     * The program of the scalar outputs, run before the others so that
+     * they can read its results. -1 if there are no scalar outputs
+     */
+    int32                  scalarProgram;
+
+    /**
+     * Program and result register of each expression
+     */
+    int32                 *expressionProgram;
+    int32                 *expressionResult;
+
+    /**
+     * Name of the output variable of each expression
+     */
+    FString               *expressionOutput;
+
+    /**
+     * Signals to load before running the programs
+     */
+    ExpEvalGAMLoad        *loads;
+
+    ///
+    int32                  nOfLoads;
+
+    /**
+     * Splits "name[N]" into the name and N (1 if not an array)
+     */
+    static bool SplitSignalName(FString &signalName, FString &variableName, uint32 &width);
+
+    /**
+     * Adds a parsed expression to the program of its output size
+     * @param j the index of the expression
+     * @param inputVariables the names of the input signals (without the size)
+     * @param inputWidths the number of elements of the input signals
+     * @param outputVariable the name of the output signal (without the size)
+     * @param outputWidth the number of elements of the output signal
+     * @return False if the expression cannot be compiled
+     */
+    bool CompileExpression(int32 j, FString *inputVariables, uint32 *inputWidths, FString &outputVariable, uint32 outputWidth);
+
+    /**
+     * Frees the programs
+     */
+    void CleanCompiled();
+
 public:
 
     /// Constructor
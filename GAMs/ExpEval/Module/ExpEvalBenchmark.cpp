@@ -0,0 +1,180 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Compares the tree interpreter of ExpEval with the compiled bytecode of
+ * ExpEvalProgram on a set of scalar expressions of 8 inputs, and on the
+ * same expressions applied element-wise to arrays.
+ * Usage: ExpEvalBenchmark.ex [nOfExpressions] [nOfCycles] [arraySize]
+ */
+
+#include "System.h"
+#include "HRT.h"
+#include "ExpEval.h"
+#include "ExpEvalBytecode.h"
+
+#define NUMBER_OF_INPUTS 8
+
+/// Expressions typical of the configurations. %d is replaced by a constant
+static const char *templates[] = {
+    "x0*x1+x2*%d",
+    "Abs(x3-x4)*%d.5",
+    "Sqrt(x5*x5+x6*x6)+%d",
+    "(x0+x1)*(x2+x3)/%d",
+    "x7^2+Sin(x0+%d)",
+    "(x1==x2)*x3+%d",
+    "2*3+x4*%d",
+    "(x0*x1+x2)*(x5-%d)"
+};
+
+#define NUMBER_OF_TEMPLATES (sizeof(templates) / sizeof(templates[0]))
+
+int main(int argc, char **argv) {
+    int32 nOfExpressions = (argc > 1) ? atoi(argv[1]) : 200;
+    int32 nOfCycles      = (argc > 2) ? atoi(argv[2]) : 2000;
+    int32 arraySize      = (argc > 3) ? atoi(argv[3]) : 64;
+    if((nOfExpressions < 1) || (nOfCycles < 1) || (arraySize < 1)) {
+        printf("Usage: ExpEvalBenchmark.ex [nOfExpressions] [nOfCycles] [arraySize]\n");
+        return -1;
+    }
+
+    /// Build the trees
+    GCRTemplate<ExpEval> *expressions = new GCRTemplate<ExpEval>[nOfExpressions];
+    int32               **indexes     = new int32 *[nOfExpressions];
+    FString               names[NUMBER_OF_INPUTS];
+    for(int32 i = 0 ; i < NUMBER_OF_INPUTS ; i++) {
+        names[i].Printf("x%d", i);
+    }
+    BasicTypeData value(BTDFloat, 1);
+    float zero = 0;
+    value.UpdateData(&zero);
+    for(int32 j = 0 ; j < nOfExpressions ; j++) {
+        FString equation;
+        equation.Printf(templates[j % NUMBER_OF_TEMPLATES], 1 + j / NUMBER_OF_TEMPLATES);
+        GCRTemplate<ExpEval> expression(GCFT_Create);
+        expression->SetEquation(equation);
+        indexes[j] = new int32[NUMBER_OF_INPUTS];
+        for(int32 i = 0 ; i < NUMBER_OF_INPUTS ; i++) {
+            indexes[j][i] = expression->eedt.CreateAndAddDataTableEntry(names[i], value);
+        }
+        expression->ParseEquation();
+        expressions[j] = expression;
+    }
+
+    /// Compile them
+    ExpEvalProgram scalar;
+    ExpEvalProgram vector;
+    scalar.Reset(1);
+    vector.Reset(arraySize);
+    int32 scalarInputs[NUMBER_OF_INPUTS];
+    int32 vectorInputs[NUMBER_OF_INPUTS];
+    int32 *scalarResults = new int32[nOfExpressions];
+    int32 *vectorResults = new int32[nOfExpressions];
+    bool   isNew;
+    for(int32 i = 0 ; i < NUMBER_OF_INPUTS ; i++) {
+        scalarInputs[i] = scalar.Variable(names[i].Buffer(), isNew);
+        vectorInputs[i] = vector.Variable(names[i].Buffer(), isNew);
+    }
+    for(int32 j = 0 ; j < nOfExpressions ; j++) {
+        int32 tableRegisters[NUMBER_OF_INPUTS];
+        for(int32 i = 0 ; i < NUMBER_OF_INPUTS ; i++) tableRegisters[indexes[j][i]] = scalarInputs[i];
+        scalarResults[j] = scalar.Compile(expressions[j]->masterOperationNode, tableRegisters, NUMBER_OF_INPUTS);
+        for(int32 i = 0 ; i < NUMBER_OF_INPUTS ; i++) tableRegisters[indexes[j][i]] = vectorInputs[i];
+        vectorResults[j] = vector.Compile(expressions[j]->masterOperationNode, tableRegisters, NUMBER_OF_INPUTS);
+        if((scalarResults[j] < 0) || (vectorResults[j] < 0)) {
+            printf("Expression %d cannot be compiled\n", j);
+            return -1;
+        }
+    }
+    scalar.Finalise();
+    vector.Finalise();
+    printf("%d expressions: %d instructions, %d registers\n", nOfExpressions, scalar.NumberOfInstructions(), scalar.NumberOfRegisters());
+
+    float  inputs[NUMBER_OF_INPUTS];
+    float *arrays = new float[NUMBER_OF_INPUTS * arraySize];
+    float *treeResults = new float[nOfExpressions];
+    float  out;
+    int32  mismatches = 0;
+
+    /// Scalar: tree interpreter
+    int64 start = HRT::HRTCounter();
+    for(int32 c = 0 ; c < nOfCycles ; c++) {
+        for(int32 i = 0 ; i < NUMBER_OF_INPUTS ; i++) inputs[i] = 0.5f + i + 0.001f * c;
+        for(int32 j = 0 ; j < nOfExpressions ; j++) {
+            for(int32 i = 0 ; i < NUMBER_OF_INPUTS ; i++) {
+                value.UpdateData(&inputs[i]);
+                expressions[j]->eedt.UpdateDataTableEntryValue(indexes[j][i], value);
+            }
+            expressions[j]->Execute().GetData(BTDFloat, &out);
+            treeResults[j] = out;
+        }
+    }
+    double treeTime = (HRT::HRTCounter() - start) * HRT::HRTPeriod();
+
+    /// Scalar: bytecode
+    start = HRT::HRTCounter();
+    for(int32 c = 0 ; c < nOfCycles ; c++) {
+        for(int32 i = 0 ; i < NUMBER_OF_INPUTS ; i++) inputs[i] = 0.5f + i + 0.001f * c;
+        for(int32 i = 0 ; i < NUMBER_OF_INPUTS ; i++) scalar.Load(scalarInputs[i], &inputs[i], 1);
+        scalar.Execute();
+    }
+    double bytecodeTime = (HRT::HRTCounter() - start) * HRT::HRTPeriod();
+    for(int32 j = 0 ; j < nOfExpressions ; j++) {
+        if(*scalar.RegisterData(scalarResults[j]) != treeResults[j]) {
+            if(mismatches++ < 5) printf("Mismatch in expression %d: %g != %g\n", j, *scalar.RegisterData(scalarResults[j]), treeResults[j]);
+        }
+    }
+    printf("scalar: tree = %8.2f us/cycle, bytecode = %8.2f us/cycle (x%.1f), %d mismatches\n", treeTime * 1e6 / nOfCycles, bytecodeTime * 1e6 / nOfCycles, treeTime / bytecodeTime, mismatches);
+
+    /// Arrays: tree interpreter on each element
+    int32 vectorCycles = (nOfCycles / arraySize > 0) ? nOfCycles / arraySize : 1;
+    start = HRT::HRTCounter();
+    for(int32 c = 0 ; c < vectorCycles ; c++) {
+        for(int32 k = 0 ; k < arraySize ; k++) {
+            for(int32 j = 0 ; j < nOfExpressions ; j++) {
+                for(int32 i = 0 ; i < NUMBER_OF_INPUTS ; i++) {
+                    float v = 0.5f + i + 0.01f * k;
+                    value.UpdateData(&v);
+                    expressions[j]->eedt.UpdateDataTableEntryValue(indexes[j][i], value);
+                }
+                expressions[j]->Execute();
+            }
+        }
+    }
+    treeTime = (HRT::HRTCounter() - start) * HRT::HRTPeriod();
+
+    /// Arrays: vectorised bytecode
+    start = HRT::HRTCounter();
+    for(int32 c = 0 ; c < vectorCycles ; c++) {
+        for(int32 i = 0 ; i < NUMBER_OF_INPUTS ; i++) {
+            for(int32 k = 0 ; k < arraySize ; k++) arrays[i * arraySize + k] = 0.5f + i + 0.01f * k;
+            vector.Load(vectorInputs[i], &arrays[i * arraySize], arraySize);
+        }
+        vector.Execute();
+    }
+    bytecodeTime = (HRT::HRTCounter() - start) * HRT::HRTPeriod();
+    printf("arrays of %d: tree = %8.2f us/cycle, bytecode = %8.2f us/cycle (x%.1f)\n", arraySize, treeTime * 1e6 / vectorCycles, bytecodeTime * 1e6 / vectorCycles, treeTime / bytecodeTime);
+    return 0;
+}
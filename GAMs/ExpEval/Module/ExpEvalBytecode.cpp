@@ -0,0 +1,321 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+#include "ExpEvalBytecode.h"
+#include "UnaryOperation.h"
+#include "BinaryOperation.h"
+#include "PlusOperation.h"
+#include "TimesOperation.h"
+#include "DivisionOperation.h"
+#include "PowerOperation.h"
+#include "AndOperation.h"
+#include "EqualOperation.h"
+#include "NotEqualOperation.h"
+#include "SqrtOperation.h"
+#include "AbsOperation.h"
+#include "SinOperation.h"
+
+/// Constructor
+ExpEvalProgram::ExpEvalProgram() {
+    width             = 1;
+    instructions      = NULL;
+    nOfInstructions   = 0;
+    registerInfo      = NULL;
+    nOfRegisters      = 0;
+    variableNames     = NULL;
+    variableRegisters = NULL;
+    nOfVariables      = 0;
+    registers         = NULL;
+}
+
+/// Destructor
+ExpEvalProgram::~ExpEvalProgram() {
+    Reset(1);
+}
+
+///
+void ExpEvalProgram::Reset(uint32 arrayWidth) {
+    if(instructions != NULL) {
+        free((void*&)instructions);
+    }
+    if(registerInfo != NULL) {
+        free((void*&)registerInfo);
+    }
+    if(variableRegisters != NULL) {
+        free((void*&)variableRegisters);
+    }
+    if(registers != NULL) {
+        free((void*&)registers);
+    }
+    if(variableNames != NULL) {
+        delete []variableNames;
+    }
+    instructions      = NULL;
+    registerInfo      = NULL;
+    variableRegisters = NULL;
+    registers         = NULL;
+    variableNames     = NULL;
+    nOfInstructions   = 0;
+    nOfRegisters      = 0;
+    nOfVariables      = 0;
+    width             = (arrayWidth > 0) ? arrayWidth : 1;
+}
+
+///
+int32 ExpEvalProgram::ResultType(int32 opcode) {
+    switch(opcode) {
+    case EEBC_EQ:
+    case EEBC_NE:
+    case EEBC_AND:
+    case EEBC_FTOU:
+        return EEBC_UINT32;
+    }
+    return EEBC_FLOAT;
+}
+
+///
+int32 ExpEvalProgram::OperandType(int32 opcode) {
+    switch(opcode) {
+    case EEBC_AND:
+    case EEBC_UTOF:
+        return EEBC_UINT32;
+    }
+    return EEBC_FLOAT;
+}
+
+///
+int32 ExpEvalProgram::NewRegister(int32 type) {
+    if(realloc((void*&)registerInfo, (nOfRegisters + 1) * sizeof(EEBCRegister)) == NULL) {
+        return -1;
+    }
+    registerInfo[nOfRegisters].type       = type;
+    registerInfo[nOfRegisters].isConstant = False;
+    registerInfo[nOfRegisters].constant.u = 0;
+    return nOfRegisters++;
+}
+
+///
+int32 ExpEvalProgram::Constant(int32 type, EEBCValue value) {
+    for(uint32 i = 0 ; i < nOfRegisters ; i++) {
+        if(registerInfo[i].isConstant && (registerInfo[i].type == type) && (registerInfo[i].constant.u == value.u)) {
+            return i;
+        }
+    }
+    int32 reg = NewRegister(type);
+    if(reg < 0) {
+        return -1;
+    }
+    registerInfo[reg].isConstant = True;
+    registerInfo[reg].constant   = value;
+    return reg;
+}
+
+///
+int32 ExpEvalProgram::Emit(int32 opcode, int32 source1, int32 source2) {
+    if((source1 < 0) || (source2 < 0)) {
+        return -1;
+    }
+    /// The same operands in the same order for the commutative operations
+    if(((opcode == EEBC_ADD) || (opcode == EEBC_MUL) || (opcode == EEBC_EQ) || (opcode == EEBC_NE) || (opcode == EEBC_AND)) && (source1 > source2)) {
+        int32 tmp = source1;
+        source1   = source2;
+        source2   = tmp;
+    }
+
+    /// Constant folding
+    if(registerInfo[source1].isConstant && registerInfo[source2].isConstant) {
+        EEBCValue result;
+        Apply(opcode, &result, &registerInfo[source1].constant, &registerInfo[source2].constant, 1);
+        return Constant(ResultType(opcode), result);
+    }
+
+    /// Common subexpressions
+    for(uint32 i = 0 ; i < nOfInstructions ; i++) {
+        if((instructions[i].opcode == opcode) && (instructions[i].source1 == source1) && (instructions[i].source2 == source2)) {
+            return instructions[i].destination;
+        }
+    }
+
+    int32 destination = NewRegister(ResultType(opcode));
+    if(destination < 0) {
+        return -1;
+    }
+    if(realloc((void*&)instructions, (nOfInstructions + 1) * sizeof(EEBCInstruction)) == NULL) {
+        return -1;
+    }
+    instructions[nOfInstructions].opcode      = opcode;
+    instructions[nOfInstructions].destination = destination;
+    instructions[nOfInstructions].source1     = source1;
+    instructions[nOfInstructions].source2     = source2;
+    nOfInstructions++;
+    return destination;
+}
+
+///
+int32 ExpEvalProgram::Convert(int32 source, int32 type) {
+    if((source < 0) || (registerInfo[source].type == type)) {
+        return source;
+    }
+    int32 opcode = (type == EEBC_FLOAT) ? EEBC_UTOF : EEBC_FTOU;
+    return Emit(opcode, source, source);
+}
+
+///
+int32 ExpEvalProgram::Variable(const char *name, bool &isNew) {
+    isNew = False;
+    for(uint32 i = 0 ; i < nOfVariables ; i++) {
+        if(variableNames[i] == name) {
+            return variableRegisters[i];
+        }
+    }
+    int32 reg = NewRegister(EEBC_FLOAT);
+    if(reg < 0) {
+        return -1;
+    }
+    BindVariable(name, reg);
+    isNew = True;
+    return reg;
+}
+
+///
+void ExpEvalProgram::BindVariable(const char *name, int32 reg) {
+    for(uint32 i = 0 ; i < nOfVariables ; i++) {
+        if(variableNames[i] == name) {
+            variableRegisters[i] = reg;
+            return;
+        }
+    }
+    FString *names = new FString[nOfVariables + 1];
+    int32   *regs  = (int32 *)malloc((nOfVariables + 1) * sizeof(int32));
+    for(uint32 i = 0 ; i < nOfVariables ; i++) {
+        names[i] = variableNames[i];
+        regs[i]  = variableRegisters[i];
+    }
+    names[nOfVariables] = name;
+    regs[nOfVariables]  = reg;
+    if(variableNames != NULL) {
+        delete []variableNames;
+    }
+    if(variableRegisters != NULL) {
+        free((void*&)variableRegisters);
+    }
+    variableNames     = names;
+    variableRegisters = regs;
+    nOfVariables++;
+}
+
+///
+int32 ExpEvalProgram::InputRegister() {
+    return NewRegister(EEBC_FLOAT);
+}
+
+///
+int32 ExpEvalProgram::CompileNode(GCRTemplate<Node> node, const int32 *tableRegisters, uint32 tableSize) {
+    if(!node.IsValid()) {
+        return -1;
+    }
+
+    GCRTemplate<BinaryOperation> binary = node;
+    if(binary.IsValid()) {
+        int32 opcode;
+        if(GCRTemplate<PlusOperation>(node).IsValid())               opcode = EEBC_ADD;
+        else if(GCRTemplate<TimesOperation>(node).IsValid())         opcode = EEBC_MUL;
+        else if(GCRTemplate<DivisionOperation>(node).IsValid())      opcode = EEBC_DIV;
+        else if(GCRTemplate<PowerOperation>(node).IsValid())         opcode = EEBC_POW;
+        else if(GCRTemplate<EqualOperation>(node).IsValid())         opcode = EEBC_EQ;
+        else if(GCRTemplate<NotEqualOperation>(node).IsValid())      opcode = EEBC_NE;
+        else if(GCRTemplate<AndOperation>(node).IsValid())           opcode = EEBC_AND;
+        else return -1;
+
+        int32 left  = CompileNode(binary->leftSink, tableRegisters, tableSize);
+        int32 right = CompileNode(binary->rightSink, tableRegisters, tableSize);
+        int32 type  = OperandType(opcode);
+        return Emit(opcode, Convert(left, type), Convert(right, type));
+    }
+
+    GCRTemplate<UnaryOperation> unary = node;
+    if(!unary.IsValid()) {
+        return -1;
+    }
+
+    int32 argument;
+    if(unary->isLeaf) {
+        if(unary->dataTable != NULL) {
+            if((unary->dataTableIndex < 0) || ((uint32)unary->dataTableIndex >= tableSize)) {
+                return -1;
+            }
+            argument = tableRegisters[unary->dataTableIndex];
+        }
+        else {
+            EEBCValue value;
+            if(!unary->data.GetData(BTDFloat, &value.f)) {
+                return -1;
+            }
+            argument = Constant(EEBC_FLOAT, value);
+        }
+    }
+    else {
+        argument = CompileNode(unary->sink, tableRegisters, tableSize);
+    }
+
+    if(GCRTemplate<SqrtOperation>(node).IsValid()) {
+        return Emit(EEBC_SQRT, Convert(argument, EEBC_FLOAT), Convert(argument, EEBC_FLOAT));
+    }
+    if(GCRTemplate<AbsOperation>(node).IsValid()) {
+        return Emit(EEBC_ABS, Convert(argument, EEBC_FLOAT), Convert(argument, EEBC_FLOAT));
+    }
+    if(GCRTemplate<SinOperation>(node).IsValid()) {
+        return Emit(EEBC_SIN, Convert(argument, EEBC_FLOAT), Convert(argument, EEBC_FLOAT));
+    }
+    /// Parenthesis, sides of the binary operations and the root
+    return argument;
+}
+
+///
+int32 ExpEvalProgram::Compile(GCRTemplate<Node> root, const int32 *tableRegisters, uint32 tableSize) {
+    if(registers != NULL) {
+        return -1;
+    }
+    return Convert(CompileNode(root, tableRegisters, tableSize), EEBC_FLOAT);
+}
+
+///
+bool ExpEvalProgram::Finalise() {
+    if(registers != NULL) {
+        free((void*&)registers);
+    }
+    uint32 size = (nOfRegisters > 0 ? nOfRegisters : 1) * width * sizeof(EEBCValue);
+    if((registers = (EEBCValue *)malloc(size)) == NULL) {
+        return False;
+    }
+    memset(registers, 0, size);
+    for(uint32 i = 0 ; i < nOfRegisters ; i++) {
+        if(registerInfo[i].isConstant) {
+            for(uint32 k = 0 ; k < width ; k++) {
+                registers[i * width + k] = registerInfo[i].constant;
+            }
+        }
+    }
+    return True;
+}
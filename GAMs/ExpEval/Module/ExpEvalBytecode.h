@@ -0,0 +1,236 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+#ifndef __EXP_EVAL_BYTECODE__
+#define __EXP_EVAL_BYTECODE__
+
+#include "System.h"
+#include "FString.h"
+#include "GCRTemplate.h"
+#include "Node.h"
+
+/// Opcodes of the bytecode
+enum EEBCOpcode {
+    EEBC_ADD  = 0,
+    EEBC_MUL,
+    EEBC_DIV,
+    EEBC_POW,
+    EEBC_SQRT,
+    EEBC_ABS,
+    EEBC_SIN,
+    /// float == float -> uint32
+    EEBC_EQ,
+    /// float != float -> uint32
+    EEBC_NE,
+    /// uint32 & uint32 -> uint32
+    EEBC_AND,
+    /// float -> uint32
+    EEBC_FTOU,
+    /// uint32 -> float
+    EEBC_UTOF
+};
+
+/// Type of the value held in a register
+enum EEBCType {
+    EEBC_FLOAT  = 0,
+    EEBC_UINT32 = 1
+};
+
+/// A register element
+union EEBCValue {
+    float  f;
+    uint32 u;
+};
+
+/// destination = opcode(source1, source2). Unary operations ignore source2
+struct EEBCInstruction {
+    int32 opcode;
+    int32 destination;
+    int32 source1;
+    int32 source2;
+};
+
+/// Description of a register
+struct EEBCRegister {
+    /// EEBCType
+    int32     type;
+    /// True if the register holds a constant
+    bool      isConstant;
+    /// The constant value
+    EEBCValue constant;
+};
+
+/**
+ * The expressions of an ExpEvalGAM compiled into a register based bytecode.
+ * Every register holds width elements and every instruction is applied
+ * element-wise, so that an expression on array signals costs one dispatch
+ * per operation instead of one per element. The scalar signals used in an
+ * array program are broadcast when loaded.
+ * The operation trees built by the ExpressionParser are flattened with
+ * constant folding and the same operation on the same registers is only
+ * computed once in the whole program, also across expressions.
+ */
+class ExpEvalProgram {
+
+private:
+
+    /// Number of elements of each register
+    uint32           width;
+
+    /// The instructions
+    EEBCInstruction *instructions;
+
+    ///
+    uint32           nOfInstructions;
+
+    /// The registers description
+    EEBCRegister    *registerInfo;
+
+    ///
+    uint32           nOfRegisters;
+
+    /// Names of the variables
+    FString         *variableNames;
+
+    /// Register of each variable
+    int32           *variableRegisters;
+
+    ///
+    uint32           nOfVariables;
+
+    /// nOfRegisters * width elements, allocated by Finalise
+    EEBCValue       *registers;
+
+    /// Adds a register. Returns its index
+    int32 NewRegister(int32 type);
+
+    /// Returns a register holding the constant value
+    int32 Constant(int32 type, EEBCValue value);
+
+    /// Appends an instruction (or folds it, or reuses an identical one).
+    /// Returns the register holding the result
+    int32 Emit(int32 opcode, int32 source1, int32 source2);
+
+    /// Converts a register to type, if needed
+    int32 Convert(int32 source, int32 type);
+
+    /// Compiles a node of the tree. Returns -1 if the node is not supported
+    int32 CompileNode(GCRTemplate<Node> node, const int32 *tableRegisters, uint32 tableSize);
+
+public:
+
+    /// The type of the result of an opcode
+    static int32 ResultType(int32 opcode);
+
+    /// The type of the operands of an opcode
+    static int32 OperandType(int32 opcode);
+
+    /// Applies an instruction to count elements
+    static inline void Apply(int32 opcode, EEBCValue *destination, const EEBCValue *source1, const EEBCValue *source2, uint32 count) {
+        uint32 k;
+        switch(opcode) {
+        case EEBC_ADD:  for(k = 0 ; k < count ; k++) destination[k].f = source1[k].f + source2[k].f;           break;
+        case EEBC_MUL:  for(k = 0 ; k < count ; k++) destination[k].f = source1[k].f * source2[k].f;           break;
+        case EEBC_DIV:  for(k = 0 ; k < count ; k++) destination[k].f = source1[k].f / source2[k].f;           break;
+        case EEBC_POW:  for(k = 0 ; k < count ; k++) destination[k].f = powf(source1[k].f, source2[k].f);      break;
+        case EEBC_SQRT: for(k = 0 ; k < count ; k++) destination[k].f = sqrt(source1[k].f);                    break;
+        case EEBC_ABS:  for(k = 0 ; k < count ; k++) destination[k].f = fabs(source1[k].f);                    break;
+        case EEBC_SIN:  for(k = 0 ; k < count ; k++) destination[k].f = sin(source1[k].f);                     break;
+        case EEBC_EQ:   for(k = 0 ; k < count ; k++) destination[k].u = (source1[k].f == source2[k].f);        break;
+        case EEBC_NE:   for(k = 0 ; k < count ; k++) destination[k].u = (source1[k].f != source2[k].f);        break;
+        case EEBC_AND:  for(k = 0 ; k < count ; k++) destination[k].u = source1[k].u & source2[k].u;           break;
+        case EEBC_FTOU: for(k = 0 ; k < count ; k++) destination[k].u = (uint32)source1[k].f;                  break;
+        case EEBC_UTOF: for(k = 0 ; k < count ; k++) destination[k].f = (float)source1[k].u;                   break;
+        }
+    }
+
+    /// Constructor
+    ExpEvalProgram();
+
+    /// Destructor
+    ~ExpEvalProgram();
+
+    /// Clears the program. All the registers will hold arrayWidth elements
+    void Reset(uint32 arrayWidth);
+
+    /// The number of elements of the registers
+    uint32 Width() {
+        return width;
+    }
+
+    /// The register of a variable. isNew is True if the register was
+    /// created by this call and must be loaded before each Execute
+    int32 Variable(const char *name, bool &isNew);
+
+    /// The following uses of the variable name refer to the register
+    void BindVariable(const char *name, int32 reg);
+
+    /// A register which is not bound to a variable and must be loaded before each Execute
+    int32 InputRegister();
+
+    /// Compiles the tree of an expression.
+    /// @param tableRegisters the register of each entry of the DataTable used by the tree
+    /// @return the float register holding the result, -1 if the tree cannot be compiled
+    int32 Compile(GCRTemplate<Node> root, const int32 *tableRegisters, uint32 tableSize);
+
+    /// Allocates the registers and loads the constants. Called after the last Compile
+    bool Finalise();
+
+    /// Copies a signal into a register. A scalar is broadcast
+    inline void Load(int32 reg, const float *data, uint32 dataWidth) {
+        float *r = RegisterData(reg);
+        if(dataWidth == width) {
+            memcpy(r, data, width * sizeof(float));
+        }
+        else {
+            for(uint32 k = 0 ; k < width ; k++) r[k] = data[0];
+        }
+    }
+
+    /// Runs the program
+    inline void Execute() {
+        const EEBCInstruction *ins = instructions;
+        const EEBCInstruction *end = instructions + nOfInstructions;
+        for( ; ins < end ; ins++) {
+            Apply(ins->opcode, registers + ins->destination * width, registers + ins->source1 * width, registers + ins->source2 * width, width);
+        }
+    }
+
+    /// The elements of a register
+    inline float *RegisterData(int32 reg) {
+        return (float *)(registers + reg * width);
+    }
+
+    ///
+    uint32 NumberOfInstructions() {
+        return nOfInstructions;
+    }
+
+    ///
+    uint32 NumberOfRegisters() {
+        return nOfRegisters;
+    }
+};
+
+#endif
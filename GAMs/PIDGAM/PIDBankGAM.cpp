@@ -0,0 +1,619 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+#include "PIDBankGAM.h"
+#include "CDBExtended.h"
+
+#include "DDBInputInterface.h"
+#include "DDBOutputInterface.h"
+
+#include "LoadCDBObjectClass.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#define TSTARTDEFAULT    0.0
+#define TENDDEFAULT    100.0
+
+/** Number of float arrays of numberOfChannels elements:
+    11 parameters, 3 masks, 3 states and 5 diagnostics */
+#define PIDBANK_NUMBER_OF_ARRAYS 22
+
+bool PIDBankGAM::LoadParameters(CDBExtended &cdb, PIDBankChannelParameters &parameters) {
+
+    if(cdb.ReadFloat(parameters.Kp, "Kp", parameters.Kp)) {
+        parameters.KpFound = True;
+    }
+    cdb.ReadFloat(parameters.Ki, "Ki", parameters.Ki);
+    cdb.ReadFloat(parameters.Kd, "Kd", parameters.Kd);
+
+    // Antiwindup gain
+    if(cdb.ReadFloat(parameters.antiwindupGain, "AntiwindupGain", parameters.antiwindupGain)) {
+        parameters.antiwindupIsEnabled = True;
+    }
+
+    // Saturation levels
+    if(cdb.ReadFloat(parameters.upperControlSaturation, "UpperControlSaturation", parameters.upperControlSaturation)) {
+        parameters.upperControlSaturationFound = True;
+    }
+    if(cdb.ReadFloat(parameters.lowerControlSaturation, "LowerControlSaturation", parameters.lowerControlSaturation)) {
+        parameters.lowerControlSaturationFound = True;
+    }
+
+    // Fast discharge
+    if (cdb->Move("FastDischarge")) {
+        if(!cdb.ReadFloat(parameters.fastDischargeAbsoluteErrorMaximumContribution, "FastDischargeAbsoluteErrorMaximumContribution")){
+            AssertErrorCondition(InitialisationError,"PIDBankGAM %s::Initialise: FastDischarge enabled but no FastDischargeAbsoluteErrorMaximumContribution specified", Name());
+            cdb->MoveToFather();
+            return False;
+        }
+        if(!cdb.ReadFloat(parameters.fastDischargeAbsoluteErrorScalingFactor, "FastDischargeAbsoluteErrorScalingFactor")){
+            AssertErrorCondition(InitialisationError, "PIDBankGAM %s::Initialise: FastDischarge enabled but no FastDischargeAbsoluteErrorScalingFactor specified", Name());
+            cdb->MoveToFather();
+            return False;
+        }
+        parameters.fastDischargeEnabled = True;
+        /** Make both quantities positive no matter what */
+        parameters.fastDischargeAbsoluteErrorMaximumContribution = fabs(parameters.fastDischargeAbsoluteErrorMaximumContribution);
+        parameters.fastDischargeAbsoluteErrorScalingFactor       = fabs(parameters.fastDischargeAbsoluteErrorScalingFactor);
+        cdb->MoveToFather();
+    }
+
+    cdb.ReadFloat(parameters.outputGain, "OutputGain", parameters.outputGain);
+
+    cdb.ReadFloat(parameters.absSlewRateLimitInAuPerSec, "AbsSlewRateLimitInAuPerSec", parameters.absSlewRateLimitInAuPerSec);
+    parameters.absSlewRateLimitInAuPerSec = fabs(parameters.absSlewRateLimitInAuPerSec);
+
+    return True;
+}
+
+bool PIDBankGAM::AddFloatSignal(DDBInterface *ddbi, const char *channelName, const char *signalName) {
+    if(!ddbi->AddSignal(signalName, "float")) {
+        AssertErrorCondition(InitialisationError, "PIDBankGAM %s::Initialise: failed to add signal %s of channel %s", Name(), signalName, channelName);
+        return False;
+    }
+    return True;
+}
+
+bool PIDBankGAM::Initialise(ConfigurationDataBase& cdbData) {
+
+    CDBExtended cdb(cdbData);
+
+    CheckAndFreeDynamicMemory();
+
+    ////////////////////////////////////////////////////
+    //                Add interfaces to DDB           //
+    ////////////////////////////////////////////////////
+    if(!AddInputInterface(input,"InputInterface")){
+        AssertErrorCondition(InitialisationError,"PIDBankGAM::Initialise: %s failed to add input interface",Name());
+        return False;
+    }
+
+    if(!AddOutputInterface(output,"OutputInterface")){
+        AssertErrorCondition(InitialisationError,"PIDBankGAM::Initialise: %s failed to add output interface",Name());
+        return False;
+    }
+
+    ////////////////////////////////////////////////////
+    //               Controller enabled               //
+    ////////////////////////////////////////////////////
+    {
+        FString tmp;
+        controllerEnabled = True;
+        if(cdb.ReadFString(tmp, "ControllerOn")) {
+            if (tmp == "OFF") {
+                controllerEnabled = False;
+                AssertErrorCondition(Warning,"PIDBankGAM::Initialise: %s PID bank is NOT enabled",Name());
+            }
+        }
+        diagnosticSignals = False;
+        if(cdb.ReadFString(tmp, "DiagnosticSignals")) {
+            if (tmp == "ON") {
+                diagnosticSignals = True;
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////
+    //            Time interval for control           //
+    ////////////////////////////////////////////////////
+    {
+        int tStartLength = 1;
+        int tEndLength   = 1;
+        FString error;
+        if(!LoadVectorObject(cdb, "TStart", (void*&)tStart, tStartLength, CDBTYPE_float, error)) {
+            AssertErrorCondition(Information,"PIDBankGAM %s::Initialise: TStart entry not found, assuming %f secs", Name(), TSTARTDEFAULT);
+            if(tStart == NULL) tStart = (float *)malloc(sizeof(float));
+            if(tStart == NULL) {
+                AssertErrorCondition(InitialisationError, "PIDBankGAM %s::Initialise: unable to allocate memory for tStart", Name());
+                return False;
+            }
+            tStart[0] = TSTARTDEFAULT;
+            tStartLength = 1;
+        }
+        if(!LoadVectorObject(cdb, "TEnd", (void*&)tEnd, tEndLength, CDBTYPE_float, error)) {
+            AssertErrorCondition(Information,"PIDBankGAM %s::Initialise: TEnd entry not found, assuming %f secs", Name(), TENDDEFAULT);
+            if(tEnd == NULL) tEnd = (float *)malloc(sizeof(float));
+            if(tEnd == NULL) {
+                AssertErrorCondition(InitialisationError, "PIDBankGAM %s::Initialise: unable to allocate memory for tEnd", Name());
+                return False;
+            }
+            tEnd[0] = TENDDEFAULT;
+            tEndLength = 1;
+        }
+
+        // Check if tStart and tEnd array lengths are the same, if not issue an error
+        if(tStartLength != tEndLength) {
+            AssertErrorCondition(InitialisationError, "PIDBankGAM %s::Initialise: Time windows mismatch -> (tStartLength = %d) != (tEndLength = %d)", Name(), tStartLength, tEndLength);
+            return False;
+        }
+        numberOfTimeWindows = tStartLength;
+
+        // Check if time windows are consistent in terms of tStart and tEnd
+        for( int i = 0 ; i < numberOfTimeWindows ; i++ ){
+            if( tStart[i] >= tEnd[i] ){
+                AssertErrorCondition(InitialisationError, "PIDBankGAM %s::Initialise: For time window %d the start time (%f) is larger than the end time (%f)", Name(), i, tStart[i], tEnd[i]);
+                return False;
+            }
+            if( i < numberOfTimeWindows - 1 ){
+                if( tStart[i+1] < tEnd[i] ){
+                    AssertErrorCondition(InitialisationError, "PIDBankGAM %s::Initialise: tStart for time window %d is smaller than tEnd for time window %d", Name(), i+1, i);
+                    return False;
+                }
+            }
+        }
+
+        if((tStartUsec = (uint32 *)malloc(tStartLength*sizeof(uint32))) == NULL) {
+            AssertErrorCondition(InitialisationError, "PIDBankGAM %s::Initialise: unable to allocate memory for tStartUsec", Name());
+            return False;
+        }
+        if((tEndUsec = (uint32 *)malloc(tStartLength*sizeof(uint32))) == NULL) {
+            AssertErrorCondition(InitialisationError, "PIDBankGAM %s::Initialise: unable to allocate memory for tEndUsec", Name());
+            return False;
+        }
+        for(int32 i = 0 ; i < tStartLength ; i++) {
+            tStartUsec[i] = (uint32)(1e6*tStart[i]);
+            tEndUsec[i]   = (uint32)(1e6*tEnd[i]);
+        }
+    }
+
+    // Load Ts
+    if(!cdb.ReadFloat(Ts, "SamplingTime")) {
+        AssertErrorCondition(InitialisationError,"PIDBankGAM %s::Initialise: SamplingTime entry not found", Name());
+        return False;
+    }
+
+    ////////////////////////////////////////////////////
+    //       Parameters shared by all the channels    //
+    ////////////////////////////////////////////////////
+    PIDBankChannelParameters bankParameters;
+    bankParameters.Kp                                            = 0.0;
+    bankParameters.Ki                                            = 0.0;
+    bankParameters.Kd                                            = 0.0;
+    bankParameters.antiwindupGain                                = 0.0;
+    bankParameters.upperControlSaturation                        = 0.0;
+    bankParameters.lowerControlSaturation                        = 0.0;
+    bankParameters.fastDischargeAbsoluteErrorScalingFactor       = 0.0;
+    bankParameters.fastDischargeAbsoluteErrorMaximumContribution = 0.0;
+    bankParameters.outputGain                                    = 1.0;
+    bankParameters.absSlewRateLimitInAuPerSec                    = 0.0;
+    bankParameters.KpFound                                       = False;
+    bankParameters.antiwindupIsEnabled                           = False;
+    bankParameters.upperControlSaturationFound                   = False;
+    bankParameters.lowerControlSaturationFound                   = False;
+    bankParameters.fastDischargeEnabled                          = False;
+    if(!LoadParameters(cdb, bankParameters)) {
+        return False;
+    }
+
+    ////////////////////////////////////////////////////
+    //                    Channels                    //
+    ////////////////////////////////////////////////////
+    FString usecTime;
+    if(!cdb.ReadFString(usecTime, "UsecTime")) {
+        AssertErrorCondition(InitialisationError,"PIDBankGAM %s::Initialise: UsecTime entry not found", Name());
+        return False;
+    }
+    FString usecTimeType;
+    cdb.ReadFString(usecTimeType, "UsecTimeType", "int32");
+    if(!input->AddSignal(usecTime.Buffer(), usecTimeType.Buffer())) {
+        AssertErrorCondition(InitialisationError,"PIDBankGAM %s::Initialise: failed to add signal %s", Name(), usecTime.Buffer());
+        return False;
+    }
+
+    if(!cdb->Move("Channels")) {
+        AssertErrorCondition(InitialisationError,"PIDBankGAM %s::Initialise: Channels entry not found", Name());
+        return False;
+    }
+    numberOfChannels = cdb->NumberOfChildren();
+    if(numberOfChannels <= 0) {
+        AssertErrorCondition(InitialisationError,"PIDBankGAM %s::Initialise: no channels specified", Name());
+        return False;
+    }
+    paddedChannels = ((numberOfChannels + PIDBANK_VECTOR_SIZE - 1) / PIDBANK_VECTOR_SIZE) * PIDBANK_VECTOR_SIZE;
+
+    arrays = (float *)malloc(PIDBANK_NUMBER_OF_ARRAYS * paddedChannels * sizeof(float));
+    channelNames = new FString[numberOfChannels];
+    if((arrays == NULL) || (channelNames == NULL)) {
+        AssertErrorCondition(InitialisationError,"PIDBankGAM %s::Initialise: unable to allocate memory for %d channels", Name(), numberOfChannels);
+        return False;
+    }
+    // The padding channels have all the parameters and states to zero
+    memset(arrays, 0, PIDBANK_NUMBER_OF_ARRAYS * paddedChannels * sizeof(float));
+    Kp                                            = arrays;
+    Ki                                            = Kp + paddedChannels;
+    Kd                                            = Ki + paddedChannels;
+    antiwindupGain                                = Kd + paddedChannels;
+    outputGain                                    = antiwindupGain + paddedChannels;
+    upperControlSaturation                        = outputGain + paddedChannels;
+    lowerControlSaturation                        = upperControlSaturation + paddedChannels;
+    fastDischargeAbsoluteErrorScalingFactor       = lowerControlSaturation + paddedChannels;
+    fastDischargeAbsoluteErrorMaximumContribution = fastDischargeAbsoluteErrorScalingFactor + paddedChannels;
+    absSlewRateLimitInAuPerSec                    = fastDischargeAbsoluteErrorMaximumContribution + paddedChannels;
+    slewRateStep                                  = absSlewRateLimitInAuPerSec + paddedChannels;
+    antiwindupMask                                = (uint32 *)(slewRateStep + paddedChannels);
+    fastDischargeMask                             = antiwindupMask + paddedChannels;
+    slewRateMask                                  = fastDischargeMask + paddedChannels;
+    previousControlValue                          = (float *)(slewRateMask + paddedChannels);
+    previousStepError                             = previousControlValue + paddedChannels;
+    integrator                                    = previousStepError + paddedChannels;
+    diagnostics                                   = integrator + paddedChannels;
+
+    // The signal names, in the order of the interfaces
+    FString *signalNames = new FString[4 * numberOfChannels];
+    if(signalNames == NULL) {
+        AssertErrorCondition(InitialisationError,"PIDBankGAM %s::Initialise: unable to allocate memory for the signal names", Name());
+        return False;
+    }
+    static const char *signalEntries[4] = {"Reference", "Measurement", "Feedforward", "ControlSignal"};
+
+    for(int32 i = 0; i < numberOfChannels; i++) {
+        cdb->MoveToChildren(i);
+        cdb->NodeName(channelNames[i]);
+
+        for(int32 j = 0; j < 4; j++) {
+            if(!cdb.ReadFString(signalNames[j * numberOfChannels + i], signalEntries[j])) {
+                AssertErrorCondition(InitialisationError,"PIDBankGAM %s::Initialise: %s entry not found for channel %s", Name(), signalEntries[j], channelNames[i].Buffer());
+                delete [] signalNames;
+                return False;
+            }
+        }
+
+        PIDBankChannelParameters parameters = bankParameters;
+        if(!LoadParameters(cdb, parameters)) {
+            delete [] signalNames;
+            return False;
+        }
+        cdb->MoveToFather();
+
+        if(!parameters.KpFound) {
+            AssertErrorCondition(InitialisationError, "PIDBankGAM %s::Initialise: Kp entry not found for channel %s", Name(), channelNames[i].Buffer());
+            delete [] signalNames;
+            return False;
+        }
+        if(parameters.antiwindupIsEnabled && !parameters.upperControlSaturationFound) {
+            AssertErrorCondition(InitialisationError,"PIDBankGAM %s::Initialise: UpperControlSaturation entry demanded by antiwindup feature not found for channel %s", Name(), channelNames[i].Buffer());
+            delete [] signalNames;
+            return False;
+        }
+        if(parameters.antiwindupIsEnabled && !parameters.lowerControlSaturationFound) {
+            AssertErrorCondition(InitialisationError,"PIDBankGAM %s::Initialise: LowerControlSaturation entry demanded by antiwindup feature not found for channel %s", Name(), channelNames[i].Buffer());
+            delete [] signalNames;
+            return False;
+        }
+
+        Kp[i]                                            = parameters.Kp;
+        Ki[i]                                            = parameters.Ki;
+        Kd[i]                                            = parameters.Kd;
+        antiwindupGain[i]                                = parameters.antiwindupGain;
+        outputGain[i]                                    = parameters.outputGain;
+        upperControlSaturation[i]                        = parameters.upperControlSaturation;
+        lowerControlSaturation[i]                        = parameters.lowerControlSaturation;
+        fastDischargeAbsoluteErrorScalingFactor[i]       = parameters.fastDischargeAbsoluteErrorScalingFactor;
+        fastDischargeAbsoluteErrorMaximumContribution[i] = parameters.fastDischargeAbsoluteErrorMaximumContribution;
+        absSlewRateLimitInAuPerSec[i]                    = parameters.absSlewRateLimitInAuPerSec;
+        slewRateStep[i]                                  = parameters.absSlewRateLimitInAuPerSec * Ts;
+        antiwindupMask[i]                                = parameters.antiwindupIsEnabled             ? 0xFFFFFFFF : 0;
+        fastDischargeMask[i]                             = parameters.fastDischargeEnabled            ? 0xFFFFFFFF : 0;
+        slewRateMask[i]                                  = (parameters.absSlewRateLimitInAuPerSec != 0.0) ? 0xFFFFFFFF : 0;
+    }
+    cdb->MoveToFather();
+
+    ////////////////////////////////////////////////////
+    //                 Add the signals                //
+    ////////////////////////////////////////////////////
+    bool ok = True;
+    for(int32 j = 0; (j < 3) && ok; j++) {
+        for(int32 i = 0; (i < numberOfChannels) && ok; i++) {
+            ok = AddFloatSignal(input, channelNames[i].Buffer(), signalNames[j * numberOfChannels + i].Buffer());
+        }
+    }
+    for(int32 i = 0; (i < numberOfChannels) && ok; i++) {
+        ok = AddFloatSignal(output, channelNames[i].Buffer(), signalNames[3 * numberOfChannels + i].Buffer());
+    }
+    delete [] signalNames;
+    if(!ok) {
+        return False;
+    }
+
+    if(diagnosticSignals) {
+        // Same order as PIDGAMOutputStructure
+        static const char *diagnosticNames[5] = {"Feedback", "Error", "IntegratorState", "FastDischargeAction", "AntiwindupAction"};
+        for(int32 j = 0; j < 5; j++) {
+            for(int32 i = 0; i < numberOfChannels; i++) {
+                FString signalName;
+                signalName.Printf("%s%s", channelNames[i].Buffer(), diagnosticNames[j]);
+                if(!AddFloatSignal(output, channelNames[i].Buffer(), signalName.Buffer())) {
+                    return False;
+                }
+            }
+        }
+    }
+
+    IsPreviousControlValueAvailable = False;
+    Reset();
+
+    AssertErrorCondition(Information, "PIDBankGAM %s::Initialise: %d channels and %d time windows correctly setup", Name(), numberOfChannels, numberOfTimeWindows);
+
+    return True;
+}
+
+void PIDBankGAM::UpdateScalar(int32 first, const float *reference, const float *measurement, const float *feedforward,
+                              float *controlSignal, float *feedback, float *error, float *integratorState,
+                              float *fastDischargeAction, float *antiwindupAction) {
+
+    // The same operations as PIDGAM::Execute
+    for(int32 i = first; i < numberOfChannels; i++) {
+        float channelError     = reference[i] - measurement[i];
+        float controlValue     = 0.0;
+        float dischargeAction  = 0.0;
+        float antiwindup       = 0.0;
+
+        // Calculate discharge action if enabled
+        if (fastDischargeMask[i] != 0) {
+            if((integrator[i]*channelError) < 0) {
+                float absoluteErrorContribution = channelError*fastDischargeAbsoluteErrorScalingFactor[i];
+                if (fabs(absoluteErrorContribution) > fastDischargeAbsoluteErrorMaximumContribution[i]) {
+                    absoluteErrorContribution = absoluteErrorContribution*fastDischargeAbsoluteErrorMaximumContribution[i]/fabs(absoluteErrorContribution);
+                }
+                dischargeAction = absoluteErrorContribution;
+            }
+        }
+
+        // Calculate the PID
+        controlValue = Kp[i] * channelError + integrator[i] + Kd[i] * (channelError - previousStepError[i])/Ts;
+
+        // Calculate antiwindup signal
+        if(antiwindupMask[i] != 0) {
+            float saturatedControlValue = controlValue;
+
+            if(saturatedControlValue > upperControlSaturation[i]) saturatedControlValue = upperControlSaturation[i];
+            if(saturatedControlValue < lowerControlSaturation[i]) saturatedControlValue = lowerControlSaturation[i];
+
+            antiwindup   = antiwindupGain[i] * (controlValue - saturatedControlValue);
+            controlValue = saturatedControlValue;
+        }
+
+        // Update the integrator result for the next cycle
+        integrator[i] += Ts * (Ki[i] * channelError + antiwindup + dischargeAction);
+
+        previousStepError[i] = channelError;
+
+        controlValue *= outputGain[i];
+        float channelFeedback = controlValue;
+
+        // Add the feedforward action
+        controlValue += feedforward[i];
+
+        // Perform slew-rate limit correction
+        if((slewRateMask[i] != 0) && IsPreviousControlValueAvailable) {
+            if((controlValue-previousControlValue[i]) > slewRateStep[i]) {
+                controlValue = previousControlValue[i] + slewRateStep[i];
+            } else if((controlValue-previousControlValue[i]) < -slewRateStep[i]) {
+                controlValue = previousControlValue[i] - slewRateStep[i];
+            }
+        }
+
+        // Apply saturations
+        if(controlValue > upperControlSaturation[i]) {
+            controlValue = upperControlSaturation[i];
+        } else if(controlValue < lowerControlSaturation[i]) {
+            controlValue = lowerControlSaturation[i];
+        }
+
+        previousControlValue[i] = controlValue;
+
+        controlSignal[i]       = controlValue;
+        feedback[i]            = channelFeedback;
+        error[i]               = channelError;
+        fastDischargeAction[i] = dischargeAction;
+        antiwindupAction[i]    = antiwindup;
+        integratorState[i]     = integrator[i];
+    }
+}
+
+#if defined(__SSE2__)
+/** mask ? a : b */
+static inline __m128 PIDBankSelect(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+#endif
+
+int32 PIDBankGAM::UpdateVector(const float *reference, const float *measurement, const float *feedforward,
+                               float *controlSignal, float *feedback, float *error, float *integratorState,
+                               float *fastDischargeAction, float *antiwindupAction) {
+    int32 i = 0;
+#if defined(__SSE2__)
+    // Each operation is the one of UpdateScalar, in the same order, so that the results are identical
+    const __m128 ts       = _mm_set1_ps(Ts);
+    const __m128 zero     = _mm_setzero_ps();
+    const __m128 absMask  = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const __m128 previous = IsPreviousControlValueAvailable ? _mm_castsi128_ps(_mm_set1_epi32(0xFFFFFFFF)) : zero;
+
+    for(; i + PIDBANK_VECTOR_SIZE <= numberOfChannels; i += PIDBANK_VECTOR_SIZE) {
+        __m128 channelError = _mm_sub_ps(_mm_loadu_ps(reference + i), _mm_loadu_ps(measurement + i));
+        __m128 integ        = _mm_loadu_ps(integrator + i);
+        __m128 upper        = _mm_loadu_ps(upperControlSaturation + i);
+        __m128 lower        = _mm_loadu_ps(lowerControlSaturation + i);
+
+        // Fast discharge
+        __m128 maximum      = _mm_loadu_ps(fastDischargeAbsoluteErrorMaximumContribution + i);
+        __m128 contribution = _mm_mul_ps(channelError, _mm_loadu_ps(fastDischargeAbsoluteErrorScalingFactor + i));
+        __m128 absolute     = _mm_and_ps(contribution, absMask);
+        __m128 limited      = _mm_div_ps(_mm_mul_ps(contribution, maximum), absolute);
+        contribution        = PIDBankSelect(_mm_cmpgt_ps(absolute, maximum), limited, contribution);
+        __m128 discharging  = _mm_and_ps(_mm_loadu_ps((const float *)(fastDischargeMask + i)), _mm_cmplt_ps(_mm_mul_ps(integ, channelError), zero));
+        __m128 discharge    = _mm_and_ps(discharging, contribution);
+
+        // PID
+        __m128 derivative   = _mm_div_ps(_mm_mul_ps(_mm_loadu_ps(Kd + i), _mm_sub_ps(channelError, _mm_loadu_ps(previousStepError + i))), ts);
+        __m128 control      = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(Kp + i), channelError), integ), derivative);
+
+        // Antiwindup
+        __m128 antiwindupOn = _mm_loadu_ps((const float *)(antiwindupMask + i));
+        __m128 saturated    = PIDBankSelect(_mm_cmpgt_ps(control, upper), upper, control);
+        saturated           = PIDBankSelect(_mm_cmplt_ps(saturated, lower), lower, saturated);
+        __m128 antiwindup   = _mm_and_ps(antiwindupOn, _mm_mul_ps(_mm_loadu_ps(antiwindupGain + i), _mm_sub_ps(control, saturated)));
+        control             = PIDBankSelect(antiwindupOn, saturated, control);
+
+        // Integrator
+        integ = _mm_add_ps(integ, _mm_mul_ps(ts, _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(Ki + i), channelError), antiwindup), discharge)));
+        _mm_storeu_ps(integrator + i, integ);
+        _mm_storeu_ps(previousStepError + i, channelError);
+
+        control             = _mm_mul_ps(control, _mm_loadu_ps(outputGain + i));
+        __m128 feedbackValue = control;
+        control             = _mm_add_ps(control, _mm_loadu_ps(feedforward + i));
+
+        // Slew rate
+        __m128 previousValue = _mm_loadu_ps(previousControlValue + i);
+        __m128 step          = _mm_loadu_ps(slewRateStep + i);
+        __m128 delta         = _mm_sub_ps(control, previousValue);
+        __m128 limiting      = _mm_and_ps(previous, _mm_loadu_ps((const float *)(slewRateMask + i)));
+        __m128 rising        = _mm_and_ps(limiting, _mm_cmpgt_ps(delta, step));
+        __m128 falling       = _mm_andnot_ps(rising, _mm_and_ps(limiting, _mm_cmplt_ps(delta, _mm_sub_ps(zero, step))));
+        control              = PIDBankSelect(rising, _mm_add_ps(previousValue, step), control);
+        control              = PIDBankSelect(falling, _mm_sub_ps(previousValue, step), control);
+
+        // Saturation
+        __m128 above = _mm_cmpgt_ps(control, upper);
+        __m128 below = _mm_andnot_ps(above, _mm_cmplt_ps(control, lower));
+        control      = PIDBankSelect(above, upper, control);
+        control      = PIDBankSelect(below, lower, control);
+        _mm_storeu_ps(previousControlValue + i, control);
+
+        _mm_storeu_ps(controlSignal + i,       control);
+        _mm_storeu_ps(feedback + i,            feedbackValue);
+        _mm_storeu_ps(error + i,               channelError);
+        _mm_storeu_ps(integratorState + i,     integ);
+        _mm_storeu_ps(fastDischargeAction + i, discharge);
+        _mm_storeu_ps(antiwindupAction + i,    antiwindup);
+    }
+#endif
+    return i;
+}
+
+bool PIDBankGAM::Execute(GAM_FunctionNumbers functionNumber) {
+
+    // Get input and output data pointers
+    uint32 *inputData  = (uint32 *)input->Buffer();
+    float  *outputData = (float  *)output->Buffer();
+
+    // Set all the outputs to zero
+    memset(outputData, 0, output->BufferWordSize() * sizeof(int32));
+
+    if(functionNumber == GAMPrepulse) {
+        // Reset everything
+        Reset();
+    }
+
+    if(controllerEnabled) {
+        input->Read();
+
+        uint32 usecTime = inputData[0];
+        if(usecTime >= tStartUsec[currentTimeWindow] && usecTime <= tEndUsec[currentTimeWindow]) {
+            const float *reference   = (const float *)(inputData + 1);
+            const float *measurement = reference + numberOfChannels;
+            const float *feedforward = measurement + numberOfChannels;
+
+            float *controlSignal = outputData;
+            float *diagnostic    = diagnosticSignals ? (outputData + numberOfChannels) : diagnostics;
+
+            int32 first = UpdateVector(reference, measurement, feedforward, controlSignal,
+                                       diagnostic, diagnostic + numberOfChannels, diagnostic + 2 * numberOfChannels,
+                                       diagnostic + 3 * numberOfChannels, diagnostic + 4 * numberOfChannels);
+            UpdateScalar(first, reference, measurement, feedforward, controlSignal,
+                         diagnostic, diagnostic + numberOfChannels, diagnostic + 2 * numberOfChannels,
+                         diagnostic + 3 * numberOfChannels, diagnostic + 4 * numberOfChannels);
+
+            IsPreviousControlValueAvailable = True;
+        } else if(usecTime > tEndUsec[currentTimeWindow]) {
+            if(currentTimeWindow < numberOfTimeWindows-1) {
+                // previousControlValue is always rewritten before being used again
+                IsPreviousControlValueAvailable = False;
+                currentTimeWindow++;
+            }
+        } else {
+            IsPreviousControlValueAvailable = False;
+        }
+    }
+
+    // Update the data output buffer
+    output->Write();
+
+    return True;
+}
+
+bool PIDBankGAM::ProcessHttpMessage(HttpStream &hStream) {
+    hStream.SSPrintf("OutputHttpOtions.Content-Type","text/html");
+    hStream.keepAlive = False;
+    hStream.WriteReplyHeader(False);
+    hStream.Printf("<html><head><title>PID bank %s</title></head><body>\n", Name());
+
+    hStream.Printf("<h1>PID bank %s</h1>", Name());
+    if (!controllerEnabled) hStream.Printf("<br><p style=\"color: 'red'\">CONTROLLER DISABLED</p><br>\n");
+
+    hStream.Printf("<p>Sampling time: %f</p>\n", Ts);
+
+    hStream.Printf("<table border=\"1\">\n");
+    hStream.Printf("<tr><th>Channel</th><th>Kp</th><th>Ki</th><th>Kd</th><th>Output gain</th>"
+                   "<th>Upper saturation</th><th>Lower saturation</th><th>Antiwindup gain</th>"
+                   "<th>Fast discharge gain</th><th>Fast discharge maximum</th><th>Slew rate</th></tr>\n");
+    for(int32 i = 0; i < numberOfChannels; i++) {
+        hStream.Printf("<tr><td>%s</td><td>%f</td><td>%f</td><td>%f</td><td>%f</td><td>%f</td><td>%f</td>",
+                       channelNames[i].Buffer(), Kp[i], Ki[i], Kd[i], outputGain[i], upperControlSaturation[i], lowerControlSaturation[i]);
+        if(antiwindupMask[i] != 0) hStream.Printf("<td>%f</td>", antiwindupGain[i]);
+        else                       hStream.Printf("<td>-</td>");
+        if(fastDischargeMask[i] != 0) hStream.Printf("<td>%f</td><td>%f</td>", fastDischargeAbsoluteErrorScalingFactor[i], fastDischargeAbsoluteErrorMaximumContribution[i]);
+        else                          hStream.Printf("<td>-</td><td>-</td>");
+        hStream.Printf("<td>%f</td></tr>\n", absSlewRateLimitInAuPerSec[i]);
+    }
+    hStream.Printf("</table>\n");
+
+    hStream.Printf("</body></html>");
+    hStream.WriteReplyHeader(True);
+    return True;
+}
+OBJECTLOADREGISTER(PIDBankGAM,"$Id$")
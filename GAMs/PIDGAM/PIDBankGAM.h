@@ -0,0 +1,327 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+#ifndef PIDBANK_H_
+#define PIDBANK_H_
+
+#include "GAM.h"
+#include "HttpInterface.h"
+
+class CDBExtended;
+class DDBInterface;
+
+/** Number of channels updated together by the vectorised loop */
+#define PIDBANK_VECTOR_SIZE 4
+
+/**
+ * The parameters of a channel of the bank, with the same meaning and
+ * defaults as the PIDGAM parameters
+ */
+struct PIDBankChannelParameters {
+    float Kp;
+    float Ki;
+    float Kd;
+    float antiwindupGain;
+    float upperControlSaturation;
+    float lowerControlSaturation;
+    float fastDischargeAbsoluteErrorScalingFactor;
+    float fastDischargeAbsoluteErrorMaximumContribution;
+    float outputGain;
+    float absSlewRateLimitInAuPerSec;
+    bool  KpFound;
+    bool  antiwindupIsEnabled;
+    bool  upperControlSaturationFound;
+    bool  lowerControlSaturationFound;
+    bool  fastDischargeEnabled;
+};
+
+/**
+ * A bank of N PID controllers with the same semantics as PIDGAM (antiwindup,
+ * saturation, fast discharge and slew rate limit), sharing the time windows
+ * and the sampling time.
+ * The parameters and the states are kept as arrays, one entry per channel,
+ * and are updated PIDBANK_VECTOR_SIZE channels at a time with SSE. The results
+ * are identical to N PIDGAM instances.
+ * The input interface holds usecTime followed by the N references, the N
+ * measurements and the N feedforwards. The output interface holds the N control
+ * signals and, if DiagnosticSignals = ON, the N feedbacks, errors, integrator
+ * states, fast discharge actions and antiwindup actions (the fields of
+ * PIDGAMOutputStructure).
+ * The parameters given at the GAM level are the defaults of all the channels
+ * and each channel can override them:
+ * <pre>
+ * +CoilControl = {
+ *     Class        = PIDBankGAM
+ *     UsecTime     = usecTime
+ *     TStart       = 0.0
+ *     TEnd         = 100.0
+ *     SamplingTime = 0.0001
+ *     Kp = 1.0
+ *     AntiwindupGain = 0.5
+ *     UpperControlSaturation = 10.0
+ *     LowerControlSaturation = -10.0
+ *     Channels = {
+ *         Coil1 = {
+ *             Reference     = coil1CurrentReference
+ *             Measurement   = coil1Current
+ *             Feedforward   = coil1Feedforward
+ *             ControlSignal = coil1Voltage
+ *             Ki            = 20.0
+ *         }
+ *         ...
+ *     }
+ * }
+ * </pre>
+ * The diagnostic signals are named after the channel, e.g. Coil1Feedback.
+ * UsecTimeType (int32 by default) sets the type of the usecTime signal.
+ */
+OBJECT_DLL(PIDBankGAM)
+class PIDBankGAM : public GAM, public HttpInterface {
+OBJECT_DLL_STUFF(PIDBankGAM)
+
+// DDB Interfaces
+private:
+    /** Input interface to read data from */
+    DDBInputInterface                      *input;
+    /** Output interface to write data to */
+    DDBOutputInterface                     *output;
+
+// Parameters
+private:
+    /** Number of controllers */
+    int32                                   numberOfChannels;
+    /** numberOfChannels rounded up to PIDBANK_VECTOR_SIZE */
+    int32                                   paddedChannels;
+    /** Names of the channels */
+    FString                                *channelNames;
+    /** True if the controllers are enabled */
+    bool                                    controllerEnabled;
+    /** True if the diagnostic signals are written to the DDB */
+    bool                                    diagnosticSignals;
+    /** Control Start Time */
+    float                                  *tStart;
+    /** Control Start Time in Microseconds */
+    uint32                                 *tStartUsec;
+    /** Control End Time */
+    float                                  *tEnd;
+    /** Control End Time in Microsconds */
+    uint32                                 *tEndUsec;
+    /** Number of time windows */
+    int                                     numberOfTimeWindows;
+    /** Current time window */
+    int                                     currentTimeWindow;
+    /** The sampling time */
+    float                                   Ts;
+
+    /** Memory of all the arrays below */
+    float                                  *arrays;
+
+    /** Gains of each channel */
+    float                                  *Kp;
+    float                                  *Ki;
+    float                                  *Kd;
+    float                                  *antiwindupGain;
+    float                                  *outputGain;
+    /** Saturations of each channel */
+    float                                  *upperControlSaturation;
+    float                                  *lowerControlSaturation;
+    /** Fast discharge parameters of each channel */
+    float                                  *fastDischargeAbsoluteErrorScalingFactor;
+    float                                  *fastDischargeAbsoluteErrorMaximumContribution;
+    /** Slew rate limit of each channel */
+    float                                  *absSlewRateLimitInAuPerSec;
+    /** absSlewRateLimitInAuPerSec*Ts */
+    float                                  *slewRateStep;
+
+    /** Per channel flags, all the bits set if enabled */
+    uint32                                 *antiwindupMask;
+    uint32                                 *fastDischargeMask;
+    uint32                                 *slewRateMask;
+
+    /** Check that, for the correspondent time window, the previous control
+     sample is available to apply slew-rate limit */
+    bool                                    IsPreviousControlValueAvailable;
+
+    /** Control value of each channel in the previous cycle */
+    float                                  *previousControlValue;
+
+    /** Destination of the diagnostic values when they are not written to the DDB */
+    float                                  *diagnostics;
+
+// States
+private:
+    /** The error signal of each channel at the previous step */
+    float                                  *previousStepError;
+
+    /** The integrators */
+    float                                  *integrator;
+
+private:
+
+    /** Reads the parameters of the current node. The values in parameters are the defaults */
+    bool LoadParameters(CDBExtended &cdb, PIDBankChannelParameters &parameters);
+
+    /** Adds a float signal to an interface */
+    bool AddFloatSignal(DDBInterface *ddbi, const char *channelName, const char *signalName);
+
+    /** Updates the channels in [first, numberOfChannels) one at a time */
+    void UpdateScalar(int32 first, const float *reference, const float *measurement, const float *feedforward,
+                      float *controlSignal, float *feedback, float *error, float *integratorState,
+                      float *fastDischargeAction, float *antiwindupAction);
+
+    /** Updates the channels PIDBANK_VECTOR_SIZE at a time.
+        @return The number of channels updated */
+    int32 UpdateVector(const float *reference, const float *measurement, const float *feedforward,
+                       float *controlSignal, float *feedback, float *error, float *integratorState,
+                       float *fastDischargeAction, float *antiwindupAction);
+
+public:
+    /** Constructor */
+    PIDBankGAM() {
+        input                           = NULL;
+        output                          = NULL;
+
+        numberOfChannels                = 0;
+        paddedChannels                  = 0;
+        channelNames                    = NULL;
+
+        tStart                          = NULL;
+        tEnd                            = NULL;
+        tStartUsec                      = NULL;
+        tEndUsec                        = NULL;
+
+        currentTimeWindow               =  0;
+        numberOfTimeWindows             = -1;
+        IsPreviousControlValueAvailable = False;
+
+        Ts                              = 0.0;
+
+        controllerEnabled               = True;
+        diagnosticSignals               = False;
+
+        arrays                          = NULL;
+        CleanArrays();
+    }
+
+    /** Destructor */
+    ~PIDBankGAM(){
+        CheckAndFreeDynamicMemory();
+    }
+
+    /** Points all the arrays to NULL */
+    void CleanArrays(){
+        Kp                                            = NULL;
+        Ki                                            = NULL;
+        Kd                                            = NULL;
+        antiwindupGain                                = NULL;
+        outputGain                                    = NULL;
+        upperControlSaturation                        = NULL;
+        lowerControlSaturation                        = NULL;
+        fastDischargeAbsoluteErrorScalingFactor       = NULL;
+        fastDischargeAbsoluteErrorMaximumContribution = NULL;
+        absSlewRateLimitInAuPerSec                    = NULL;
+        slewRateStep                                  = NULL;
+        antiwindupMask                                = NULL;
+        fastDischargeMask                             = NULL;
+        slewRateMask                                  = NULL;
+        previousControlValue                          = NULL;
+        diagnostics                                   = NULL;
+        previousStepError                             = NULL;
+        integrator                                    = NULL;
+    }
+
+    /** Free dynamic memory */
+    void CheckAndFreeDynamicMemory(){
+        if( tStart != NULL ){
+            free((void*&)tStart);
+            tStart = NULL;
+        }
+        if( tEnd != NULL ){
+            free((void*&)tEnd);
+            tEnd = NULL;
+        }
+        if( tStartUsec != NULL ){
+            free((void*&)tStartUsec);
+            tStartUsec = NULL;
+        }
+        if( tEndUsec != NULL ){
+            free((void*&)tEndUsec);
+            tEndUsec = NULL;
+        }
+        if( arrays != NULL ){
+            free((void*&)arrays);
+            arrays = NULL;
+        }
+        if( channelNames != NULL ){
+            delete [] channelNames;
+            channelNames = NULL;
+        }
+        CleanArrays();
+    }
+
+    /**
+     * Resets the states of all the channels
+     */
+    void Reset() {
+        for(int32 i = 0; i < paddedChannels; i++){
+            previousStepError[i] = 0.0;
+            integrator[i]        = 0.0;
+        }
+        currentTimeWindow = 0;
+    }
+
+    /** Number of controllers */
+    int32 NumberOfChannels() const{
+        return numberOfChannels;
+    }
+
+    /**
+    * Loads GAM parameters from a CDB
+    * @param cdbData the CDB
+    * @return True if the initialisation went ok, False otherwise
+    */
+    virtual bool Initialise(ConfigurationDataBase& cdbData);
+
+    /**
+    * GAM main body
+    * @param functionNumber The current state of MARTe
+    * @return False on error, True otherwise
+    */
+    virtual bool Execute(GAM_FunctionNumbers functionNumber);
+
+    /**
+    * Saves parameters to a CDB
+    * @param info the CDB to save to
+    * @return True
+    */
+    virtual bool ObjectSaveSetup(ConfigurationDataBase &info, StreamInterface *err){ return True; };
+
+    /**
+    * The message is actually a multi stream (HttpStream)
+    * with a convention described in HttpStream
+    */
+    virtual bool ProcessHttpMessage(HttpStream &hStream);
+};
+
+#endif /* PIDBANK_H_ */
@@ -0,0 +1,209 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Runs nOfChannels PIDGAM instances and one PIDBankGAM with the same parameters
+ * and inputs, checks that all the outputs are bitwise identical and compares the
+ * time spent in Execute. The channels cycle through the antiwindup, fast discharge
+ * and slew rate limit options; two time windows and a prepulse are exercised.
+ * The interfaces are not linked to a DDB, so the copies are not timed.
+ * Usage: PIDBankGAMBenchmark.ex [nOfChannels] [nOfCycles]
+ * @return 0 if the outputs of the bank match the PIDGAMs
+ */
+
+#include "System.h"
+#include "FString.h"
+#include "HRT.h"
+#include "ConfigurationDataBase.h"
+#include "DDBInterface.h"
+#include "PIDGAM.h"
+#include "PIDBankGAM.h"
+
+/** Cycle period */
+#define CYCLE_USEC      100
+
+/** Number of outputs of each PIDGAM (PIDGAMOutputStructure) */
+#define PID_OUTPUTS     6
+
+static bool Setup(GAM &gam, const char *name, FString &config){
+    config.Seek(0);
+    ConfigurationDataBase cdb;
+    if(!cdb->ReadFromStream(config)){
+        printf("Could not parse the %s configuration\n", name);
+        return False;
+    }
+    gam.SetObjectName(name);
+    if(!gam.ObjectLoadSetup(cdb, NULL)){
+        printf("Could not setup %s\n", name);
+        return False;
+    }
+    return True;
+}
+
+static DDBInterface *FindInterface(GAM &gam, const char *name){
+    LinkedListable *interfaces = gam.InterfacesList();
+    while(interfaces != NULL){
+        DDBInterface *ddbi = dynamic_cast<DDBInterface *>(interfaces);
+        interfaces = interfaces->Next();
+        if((ddbi != NULL) && (strcmp(ddbi->InterfaceName(), name) == 0)) return ddbi;
+    }
+    return NULL;
+}
+
+/** Uniform in [-range, range] */
+static float Random(uint32 &seed, float range){
+    seed = seed * 1664525 + 1013904223;
+    return range * ((float)(seed >> 8) / (float)(1 << 23) - 1.0);
+}
+
+/** The parameters of a channel, shared by the PIDGAM and the bank */
+static void ChannelParameters(int32 channel, FString &config){
+    config.Printf("Kp = %d.%d\n", 1 + channel % 3, channel % 10);
+    config.Printf("Ki = %d.5\n", 20 + channel % 7);
+    config.Printf("Kd = 0.00%d\n", channel % 5);
+    config.Printf("UpperControlSaturation = %d.0\n", 2 + channel % 4);
+    config.Printf("LowerControlSaturation = -%d.0\n", 2 + channel % 3);
+    if((channel % 4) == 1 || (channel % 4) == 3){
+        config.Printf("AntiwindupGain = 0.%d\n", 1 + channel % 9);
+    }
+    if((channel % 4) >= 2){
+        config.Printf("FastDischarge = {\n FastDischargeAbsoluteErrorMaximumContribution = 0.%d\n FastDischargeAbsoluteErrorScalingFactor = %d.0\n}\n", 1 + channel % 8, 1 + channel % 5);
+    }
+    if((channel % 3) == 0){
+        config.Printf("AbsSlewRateLimitInAuPerSec = %d000.0\n", 1 + channel % 6);
+    }
+    if((channel % 5) == 0){
+        config.Printf("OutputGain = 0.75\n");
+    }
+}
+
+int main(int argc, char **argv){
+    int32 nOfChannels = (argc > 1) ? atoi(argv[1]) : 200;
+    int32 nOfCycles   = (argc > 2) ? atoi(argv[2]) : 20000;
+    if((nOfChannels < 1) || (nOfCycles < 1)){
+        printf("Usage: PIDBankGAMBenchmark.ex [nOfChannels] [nOfCycles]\n");
+        return -1;
+    }
+
+    /// Two windows covering about one third of the cycles each
+    float  tEnd    = nOfCycles * CYCLE_USEC * 1e-6;
+    FString windows;
+    windows.Printf("TStart = { %f %f }\nTEnd = { %f %f }\nSamplingTime = %f\n", 0.05 * tEnd, 0.5 * tEnd, 0.4 * tEnd, 0.85 * tEnd, CYCLE_USEC * 1e-6);
+
+    PIDGAM **pids = new PIDGAM *[nOfChannels];
+    for(int32 i = 0; i < nOfChannels; i++){
+        FString config;
+        config.Printf("%s", windows.Buffer());
+        config.Printf("InputSignals = {\n PIDInput = {\n SignalName = PIDIn%d\n SignalType = PIDGAMInputStructure\n }\n}\n", i);
+        config.Printf("OutputSignals = {\n PIDOutput = {\n SignalName = PIDOut%d\n SignalType = PIDGAMOutputStructure\n }\n}\n", i);
+        ChannelParameters(i, config);
+        pids[i] = new PIDGAM();
+        if(!Setup(*pids[i], "PIDGAM", config)){
+            return -1;
+        }
+    }
+
+    FString bankConfig;
+    bankConfig.Printf("%s", windows.Buffer());
+    bankConfig.Printf("UsecTime = usecTime\nUsecTimeType = uint32\nDiagnosticSignals = ON\nKp = 1.0\nChannels = {\n");
+    for(int32 i = 0; i < nOfChannels; i++){
+        bankConfig.Printf("C%d = {\nReference = ref%d\nMeasurement = meas%d\nFeedforward = ff%d\nControlSignal = ctl%d\n", i, i, i, i, i);
+        ChannelParameters(i, bankConfig);
+        bankConfig.Printf("}\n");
+    }
+    bankConfig.Printf("}\n");
+    PIDBankGAM bank;
+    if(!Setup(bank, "PIDBankGAM", bankConfig)){
+        return -1;
+    }
+
+    float **pidInputs  = new float *[nOfChannels];
+    float **pidOutputs = new float *[nOfChannels];
+    for(int32 i = 0; i < nOfChannels; i++){
+        pidInputs[i]  = (float *)FindInterface(*pids[i], "InputInterface")->Buffer();
+        pidOutputs[i] = (float *)FindInterface(*pids[i], "OutputInterface")->Buffer();
+    }
+    float *bankInput  = (float *)FindInterface(bank, "InputInterface")->Buffer();
+    float *bankOutput = (float *)FindInterface(bank, "OutputInterface")->Buffer();
+
+    uint32 seed       = 12345;
+    int32  mismatches = 0;
+    int64  pidTicks   = 0;
+    int64  bankTicks  = 0;
+    for(int32 c = 0; c < nOfCycles; c++){
+        uint32 usecTime = c * CYCLE_USEC;
+        *(uint32 *)bankInput = usecTime;
+        for(int32 i = 0; i < nOfChannels; i++){
+            float reference   = Random(seed, 3.0);
+            float measurement = Random(seed, 3.0);
+            float feedforward = Random(seed, 0.5);
+            *(uint32 *)pidInputs[i] = usecTime;
+            pidInputs[i][1] = reference;
+            pidInputs[i][2] = measurement;
+            pidInputs[i][3] = feedforward;
+            bankInput[1 + i]                   = reference;
+            bankInput[1 + nOfChannels + i]     = measurement;
+            bankInput[1 + 2 * nOfChannels + i] = feedforward;
+        }
+
+        GAM_FunctionNumbers functionNumber = (c == 0) ? GAMPrepulse : GAMOnline;
+        int64 start = HRT::HRTCounter();
+        for(int32 i = 0; i < nOfChannels; i++){
+            pids[i]->Execute(functionNumber);
+        }
+        int64 middle = HRT::HRTCounter();
+        bank.Execute(functionNumber);
+        int64 end    = HRT::HRTCounter();
+        pidTicks    += middle - start;
+        bankTicks   += end - middle;
+
+        for(int32 i = 0; i < nOfChannels; i++){
+            for(int32 j = 0; j < PID_OUTPUTS; j++){
+                if(memcmp(&pidOutputs[i][j], &bankOutput[j * nOfChannels + i], sizeof(float)) != 0){
+                    if(mismatches < 10){
+                        printf("Cycle %d channel %d output %d: PIDGAM %.9g bank %.9g\n", c, i, j, pidOutputs[i][j], bankOutput[j * nOfChannels + i]);
+                    }
+                    mismatches++;
+                }
+            }
+        }
+    }
+
+    double pidTime  = pidTicks  * HRT::HRTPeriod() * 1e6 / nOfCycles;
+    double bankTime = bankTicks * HRT::HRTPeriod() * 1e6 / nOfCycles;
+    printf("PID: %d channels, %d cycles\n", nOfChannels, nOfCycles);
+    printf("  PIDGAM      %10.2f us per cycle\n", pidTime);
+    printf("  PIDBankGAM  %10.2f us per cycle\n", bankTime);
+    printf("  mismatches  %d\n", mismatches);
+
+    for(int32 i = 0; i < nOfChannels; i++){
+        delete pids[i];
+    }
+    delete [] pids;
+    delete [] pidInputs;
+    delete [] pidOutputs;
+
+    return (mismatches == 0) ? 0 : -1;
+}
@@ -0,0 +1,302 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Compares the matrix x vector products used by the state space models on
+ * random matrices of several sizes and densities:
+ * - the row by row scalar loop (the previous RTMVProduct implementation)
+ * - the blocked vectorised RTMVProduct (SSMOptimisedMatrix WHOLE)
+ * - the compressed sparse rows (SSMOptimisedMatrix SPARSE)
+ * - the same RTMVProduct on doubles
+ * and the four separate products of a model (F, G, H and D) against the single
+ * product of the stacked matrix (FusedProduct = ON).
+ * The times are in microseconds per product, the errors relative to the
+ * sum of the absolute values of the products of each row (computed in double).
+ * Usage: SSMBenchmark.ex [maximumSize]
+ * @return 0 if all the products are within the accepted error
+ */
+
+#include "System.h"
+#include "HRT.h"
+#include "Matrix.h"
+#include "SSMOptimisedMatrix.h"
+
+/** Accepted relative error of the float products */
+#define ACCEPTED_ERROR_F    1e-5
+
+/** Accepted relative error of the double products */
+#define ACCEPTED_ERROR_D    1e-13
+
+/** Number of multiply-adds timed for each case */
+#define TIMED_OPERATIONS    20000000.0
+
+static uint32 seed = 12345;
+
+/** Uniform in [-1, 1) */
+static double Random(){
+    seed = seed * 1664525 + 1013904223;
+    return (seed >> 8) / 8388608.0 - 1.0;
+}
+
+/** Fills a nRows x nColumns matrix with a fraction density of non zero elements */
+static void RandomMatrix(float *data, int nRows, int nColumns, double density){
+    for(int i = 0; i < nRows * nColumns; i++){
+        data[i] = 0.0;
+        if((Random() + 1.0) * 0.5 < density) data[i] = Random();
+    }
+}
+
+/** The row by row loop of the previous RTMVProduct */
+template <class T>
+static void ScalarProduct(const T *mat, int nRows, int nColumns, const T *input, T *output){
+    for(int i = 0; i < nRows; i++){
+        T res = 0.0;
+        for(int j = 0; j < nColumns; j++) res += input[j] * *mat++;
+        output[i] = res;
+    }
+}
+
+/** The largest error of output against mat x input computed in double */
+template <class T>
+static double Error(const T *mat, int nRows, int nColumns, const T *input, const T *output){
+    double worst = 0.0;
+    for(int i = 0; i < nRows; i++){
+        double sum  = 0.0;
+        double norm = 0.0;
+        for(int j = 0; j < nColumns; j++){
+            double p = (double)mat[i * nColumns + j] * (double)input[j];
+            sum  += p;
+            norm += fabs(p);
+        }
+        if(norm == 0.0) norm = 1.0;
+        double error = fabs(output[i] - sum) / norm;
+        if(error > worst) worst = error;
+    }
+    return worst;
+}
+
+static int32 Cycles(int nRows, int nColumns){
+    int32 cycles = (int32)(TIMED_OPERATIONS / ((double)nRows * nColumns));
+    return (cycles < 10) ? 10 : cycles;
+}
+
+static double Microseconds(int64 ticks, int32 cycles){
+    return ticks * HRT::HRTPeriod() * 1e6 / cycles;
+}
+
+static const char *TypeName(int type){
+    switch(type){
+        case EMPTY:    return "EMPTY";
+        case IDENTITY: return "IDENTITY";
+        case DIAGONAL: return "DIAGONAL";
+        case WHOLE:    return "WHOLE";
+        case SPARSE:   return "SPARSE";
+    }
+    return "NOTINIT";
+}
+
+/** Times the products of a n x n matrix. @return False if an error is above the accepted one */
+static bool BenchmarkProducts(int n, double density){
+    float  *data    = (float *)malloc(sizeof(float) * n * n);
+    float  *input   = (float *)malloc(sizeof(float) * n);
+    float  *output  = (float *)malloc(sizeof(float) * n);
+    double *dataD   = (double *)malloc(sizeof(double) * n * n);
+    double *inputD  = (double *)malloc(sizeof(double) * n);
+    double *outputD = (double *)malloc(sizeof(double) * n);
+    int i;
+
+    RandomMatrix(data, n, n, density);
+    for(i = 0; i < n; i++) input[i] = Random();
+    for(i = 0; i < n * n; i++) dataD[i] = data[i];
+    for(i = 0; i < n; i++) inputD[i] = input[i];
+
+    SSMOptimisedMatrix dense;
+    SSMOptimisedMatrix sparse;
+    SSMOptimisedMatrix automatic;
+    dense.Init(n, n, data, 0.0);
+    sparse.Init(n, n, data, 1.1);
+    automatic.Init(n, n, data);
+
+    MatrixD matD(n, n);
+    for(i = 0; i < n * n; i++) matD.data[i] = dataD[i];
+
+    int32 cycles = Cycles(n, n);
+    int32 c;
+    int64 start;
+
+    start = HRT::HRTCounter();
+    for(c = 0; c < cycles; c++) ScalarProduct(data, n, n, input, output);
+    double scalarTime  = Microseconds(HRT::HRTCounter() - start, cycles);
+    double scalarError = Error(data, n, n, input, output);
+
+    start = HRT::HRTCounter();
+    for(c = 0; c < cycles; c++) dense.Product(input, output);
+    double denseTime  = Microseconds(HRT::HRTCounter() - start, cycles);
+    double denseError = Error(data, n, n, input, output);
+
+    start = HRT::HRTCounter();
+    for(c = 0; c < cycles; c++) sparse.Product(input, output);
+    double sparseTime  = Microseconds(HRT::HRTCounter() - start, cycles);
+    double sparseError = Error(data, n, n, input, output);
+
+    start = HRT::HRTCounter();
+    for(c = 0; c < cycles; c++) ScalarProduct(dataD, n, n, inputD, outputD);
+    double scalarTimeD = Microseconds(HRT::HRTCounter() - start, cycles);
+
+    start = HRT::HRTCounter();
+    for(c = 0; c < cycles; c++) RTMVProduct_U(matD, inputD, outputD);
+    double denseTimeD  = Microseconds(HRT::HRTCounter() - start, cycles);
+    double denseErrorD = Error(dataD, n, n, inputD, outputD);
+
+    printf("%5d %6.2f %10.2f %10.2f %10.2f %-8s %10.2f %10.2f %9.1e %9.1e %9.1e %9.1e\n",
+           n, density, scalarTime, denseTime, sparseTime, TypeName(automatic.Type()),
+           scalarTimeD, denseTimeD, scalarError, denseError, sparseError, denseErrorD);
+
+    free((void *&)data);
+    free((void *&)input);
+    free((void *&)output);
+    free((void *&)dataD);
+    free((void *&)inputD);
+    free((void *&)outputD);
+
+    return (denseError < ACCEPTED_ERROR_F) && (sparseError < ACCEPTED_ERROR_F) && (denseErrorD < ACCEPTED_ERROR_D);
+}
+
+/** Times a model with n states, n/4 inputs and n/4 outputs evaluated with
+    separate products and with the stacked matrix, as SSMGenericModel does.
+    @return False if the results differ more than the accepted error */
+static bool BenchmarkModel(int n, double density){
+    int nIn    = (n < 4) ? 1 : n / 4;
+    int nOut   = nIn;
+    int nRows  = n + nOut;
+    int nCols  = n + nIn;
+    float *f   = (float *)malloc(sizeof(float) * n * n);
+    float *g   = (float *)malloc(sizeof(float) * n * nIn);
+    float *h   = (float *)malloc(sizeof(float) * nOut * n);
+    float *d   = (float *)malloc(sizeof(float) * nOut * nIn);
+    float *all = (float *)malloc(sizeof(float) * nRows * nCols);
+    float *x   = (float *)malloc(sizeof(float) * nCols);
+    float *y   = (float *)malloc(sizeof(float) * nRows);
+    float *xu  = (float *)malloc(sizeof(float) * nCols);
+    float *yy  = (float *)malloc(sizeof(float) * nRows);
+    int i, j;
+
+    RandomMatrix(f, n,    n,   density);
+    RandomMatrix(g, n,    nIn, density);
+    RandomMatrix(h, nOut, n,   density);
+    RandomMatrix(d, nOut, nIn, density);
+    for(i = 0; i < nRows; i++){
+        for(j = 0; j < nCols; j++){
+            if(i < n) all[i * nCols + j] = (j < n) ? f[i * n + j]          : g[i * nIn + j - n];
+            else      all[i * nCols + j] = (j < n) ? h[(i - n) * n + j]    : d[(i - n) * nIn + j - n];
+        }
+    }
+    for(i = 0; i < nCols; i++) x[i] = Random();
+
+    SSMOptimisedMatrix mf, mg, mh, md, fused;
+    mf.Init(n, n, f);
+    mg.Init(n, nIn, g);
+    mh.Init(nOut, n, h);
+    md.Init(nOut, nIn, d);
+    fused.Init(nRows, nCols, all);
+
+    int32 cycles = Cycles(nRows, nCols);
+    int32 c;
+    int64 start;
+
+    start = HRT::HRTCounter();
+    for(c = 0; c < cycles; c++){
+        mf.Product(x, y);
+        mg.Product_Acc(x + n, y);
+        mh.Product(x, y + n);
+        md.Product_Acc(x + n, y + n);
+    }
+    double separateTime  = Microseconds(HRT::HRTCounter() - start, cycles);
+    double separateError = Error(all, nRows, nCols, x, y);
+
+    start = HRT::HRTCounter();
+    for(c = 0; c < cycles; c++){
+        for(i = 0; i < nCols; i++) xu[i] = x[i];
+        fused.Product(xu, yy);
+        for(i = 0; i < nRows; i++) y[i] = yy[i];
+    }
+    double fusedTime  = Microseconds(HRT::HRTCounter() - start, cycles);
+    double fusedError = Error(all, nRows, nCols, x, y);
+
+    printf("%5d %6.2f %10.2f %10.2f %-8s %9.1e %9.1e\n",
+           n, density, separateTime, fusedTime, TypeName(fused.Type()), separateError, fusedError);
+
+    free((void *&)f);
+    free((void *&)g);
+    free((void *&)h);
+    free((void *&)d);
+    free((void *&)all);
+    free((void *&)x);
+    free((void *&)y);
+    free((void *&)xu);
+    free((void *&)yy);
+
+    return (separateError < ACCEPTED_ERROR_F) && (fusedError < ACCEPTED_ERROR_F);
+}
+
+int main(int argc, char **argv){
+    int maximumSize = 1024;
+    if(argc > 1){
+        maximumSize = atoi(argv[1]);
+    }
+    if(maximumSize < 1){
+        printf("Usage: SSMBenchmark.ex [maximumSize]\n");
+        return -1;
+    }
+
+    static const int    sizes[]     = {8, 32, 128, 512, 1024, 2048};
+    static const double densities[] = {1.0, 0.3, 0.1, 0.03, 0.01};
+    const int nOfSizes     = sizeof(sizes) / sizeof(sizes[0]);
+    const int nOfDensities = sizeof(densities) / sizeof(densities[0]);
+    bool ok = True;
+    int i, j;
+
+    printf("Matrix x vector, us per product (float unless _D)\n");
+    printf("%5s %6s %10s %10s %10s %-8s %10s %10s %9s %9s %9s %9s\n", "size", "dens", "scalar", "blocked", "sparse", "auto",
+           "scalar_D", "blocked_D", "err_sc", "err_bl", "err_sp", "err_bl_D");
+    for(i = 0; i < nOfSizes; i++){
+        if(sizes[i] > maximumSize) break;
+        for(j = 0; j < nOfDensities; j++){
+            if(!BenchmarkProducts(sizes[i], densities[j])) ok = False;
+        }
+    }
+
+    printf("\nModel with size states, size/4 inputs and size/4 outputs, us per step\n");
+    printf("%5s %6s %10s %10s %-8s %9s %9s\n", "size", "dens", "separate", "fused", "fused", "err_sep", "err_fus");
+    for(i = 0; i < nOfSizes; i++){
+        if(sizes[i] > maximumSize) break;
+        for(j = 0; j < nOfDensities; j++){
+            if(!BenchmarkModel(sizes[i], densities[j])) ok = False;
+        }
+    }
+
+    if(!ok) printf("\nSome products are outside the accepted error\n");
+    return ok ? 0 : 1;
+}
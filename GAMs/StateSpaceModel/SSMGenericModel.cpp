@@ -32,6 +32,11 @@ SSMGenericModel::SSMGenericModel(){
     oldState       = NULL;
     stateDDB       = NULL;
     stateDim       = 0;
+    inputDim       = 0;
+    fusedOutputDim = 0;
+    fusedProduct   = False;
+    fusedInput     = NULL;
+    fusedOutput    = NULL;
     saveStateOnDDB = False;
 }
 
@@ -44,14 +49,22 @@ SSMGenericModel::~SSMGenericModel(){
 void SSMGenericModel::CleanUp(){
     if( state    != NULL ) free((void*&)state);
     if( oldState != NULL ) free((void*&)oldState);
+    if( fusedInput  != NULL ) free((void*&)fusedInput);
+    if( fusedOutput != NULL ) free((void*&)fusedOutput);
     state          = NULL;
     oldState       = NULL;
+    fusedInput     = NULL;
+    fusedOutput    = NULL;
     stateDim       = 0;
+    inputDim       = 0;
+    fusedOutputDim = 0;
+    fusedProduct   = False;
     saveStateOnDDB = False;
     stateFromState.CleanUp();
     stateFromInput.CleanUp();
     outputFromState.CleanUp();
     outputFromInput.CleanUp();
+    fusedMatrix.CleanUp();
     initialInput.CleanUp();
     initialOutput.CleanUp();
     stateInitGuess.CleanUp();
@@ -74,6 +87,17 @@ bool SSMGenericModel::LoadModel(ConfigurationDataBase &cdb, GAM &gam, int inputD
         return False;
     }
 
+    this->inputDim = inputDim;
+
+    // Matrices with a lower fraction of non zero elements are multiplied in sparse format
+    float sparseDensity = SSM_SPARSE_DENSITY;
+    cdblocal.ReadFloat(sparseDensity,"SparseDensity",SSM_SPARSE_DENSITY);
+
+    // Evaluates the model with a single product of the stacked matrices
+    FString fused;
+    cdblocal.ReadFString(fused,"FusedProduct","OFF");
+    fusedProduct = (fused == "ON");
+
     /// Load StateMap
     stateDim = 0;
 
@@ -100,7 +124,7 @@ bool SSMGenericModel::LoadModel(ConfigurationDataBase &cdb, GAM &gam, int inputD
     }
 
     if( cdblocal->Exists("StateFromState") ){
-        if( !stateFromState.Load(cdblocal,"StateFromState") ){
+        if( !stateFromState.Load(cdblocal,"StateFromState",sparseDensity) ){
             CStaticAssertErrorCondition(InitialisationError,"SSMGenericModel::LoadModel error loading StateFromState");
             return False;
         }
@@ -116,7 +140,7 @@ bool SSMGenericModel::LoadModel(ConfigurationDataBase &cdb, GAM &gam, int inputD
     }
 
     if( cdblocal->Exists("StateFromInput") ){
-        if( !stateFromInput.Load(cdblocal,"StateFromInput") ){
+        if( !stateFromInput.Load(cdblocal,"StateFromInput",sparseDensity) ){
             CStaticAssertErrorCondition(InitialisationError,"SSMGenericModel::LoadModel error loading StateFromInput");
             return False;
         }
@@ -128,7 +152,7 @@ bool SSMGenericModel::LoadModel(ConfigurationDataBase &cdb, GAM &gam, int inputD
     }
 
     if( cdblocal->Exists("OutputFromState") ){
-        if( !outputFromState.Load(cdblocal,"OutputFromState") ){
+        if( !outputFromState.Load(cdblocal,"OutputFromState",sparseDensity) ){
             CStaticAssertErrorCondition(InitialisationError,"SSMGenericModelClass::LoadModel error loading OutputFromState");
             return False;
         }
@@ -140,7 +164,7 @@ bool SSMGenericModel::LoadModel(ConfigurationDataBase &cdb, GAM &gam, int inputD
     }
 
     if( cdblocal->Exists("OutputFromInput") ){
-        if( !outputFromInput.Load(cdblocal,"OutputFromInput") ){
+        if( !outputFromInput.Load(cdblocal,"OutputFromInput",sparseDensity) ){
             CStaticAssertErrorCondition(InitialisationError,"SSMGenericModel::LoadModel error loading OutputFromInput");
             return False;
         }
@@ -195,9 +219,57 @@ bool SSMGenericModel::LoadModel(ConfigurationDataBase &cdb, GAM &gam, int inputD
         }
     }
 
+    if( fusedProduct ){
+        // Without F the separate products accumulate G u(t) on the previous
+        // state, and without H the output D u(t) on the previous output
+        if( (stateFromState.NRows() == 0) || ((outputFromInput.NRows() != 0) && (outputFromState.NRows() == 0)) ){
+            CStaticAssertErrorCondition(Warning,"SSMGenericModel::LoadModel FusedProduct requires StateFromState and OutputFromState: using the separate products");
+            fusedProduct = False;
+        }else if( !BuildFusedMatrix(sparseDensity) ){
+            CStaticAssertErrorCondition(InitialisationError,"SSMGenericModel::LoadModel error building the fused matrix");
+            return False;
+        }
+    }
+
     return True;
 }
 
+///
+bool SSMGenericModel::BuildFusedMatrix(float sparseDensity){
+
+    fusedOutputDim = outputFromState.NRows();
+
+    int nRows    = stateDim + fusedOutputDim;
+    int nColumns = stateDim + inputDim;
+
+    fusedInput  = (float*)malloc(sizeof(float)*nColumns);
+    fusedOutput = (float*)malloc(sizeof(float)*nRows);
+    float *data = (float*)malloc(sizeof(float)*nRows*nColumns);
+    if( (fusedInput == NULL) || (fusedOutput == NULL) || (data == NULL) ){
+        CStaticAssertErrorCondition(InitialisationError,"SSMGenericModel::BuildFusedMatrix error allocating %i x %i matrix",nRows,nColumns);
+        if( data != NULL ) free((void*&)data);
+        return False;
+    }
+
+    for( int i = 0; i < nRows; i++ ){
+        float *row = data + i*nColumns;
+        for( int j = 0; j < nColumns; j++ ){
+            if( i < stateDim ){
+                if( j < stateDim ) row[j] = stateFromState.Element(i,j);
+                else               row[j] = stateFromInput.Element(i,j-stateDim);
+            }else{
+                if( j < stateDim ) row[j] = outputFromState.Element(i-stateDim,j);
+                else               row[j] = outputFromInput.Element(i-stateDim,j-stateDim);
+            }
+        }
+    }
+
+    bool ret = fusedMatrix.Init(nRows,nColumns,data,sparseDensity);
+    free((void*&)data);
+
+    return ret;
+}
+
 
 bool SSMGenericModel::Execute(float *input, float *output, int execFlag){
     if( execFlag == INITEXECUTE ){
@@ -229,36 +301,57 @@ bool SSMGenericModel::Execute(float *input, float *output, int execFlag){
 
         if( saveStateOnDDB ) state = (float*)stateDDB->Buffer();
 
-        /// Update status
-        if( stateFromState.NRows() != 0 ){
-            if( !stateFromState.Product(oldState,state) ){
-                CStaticAssertErrorCondition(FatalError,"SSMGenericModel::Execute run-time error State/State");
+        if( fusedProduct ){
+
+            int i;
+            for( i = 0; i < stateDim; i++ ) fusedInput[i]          = oldState[i];
+            for( i = 0; i < inputDim; i++ ) fusedInput[stateDim+i] = input[i];
+
+            /// Update status and outputs
+            if( !fusedMatrix.Product(fusedInput,fusedOutput) ){
+                CStaticAssertErrorCondition(FatalError,"SSMGenericModel::Execute run-time error fused product");
                 return False;
             }
-        }
 
-        if( stateFromInput.NRows() != 0 ){
-            if( !stateFromInput.Product_Acc(input,state) ){
-                CStaticAssertErrorCondition(FatalError,"SSMGenericModel::Execute run-time error State/Input");
-                return False;
+            for( i = 0; i < stateDim; i++ )       state[i]  = fusedOutput[i];
+            for( i = 0; i < fusedOutputDim; i++ ) output[i] = fusedOutput[stateDim+i];
+
+            // Offset on states (optional)
+            if( !offsetState.Update(state,ADD) ) return False;
+
+        }else{
+
+            /// Update status
+            if( stateFromState.NRows() != 0 ){
+                if( !stateFromState.Product(oldState,state) ){
+                    CStaticAssertErrorCondition(FatalError,"SSMGenericModel::Execute run-time error State/State");
+                    return False;
+                }
+            }
+
+            if( stateFromInput.NRows() != 0 ){
+                if( !stateFromInput.Product_Acc(input,state) ){
+                    CStaticAssertErrorCondition(FatalError,"SSMGenericModel::Execute run-time error State/Input");
+                    return False;
+                }
             }
-        }
 
-        // Offset on states (optional)
-        if( !offsetState.Update(state,ADD) ) return False;
+            // Offset on states (optional)
+            if( !offsetState.Update(state,ADD) ) return False;
 
-        /// Update outputs
-        if( outputFromState.NRows() != 0 ){
-            if( !outputFromState.Product(oldState,output) ){
-                CStaticAssertErrorCondition(FatalError,"SSMGenericModel::Execute run-time error Output/State");
-                return False;
+            /// Update outputs
+            if( outputFromState.NRows() != 0 ){
+                if( !outputFromState.Product(oldState,output) ){
+                    CStaticAssertErrorCondition(FatalError,"SSMGenericModel::Execute run-time error Output/State");
+                    return False;
+                }
             }
-        }
 
-        if( outputFromInput.NRows() != 0 ){
-            if( !outputFromInput.Product_Acc(input,output) ){
-                CStaticAssertErrorCondition(FatalError,"SSMGenericModel::Execute run-time error Output/Input");
-                return False;
+            if( outputFromInput.NRows() != 0 ){
+                if( !outputFromInput.Product_Acc(input,output) ){
+                    CStaticAssertErrorCondition(FatalError,"SSMGenericModel::Execute run-time error Output/Input");
+                    return False;
+                }
             }
         }
 
@@ -89,6 +89,30 @@ private:
     /** Number of status. */
     int                         stateDim;
 
+    /** Number of inputs. */
+    int                         inputDim;
+
+    /** Number of outputs computed by the fused product (0 if H and D are not defined). */
+    int                         fusedOutputDim;
+
+    /** If True the model is evaluated with the single product fusedMatrix. */
+    bool                        fusedProduct;
+
+    /**
+        The matrices stacked in one
+
+        | x(t+1) |   | F G | | x(t) |
+        |  y(t)  | = | H D | | u(t) |
+
+    */
+    SSMOptimisedMatrix          fusedMatrix;
+
+    /** [x(t); u(t)] */
+    float                       *fusedInput;
+
+    /** [x(t+1); y(t)] */
+    float                       *fusedOutput;
+
     /** Start time. */
     float                       tstart;
 
@@ -112,5 +136,8 @@ public:
 private:
     /** */
     void CleanUp();
+
+    /** Builds fusedMatrix from F, G, H and D. */
+    bool BuildFusedMatrix(float sparseDensity);
 };
 #endif
@@ -26,16 +26,32 @@
 
 ///
 SSMOptimisedMatrix::SSMOptimisedMatrix(){
-    type = NOTINIT;
+    type            = NOTINIT;
+    numberOfRows    = 0;
+    numberOfColumns = 0;
+    sparseValues    = NULL;
+    sparseColumns   = NULL;
+    sparseRowStart  = NULL;
 }
 
 ///
 SSMOptimisedMatrix::~SSMOptimisedMatrix(){
+    CleanUpSparse();
+}
+
+///
+void SSMOptimisedMatrix::CleanUpSparse(){
+    if( sparseValues   != NULL ) free((void*&)sparseValues);
+    if( sparseColumns  != NULL ) free((void*&)sparseColumns);
+    if( sparseRowStart != NULL ) free((void*&)sparseRowStart);
+    sparseValues   = NULL;
+    sparseColumns  = NULL;
+    sparseRowStart = NULL;
 }
 
 
 ///
-bool SSMOptimisedMatrix::Init(int nRow, int nColumn, float *data){
+bool SSMOptimisedMatrix::Init(int nRow, int nColumn, float *data, float sparseDensity){
 
     if( nRow == 0 || nColumn == 0 ){
         CStaticAssertErrorCondition(InitialisationError,"SSMOptimisedMatrix::Init error on the matrix dimensions [%d,%d]",nRow,nColumn);
@@ -54,13 +70,13 @@ bool SSMOptimisedMatrix::Init(int nRow, int nColumn, float *data){
     numberOfRows    = mat.NRows();
     numberOfColumns = mat.NColumns();
 
-    AnalisedMatrix();
+    AnalisedMatrix(sparseDensity);
 
     return True;
 }
 
 ///
-bool SSMOptimisedMatrix::Load(ConfigurationDataBase &cdb, char *entryName){
+bool SSMOptimisedMatrix::Load(ConfigurationDataBase &cdb, char *entryName, float sparseDensity){
 
     CDBExtended cdblocal(cdb);
 
@@ -94,11 +110,22 @@ bool SSMOptimisedMatrix::Load(ConfigurationDataBase &cdb, char *entryName){
     numberOfRows    = mat.NRows();
     numberOfColumns = mat.NColumns();
 
-    AnalisedMatrix();
+    AnalisedMatrix(sparseDensity);
 
     return True;
 }
 
+///
+float SSMOptimisedMatrix::Element(int row, int column){
+    if( (row < 0) || (row >= numberOfRows) || (column < 0) || (column >= numberOfColumns) ) return 0.0;
+    switch( type ){
+        case IDENTITY:
+        case DIAGONAL: return (row == column) ? mat.data[row] : 0.0;
+        case NOTINIT:  return 0.0;
+        default:       return mat[row][column];
+    }
+}
+
 
 ///
 bool SSMOptimisedMatrix::Product_Private(float *input, float *output, bool accumulate){
@@ -110,6 +137,15 @@ bool SSMOptimisedMatrix::Product_Private(float *input, float *output, bool accum
             else             RTMVProduct_U(mat,input,output);
         }break;
 
+        case SPARSE:{
+            for( int i = 0; i < numberOfRows; i++ ){
+                float sum = 0.0;
+                for( int k = sparseRowStart[i]; k < sparseRowStart[i+1]; k++ ) sum += sparseValues[k]*input[sparseColumns[k]];
+                if( accumulate ) output[i] += sum;
+                else             output[i]  = sum;
+            }
+        }break;
+
         case NOTINIT:{
             CStaticAssertErrorCondition(InitialisationError,"SSMOptimisedMatrix::Product_Private matrix has been not initialised");
             return False;
@@ -139,10 +175,12 @@ bool SSMOptimisedMatrix::Product_Private(float *input, float *output, bool accum
 }
 
 ///
-void SSMOptimisedMatrix::AnalisedMatrix(){
+void SSMOptimisedMatrix::AnalisedMatrix(float sparseDensity){
 
     int i,j;
 
+    CleanUpSparse();
+
     bool isIdentity = True;
     bool isDiagonal = True;
     bool isNull     = True;
@@ -196,6 +234,45 @@ void SSMOptimisedMatrix::AnalisedMatrix(){
         // The Product function will do nothing
         type = EMPTY;
 
-    }else type = WHOLE;
+    }else{
+
+        type = WHOLE;
 
+        // The product on a few non zero elements is faster in CSR format than
+        // the dense vectorised one
+        int nonZeros = 0;
+        for( i = 0; i < mat.NRows()*mat.NColumns(); i++ ) if( mat.data[i] != 0 ) nonZeros++;
+        if( nonZeros < sparseDensity*mat.NRows()*mat.NColumns() ){
+            if( BuildSparse(nonZeros) ) type = SPARSE;
+        }
+    }
+
+}
+
+///
+bool SSMOptimisedMatrix::BuildSparse(int nonZeros){
+
+    sparseValues   = (float*)malloc(sizeof(float)*(nonZeros > 0 ? nonZeros : 1));
+    sparseColumns  = (int*)malloc(sizeof(int)*(nonZeros > 0 ? nonZeros : 1));
+    sparseRowStart = (int*)malloc(sizeof(int)*(mat.NRows()+1));
+    if( (sparseValues == NULL) || (sparseColumns == NULL) || (sparseRowStart == NULL) ){
+        CStaticAssertErrorCondition(Warning,"SSMOptimisedMatrix::BuildSparse error allocating %i elements, using the dense product",nonZeros);
+        CleanUpSparse();
+        return False;
+    }
+
+    int k = 0;
+    for( int i = 0; i < mat.NRows(); i++ ){
+        sparseRowStart[i] = k;
+        for( int j = 0; j < mat.NColumns(); j++ ){
+            if( mat[i][j] != 0 ){
+                sparseValues[k]  = mat[i][j];
+                sparseColumns[k] = j;
+                k++;
+            }
+        }
+    }
+    sparseRowStart[mat.NRows()] = k;
+
+    return True;
 }
@@ -34,6 +34,11 @@
 #define IDENTITY         1
 #define DIAGONAL         2
 #define WHOLE            3
+#define SPARSE           4
+
+/** A WHOLE matrix with a fraction of non zero elements below this value is
+    stored in the compressed sparse row format */
+#define SSM_SPARSE_DENSITY  0.1
 
 class SSMOptimisedMatrix {
 
@@ -42,9 +47,18 @@ public:
     /** Matrix. */
     MatrixF     mat;
 
-    /** Type of the matrix EMPTY, IDENTITY, DIAGONAL or WHOLE. */
+    /** Type of the matrix EMPTY, IDENTITY, DIAGONAL, WHOLE or SPARSE. */
     int         type;
 
+    /** Non zero elements of a SPARSE matrix, row by row. */
+    float       *sparseValues;
+
+    /** Column of each non zero element of a SPARSE matrix. */
+    int         *sparseColumns;
+
+    /** Index in sparseValues of the first element of each row (numberOfRows + 1 entries). */
+    int         *sparseRowStart;
+
     /** Real number of rows. */
     int         numberOfRows;
 
@@ -59,11 +73,13 @@ public:
     /** */
     ~SSMOptimisedMatrix();
 
-    /** Initialised matrix by an input vector. */
-    bool Init(int nRow, int nColumn, float *data);
+    /** Initialised matrix by an input vector.
+        A matrix whose density is below sparseDensity is stored as SPARSE. */
+    bool Init(int nRow, int nColumn, float *data, float sparseDensity = SSM_SPARSE_DENSITY);
 
-    /** Initialised matrix by CDB. */
-    bool Load(ConfigurationDataBase &cdb, char *entryName);
+    /** Initialised matrix by CDB.
+        A matrix whose density is below sparseDensity is stored as SPARSE. */
+    bool Load(ConfigurationDataBase &cdb, char *entryName, float sparseDensity = SSM_SPARSE_DENSITY);
 
     /** Product output = Matrix x input. */
     inline bool Product(float *input, float *output){
@@ -81,10 +97,19 @@ public:
     /** Return the number of the columns. */
     inline int NColumns(){ return numberOfColumns; }
 
+    /** Return the type of the matrix. */
+    inline int Type(){ return type; }
+
+    /** Element (row,column) of the matrix, whatever its type. */
+    float Element(int row, int column);
+
     /** Clean up the class parameters. */
     inline void CleanUp(){
         mat.ReSize(0,0);
-        type = NOTINIT;
+        type            = NOTINIT;
+        numberOfRows    = 0;
+        numberOfColumns = 0;
+        CleanUpSparse();
     }
 
 private:
@@ -93,7 +118,13 @@ private:
     bool Product_Private(float *input, float *output, bool accumulate);
 
     /** Analisys of the matrix type. */
-    void AnalisedMatrix();
+    void AnalisedMatrix(float sparseDensity);
+
+    /** Builds the compressed sparse row arrays from mat. */
+    bool BuildSparse(int nonZeros);
+
+    /** Frees the compressed sparse row arrays. */
+    void CleanUpSparse();
 };
 
 #endif
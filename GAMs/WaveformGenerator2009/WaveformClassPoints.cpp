@@ -31,6 +31,7 @@ WaveformClassPoints::WaveformClassPoints(){
     values         = NULL;
     numberOfValues = 0;
     closestEnable  = False;
+    cursor         = 0;
 }
 
 ///
@@ -41,6 +42,37 @@ WaveformClassPoints::~WaveformClassPoints(){
     values   = NULL;
 }
 
+/// Number of points walked forward from the cursor before the binary search
+#define WFP_CURSOR_WALK 4
+
+///
+int32 WaveformClassPoints::UpperBound(int32 timeRef){
+
+    int32 low  = 0;
+    int32 high = numberOfValues;
+
+    if( cursor == 0 || timeBase[cursor-1] <= timeRef ){
+        // Time moved forward: the answer is usually the cursor or one of the next points
+        int32 limit = cursor + WFP_CURSOR_WALK;
+        if( limit > numberOfValues ) limit = numberOfValues;
+        while( cursor < limit && timeBase[cursor] <= timeRef ) cursor++;
+        if( cursor == numberOfValues || timeBase[cursor] > timeRef ) return cursor;
+        low = cursor + 1;
+    }else{
+        // Time moved back
+        high = cursor - 1;
+    }
+
+    while( low < high ){
+        int32 middle = low + (high - low) / 2;
+        if( timeBase[middle] <= timeRef ) low  = middle + 1;
+        else                              high = middle;
+    }
+    cursor = low;
+
+    return cursor;
+}
+
 ///
 float WaveformClassPoints::GetValue(int32 usecTime){
 
@@ -64,8 +96,7 @@ float WaveformClassPoints::GetValue(int32 usecTime){
             timeRef = (int32)round(localPhase*actFrequency*1000000);
         }
 
-        int k = 0;
-        while( timeBase[k] <= timeRef && k < numberOfValues ) k++;
+        int k = UpperBound(timeRef);
 
         if( k == 0 ) return 0.0;
 
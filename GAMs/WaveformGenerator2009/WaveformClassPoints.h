@@ -47,6 +47,15 @@ private:
     /** */
     bool          closestEnable;
 
+    /** Index of the first point after the time of the last sample.
+        The next search starts from here */
+    int32         cursor;
+
+    /** The index of the first point whose time is greater than timeRef.
+        Walks forward from the cursor and falls back to a binary search
+        when the time jumps or goes back (e.g. at the start of a period) */
+    int32 UpperBound(int32 timeRef);
+
 public:
 
     /** */
@@ -59,6 +68,9 @@ public:
     WaveformClassPoints(const WaveformClassPoints &wave) : WaveformPeriodicClass(wave) {
         this->numberOfValues = wave.numberOfValues;
         this->closestEnable  = wave.closestEnable;
+        this->cursor         = 0;
+        this->timeBase       = NULL;
+        this->values         = NULL;
         if( wave.numberOfValues <= 0 || wave.timeBase == NULL || wave.values == NULL ){
             AssertErrorCondition(InitialisationError,"WaveformClassPoints %s::Copy constructor: input data incorrect", Name());
             return;
@@ -83,6 +95,12 @@ public:
     /** */
     virtual float GetValue(int32 usecTime);
 
+    /** */
+    virtual void Reset(){
+        WaveformPeriodicClass::Reset();
+        cursor = 0;
+    }
+
     /** */
     virtual bool ProcessHttpMessage(HttpStream &hStream);
 
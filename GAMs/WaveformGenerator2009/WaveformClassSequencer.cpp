@@ -113,6 +113,54 @@ bool WaveformClassSequencer::ObjectLoadSetup(ConfigurationDataBase &cdbData, Str
     return True;
 }
 
+///
+int32 WaveformClassSequencer::FindWindow(int32 usecTime) {
+
+    // Rows of [start, end]
+    int32 *windows = timeWindowsUsecTime.data;
+
+    int32 low   = 0;
+    int32 high  = numberOfWaveforms;
+    int32 index = currentWaveformIndex;
+    if( index >= numberOfWaveforms ) index = numberOfWaveforms - 1;
+
+    // Look for the first window starting after usecTime
+    if( usecTime >= windows[2*index] ){
+        // Time moved forward: usually the same or the next window
+        if( index + 1 == numberOfWaveforms || usecTime < windows[2*(index+1)] ){
+            low = index + 1;
+            high = low;
+        }else if( index + 2 == numberOfWaveforms || usecTime < windows[2*(index+2)] ){
+            low = index + 2;
+            high = low;
+        }else{
+            low = index + 3;
+        }
+    }else{
+        // Time moved back
+        high = index;
+    }
+
+    while( low < high ){
+        int32 middle = low + (high - low) / 2;
+        if( windows[2*middle] <= usecTime ) low  = middle + 1;
+        else                                high = middle;
+    }
+
+    // Before the first window
+    if( low == 0 ){
+        currentWaveformIndex = 0;
+        return -1;
+    }
+
+    currentWaveformIndex = low - 1;
+
+    // Between two windows
+    if( usecTime >= windows[2*currentWaveformIndex+1] ) return -1;
+
+    return currentWaveformIndex;
+}
+
 ///
 float WaveformClassSequencer::GetValue(int32 usecTime) {
 
@@ -120,23 +168,10 @@ float WaveformClassSequencer::GetValue(int32 usecTime) {
 
     if( usecTime < 0.0 ) return 0.0;
 
-    if( currentWaveformIndex == numberOfWaveforms ) return 0.0;
-
-    if( usecTime >= timeWindowsUsecTime[currentWaveformIndex][0] ){
-        if( usecTime < timeWindowsUsecTime[currentWaveformIndex][1] ){
-            return waveforms[currentWaveformIndex]->GetValue(usecTime) * gain + offsetValue;
-        }else{
-            currentWaveformIndex++;
-            if( currentWaveformIndex == numberOfWaveforms ) return 0.0;
-            if( usecTime >= timeWindowsUsecTime[currentWaveformIndex][0] ){
-                if( usecTime < timeWindowsUsecTime[currentWaveformIndex][1] ){
-                    return waveforms[currentWaveformIndex]->GetValue(usecTime) * gain + offsetValue;
-                }
-            }
-        }
-    }
+    int32 index = FindWindow(usecTime);
+    if( index < 0 ) return 0.0;
 
-    return 0.0;
+    return waveforms[index]->GetValue(usecTime) * gain + offsetValue;
 }
 
 ///
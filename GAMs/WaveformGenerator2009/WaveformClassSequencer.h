@@ -44,9 +44,12 @@ private:
     /** */
     GCRTemplate<WaveformInterface>*       waveforms;
 
-    /** */
+    /** Window of the last sample. The next search starts from here */
     int32                                 currentWaveformIndex;
 
+    /** The index of the window containing usecTime, -1 if none */
+    int32 FindWindow(int32 usecTime);
+
 public:
 
     /** */
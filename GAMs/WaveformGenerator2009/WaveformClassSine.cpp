@@ -24,9 +24,51 @@
 
 #include "WaveformClassSine.h"
 
+/** 2*pi in double precision */
+#define WFS_2PI                 6.283185307179586
+
+/** Number of intervals of the sine table */
+#define WFS_TABLE_SIZE          4096
+
+/** Number of rotations of the oscillator between two exact evaluations */
+#define WFS_OSCILLATOR_RESYNC   4096
+
+/** One period of the sine, plus the first point repeated for the interpolation */
+static float sineTable[WFS_TABLE_SIZE+1];
+
+/** */
+static bool  sineTableReady = False;
+
+/** Sine of 2*pi*cycles by linear interpolation of the table (error below 3e-7) */
+static inline float SineTable(double cycles){
+    double position = (cycles - floor(cycles)) * WFS_TABLE_SIZE;
+    int32  index    = (int32)position;
+    if( index >= WFS_TABLE_SIZE ) index = WFS_TABLE_SIZE - 1;
+    float  fraction = (float)(position - index);
+    return sineTable[index] + (sineTable[index+1] - sineTable[index]) * fraction;
+}
+
 ///
 WaveformClassSine::WaveformClassSine(){
-    sweepingSet = True;
+    sweepingSet    = True;
+    fastOscillator = False;
+    oscPhase       = 0.0;
+    oscPhaseStep   = 0.0;
+    oscSin         = 0.0;
+    oscCos         = 1.0;
+    oscSinStep     = 0.0;
+    oscCosStep     = 1.0;
+    oscRotations   = 0;
+    oscLocked      = False;
+
+    if( !sineTableReady ){
+        int i;
+        for( i = 0; i < WFS_TABLE_SIZE; i++ ){
+            sineTable[i] = (float)sin((WFS_2PI * i) / WFS_TABLE_SIZE);
+        }
+        sineTable[WFS_TABLE_SIZE] = sineTable[0];
+        sineTableReady = True;
+    }
 }
 
 ///
@@ -53,6 +95,18 @@ bool WaveformClassSine::ObjectLoadSetup(ConfigurationDataBase &cdbData, StreamIn
 
     CStaticAssertErrorCondition(Information,"WaveformClassSine::Init Sweeping option = %s",sweep.Buffer());
 
+    // OFF (default): sin() of the float integrated frequency at every sample, as before.
+    // ON: sine table and, for a constant frequency sweep, a recurrence oscillator with a
+    // double precision phase. The output is not bit identical to OFF (table interpolation
+    // and the float phase drift of OFF), so it must be enabled per waveform
+    FString oscillator;
+    cdb.ReadFString(oscillator,"FastOscillator","OFF");
+
+    fastOscillator = False;
+    if( strcmp(oscillator.Buffer(),"ON") == 0 ) fastOscillator = True;
+
+    CStaticAssertErrorCondition(Information,"WaveformClassSine::Init FastOscillator option = %s",oscillator.Buffer());
+
     // 2pi is multiplied during run-time
     phase /= 360.0;
 
@@ -61,12 +115,72 @@ bool WaveformClassSine::ObjectLoadSetup(ConfigurationDataBase &cdbData, StreamIn
     return True;
 }
 
+///
+double WaveformClassSine::OscillatorSweep(int32 actTimeUsec, int32 lastUsecTime, float lastFrequency){
+
+    // Same integration as WaveformPeriodicClass::Execute, without the float rounding of integratedFrequency
+    double step = 0.0;
+    if( lastUsecTime == -1 ){
+        oscPhase = (double)frequency*(actTimeUsec-tStartUsecLocal)*1.0e-6 + phase;
+    }else if( actTimeUsec != lastUsecTime ){
+        step      = ((double)frequency+lastFrequency)*(actTimeUsec-lastUsecTime)*0.5e-6;
+        oscPhase += step;
+    }else{
+        // Sample already computed
+        if( oscLocked ) return oscSin;
+        return SineTable(oscPhase);
+    }
+    if( oscPhase >= 1.0 || oscPhase < 0.0 ) oscPhase -= floor(oscPhase);
+
+    if( oscLocked && step == oscPhaseStep ){
+        if( ++oscRotations < WFS_OSCILLATOR_RESYNC ){
+            double rotatedSin = oscSin*oscCosStep + oscCos*oscSinStep;
+            oscCos            = oscCos*oscCosStep - oscSin*oscSinStep;
+            oscSin            = rotatedSin;
+            return oscSin;
+        }
+        // Bound the rounding errors accumulated by the rotations
+        oscSin       = sin(WFS_2PI*oscPhase);
+        oscCos       = cos(WFS_2PI*oscPhase);
+        oscRotations = 0;
+        return oscSin;
+    }
+
+    if( step != 0.0 && step == oscPhaseStep ){
+        // Two equal increments: lock the oscillator
+        oscSin       = sin(WFS_2PI*oscPhase);
+        oscCos       = cos(WFS_2PI*oscPhase);
+        oscSinStep   = sin(WFS_2PI*step);
+        oscCosStep   = cos(WFS_2PI*step);
+        oscRotations = 0;
+        oscLocked    = True;
+        return oscSin;
+    }
+
+    // The increment is changing (variable frequency or irregular sampling)
+    oscPhaseStep = step;
+    oscLocked    = False;
+    return SineTable(oscPhase);
+}
+
 ///
 float WaveformClassSine::GetValue(int32 actTimeUsec){
 
+    if( !fastOscillator ){
+        if( WaveformPeriodicClass::Execute(actTimeUsec) ){
+            if( sweepingSet ) return sin(PI2*integratedFrequency)*gain+offsetValue;
+            else              return sin(PI2*localPhase)*gain+offsetValue;
+        }
+        return 0.0;
+    }
+
+    // Needed by the oscillator and updated by Execute
+    int32 lastUsecTime  = oldUsecTime;
+    float lastFrequency = oldFrequency;
+
     if( WaveformPeriodicClass::Execute(actTimeUsec) ){
-        if( sweepingSet ) return sin(PI2*integratedFrequency)*gain+offsetValue;
-        else              return sin(PI2*localPhase)*gain+offsetValue;
+        if( sweepingSet ) return OscillatorSweep(actTimeUsec,lastUsecTime,lastFrequency)*gain+offsetValue;
+        else              return SineTable(localPhase)*gain+offsetValue;
     }
 
     return 0.0;
@@ -37,6 +37,36 @@ private:
     /** */
     bool        sweepingSet;
 
+    /** If True the sine is computed by the oscillator instead of calling sin(). Off by default */
+    bool        fastOscillator;
+
+/*************************/
+/*  Oscillator state     */
+/*************************/
+
+    /** Integrated frequency of the sweep in double precision, wrapped in [0,1) */
+    double      oscPhase;
+
+    /** Phase increment of the last sample */
+    double      oscPhaseStep;
+
+    /** sin and cos of 2*pi*oscPhase, advanced by rotation while the increment is constant */
+    double      oscSin;
+    double      oscCos;
+
+    /** sin and cos of 2*pi*oscPhaseStep */
+    double      oscSinStep;
+    double      oscCosStep;
+
+    /** Number of rotations since sin and cos were last computed exactly */
+    int32       oscRotations;
+
+    /** True while oscSin and oscCos follow oscPhase */
+    bool        oscLocked;
+
+    /** Sweeping output computed by the oscillator */
+    double      OscillatorSweep(int32 actTimeUsec, int32 lastUsecTime, float lastFrequency);
+
 public:
 
     /** */
@@ -46,7 +76,18 @@ public:
     ~WaveformClassSine();
 
     /** Copy constructor */
-    WaveformClassSine(const WaveformClassSine &wave) : WaveformPeriodicClass(wave) {}
+    WaveformClassSine(const WaveformClassSine &wave) : WaveformPeriodicClass(wave) {
+        this->sweepingSet    = wave.sweepingSet;
+        this->fastOscillator = wave.fastOscillator;
+        this->oscPhase       = 0.0;
+        this->oscPhaseStep   = 0.0;
+        this->oscSin         = 0.0;
+        this->oscCos         = 1.0;
+        this->oscSinStep     = 0.0;
+        this->oscCosStep     = 1.0;
+        this->oscRotations   = 0;
+        this->oscLocked      = False;
+    }
 
     /** */
     virtual bool ObjectLoadSetup(ConfigurationDataBase &cdbData, StreamInterface *err);
@@ -54,6 +95,14 @@ public:
     /** */
     virtual float GetValue(int32 usecTime);
 
+    /** */
+    virtual void Reset(){
+        WaveformPeriodicClass::Reset();
+        oscPhaseStep = 0.0;
+        oscRotations = 0;
+        oscLocked    = False;
+    }
+
     /** */
     virtual bool ProcessHttpMessage(HttpStream &hStream);
 };
@@ -33,6 +33,12 @@ WaveformGenerator::WaveformGenerator(){
     ddbOutputInterface = NULL;
     waveformList       = NULL;
     isIntOutputList    = NULL;
+    floatWaveforms     = NULL;
+    floatOutputs       = NULL;
+    nOfFloatOutputs    = 0;
+    intWaveforms       = NULL;
+    intOutputs         = NULL;
+    nOfIntOutputs      = 0;
 }
 
 
@@ -40,6 +46,10 @@ WaveformGenerator::WaveformGenerator(){
 WaveformGenerator::~WaveformGenerator(){
     if( waveformList    != NULL ) delete[] waveformList;
     if( isIntOutputList != NULL ) free((void*&)isIntOutputList);
+    if( floatWaveforms  != NULL ) free((void*&)floatWaveforms);
+    if( floatOutputs    != NULL ) free((void*&)floatOutputs);
+    if( intWaveforms    != NULL ) free((void*&)intWaveforms);
+    if( intOutputs      != NULL ) free((void*&)intOutputs);
 }
 
 ///
@@ -143,6 +153,29 @@ bool WaveformGenerator::Initialise(ConfigurationDataBase& cdbData){
         }
     }
 
+    // Group the channels by type of output, so that Execute runs two branch free loops
+    floatWaveforms = (WaveformInterface**)malloc(sizeof(WaveformInterface*)*Size());
+    floatOutputs   = (int32*)malloc(sizeof(int32)*Size());
+    intWaveforms   = (WaveformInterface**)malloc(sizeof(WaveformInterface*)*Size());
+    intOutputs     = (int32*)malloc(sizeof(int32)*Size());
+    if( floatWaveforms == NULL || floatOutputs == NULL || intWaveforms == NULL || intOutputs == NULL ){
+        AssertErrorCondition(InitialisationError,"WaveformGenerator::Initialize: error allocating memory for the channel tables");
+        return False;
+    }
+    nOfFloatOutputs = 0;
+    nOfIntOutputs   = 0;
+    for( i = 0; i < Size(); i++ ){
+        if( isIntOutputList[i] ){
+            intWaveforms[nOfIntOutputs] = waveformList[i].operator->();
+            intOutputs[nOfIntOutputs]   = i;
+            nOfIntOutputs++;
+        }else{
+            floatWaveforms[nOfFloatOutputs] = waveformList[i].operator->();
+            floatOutputs[nOfFloatOutputs]   = i;
+            nOfFloatOutputs++;
+        }
+    }
+
     // Reset all the waveforms
     for(i = 0 ; i < Size() ; i++) {
         waveformList[i]->Reset();
@@ -168,16 +201,18 @@ bool WaveformGenerator::Execute(GAM_FunctionNumbers functionNumber){
     int32 *inputData = (int32*)(ddbInputInterface->Buffer());
     int32 usecTime = inputData[0];
     
-    float *output = (float *)ddbOutputInterface->Buffer();
-    
     for(i = 0 ; i < Size() ; i++) {
         waveformList[i]->SetState(functionNumber);
-        if(isIntOutputList[i]) {
-            *((int32*)output) = (int32)(waveformList[i]->GetValueInt32(usecTime));
-        } else {
-            *output = waveformList[i]->GetValue(usecTime);
-        }
-        output++;
+    }
+
+    float *output    = (float *)ddbOutputInterface->Buffer();
+    int32 *intOutput = (int32 *)output;
+
+    for(i = 0 ; i < nOfFloatOutputs ; i++) {
+        output[floatOutputs[i]] = floatWaveforms[i]->GetValue(usecTime);
+    }
+    for(i = 0 ; i < nOfIntOutputs ; i++) {
+        intOutput[intOutputs[i]] = intWaveforms[i]->GetValueInt32(usecTime);
     }
     ddbOutputInterface->Write();
     
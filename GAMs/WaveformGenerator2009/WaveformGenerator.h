@@ -62,6 +62,28 @@ private:
     /** */
     uint32                               resetEvent;
 
+/*******************************************/
+/*  Channels grouped by type of output     */
+/*******************************************/
+
+    /** Waveforms of the float outputs */
+    WaveformInterface                  **floatWaveforms;
+
+    /** Position of each float output in the output buffer */
+    int32                               *floatOutputs;
+
+    /** Number of float outputs */
+    int32                                nOfFloatOutputs;
+
+    /** Waveforms of the int32 outputs */
+    WaveformInterface                  **intWaveforms;
+
+    /** Position of each int32 output in the output buffer */
+    int32                               *intOutputs;
+
+    /** Number of int32 outputs */
+    int32                                nOfIntOutputs;
+
 public:
 
     /** */
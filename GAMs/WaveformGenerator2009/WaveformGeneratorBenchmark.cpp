@@ -0,0 +1,227 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Evaluates nOfChannels waveforms per cycle, as WaveformGenerator::Execute does.
+ * WaveformClassPoints: each channel follows a trajectory of nOfPoints points.
+ * The cursor search is timed over all the cycles; the linear scan of the previous
+ * implementation is timed on a subset of the cycles and checked against the cursor.
+ * WaveformClassSine: sweeping sines timed with sin() (FastOscillator = OFF) and with
+ * the oscillator, and compared with a double precision reference.
+ * Usage: WaveformGeneratorBenchmark.ex [nOfChannels] [nOfPoints] [nOfCycles]
+ */
+
+#include "System.h"
+#include "FString.h"
+#include "HRT.h"
+#include "ConfigurationDataBase.h"
+#include "WaveformClassPoints.h"
+#include "WaveformClassSine.h"
+
+/** Time between two points of the trajectories and between two cycles */
+#define POINTS_PERIOD_USEC  100
+
+/** Number of cycles on which the linear scan is timed */
+#define LEGACY_CYCLES       50
+
+/** Number of channels compared with the double precision sine */
+#define CHECKED_SINES       8
+
+static bool Setup(WaveformGenericClass &waveform, const char *name, FString &config){
+    config.Seek(0);
+    ConfigurationDataBase cdb;
+    if(!cdb->ReadFromStream(config)){
+        printf("Could not parse the %s configuration\n", name);
+        return False;
+    }
+    waveform.SetObjectName(name);
+    return waveform.ObjectLoadSetup(cdb, NULL);
+}
+
+/** The search of the previous implementation of WaveformClassPoints::GetValue */
+static float LegacyPoints(const int32 *timeBase, const float *values, int32 numberOfValues, int32 timeRef){
+    int32 k = 0;
+    while( k < numberOfValues && timeBase[k] <= timeRef ) k++;
+    if( k == 0 || k == numberOfValues ) return 0.0;
+    float output = values[k] + (values[k-1]-values[k])*((float)(timeRef-timeBase[k])) / ((float)(timeBase[k-1]-timeBase[k]));
+    return output * 1.0 + 0.0;
+}
+
+static float SineFrequency(int32 channel){
+    return 10.0 + 0.37 * channel;
+}
+
+/** Runs the sines for nOfCycles and returns the time per cycle in microseconds */
+static double RunSines(WaveformClassSine **sines, int32 nOfChannels, int32 nOfCycles, float &checksum){
+    checksum = 0;
+    int64 start = HRT::HRTCounter();
+    for(int32 c = 0; c < nOfCycles; c++){
+        int32 usecTime = c * POINTS_PERIOD_USEC;
+        for(int32 i = 0; i < nOfChannels; i++){
+            checksum += sines[i]->GetValue(usecTime);
+        }
+    }
+    return (HRT::HRTCounter() - start) * HRT::HRTPeriod() * 1e6 / nOfCycles;
+}
+
+/** Largest difference with sin(2*pi*f*t) on the first CHECKED_SINES channels */
+static double SineError(WaveformClassSine **sines, int32 nOfChannels, int32 nOfCycles){
+    double maxError = 0.0;
+    for(int32 i = 0; (i < nOfChannels) && (i < CHECKED_SINES); i++){
+        sines[i]->Reset();
+        double frequency = SineFrequency(i);
+        for(int32 c = 0; c < nOfCycles; c++){
+            int32  usecTime  = c * POINTS_PERIOD_USEC;
+            double cycles    = frequency * usecTime * 1e-6;
+            double reference = sin(6.283185307179586 * (cycles - floor(cycles)));
+            double error     = fabs(sines[i]->GetValue(usecTime) - reference);
+            if(error > maxError) maxError = error;
+        }
+    }
+    return maxError;
+}
+
+int main(int argc, char **argv){
+    int32 nOfChannels = (argc > 1) ? atoi(argv[1]) : 1000;
+    int32 nOfPoints   = (argc > 2) ? atoi(argv[2]) : 100000;
+    int32 nOfCycles   = (argc > 3) ? atoi(argv[3]) : 100000;
+    if((nOfChannels < 1) || (nOfPoints < 2) || (nOfCycles < LEGACY_CYCLES)){
+        printf("Usage: WaveformGeneratorBenchmark.ex [nOfChannels] [nOfPoints] [nOfCycles]\n");
+        return -1;
+    }
+
+    /// The trajectory, shared by all the channels
+    FString config;
+    config.Printf("TimeVector = { ");
+    for(int32 j = 0; j < nOfPoints; j++){
+        config.Printf("%.4f ", j * POINTS_PERIOD_USEC * 1e-6);
+    }
+    config.Printf("}\nValueVector = { ");
+    for(int32 j = 0; j < nOfPoints; j++){
+        config.Printf("%d ", (j * 7919) % 1000);
+    }
+    config.Printf("}\nTend = 1000\n");
+
+    /// The same conversion as WaveformClassPoints::ObjectLoadSetup, for the reference
+    int32 *timeBase = (int32 *)malloc(nOfPoints * sizeof(int32));
+    float *values   = (float *)malloc(nOfPoints * sizeof(float));
+    for(int32 j = 0; j < nOfPoints; j++){
+        FString point;
+        point.Printf("%.4f", j * POINTS_PERIOD_USEC * 1e-6);
+        float seconds = (float)atof(point.Buffer());
+        timeBase[j]   = (int32)round((seconds - 0.0f) * 1000000);
+        values[j]     = (float)((j * 7919) % 1000);
+    }
+
+    WaveformClassPoints prototype;
+    if(!Setup(prototype, "Points", config)){
+        return -1;
+    }
+    WaveformClassPoints **points = new WaveformClassPoints *[nOfChannels];
+    for(int32 i = 0; i < nOfChannels; i++){
+        points[i] = new WaveformClassPoints(prototype);
+    }
+
+    /// Cursor: all the cycles
+    int32 cycleUsec = (int32)(((int64)nOfPoints * POINTS_PERIOD_USEC) / nOfCycles);
+    if(cycleUsec < 1) cycleUsec = 1;
+    float checksum = 0;
+    int64 start = HRT::HRTCounter();
+    for(int32 c = 0; c < nOfCycles; c++){
+        int32 usecTime = c * cycleUsec;
+        for(int32 i = 0; i < nOfChannels; i++){
+            checksum += points[i]->GetValue(usecTime + (i & 0x7));
+        }
+    }
+    double cursorTime = (HRT::HRTCounter() - start) * HRT::HRTPeriod() * 1e6 / nOfCycles;
+
+    /// Linear scan: LEGACY_CYCLES cycles spread over the trajectory (the channels have different times so that the scan is not hoisted)
+    float legacyChecksum = 0;
+    start = HRT::HRTCounter();
+    for(int32 c = 0; c < LEGACY_CYCLES; c++){
+        int32 usecTime = (int32)(((int64)c * nOfCycles / LEGACY_CYCLES) * cycleUsec);
+        for(int32 i = 0; i < nOfChannels; i++){
+            legacyChecksum += LegacyPoints(timeBase, values, nOfPoints, usecTime + (i & 0x7));
+        }
+    }
+    double legacyTime = (HRT::HRTCounter() - start) * HRT::HRTPeriod() * 1e6 / LEGACY_CYCLES;
+
+    /// The cursor must give the same values, also when the time jumps and goes back
+    int32 mismatches = 0;
+    for(int32 c = 0; c < 2 * LEGACY_CYCLES; c++){
+        int32 sample   = (c < LEGACY_CYCLES) ? c : (2 * LEGACY_CYCLES - 1 - c);
+        int32 usecTime = (int32)(((int64)sample * nOfCycles / LEGACY_CYCLES) * cycleUsec) + 37 * c;
+        if(points[0]->GetValue(usecTime) != LegacyPoints(timeBase, values, nOfPoints, usecTime)){
+            mismatches++;
+        }
+    }
+
+    printf("Points: %d channels x %d points, %d cycles of %d us\n", nOfChannels, nOfPoints, nOfCycles, cycleUsec);
+    printf("  linear scan %12.1f us per cycle (%d cycles)\n", legacyTime, LEGACY_CYCLES);
+    printf("  cursor      %12.1f us per cycle (%d cycles)\n", cursorTime, nOfCycles);
+    printf("  mismatches  %d, checksums %e %e\n", mismatches, checksum, legacyChecksum);
+
+    for(int32 i = 0; i < nOfChannels; i++){
+        delete points[i];
+    }
+    delete [] points;
+    free((void *&)timeBase);
+    free((void *&)values);
+
+    /// Sweeping sines with sin() and with the oscillator
+    WaveformClassSine **sines     = new WaveformClassSine *[nOfChannels];
+    WaveformClassSine **fastSines = new WaveformClassSine *[nOfChannels];
+    for(int32 i = 0; i < nOfChannels; i++){
+        FString sineConfig;
+        sineConfig.Printf("Frequency = %f\nSweeping = ON\nFastOscillator = OFF\nTend = 1000\n", SineFrequency(i));
+        sines[i] = new WaveformClassSine();
+        if(!Setup(*sines[i], "Sine", sineConfig)){
+            return -1;
+        }
+        FString fastConfig;
+        fastConfig.Printf("Frequency = %f\nSweeping = ON\nFastOscillator = ON\nTend = 1000\n", SineFrequency(i));
+        fastSines[i] = new WaveformClassSine();
+        if(!Setup(*fastSines[i], "FastSine", fastConfig)){
+            return -1;
+        }
+    }
+    float sinChecksum        = 0;
+    float oscillatorChecksum = 0;
+    double sinTime           = RunSines(sines, nOfChannels, nOfCycles, sinChecksum);
+    double oscillatorTime    = RunSines(fastSines, nOfChannels, nOfCycles, oscillatorChecksum);
+
+    printf("Sine: %d channels, %d cycles of %d us\n", nOfChannels, nOfCycles, POINTS_PERIOD_USEC);
+    printf("  sin()       %12.1f us per cycle, max error %e\n", sinTime, SineError(sines, nOfChannels, nOfCycles));
+    printf("  oscillator  %12.1f us per cycle, max error %e\n", oscillatorTime, SineError(fastSines, nOfChannels, nOfCycles));
+
+    for(int32 i = 0; i < nOfChannels; i++){
+        delete sines[i];
+        delete fastSines[i];
+    }
+    delete [] sines;
+    delete [] fastSines;
+
+    return 0;
+}
@@ -176,6 +176,11 @@ public:
         return inputModule->IsSynchronizing();
     }
 
+    /** Returns the driver of the GAM */
+    virtual GCReference AcquisitionModule(){
+        return inputModule;
+    }
+
     /**
      *  Builds the webpage.
      * @param hStream The HttpStream to write to.
@@ -24,6 +24,47 @@
 
 #include "CircularBufferSynchDrv.h"
 #include "GlobalObjectDataBase.h"
+#include "Atomic.h"
+#include "HRT.h"
+
+#if defined(_LINUX)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/**
+ * The head index is only written by the producer and the tail index only by the consumer.
+ * Each side publishes its index with release semantics and reads the other one with
+ * acquire semantics, so that the buffer contents are always visible before the index.
+ */
+static inline uint32 CBSDLoadAcquire(volatile uint32 *p){
+#if defined(__ATOMIC_ACQUIRE)
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+#else
+    uint32 value = *p;
+    __sync_synchronize();
+    return value;
+#endif
+}
+
+static inline void CBSDStoreRelease(volatile uint32 *p, uint32 value){
+#if defined(__ATOMIC_RELEASE)
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+#else
+    __sync_synchronize();
+    *p = value;
+#endif
+}
+
+/** Hint to the processor that the producer is polling the consumer index */
+static inline void CBSDCPURelax(){
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    __asm__ __volatile__("pause" ::: "memory");
+#else
+    Atomic::Barrier();
+#endif
+}
 
 bool CircularBufferSynchDrv::ObjectLoadSetup(ConfigurationDataBase &info,StreamInterface *err){
     AssertErrorCondition(Information, "CircularBufferSynchDrv::ObjectLoadSetup: %s Loading signals", Name());
@@ -49,32 +90,121 @@ bool CircularBufferSynchDrv::ObjectLoadSetup(ConfigurationDataBase &info,StreamI
         AssertErrorCondition(InitialisationError,"CircularBufferSynchDrv::ObjectLoadSetup: %s at least one buffer must be specified. NumberOfBuffers = %d",Name(), numberOfBuffers);
         return false;
     }
-    numberOfFreeBuffers = numberOfBuffers;
+
+    FString overflowPolicyStr;
+    cdb.ReadFString(overflowPolicyStr, "OverflowPolicy", "DropNewest");
+    if(overflowPolicyStr == "DropNewest"){
+        overflowPolicy = CBSDDropNewest;
+    }
+    else if(overflowPolicyStr == "DropOldest"){
+        overflowPolicy = CBSDDropOldest;
+    }
+    else if(overflowPolicyStr == "Block"){
+        overflowPolicy = CBSDBlock;
+    }
+    else{
+        AssertErrorCondition(InitialisationError,"CircularBufferSynchDrv::ObjectLoadSetup: %s unknown OverflowPolicy %s. Use DropNewest, DropOldest or Block",Name(), overflowPolicyStr.Buffer());
+        return false;
+    }
+
+    int32 blockTimeoutUsec = 0;
+    cdb.ReadInt32(blockTimeoutUsec, "BlockTimeoutUsec", 1000);
+    if(blockTimeoutUsec <= 0){
+        AssertErrorCondition(InitialisationError,"CircularBufferSynchDrv::ObjectLoadSetup: %s BlockTimeoutUsec must be > 0. BlockTimeoutUsec = %d",Name(), blockTimeoutUsec);
+        return false;
+    }
+    blockTimeoutTicks = (int64)(blockTimeoutUsec * 1e-6 * HRT::HRTFrequency());
+
+    FString pollModeStr;
+    cdb.ReadFString(pollModeStr, "PollMode", "EventSem");
+    if(pollModeStr == "EventSem"){
+        pollMode = CBSDEventSem;
+    }
+    else if(pollModeStr == "BusySpin"){
+        pollMode = CBSDBusySpin;
+    }
+    else if(pollModeStr == "Futex"){
+#if defined(_LINUX)
+        pollMode = CBSDFutex;
+#else
+        AssertErrorCondition(Warning,"CircularBufferSynchDrv::ObjectLoadSetup: %s PollMode Futex is only available in Linux. Using EventSem",Name());
+        pollMode = CBSDEventSem;
+#endif
+    }
+    else{
+        AssertErrorCondition(InitialisationError,"CircularBufferSynchDrv::ObjectLoadSetup: %s unknown PollMode %s. Use EventSem, BusySpin or Futex",Name(), pollModeStr.Buffer());
+        return false;
+    }
+
     //Allocate the shared memory
     sharedBuffer = new int32*[numberOfBuffers];
-    if(sharedBuffer == NULL){
+    bufferSequence = new uint32[numberOfBuffers];
+    if((sharedBuffer == NULL) || (bufferSequence == NULL)){
         AssertErrorCondition(FatalError, "CircularBufferSynchDrv::ObjectLoadSetup: %s Failed to allocated sharedBuffer for %d buffers", Name(), numberOfBuffers);
         return false;
     }
     uint32 i;
     for(i=0; i < numberOfBuffers; i++){
         sharedBuffer[i] = new int32[numberOfInputChannels];
+        bufferSequence[i] = 0;
     }
+    head = 0;
+    tail = 0;
     return true;
 }
 
-bool CircularBufferSynchDrv::WriteData(uint32 usecTime, const int32 *ibuffer){
-    memcpy(&sharedBuffer[currentBuffer][0], ibuffer, numberOfBuffers * sizeof(int32));
-    currentBuffer++;
-    if(currentBuffer == numberOfBuffers){
-        currentBuffer = 0;
+void CircularBufferSynchDrv::WakeConsumer(){
+    if(pollMode == CBSDBusySpin){
+        return;
     }
-    if(currentBuffer == currentReadBuffer){
-        AssertErrorCondition(FatalError,"CircularBufferSynchDrv::WriteData: %s sharedBuffer overwritten for index: %d. Data lost. Try increasing number of buffers.", Name(), currentBuffer);
-        return false;
+    //Make sure that the new head is visible before checking if the consumer is asleep
+    Atomic::FullBarrier();
+    if(consumerWaiting == 0){
+        return;
+    }
+#if defined(_LINUX)
+    if(pollMode == CBSDFutex){
+        syscall(SYS_futex, (int *)&head, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+        return;
     }
-    numberOfFreeBuffers--;
+#endif
     synchSem.Post();
+}
+
+bool CircularBufferSynchDrv::WriteData(uint32 usecTime, const int32 *ibuffer){
+    uint32 currentHead = head;
+    if((currentHead - CBSDLoadAcquire(&tail)) >= (uint32)numberOfBuffers){
+        if(overflowPolicy == CBSDDropNewest){
+            droppedWrites++;
+            return true;
+        }
+        if(overflowPolicy == CBSDBlock){
+            blockedWrites++;
+            //Do not hang the real-time thread on a stalled consumer
+            int64 deadline = HRT::HRTCounter() + blockTimeoutTicks;
+            while((currentHead - CBSDLoadAcquire(&tail)) >= (uint32)numberOfBuffers){
+                if(HRT::HRTCounter() > deadline){
+                    blockTimeouts++;
+                    droppedWrites++;
+                    return true;
+                }
+                CBSDCPURelax();
+            }
+        }
+        //With CBSDDropOldest the consumer detects and skips the overwritten buffers
+    }
+
+    uint32 index = currentHead % numberOfBuffers;
+    if(overflowPolicy == CBSDDropOldest){
+        //Mark the buffer as being written before touching it
+        bufferSequence[index] = 0;
+        Atomic::FullBarrier();
+    }
+    memcpy(&sharedBuffer[index][0], ibuffer, numberOfOutputChannels * sizeof(int32));
+    CBSDStoreRelease(&bufferSequence[index], currentHead + 1);
+    CBSDStoreRelease(&head, currentHead + 1);
+    WakeConsumer();
+
     for(int i = 0 ; i < nOfTriggeringServices ; i++) {
         triggerService[i].Trigger();
     }
@@ -102,29 +232,106 @@ bool CircularBufferSynchDrv::ProcessHttpMessage(HttpStream &hStream) {
 
     hStream.Printf("<h1>Shared buffer status</h1>\n");
 
-    hStream.Printf("Number of free buffers = %d\n<br>\n", numberOfFreeBuffers);
-    hStream.Printf("Current buffer = %d\n<br>\n", currentBuffer);
-    hStream.Printf("Current read buffer = %d\n<br>\n", currentReadBuffer);
+    uint32 currentHead = head;
+    uint32 currentTail = tail;
+    uint32 fillLevel   = currentHead - currentTail;
+    if(fillLevel > (uint32)numberOfBuffers){
+        fillLevel = numberOfBuffers;
+    }
+    const char *policyNames[] = {"DropNewest", "DropOldest", "Block"};
+    const char *pollNames[]   = {"EventSem", "BusySpin", "Futex"};
+
+    hStream.Printf("Overflow policy = %s\n<br>\n", policyNames[overflowPolicy]);
+    hStream.Printf("Poll mode = %s\n<br>\n", pollNames[pollMode]);
+    hStream.Printf("Number of buffers = %d\n<br>\n", numberOfBuffers);
+    hStream.Printf("Fill level = %u\n<br>\n", fillLevel);
+    hStream.Printf("Maximum fill level = %u\n<br>\n", maxFillLevel);
+    hStream.Printf("Number of free buffers = %u\n<br>\n", numberOfBuffers - fillLevel);
+    hStream.Printf("Current buffer = %u\n<br>\n", currentHead % numberOfBuffers);
+    hStream.Printf("Current read buffer = %u\n<br>\n", currentTail % numberOfBuffers);
+    hStream.Printf("Buffers written = %u\n<br>\n", currentHead);
+    hStream.Printf("Buffers read = %u\n<br>\n", currentTail);
+    hStream.Printf("Dropped writes (overrun) = %u\n<br>\n", droppedWrites);
+    hStream.Printf("Overwritten buffers (overrun) = %u\n<br>\n", overwrittenBuffers);
+    hStream.Printf("Blocked writes = %u\n<br>\n", blockedWrites);
+    hStream.Printf("Blocked writes timed out = %u\n<br>\n", blockTimeouts);
     hStream.Printf("</body></html>\n");
 
+    return True;
 }
 
 int32 CircularBufferSynchDrv::GetData(uint32 usecTime, int32 *buffer, int32 bufferNumber) {
-    memcpy(buffer, &sharedBuffer[currentReadBuffer][0], numberOfInputChannels * sizeof(int32));
-    currentReadBuffer++;
-    if(currentReadBuffer == numberOfBuffers){
-        currentReadBuffer = 0;
+    uint32 currentTail = tail;
+    while(true){
+        uint32 currentHead = CBSDLoadAcquire(&head);
+        if(currentHead == currentTail){
+            if(currentTail != tail){
+                //Overwritten buffers were skipped
+                CBSDStoreRelease(&tail, currentTail);
+            }
+            return 0;
+        }
+        uint32 fillLevel = currentHead - currentTail;
+        if(fillLevel > (uint32)numberOfBuffers){
+            //Only possible with CBSDDropOldest: the producer went around the buffer
+            overwrittenBuffers += fillLevel - numberOfBuffers;
+            currentTail = currentHead - numberOfBuffers;
+            fillLevel = numberOfBuffers;
+        }
+        if(fillLevel > maxFillLevel){
+            maxFillLevel = fillLevel;
+        }
+
+        uint32 index = currentTail % numberOfBuffers;
+        if(CBSDLoadAcquire(&bufferSequence[index]) == (currentTail + 1)){
+            memcpy(buffer, &sharedBuffer[index][0], numberOfInputChannels * sizeof(int32));
+            bool valid = true;
+            if(overflowPolicy == CBSDDropOldest){
+                //Check that the producer did not start overwriting the buffer during the copy
+                Atomic::FullBarrier();
+                valid = (bufferSequence[index] == (currentTail + 1));
+            }
+            if(valid){
+                CBSDStoreRelease(&tail, currentTail + 1);
+                return 1;
+            }
+        }
+        //The buffer is being overwritten. Skip it
+        overwrittenBuffers++;
+        currentTail++;
     }
-    numberOfFreeBuffers++;
     return 0;
 }
 
 bool CircularBufferSynchDrv::Poll(){
-    if(currentReadBuffer != currentBuffer){
+    uint32 currentTail = tail;
+    if(pollMode == CBSDBusySpin){
+        while(CBSDLoadAcquire(&head) == currentTail){
+        }
         return true;
     }
-    synchSem.Wait();
-    synchSem.Reset();
+    while(CBSDLoadAcquire(&head) == currentTail){
+        if(pollMode == CBSDEventSem){
+            synchSem.Reset();
+        }
+        consumerWaiting = 1;
+        //Publish the waiting flag before the last check of the head
+        Atomic::FullBarrier();
+        uint32 currentHead = head;
+        if(currentHead == currentTail){
+#if defined(_LINUX)
+            if(pollMode == CBSDFutex){
+                syscall(SYS_futex, (int *)&head, FUTEX_WAIT_PRIVATE, currentHead, NULL, NULL, 0);
+            }
+            else{
+                synchSem.Wait();
+            }
+#else
+            synchSem.Wait();
+#endif
+        }
+        consumerWaiting = 0;
+    }
     return true;
 }
 
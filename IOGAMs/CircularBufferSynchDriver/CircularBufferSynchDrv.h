@@ -27,35 +27,143 @@
 #include "FastPollingMutexSem.h"
 #include "MessageHandler.h"
 
+/** Size used to keep the producer and consumer indices in different cache lines */
+#define CBSD_CACHE_LINE_SIZE 64
+
+/**
+ * What to do when the producer finds the circular buffer full
+ */
+enum CBSDOverflowPolicy {
+    /** The new data is discarded */
+    CBSDDropNewest = 0,
+    /** The oldest unread buffer is overwritten */
+    CBSDDropOldest = 1,
+    /**
+     * The producer waits until the consumer frees one buffer. The wait stalls the
+     * real-time cycle for up to BlockTimeoutUsec, after which the new data is discarded
+     */
+    CBSDBlock      = 2
+};
+
+/**
+ * How the consumer waits for new data in Poll()
+ */
+enum CBSDPollMode {
+    /** Sleep on an EventSem posted by the producer */
+    CBSDEventSem  = 0,
+    /** Spin on the producer index without ever leaving the CPU */
+    CBSDBusySpin  = 1,
+    /** Sleep on a futex placed on the producer index (Linux only) */
+    CBSDFutex     = 2
+};
+
 OBJECT_DLL(CircularBufferSynchDrv)
 class CircularBufferSynchDrv:public GenericAcqModule{
 OBJECT_DLL_STUFF(CircularBufferSynchDrv)
 
 private:
+    /**
+     * Number of buffers written so far. Only modified by the producer (WriteData).
+     * The buffer index is head % numberOfBuffers.
+     */
+    volatile uint32 head;
+    char headPadding[CBSD_CACHE_LINE_SIZE - sizeof(uint32)];
+
+    /**
+     * Number of buffers read so far. Only modified by the consumer (GetData).
+     */
+    volatile uint32 tail;
+    char tailPadding[CBSD_CACHE_LINE_SIZE - sizeof(uint32)];
+
+    /**
+     * Set by the consumer before sleeping, so that the producer only signals when needed
+     */
+    volatile int32 consumerWaiting;
+    char waitingPadding[CBSD_CACHE_LINE_SIZE - sizeof(int32)];
+
     /**
      * The number of buffers of the circular buffer
      */
-	int32 numberOfBuffers;
-    int32 currentBuffer;
-    int32 currentReadBuffer;
-    EventSem synchSem;
+    int32 numberOfBuffers;
 
     /**
      * The shared buffer. The WriteData puts data here and the GetData reads data from here
      */
     int32 **sharedBuffer;
-   
+
+    /**
+     * For each buffer the value of head when it was last written.
+     * Allows the consumer to detect buffers overwritten while being copied
+     * (only possible with the CBSDDropOldest policy)
+     */
+    volatile uint32 *bufferSequence;
+
+    /**
+     * The overflow policy
+     */
+    CBSDOverflowPolicy overflowPolicy;
+
     /**
-     * Current number of free buffers
+     * How Poll waits for data
      */
-    int32 numberOfFreeBuffers;
-        
+    CBSDPollMode pollMode;
+
+    /**
+     * Used to wake the consumer in the CBSDEventSem poll mode
+     */
+    EventSem synchSem;
+
+    /**
+     * Number of buffers discarded by the producer (CBSDDropNewest)
+     */
+    uint32 droppedWrites;
+
+    /**
+     * Number of buffers the consumer found overwritten (CBSDDropOldest)
+     */
+    uint32 overwrittenBuffers;
+
+    /**
+     * Number of times the producer had to wait for a free buffer (CBSDBlock)
+     */
+    uint32 blockedWrites;
+
+    /**
+     * Number of CBSDBlock waits which expired. Also counted in droppedWrites
+     */
+    uint32 blockTimeouts;
+
+    /**
+     * Longest wait for a free buffer with CBSDBlock, in HRT ticks
+     */
+    int64 blockTimeoutTicks;
+
+    /**
+     * Maximum number of used buffers observed by the consumer
+     */
+    uint32 maxFillLevel;
+
+    /**
+     * Wakes the consumer if it is sleeping in Poll
+     */
+    inline void WakeConsumer();
+
 public:
     CircularBufferSynchDrv(){
+        head = 0;
+        tail = 0;
+        consumerWaiting = 0;
         numberOfBuffers = 0;
-        currentBuffer = 0;
-        currentReadBuffer = 0;
         sharedBuffer = NULL;
+        bufferSequence = NULL;
+        overflowPolicy = CBSDDropNewest;
+        pollMode = CBSDEventSem;
+        droppedWrites = 0;
+        overwrittenBuffers = 0;
+        blockedWrites = 0;
+        blockTimeouts = 0;
+        blockTimeoutTicks = 0;
+        maxFillLevel = 0;
         synchSem.Create();
         synchSem.Reset();
     }
@@ -68,7 +176,10 @@ public:
                     delete []sharedBuffer[i];
                 }
             }
-            delete sharedBuffer;
+            delete []sharedBuffer;
+        }
+        if(bufferSequence != NULL){
+            delete []bufferSequence;
         }
         synchSem.Close();
     }
@@ -77,6 +188,11 @@ public:
      * Reset the internal counters 
      */
     bool PulseStart(){
+        droppedWrites = 0;
+        overwrittenBuffers = 0;
+        blockedWrites = 0;
+        blockTimeouts = 0;
+        maxFillLevel = 0;
         return True;
     }
 
@@ -86,7 +202,8 @@ public:
     bool ProcessHttpMessage(HttpStream &hStream);
 
     /** 
-     * Gets the data at the sharedBuffer[currentBuffer] location 
+     * Gets the oldest unread buffer
+     * @return 1 if data was copied, 0 if no data is available
      */
     int32 GetData(uint32 usecTime, int32 *buffer, int32 bufferNumber = 0);
 
@@ -0,0 +1,444 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they
+   will be approved by the European Commission - subsequent
+   versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the
+   Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in
+   writing, software distributed under the Licence is
+   distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+   express or implied.
+ * See the Licence for the specific language governing
+   permissions and limitations under the Licence.
+ *
+ * $Id$
+ *
+**/
+
+#include "FileWriterBlockQueue.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#if defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#define FWBQ_HAS_IO_URING
+#endif
+
+/**
+ * Minimal io_uring submission/completion ring, driven through the raw system calls
+ */
+class FileWriterIOUring{
+#if defined(FWBQ_HAS_IO_URING)
+private:
+    int32                 ringFd;
+    void                 *sqRing;
+    size_t                sqRingSize;
+    void                 *cqRing;
+    size_t                cqRingSize;
+    struct io_uring_sqe  *sqes;
+    size_t                sqesSize;
+    uint32               *sqHead;
+    uint32               *sqTail;
+    uint32               *sqArray;
+    uint32                sqMask;
+    uint32               *cqHead;
+    uint32               *cqTail;
+    uint32                cqMask;
+    struct io_uring_cqe  *cqes;
+
+public:
+    FileWriterIOUring(){
+        ringFd     = -1;
+        sqRing     = MAP_FAILED;
+        cqRing     = MAP_FAILED;
+        sqes       = (struct io_uring_sqe *)MAP_FAILED;
+        sqRingSize = 0;
+        cqRingSize = 0;
+        sqesSize   = 0;
+    }
+
+    ~FileWriterIOUring(){
+        if(sqes != MAP_FAILED)                              munmap(sqes, sqesSize);
+        if((cqRing != MAP_FAILED) && (cqRing != sqRing))    munmap(cqRing, cqRingSize);
+        if(sqRing != MAP_FAILED)                            munmap(sqRing, sqRingSize);
+        if(ringFd >= 0)                                     close(ringFd);
+    }
+
+    bool Setup(uint32 entries){
+        struct io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        ringFd = syscall(__NR_io_uring_setup, entries, &params);
+        if(ringFd < 0) return False;
+
+        sqRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32);
+        cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        bool singleMap = ((params.features & IORING_FEAT_SINGLE_MMAP) != 0);
+        if(singleMap){
+            if(cqRingSize > sqRingSize) sqRingSize = cqRingSize;
+            cqRingSize = sqRingSize;
+        }
+        sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+        if(sqRing == MAP_FAILED) return False;
+        if(singleMap){
+            cqRing = sqRing;
+        }
+        else{
+            cqRing = mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+            if(cqRing == MAP_FAILED) return False;
+        }
+        sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+        sqes     = (struct io_uring_sqe *)mmap(NULL, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+        if(sqes == MAP_FAILED) return False;
+
+        sqHead  = (uint32 *)((char *)sqRing + params.sq_off.head);
+        sqTail  = (uint32 *)((char *)sqRing + params.sq_off.tail);
+        sqArray = (uint32 *)((char *)sqRing + params.sq_off.array);
+        sqMask  = *(uint32 *)((char *)sqRing + params.sq_off.ring_mask);
+        cqHead  = (uint32 *)((char *)cqRing + params.cq_off.head);
+        cqTail  = (uint32 *)((char *)cqRing + params.cq_off.tail);
+        cqMask  = *(uint32 *)((char *)cqRing + params.cq_off.ring_mask);
+        cqes    = (struct io_uring_cqe *)((char *)cqRing + params.cq_off.cqes);
+        return True;
+    }
+
+    /** Queues a vectored write and enters the kernel to start it.
+        If the kernel did not take the entry it is removed from the ring, so that
+        a later submission does not write a block which was reused meanwhile */
+    bool Submit(int32 fd, struct iovec *iov, int64 offset, uint64 userData){
+        uint32 tail = *sqTail;
+        uint32 idx  = tail & sqMask;
+        struct io_uring_sqe *sqe = &sqes[idx];
+        memset(sqe, 0, sizeof(struct io_uring_sqe));
+        sqe->opcode    = IORING_OP_WRITEV;
+        sqe->fd        = fd;
+        sqe->addr      = (uint64)(uintptr_t)iov;
+        sqe->len       = 1;
+        sqe->off       = offset;
+        sqe->user_data = userData;
+        sqArray[idx]   = idx;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+        int32 ret = -1;
+        for(int32 retry = 0; retry < 100; retry++){
+            ret = syscall(__NR_io_uring_enter, ringFd, 1, 0, 0, NULL, 0);
+            if(ret >= 0) break;
+            if((errno != EINTR) && (errno != EAGAIN) && (errno != EBUSY)) break;
+        }
+        if(ret == 1) return True;
+        // Without SQPOLL the kernel only consumes entries inside io_uring_enter
+        if(__atomic_load_n(sqHead, __ATOMIC_ACQUIRE) != tail) return True;
+        __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+        return False;
+    }
+
+    /** Blocks until at least one completion is available */
+    bool Wait(){
+        int32 ret = syscall(__NR_io_uring_enter, ringFd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+        return ((ret >= 0) || (errno == EINTR));
+    }
+
+    /** Gets the next completion. @return False if there are none */
+    bool Next(uint64 &userData, int32 &result){
+        uint32 head = *cqHead;
+        if(head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE)) return False;
+        struct io_uring_cqe *cqe = &cqes[head & cqMask];
+        userData = cqe->user_data;
+        result   = cqe->res;
+        __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+        return True;
+    }
+#else
+public:
+    bool Setup(uint32 entries){
+        return False;
+    }
+    bool Submit(int32 fd, struct iovec *iov, int64 offset, uint64 userData){
+        return False;
+    }
+    bool Wait(){
+        return False;
+    }
+    bool Next(uint64 &userData, int32 &result){
+        return False;
+    }
+#endif
+};
+
+FileWriterBlockQueue::FileWriterBlockQueue(){
+    fds            = NULL;
+    numberOfFiles  = 0;
+    blocks         = NULL;
+    numberOfBlocks = 0;
+    queueDepth     = 0;
+    blockSize      = 0;
+    currentBlock   = NULL;
+    currentFill    = NULL;
+    fileSize       = NULL;
+    directIO       = False;
+    ring           = NULL;
+    inFlight       = 0;
+    completedBytes = 0;
+    writeErrors    = 0;
+}
+
+bool FileWriterBlockQueue::Open(FString *fileNames, int32 nOfFiles, uint32 minimumBlockSize, int32 depth, bool useIOUring, bool useDirectIO, int64 preallocateBytes, const char *owner){
+    Close();
+    ownerName      = owner;
+    inFlight       = 0;
+    completedBytes = 0;
+    writeErrors    = 0;
+    directIO       = useDirectIO;
+    queueDepth     = (depth < 1) ? 1 : depth;
+    blockSize      = ((minimumBlockSize + FWBQ_BLOCK_ALIGNMENT - 1) / FWBQ_BLOCK_ALIGNMENT) * FWBQ_BLOCK_ALIGNMENT;
+    if(blockSize == 0) blockSize = FWBQ_BLOCK_ALIGNMENT;
+
+    fds          = new int32[nOfFiles];
+    currentBlock = new int32[nOfFiles];
+    currentFill  = new uint32[nOfFiles];
+    fileSize     = new int64[nOfFiles];
+    blocks       = new FileWriterBlock[nOfFiles * queueDepth];
+    if((fds == NULL) || (currentBlock == NULL) || (currentFill == NULL) || (fileSize == NULL) || (blocks == NULL)){
+        CStaticAssertErrorCondition(InitialisationError, "FileWriterBlockQueue::Open: %s Failed allocating the queue for %d files", ownerName.Buffer(), nOfFiles);
+        Close();
+        return False;
+    }
+    int32 i;
+    for(i = 0; i < nOfFiles; i++){
+        fds[i]          = -1;
+        currentBlock[i] = 0;
+        currentFill[i]  = 0;
+        fileSize[i]     = 0;
+    }
+    numberOfFiles  = nOfFiles;
+    numberOfBlocks = nOfFiles * queueDepth;
+
+    for(i = 0; i < numberOfBlocks; i++){
+        // Anonymous mappings are page aligned, as required by O_DIRECT
+        void *memory = mmap(NULL, blockSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if(memory == MAP_FAILED){
+            CStaticAssertErrorCondition(InitialisationError, "FileWriterBlockQueue::Open: %s Failed allocating a block of %d bytes", ownerName.Buffer(), blockSize);
+            Close();
+            return False;
+        }
+        blocks[i].data = (char *)memory;
+    }
+
+    for(i = 0; i < nOfFiles; i++){
+        int flags = O_WRONLY | O_CREAT | O_TRUNC;
+#if defined(O_DIRECT)
+        if(directIO) flags |= O_DIRECT;
+#endif
+        fds[i] = open(fileNames[i].Buffer(), flags, 0644);
+        if((fds[i] < 0) && directIO && (errno == EINVAL)){
+            CStaticAssertErrorCondition(Warning, "FileWriterBlockQueue::Open: %s O_DIRECT is not supported for %s. Using the page cache", ownerName.Buffer(), fileNames[i].Buffer());
+            directIO = False;
+            fds[i]   = open(fileNames[i].Buffer(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        }
+        if(fds[i] < 0){
+            CStaticAssertErrorCondition(InitialisationError, "FileWriterBlockQueue::Open: %s Failed opening file: %s", ownerName.Buffer(), fileNames[i].Buffer());
+            Close();
+            return False;
+        }
+        if(preallocateBytes > 0){
+            if(fallocate(fds[i], 0, 0, preallocateBytes) != 0){
+                CStaticAssertErrorCondition(Warning, "FileWriterBlockQueue::Open: %s Failed preallocating %lld bytes for file: %s", ownerName.Buffer(), preallocateBytes, fileNames[i].Buffer());
+            }
+        }
+    }
+
+    if(useIOUring){
+        ring = new FileWriterIOUring();
+        if((ring != NULL) && !ring->Setup(nOfFiles * queueDepth)){
+            delete ring;
+            ring = NULL;
+        }
+        if(ring == NULL){
+            CStaticAssertErrorCondition(Warning, "FileWriterBlockQueue::Open: %s io_uring is not available. Using pwrite", ownerName.Buffer());
+        }
+    }
+    return True;
+}
+
+bool FileWriterBlockQueue::PWriteBlock(int32 file, FileWriterBlock &block){
+    uint32 written = 0;
+    while(written < block.size){
+        ssize_t ret = pwrite(fds[file], block.data + written, block.size - written, block.offset + written);
+        if((ret < 0) && (errno == EINTR)) continue;
+        uint32 done = (ret > 0) ? (uint32)ret : 0;
+        // O_DIRECT needs an aligned buffer and offset: resume from the last aligned byte
+        if(directIO && ((written + done) < block.size)) done -= (written + done) % FWBQ_BLOCK_ALIGNMENT;
+        if(done == 0){
+            CStaticAssertErrorCondition(FatalError, "FileWriterBlockQueue::PWriteBlock: %s Failed writing %d bytes at offset %lld of file %d", ownerName.Buffer(), block.size, block.offset, file);
+            writeErrors++;
+            return False;
+        }
+        written += done;
+    }
+    completedBytes += block.size;
+    return True;
+}
+
+bool FileWriterBlockQueue::SubmitBlock(int32 file, int32 blockIdx){
+    FileWriterBlock &block = blocks[file * queueDepth + blockIdx];
+    if(ring != NULL){
+        block.iov.iov_base = block.data;
+        block.iov.iov_len  = block.size;
+        block.busy         = True;
+        inFlight++;
+        if(ring->Submit(fds[file], &block.iov, block.offset, file * queueDepth + blockIdx)){
+            return True;
+        }
+        CStaticAssertErrorCondition(Warning, "FileWriterBlockQueue::SubmitBlock: %s io_uring submission failed. Writing synchronously", ownerName.Buffer());
+        block.busy = False;
+        inFlight--;
+    }
+    return PWriteBlock(file, block);
+}
+
+void FileWriterBlockQueue::Complete(int32 file, FileWriterBlock &block, int32 result){
+    if(result < 0){
+        CStaticAssertErrorCondition(FatalError, "FileWriterBlockQueue::Complete: %s Failed writing %d bytes at offset %lld of file %d: %s", ownerName.Buffer(), block.size, block.offset, file, strerror(-result));
+        writeErrors++;
+    }
+    else if((uint32)result < block.size){
+        // Short write, the remainder is written synchronously. With O_DIRECT
+        // it starts at the last aligned byte
+        uint32 done = (uint32)result;
+        if(directIO) done -= done % FWBQ_BLOCK_ALIGNMENT;
+        FileWriterBlock remainder;
+        remainder.data   = block.data + done;
+        remainder.size   = block.size - done;
+        remainder.offset = block.offset + done;
+        completedBytes  += done;
+        PWriteBlock(file, remainder);
+    }
+    else{
+        completedBytes += block.size;
+    }
+    block.busy = False;
+    inFlight--;
+}
+
+bool FileWriterBlockQueue::Reap(bool wait){
+    if(ring == NULL) return True;
+    int32  errors   = writeErrors;
+    uint64 userData = 0;
+    int32  result   = 0;
+    bool   reaped   = False;
+    while(!reaped){
+        while(ring->Next(userData, result)){
+            int32 idx = (int32)userData;
+            Complete(idx / queueDepth, blocks[idx], result);
+            reaped = True;
+        }
+        if(!wait) break;
+        if(!reaped && !ring->Wait()){
+            CStaticAssertErrorCondition(FatalError, "FileWriterBlockQueue::Reap: %s Failed waiting for io_uring completions", ownerName.Buffer());
+            return False;
+        }
+    }
+    return (errors == writeErrors);
+}
+
+bool FileWriterBlockQueue::Append(int32 file, const char *data, uint32 size){
+    bool ok = True;
+    while(size > 0){
+        int32 b = currentBlock[file];
+        FileWriterBlock &block = blocks[file * queueDepth + b];
+        while(block.busy){
+            if(!Reap(True) && block.busy) return False;
+        }
+        uint32 n = blockSize - currentFill[file];
+        if(n > size) n = size;
+        memcpy(block.data + currentFill[file], data, n);
+        currentFill[file] += n;
+        data              += n;
+        size              -= n;
+        if(currentFill[file] == blockSize){
+            block.size      = blockSize;
+            block.offset    = fileSize[file];
+            fileSize[file] += blockSize;
+            ok = SubmitBlock(file, b) && ok;
+            currentFill[file]  = 0;
+            currentBlock[file] = (b + 1) % queueDepth;
+        }
+    }
+    return ok;
+}
+
+bool FileWriterBlockQueue::Close(){
+    bool ok = True;
+    int32 i;
+    if(fds != NULL){
+        // Write what is left in the partially filled blocks
+        for(i = 0; i < numberOfFiles; i++){
+            if((fds[i] < 0) || (currentFill[i] == 0)) continue;
+            FileWriterBlock &block = blocks[i * queueDepth + currentBlock[i]];
+            while(block.busy){
+                if(!Reap(True) && block.busy) break;
+            }
+            block.size   = currentFill[i];
+            block.offset = fileSize[i];
+            if(directIO){
+                // O_DIRECT only accepts aligned sizes, the padding is trimmed below
+                block.size = ((block.size + FWBQ_BLOCK_ALIGNMENT - 1) / FWBQ_BLOCK_ALIGNMENT) * FWBQ_BLOCK_ALIGNMENT;
+                memset(block.data + currentFill[i], 0, block.size - currentFill[i]);
+            }
+            fileSize[i]   += currentFill[i];
+            currentFill[i] = 0;
+            ok = SubmitBlock(i, currentBlock[i]) && ok;
+        }
+        while(inFlight > 0){
+            if(!Reap(True)){
+                ok = False;
+                if(inFlight > 0) break;
+            }
+        }
+        for(i = 0; i < numberOfFiles; i++){
+            if(fds[i] < 0) continue;
+            if(ftruncate(fds[i], fileSize[i]) != 0){
+                CStaticAssertErrorCondition(Warning, "FileWriterBlockQueue::Close: %s Failed trimming file %d to %lld bytes", ownerName.Buffer(), i, fileSize[i]);
+            }
+            if(close(fds[i]) != 0){
+                CStaticAssertErrorCondition(FatalError, "FileWriterBlockQueue::Close: %s Failed closing file %d", ownerName.Buffer(), i);
+                ok = False;
+            }
+        }
+        delete []fds;
+        fds = NULL;
+    }
+    if(ring != NULL){
+        delete ring;
+        ring = NULL;
+    }
+    if(blocks != NULL){
+        for(i = 0; i < numberOfBlocks; i++){
+            if(blocks[i].data != NULL) munmap(blocks[i].data, blockSize);
+        }
+        delete []blocks;
+        blocks = NULL;
+    }
+    numberOfBlocks = 0;
+    if(currentBlock != NULL) delete []currentBlock;
+    if(currentFill  != NULL) delete []currentFill;
+    if(fileSize     != NULL) delete []fileSize;
+    currentBlock  = NULL;
+    currentFill   = NULL;
+    fileSize      = NULL;
+    numberOfFiles = 0;
+    inFlight      = 0;
+    return ok;
+}
+
@@ -0,0 +1,198 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they
+   will be approved by the European Commission - subsequent
+   versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the
+   Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in
+   writing, software distributed under the Licence is
+   distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+   express or implied.
+ * See the Licence for the specific language governing
+   permissions and limitations under the Licence.
+ *
+ * $Id$
+ *
+**/
+
+#if !defined (FILE_WRITER_BLOCK_QUEUE)
+#define FILE_WRITER_BLOCK_QUEUE
+
+/**
+ * @file Coalesces the samples written to a set of files into large aligned blocks.
+ * Each file owns a ring of blocks: the samples are appended to the current block
+ * and the block is submitted to the disk as soon as it is full. The blocks are
+ * written with io_uring when available (the kernel completes them asynchronously)
+ * or with pwrite otherwise. The files may be opened with O_DIRECT, in which case
+ * the block size and the file offsets are multiples of FWBQ_BLOCK_ALIGNMENT.
+ * All the methods must be called from the same thread.
+ */
+
+#include "System.h"
+#include "FString.h"
+
+#include <sys/uio.h>
+
+/** Alignment of the blocks in memory, in size and in the file (O_DIRECT requirement) */
+#define FWBQ_BLOCK_ALIGNMENT 4096
+
+class FileWriterIOUring;
+
+/** A staging block */
+class FileWriterBlock{
+public:
+    /** Aligned memory */
+    char         *data;
+    /** Number of bytes to write */
+    uint32        size;
+    /** Offset in the file */
+    int64         offset;
+    /** True while the block is being written */
+    bool          busy;
+    /** Used by the io_uring submission */
+    struct iovec  iov;
+
+    FileWriterBlock(){
+        data   = NULL;
+        size   = 0;
+        offset = 0;
+        busy   = False;
+    }
+};
+
+class FileWriterBlockQueue{
+private:
+    /** The file descriptors */
+    int32              *fds;
+
+    /** Number of files */
+    int32               numberOfFiles;
+
+    /** The blocks, queueDepth per file */
+    FileWriterBlock    *blocks;
+
+    /** Number of blocks per file */
+    int32               queueDepth;
+
+    /** Number of entries of blocks, the ones not yet mapped have NULL data */
+    int32               numberOfBlocks;
+
+    /** Size of each block */
+    uint32              blockSize;
+
+    /** Current block of each file */
+    int32              *currentBlock;
+
+    /** Bytes already in the current block of each file */
+    uint32             *currentFill;
+
+    /** Bytes written to each file */
+    int64              *fileSize;
+
+    /** True if the files were opened with O_DIRECT */
+    bool                directIO;
+
+    /** The io_uring. NULL if pwrite is used */
+    FileWriterIOUring  *ring;
+
+    /** Number of blocks being written */
+    volatile int32      inFlight;
+
+    /** Number of bytes completed since the queue was opened */
+    volatile int64      completedBytes;
+
+    /** Number of failed writes */
+    int32               writeErrors;
+
+    /** Name of the owner, used in the error messages */
+    FString             ownerName;
+
+    /** Writes a block synchronously */
+    bool PWriteBlock(int32 file, FileWriterBlock &block);
+
+    /** Submits a block */
+    bool SubmitBlock(int32 file, int32 blockIdx);
+
+    /** Processes the completed blocks.
+        @param wait If True waits for at least one completion */
+    bool Reap(bool wait);
+
+    /** Handles the completion of a block */
+    void Complete(int32 file, FileWriterBlock &block, int32 result);
+
+public:
+
+    FileWriterBlockQueue();
+
+    ~FileWriterBlockQueue(){
+        Close();
+    }
+
+    /**
+     * Opens (and truncates) the files and allocates the staging blocks
+     * @param fileNames The files to write
+     * @param nOfFiles Number of files
+     * @param minimumBlockSize The block size is this value rounded up to FWBQ_BLOCK_ALIGNMENT
+     * @param depth Number of blocks per file which can be in flight
+     * @param useIOUring If False or not supported by the kernel pwrite is used
+     * @param useDirectIO Open the files with O_DIRECT
+     * @param preallocateBytes If > 0 reserves this space in each file with fallocate
+     * @param owner Name used in the error messages
+     * @return True if all the files were opened
+     */
+    bool Open(FString *fileNames, int32 nOfFiles, uint32 minimumBlockSize, int32 depth, bool useIOUring, bool useDirectIO, int64 preallocateBytes, const char *owner);
+
+    /**
+     * Copies data at the end of a file. Full blocks are submitted.
+     * @return False if a write failed
+     */
+    bool Append(int32 file, const char *data, uint32 size);
+
+    /**
+     * Processes the completed writes without waiting
+     */
+    bool Poll(){
+        return Reap(False);
+    }
+
+    /**
+     * Writes the partially filled blocks, waits for all the writes, trims
+     * the files to the written size and closes them
+     */
+    bool Close();
+
+    /** Number of blocks being written */
+    int32 InFlight() const{
+        return inFlight;
+    }
+
+    /** Number of bytes written to the disk */
+    int64 CompletedBytes() const{
+        return completedBytes;
+    }
+
+    /** Number of failed writes */
+    int32 WriteErrors() const{
+        return writeErrors;
+    }
+
+    /** True if the writes are submitted through io_uring */
+    bool UsingIOUring() const{
+        return (ring != NULL);
+    }
+
+    /** The size of the blocks */
+    uint32 BlockSize() const{
+        return blockSize;
+    }
+};
+
+#endif
+
@@ -45,12 +45,40 @@ void FileWriterDrv::WriteDataToDisk(){
     int64 lastWriteCounter = HRT::HRTCounter();
     int64 ellapsedWriteCounter = lastWriteCounter;
     int64 lastWriteSize = 0;
+    int64 lastCompletedBytes = 0;
     while(running){
         //Wait for the next buffer to be free
         sharedBufferMux.FastLock();
         sharedBufferSem.Reset();
         sharedBufferMux.FastUnLock();
         sharedBufferSem.Wait();
+        if(batchCycles > 0){
+            //Copy to the blocks and release the buffer, the blocks are written when full
+            while(sharedBuffer[i][0] == 1){
+                for(j=0; j<numberOfOutputFiles; j++){
+                    if(!batchQueue.Append(j, (const char *)(&sharedBuffer[i][1] + j * numberOfWordsPerSignal), numberOfBytesPerSignal)){
+                        AssertErrorCondition(FatalError,"FileWriterDrv::WriteDataToDisk: %s Could not write data for file: %s",Name(),outputFilenames[j].Buffer());
+                    }
+                }
+                sharedBufferMux.FastLock();
+                sharedBuffer[i][0] = 0;
+                numberOfFreeBuffers++;
+                sharedBufferMux.FastUnLock();
+                i++;
+                if(i == numberOfBuffers){
+                    i = 0;
+                }
+            }
+            batchQueue.Poll();
+            ellapsedWriteCounter = HRT::HRTCounter() - lastWriteCounter;
+            if(ellapsedWriteCounter * HRT::HRTPeriod() >= 1.0){
+                int64 completedBytes = batchQueue.CompletedBytes();
+                bandwidthToDisk    = (completedBytes - lastCompletedBytes) / (ellapsedWriteCounter * HRT::HRTPeriod());
+                lastCompletedBytes = completedBytes;
+                lastWriteCounter   = HRT::HRTCounter();
+            }
+            continue;
+        }
         while(sharedBuffer[i][0] == 1){
             //Write to disk
             for(j=0; j<numberOfOutputFiles; j++){
@@ -79,10 +107,18 @@ void FileWriterDrv::WriteDataToDisk(){
             }
         } 
     }
-    for(j=0; j<numberOfOutputFiles; j++){
-        AssertErrorCondition(Information,"FileWriterDrv::WriteDataToDisk: %s Closing file: %s",Name(),outputFilenames[j].Buffer());
-        if(!outputFiles[j].Close()){
-            AssertErrorCondition(FatalError,"FileWriterDrv::WriteDataToDisk: %s Failed closing file: %s",Name(),outputFilenames[j].Buffer());
+    if(batchCycles > 0){
+        AssertErrorCondition(Information,"FileWriterDrv::WriteDataToDisk: %s Flushing and closing %d files",Name(),numberOfOutputFiles);
+        if(!batchQueue.Close()){
+            AssertErrorCondition(FatalError,"FileWriterDrv::WriteDataToDisk: %s Failed flushing the files",Name());
+        }
+    }
+    else{
+        for(j=0; j<numberOfOutputFiles; j++){
+            AssertErrorCondition(Information,"FileWriterDrv::WriteDataToDisk: %s Closing file: %s",Name(),outputFilenames[j].Buffer());
+            if(!outputFiles[j].Close()){
+                AssertErrorCondition(FatalError,"FileWriterDrv::WriteDataToDisk: %s Failed closing file: %s",Name(),outputFilenames[j].Buffer());
+            }
         }
     }
     running = True;
@@ -97,8 +133,8 @@ bool FileWriterDrv::ObjectLoadSetup(ConfigurationDataBase &info,StreamInterface
         return False;
     }
 
-    if(numberOfInputChannels != 2) {
-        AssertErrorCondition(InitialisationError,"FileWriterDrv::ObjectLoadSetup: %s GenericAcqModule::ObjectLoadSetup Failed. Please set NumberOfInputs=2 to account for the statistics channels",Name());
+    if((numberOfInputChannels != 2) && (numberOfInputChannels != 4)) {
+        AssertErrorCondition(InitialisationError,"FileWriterDrv::ObjectLoadSetup: %s GenericAcqModule::ObjectLoadSetup Failed. Please set NumberOfInputs=2 (or 4 for the queue depth and dropped cycles) to account for the statistics channels",Name());
         return False;
     }
 
@@ -169,11 +205,34 @@ bool FileWriterDrv::ObjectLoadSetup(ConfigurationDataBase &info,StreamInterface
             return False;
         }
     }
-    int32 j=0;
-    for(j=0; j<numberOfOutputFiles; j++){
-        AssertErrorCondition(Information,"FileWriterDrv::WriteDataToDisk: %s Opening file: %s",Name(),outputFilenames[j].Buffer());
-        if(!outputFiles[j].OpenWrite(outputFilenames[j].Buffer())){
-            AssertErrorCondition(InitialisationError,"FileWriterDrv::WriteDataToDisk: %s Failed opening file: %s",Name(),outputFilenames[j].Buffer());
+    cdb.ReadInt32(batchCycles, "BatchCycles", 0);
+    if(batchCycles > 0){
+        FString writeMethod;
+        cdb.ReadFString(writeMethod, "WriteMethod", "IOUring");
+        if((writeMethod != "IOUring") && (writeMethod != "PWrite")){
+            AssertErrorCondition(InitialisationError,"FileWriterDrv::ObjectLoadSetup: %s WriteMethod must be IOUring or PWrite and not %s",Name(),writeMethod.Buffer());
+            return False;
+        }
+        FString directIO;
+        cdb.ReadFString(directIO, "DirectIO", "False");
+        int32 queueDepth = 0;
+        cdb.ReadInt32(queueDepth, "IOQueueDepth", 4);
+        int32 preallocateMBytes = 0;
+        cdb.ReadInt32(preallocateMBytes, "PreallocateMBytes", 0);
+
+        if(!batchQueue.Open(outputFilenames, numberOfOutputFiles, batchCycles * numberOfBytesPerSignal, queueDepth, (writeMethod == "IOUring"), (directIO == "True"), (int64)preallocateMBytes * 1024 * 1024, Name())){
+            AssertErrorCondition(InitialisationError,"FileWriterDrv::ObjectLoadSetup: %s Failed opening the output files",Name());
+            return False;
+        }
+        AssertErrorCondition(Information,"FileWriterDrv::ObjectLoadSetup: %s Writing blocks of %d bytes per file using %s",Name(),batchQueue.BlockSize(),batchQueue.UsingIOUring() ? "io_uring" : "pwrite");
+    }
+    else{
+        int32 j=0;
+        for(j=0; j<numberOfOutputFiles; j++){
+            AssertErrorCondition(Information,"FileWriterDrv::WriteDataToDisk: %s Opening file: %s",Name(),outputFilenames[j].Buffer());
+            if(!outputFiles[j].OpenWrite(outputFilenames[j].Buffer())){
+                AssertErrorCondition(InitialisationError,"FileWriterDrv::WriteDataToDisk: %s Failed opening file: %s",Name(),outputFilenames[j].Buffer());
+            }
         }
     }
 
@@ -194,6 +253,8 @@ bool FileWriterDrv::ObjectLoadSetup(ConfigurationDataBase &info,StreamInterface
 
 bool FileWriterDrv::StopWriteDataToDiskThread(){
     running = False;
+    //Wake up the thread in case no more data is written
+    sharedBufferSem.Post();
     uint32 counter = 0;
     while(!running){
         if(counter++ > 100){
@@ -267,6 +328,7 @@ bool FileWriterDrv::WriteData(uint32 usecTime, const int32 *ibuffer){
     //has still not consumed the latest buffer...
     sharedBufferMux.FastLock();
     if(sharedBuffer[lastWriteIdx][0] != 0){
+        droppedCycles++;
         AssertErrorCondition(FatalError,"FileWriterDrv::WriteData: %s sharedbuffer overwritten for index: %d. Data lost. Try increasing number of buffers.",Name(),lastWriteIdx);
         sharedBufferMux.FastUnLock();
         return False;
@@ -307,6 +369,12 @@ bool FileWriterDrv::ProcessHttpMessage(HttpStream &hStream) {
     hStream.Printf("<h1>Shared buffer status</h1>\n");
     hStream.Printf("Bandwidth to disk (MB/s) = %f\n<br>\n", bandwidthToDisk/1e6);
     hStream.Printf("Number of free buffers = %d\n<br>\n", numberOfFreeBuffers);
+    hStream.Printf("Dropped cycles = %d\n<br>\n", droppedCycles);
+    if(batchCycles > 0){
+        hStream.Printf("Batch cycles = %d (blocks of %d bytes written with %s)\n<br>\n", batchCycles, batchQueue.BlockSize(), batchQueue.UsingIOUring() ? "io_uring" : "pwrite");
+        hStream.Printf("Blocks being written = %d\n<br>\n", batchQueue.InFlight());
+        hStream.Printf("Write errors = %d\n<br>\n", batchQueue.WriteErrors());
+    }
     /* Data table */
     hStream.Printf("<table border=\"1\" align=\"left\">\n");
     int32 i=0;
@@ -333,6 +401,10 @@ bool FileWriterDrv::ProcessHttpMessage(HttpStream &hStream) {
 int32 FileWriterDrv::GetData(uint32 usecTime, int32 *buffer, int32 bufferNumber) {
     memcpy(buffer, &numberOfFreeBuffers, sizeof(int32));
     memcpy(buffer+1, &bandwidthToDisk, sizeof(float));
+    if(numberOfInputChannels == 4){
+        buffer[2] = batchQueue.InFlight();
+        buffer[3] = droppedCycles;
+    }
     return 0;
 }
 
@@ -31,6 +31,7 @@
 #include "EventSem.h"
 #include "FastPollingMutexSem.h"
 #include "MessageHandler.h"
+#include "FileWriterBlockQueue.h"
 
 OBJECT_DLL(FileWriterDrv)
 class FileWriterDrv:public GenericAcqModule, public MessageHandler{
@@ -123,6 +124,21 @@ private:
      */
     int32 numberOfFreeBuffers;
 
+    /**
+     * Number of cycles lost because the shared buffer was full
+     */
+    int32 droppedCycles;
+
+    /**
+     * If > 0 the samples of BatchCycles cycles are coalesced in a single write per file
+     */
+    int32 batchCycles;
+
+    /**
+     * Used instead of outputFiles when batchCycles > 0
+     */
+    FileWriterBlockQueue batchQueue;
+
     /**
      * The writer thread is stopped by the message
      * This has to be called by the state machine to properly close all the files...
@@ -147,6 +163,8 @@ public:
         threadPriority = 0;
         bandwidthToDisk = 0;
         numberOfFreeBuffers = 0;
+        droppedCycles = 0;
+        batchCycles = 0;
     }
 
     virtual ~FileWriterDrv(){
@@ -179,6 +197,7 @@ public:
      * Reset the internal counters 
      */
     bool PulseStart(){
+        droppedCycles = 0;
         return True;
     }
 
@@ -200,7 +219,9 @@ public:
     /** 
      * Writes the statistics of shared buffer.
      * First channel is the number of free buffer and second the channel
-     * the bandwidth to disk.
+     * the bandwidth to disk (bytes/s, float). If NumberOfInputs = 4 the third
+     * channel is the number of blocks being written and the fourth the number
+     * of dropped cycles.
      */
     int32 GetData(uint32 usecTime, int32 *buffer, int32 bufferNumber = 0);
 
@@ -0,0 +1,202 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+#include "LinuxTimerClock.h"
+#include "ErrorManagement.h"
+#include "Sleep.h"
+#include "HRT.h"
+
+#if defined(_LINUX)
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+/** CLOCK_MONOTONIC in nanoseconds */
+static inline int64 LTCNow(){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64)now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+static inline void LTCToTimespec(int64 nsec, struct timespec &ts){
+    ts.tv_sec  = (time_t)(nsec / 1000000000LL);
+    ts.tv_nsec = (long)(nsec % 1000000000LL);
+}
+#endif
+
+LinuxTimerClock::LinuxTimerClock(){
+    nature                = Default;
+    periodNsec            = 1000000;
+    nonBusySleepPeriodSec = 0.0;
+    maxBusyWaitWindowNsec = 0;
+    autoBusyWaitWindow    = False;
+    nextDeadline          = 0;
+    lastTickCounter       = 0;
+    timerFd               = -1;
+    latencyCycles         = 0;
+    resetStatistics       = False;
+    lastWakeUpErrorNsec   = 0;
+    maxWakeUpErrorNsec    = 0;
+    missedTicks           = 0;
+    busyWaitWindowNsec    = 0;
+}
+
+bool LinuxTimerClock::Init(LinuxTimerSleepNature sleepNature, int32 periodUsec, int32 nonBusySleepPeriodUsec, int32 busyWaitWindowUsec, bool autoWindow){
+    Close();
+    nature                = sleepNature;
+    periodNsec            = (int64)periodUsec * 1000;
+    nonBusySleepPeriodSec = nonBusySleepPeriodUsec * 1E-6;
+    maxBusyWaitWindowNsec = (int64)busyWaitWindowUsec * 1000;
+    autoBusyWaitWindow    = autoWindow;
+    busyWaitWindowNsec    = (int32)maxBusyWaitWindowNsec;
+    latencyCycles         = 0;
+    wakeUpLatency.Reset();
+    wakeUpErrors.Reset();
+    lastTickCounter       = HRT::HRTCounter();
+
+    if((nature == Default) || (nature == Busy) || (nature == SemiBusy)) return True;
+
+#if defined(_LINUX)
+    nextDeadline = LTCNow() + periodNsec;
+    if(nature == AbsoluteDeadline) return True;
+    if(nature == TimerFD){
+        timerFd = timerfd_create(CLOCK_MONOTONIC, 0);
+        if(timerFd < 0){
+            CStaticAssertErrorCondition(InitialisationError, "LinuxTimerClock::Init: timerfd_create failed: %s", strerror(errno));
+            return False;
+        }
+        return ArmTimerFd();
+    }
+#endif
+    CStaticAssertErrorCondition(InitialisationError, "LinuxTimerClock::Init: sleep nature %d not supported on this platform", nature);
+    return False;
+}
+
+void LinuxTimerClock::Close(){
+#if defined(_LINUX)
+    if(timerFd >= 0) close(timerFd);
+#endif
+    timerFd = -1;
+}
+
+bool LinuxTimerClock::ArmTimerFd(){
+#if defined(_LINUX)
+    struct itimerspec spec;
+    LTCToTimespec(nextDeadline - busyWaitWindowNsec, spec.it_value);
+    LTCToTimespec(periodNsec, spec.it_interval);
+    if(timerfd_settime(timerFd, TFD_TIMER_ABSTIME, &spec, NULL) != 0){
+        CStaticAssertErrorCondition(FatalError, "LinuxTimerClock::ArmTimerFd: timerfd_settime failed: %s", strerror(errno));
+        return False;
+    }
+    return True;
+#else
+    return False;
+#endif
+}
+
+void LinuxTimerClock::Account(int64 wakeUpErrorNsec, int64 sleepLatencyNsec, uint32 missed){
+    if(resetStatistics){
+        resetStatistics    = False;
+        maxWakeUpErrorNsec = 0;
+        missedTicks        = 0;
+        wakeUpErrors.Reset();
+    }
+
+    int64 absoluteError = (wakeUpErrorNsec < 0) ? -wakeUpErrorNsec : wakeUpErrorNsec;
+    if(absoluteError > 0x7FFFFFFF) absoluteError = 0x7FFFFFFF;
+    lastWakeUpErrorNsec = (wakeUpErrorNsec < 0) ? -(int32)absoluteError : (int32)absoluteError;
+    if(absoluteError > maxWakeUpErrorNsec) maxWakeUpErrorNsec = (int32)absoluteError;
+    missedTicks += missed;
+    wakeUpErrors.Add((uint32)absoluteError);
+
+    if(!autoBusyWaitWindow) return;
+    if(sleepLatencyNsec < 0) sleepLatencyNsec = 0;
+    if(sleepLatencyNsec > 0x7FFFFFFF) sleepLatencyNsec = 0x7FFFFFFF;
+    wakeUpLatency.Add((uint32)sleepLatencyNsec);
+    if(++latencyCycles < LTC_AUTO_WINDOW_CYCLES) return;
+
+    int64 window = wakeUpLatency.Percentile(0.999);
+    if(window > maxBusyWaitWindowNsec) window = maxBusyWaitWindowNsec;
+    busyWaitWindowNsec = (int32)window;
+    latencyCycles      = 0;
+    wakeUpLatency.Reset();
+}
+
+uint32 LinuxTimerClock::WaitNextTick(){
+    if((nature == Default) || (nature == Busy) || (nature == SemiBusy)){
+        // the time spent since the previous tick is not slept
+        double hrtPeriod      = HRT::HRTPeriod();
+        double timeCorrection = (HRT::HRTCounter() - lastTickCounter) * hrtPeriod;
+        double sleepSec       = periodNsec * 1E-9 - timeCorrection;
+        if(nature == Busy) {
+            SleepBusy(sleepSec);
+        } else if(nature == SemiBusy) {
+            SleepSemiBusy(sleepSec, nonBusySleepPeriodSec);
+        } else {
+            SleepNoMore(sleepSec);
+        }
+        int64 now = HRT::HRTCounter();
+        int64 cycleNsec = (int64)((now - lastTickCounter) * hrtPeriod * 1E9);
+        lastTickCounter = now;
+        Account(cycleNsec - periodNsec, 0, 0);
+        return 0;
+    }
+
+#if defined(_LINUX)
+    int64 window   = busyWaitWindowNsec;
+    int64 wakeUpAt = nextDeadline - window;
+    uint32 missed  = 0;
+
+    if(nature == AbsoluteDeadline){
+        struct timespec ts;
+        LTCToTimespec(wakeUpAt, ts);
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+    } else {
+        uint64 expirations = 0;
+        while((read(timerFd, &expirations, sizeof(expirations)) < 0) && (errno == EINTR));
+        if(expirations > 1) missed = (uint32)(expirations - 1);
+        nextDeadline += missed * periodNsec;
+    }
+
+    int64 now          = LTCNow();
+    int64 sleepLatency = now - wakeUpAt - missed * periodNsec;
+    // the timerfd expirations already account the late ticks
+    if((nature == AbsoluteDeadline) && (now - nextDeadline >= periodNsec)){
+        uint32 late   = (uint32)((now - nextDeadline) / periodNsec);
+        missed       += late;
+        nextDeadline += late * periodNsec;
+    }
+    while(now < nextDeadline) now = LTCNow();
+
+    Account(now - nextDeadline, sleepLatency, missed);
+    nextDeadline += periodNsec;
+
+    // a new window moves the expirations of the timerfd
+    if((nature == TimerFD) && (busyWaitWindowNsec != window)) ArmTimerFd();
+    return missed;
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * The periodic wait of the LinuxTimerDrv thread.
+ *
+ * The Default, Busy and SemiBusy natures sleep for a period (less the time
+ * spent since the previous tick) relative to the moment they are called, so
+ * the delays accumulate. The AbsoluteDeadline and TimerFD natures wait for
+ * deadlines which are multiples of the period from the start:
+ *  - AbsoluteDeadline sleeps with clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME)
+ *  - TimerFD reads a periodic timerfd, whose expiration count gives the overruns
+ * Both can wake up a short window before the deadline and busy wait for
+ * the rest. The window is either fixed or, with AutoBusyWaitWindow, set
+ * to the 99.9 percentile of the wake-up latency of the previous
+ * LTC_AUTO_WINDOW_CYCLES cycles (bounded by the configured window).
+ * A deadline which is already one or more periods old is skipped and
+ * counted as missed.
+ */
+#if !defined (_LINUX_TIMER_CLOCK_H)
+#define _LINUX_TIMER_CLOCK_H
+
+#include "System.h"
+#include "RTLatencyHistogram.h"
+
+enum LinuxTimerSleepNature {
+  Default          = 0,
+  Busy             = 1,
+  SemiBusy         = 2,
+  AbsoluteDeadline = 3,
+  TimerFD          = 4
+};
+
+/** Number of cycles after which the automatic busy wait window is updated */
+#define LTC_AUTO_WINDOW_CYCLES 1024
+
+class LinuxTimerClock{
+private:
+    /** How the period is waited */
+    LinuxTimerSleepNature   nature;
+
+    /** The period in nanoseconds */
+    int64                   periodNsec;
+
+    /** Used only in the SemiBusy case */
+    double                  nonBusySleepPeriodSec;
+
+    /** The largest busy wait window in nanoseconds */
+    int64                   maxBusyWaitWindowNsec;
+
+    /** Adapt the window to the measured wake-up latency */
+    bool                    autoBusyWaitWindow;
+
+    /** The next deadline (CLOCK_MONOTONIC nanoseconds) */
+    int64                   nextDeadline;
+
+    /** The HRT counter when the previous tick was returned */
+    int64                   lastTickCounter;
+
+    /** The timerfd of the TimerFD nature */
+    int32                   timerFd;
+
+    /** Number of cycles accounted in wakeUpLatency */
+    int32                   latencyCycles;
+
+    /** How late the sleep returned compared with the requested wake up time */
+    RTLatencyHistogram      wakeUpLatency;
+
+    /** Set by ResetStatistics, served by the timer thread */
+    volatile bool           resetStatistics;
+
+    /** Arms the timerfd so that it expires one window before each deadline */
+    bool ArmTimerFd();
+
+    /** Accounts a tick and updates the window */
+    void Account(int64 wakeUpErrorNsec, int64 sleepLatencyNsec, uint32 missed);
+
+public:
+
+    /** Error of the last tick compared with its deadline in nanoseconds */
+    volatile int32          lastWakeUpErrorNsec;
+
+    /** Largest absolute error since the statistics were reset */
+    volatile int32          maxWakeUpErrorNsec;
+
+    /** Number of deadlines skipped since the statistics were reset */
+    volatile int32          missedTicks;
+
+    /** The busy wait window in use in nanoseconds */
+    volatile int32          busyWaitWindowNsec;
+
+    /** Absolute error of each tick in nanoseconds */
+    RTLatencyHistogram      wakeUpErrors;
+
+    LinuxTimerClock();
+
+    ~LinuxTimerClock(){
+        Close();
+    }
+
+    /**
+     * Prepares the clock. Must be called by the thread which waits for the ticks.
+     * @param sleepNature How the period is waited
+     * @param periodUsec The period
+     * @param nonBusySleepPeriodUsec The non busy part of the SemiBusy nature
+     * @param busyWaitWindowUsec The busy wait before the deadline (AbsoluteDeadline and TimerFD)
+     * @param autoWindow Adapt the window to the measured latency, up to busyWaitWindowUsec
+     * @return False if the nature is not supported
+     */
+    bool Init(LinuxTimerSleepNature sleepNature, int32 periodUsec, int32 nonBusySleepPeriodUsec, int32 busyWaitWindowUsec, bool autoWindow);
+
+    /**
+     * Waits for the next tick
+     * @return The number of ticks skipped because their deadline had passed
+     */
+    uint32 WaitNextTick();
+
+    /** Releases the timerfd */
+    void Close();
+
+    /** Clears the statistics at the next tick */
+    void ResetStatistics(){
+        resetStatistics = True;
+    }
+};
+
+#endif
@@ -42,25 +42,24 @@ void __thread_decl TimerThread(void* data){
     Threads::SetRealTimeClass();
     Threads::SetPriorityLevel(32);
 	
+    // The clock must be created by the thread which waits
+    if (!Timer->clock.Init(Timer->busy, Timer->timerPeriodUsec, Timer->nonBusySleepPeriodUsec, Timer->busyWaitWindowUsec, Timer->autoBusyWaitWindow)) {
+        CStaticAssertErrorCondition(InitialisationError,"LinuxTimerDrv::TimerThread: %s failed to initialise the clock", Timer->Name());
+        Timer->keepAlive = False;
+        Timer->StartStopSem.Post();
+        return;
+    }
+
     // Signal correct initialization to ObjectLoadSetup
     Timer->StartStopSem.Post();
 
-    double hrtPeriod = HRT::HRTPeriod();
-	
     // Main cycle
     while (Timer->keepAlive) {
-        if(Timer->busy == Busy) {
-	    SleepBusy((Timer->timerPeriodUsec)*1E-6 - Timer->timeCorrection);
-        } else if(Timer->busy == SemiBusy) {
-	    SleepSemiBusy((Timer->timerPeriodUsec)*1E-6 - Timer->timeCorrection, Timer->nonBusySleepPeriodUsec*1E-6);
-        } else {
-	    SleepNoMore((Timer->timerPeriodUsec)*1E-6 - Timer->timeCorrection);
-	}
+        Timer->clock.WaitNextTick();
         // Update localTime
-	int64 timeMeasurement = HRT::HRTCounter();
     	Timer->InterruptServiceRoutine();
-	Timer->timeCorrection = (HRT::HRTCounter() - timeMeasurement) * hrtPeriod;
     }
+    Timer->clock.Close();
     
     // Signal correct end of execution to LinuxTimerDrv deconstructor
     Timer->StartStopSem.Post();
@@ -73,10 +72,12 @@ LinuxTimerDrv::LinuxTimerDrv(){
     // Init sem
     StartStopSem.Create();
     pollSynchSem.Create();
-    localTime      = 0;
-    timeCorrection = 0;
-    busy           = Default;
-    usePolling     = False;
+    localTime              = 0;
+    busy                   = Default;
+    nonBusySleepPeriodUsec = 0;
+    busyWaitWindowUsec     = 0;
+    autoBusyWaitWindow     = False;
+    usePolling             = False;
 }
 
 
@@ -112,11 +113,28 @@ bool LinuxTimerDrv::ObjectLoadSetup(ConfigurationDataBase &info,StreamInterface
 	    AssertErrorCondition(Warning, "LinuxTimerDrv::ObjectLoadSetup: %s NonBusySleepPeriodUsec > TimerPeriodUsec", Name());
 	    return False;
 	}
+    } else if(sleepNatureStr == "AbsoluteDeadline") {
+        busy = AbsoluteDeadline;
+    } else if(sleepNatureStr == "TimerFD") {
+        busy = TimerFD;
     } else {
         AssertErrorCondition(Warning, "LinuxTimerDrv::ObjectLoadSetup: %s SleepNature parameter with unknown value, assuming %s", Name(), sleepNatureStr.Buffer());
         busy = Default;
     }
 
+    if((busy == AbsoluteDeadline) || (busy == TimerFD)) {
+        FString autoWindowStr;
+        cdb.ReadFString(autoWindowStr, "AutoBusyWaitWindow", "False");
+        autoBusyWaitWindow = ((autoWindowStr == "True") || (autoWindowStr == "true") || (autoWindowStr == "yes"));
+        // With the automatic window the default bound is a quarter of the period
+        cdb.ReadInt32(busyWaitWindowUsec, "BusyWaitWindowUsec", autoBusyWaitWindow ? timerPeriodUsec / 4 : 0);
+        if((busyWaitWindowUsec < 0) || (busyWaitWindowUsec >= timerPeriodUsec)) {
+            AssertErrorCondition(InitialisationError, "LinuxTimerDrv::ObjectLoadSetup: %s BusyWaitWindowUsec must be in [0, TimerPeriodUsec)", Name());
+            return False;
+        }
+        AssertErrorCondition(Information, "LinuxTimerDrv::ObjectLoadSetup: %s %s with a busy wait window of %d microseconds%s", Name(), sleepNatureStr.Buffer(), busyWaitWindowUsec, autoBusyWaitWindow ? " (upper bound)" : "");
+    }
+
     FString usePollingStr;
     cdb.ReadFString(usePollingStr, "UsePolling", "no");
     usePolling = ((usePollingStr == "yes") || (usePollingStr == "True") || (usePollingStr == "Yes") || (usePollingStr == "true"));
@@ -134,6 +152,11 @@ bool LinuxTimerDrv::ObjectLoadSetup(ConfigurationDataBase &info,StreamInterface
     // Wait for the thread to start
     StartStopSem.Wait();
 
+    if (!keepAlive) {
+        AssertErrorCondition(InitialisationError, "LinuxTimerDrv::ObjectLoadSetup: %s the timer thread failed to start", Name());
+        return False;
+    }
+
     return True;
 }
 
@@ -143,6 +166,11 @@ int32 LinuxTimerDrv::GetData(uint32 usecTime, int32 *buffer, int32 bufferNumber)
     buffer[0] = (int32)(localTime);
     // Packet Usec Time
     buffer[1] = (int32)(localTime * timerPeriodUsec);
+    // Optional statistics of the timer thread
+    if(numberOfInputChannels > 2) buffer[2] = clock.lastWakeUpErrorNsec;
+    if(numberOfInputChannels > 3) buffer[3] = clock.maxWakeUpErrorNsec;
+    if(numberOfInputChannels > 4) buffer[4] = clock.missedTicks;
+    if(numberOfInputChannels > 5) buffer[5] = clock.busyWaitWindowNsec;
     return True;
 }
 
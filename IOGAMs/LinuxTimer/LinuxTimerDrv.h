@@ -30,12 +30,7 @@
 #include "GenericAcqModule.h"
 #include "FString.h"
 #include "File.h"
-
-enum LinuxTimerSleepNature {
-  Default  = 0,
-  Busy     = 1,
-  SemiBusy = 2
-};
+#include "LinuxTimerClock.h"
 
 OBJECT_DLL(LinuxTimerDrv)
 
@@ -60,8 +55,12 @@ private:
     LinuxTimerSleepNature busy;
     // Used only in the SemiBusy case
     int32 nonBusySleepPeriodUsec;
-    //
-    double timeCorrection;
+    // Largest busy wait before the deadline (AbsoluteDeadline and TimerFD)
+    int32 busyWaitWindowUsec;
+    // Adapt the busy wait window to the measured wake-up latency
+    bool autoBusyWaitWindow;
+    // Waits for the ticks and keeps the wake-up statistics
+    LinuxTimerClock clock;
 
     /** Constructor */
     LinuxTimerDrv();
@@ -75,7 +74,11 @@ private:
     // Object Description
     virtual bool ObjectDescription(StreamInterface &s,bool full = False, StreamInterface *err=NULL);
 
-    // Get Data
+    /** Get Data. buffer[0] is the packet number and buffer[1] the time in microseconds.
+        With NumberOfInputs > 2 the following channels give the statistics of the timer thread:
+        buffer[2] wake-up error of the last tick (ns), buffer[3] largest absolute error (ns),
+        buffer[4] number of missed ticks and buffer[5] the busy wait window in use (ns).
+        The statistics are cleared by PulseStart */
     int32 GetData(uint32 usecTime, int32 *buffer, int32 bufferNumber = 0);
 
     /** Update the output of the module using n = numberOfOutputChannels data word of the source buffer starting from absoluteOutputPosition */
@@ -119,6 +122,7 @@ private:
 public:
     bool PulseStart(){
         localTime = 0;
+        clock.ResetStatistics();
         return True;
     }
 
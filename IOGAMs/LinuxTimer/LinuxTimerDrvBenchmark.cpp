@@ -0,0 +1,103 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Jitter of the LinuxTimerDrv sleep natures.
+ * For each nature the clock runs for a number of ticks and reports the
+ * wake-up error percentiles, the missed ticks, the drift of the last tick
+ * from its ideal time and the CPU used by the waiting thread.
+ * The Default, Busy and SemiBusy errors are relative to the previous tick,
+ * the AbsoluteDeadline and TimerFD errors are relative to the deadline.
+ * Usage: LinuxTimerDrvBenchmark.ex [periodUsec] [nOfTicks] [busyWaitWindowUsec]
+ */
+
+#include "System.h"
+#include "Threads.h"
+#include "LinuxTimerClock.h"
+
+#include <time.h>
+
+static double ThreadCPUSeconds(){
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1E-9;
+}
+
+static double MonotonicSeconds(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1E-9;
+}
+
+static void RunTest(const char *name, LinuxTimerSleepNature nature, int32 periodUsec, int32 nOfTicks, int32 windowUsec, bool autoWindow){
+    LinuxTimerClock clock;
+    if(!clock.Init(nature, periodUsec, periodUsec * 3 / 4, windowUsec, autoWindow)){
+        printf("%-26s not supported\n", name);
+        return;
+    }
+
+    double startWall = MonotonicSeconds();
+    double startCPU  = ThreadCPUSeconds();
+    for(int32 i = 0; i < nOfTicks; i++){
+        clock.WaitNextTick();
+    }
+    double wall = MonotonicSeconds() - startWall;
+    double cpu  = ThreadCPUSeconds() - startCPU;
+    clock.Close();
+
+    RTLatencyHistogram errors;
+    clock.wakeUpErrors.Snapshot(errors);
+    double driftUsec = (wall - (nOfTicks * periodUsec * 1E-6)) * 1E6;
+    printf("%-26s %8.1f %8.1f %8.1f %8.1f %7d %10.1f %6.1f%% %8.1f\n", name,
+           errors.Percentile(0.5) * 1E-3, errors.Percentile(0.99) * 1E-3,
+           errors.Percentile(0.999) * 1E-3, errors.Max() * 1E-3,
+           clock.missedTicks, driftUsec, 100.0 * cpu / wall, clock.busyWaitWindowNsec * 1E-3);
+}
+
+int main(int argc, char **argv){
+    int32 periodUsec = (argc > 1) ? atoi(argv[1]) : 1000;
+    int32 nOfTicks   = (argc > 2) ? atoi(argv[2]) : 5000;
+    int32 windowUsec = (argc > 3) ? atoi(argv[3]) : periodUsec / 10;
+    if((periodUsec < 10) || (nOfTicks < 1) || (windowUsec < 0) || (windowUsec >= periodUsec)){
+        printf("Usage: LinuxTimerDrvBenchmark.ex [periodUsec] [nOfTicks] [busyWaitWindowUsec]\n");
+        return -1;
+    }
+
+    Threads::SetRealTimeClass();
+    Threads::SetPriorityLevel(32);
+
+    printf("period %d us, %d ticks, busy wait window %d us\n", periodUsec, nOfTicks, windowUsec);
+    printf("%-26s %8s %8s %8s %8s %7s %10s %7s %8s\n", "nature (errors in us)", "p50", "p99", "p99.9", "max", "missed", "drift us", "cpu", "window");
+    RunTest("Default",                  Default,          periodUsec, nOfTicks, 0,          False);
+    RunTest("SemiBusy",                 SemiBusy,         periodUsec, nOfTicks, 0,          False);
+    RunTest("Busy",                     Busy,             periodUsec, nOfTicks, 0,          False);
+    RunTest("AbsoluteDeadline",         AbsoluteDeadline, periodUsec, nOfTicks, 0,          False);
+    RunTest("AbsoluteDeadline+window",  AbsoluteDeadline, periodUsec, nOfTicks, windowUsec, False);
+    RunTest("AbsoluteDeadline+auto",    AbsoluteDeadline, periodUsec, nOfTicks, windowUsec, True);
+    RunTest("TimerFD",                  TimerFD,          periodUsec, nOfTicks, 0,          False);
+    RunTest("TimerFD+window",           TimerFD,          periodUsec, nOfTicks, windowUsec, False);
+    RunTest("TimerFD+auto",             TimerFD,          periodUsec, nOfTicks, windowUsec, True);
+    return 0;
+}
@@ -117,6 +117,11 @@ public:
 	return outputModule->IsSynchronizing();
     }
 
+    /** Returns the driver of the GAM */
+    virtual GCReference AcquisitionModule(){
+        return outputModule;
+    }
+
 };
 
 
@@ -37,25 +37,70 @@ bool SharedMemoryDrv::ObjectLoadSetup(ConfigurationDataBase &info,StreamInterfac
     cdb.ReadInt32(readMemKey,  "ReadMemKey", -1);
     cdb.ReadInt32(writeMemKey, "WriteMemKey", -1);
 
+    FString synchronisation;
+    cdb.ReadFString(synchronisation, "Synchronisation", "None");
+    if(synchronisation == "SeqLock"){
+        useFrames = True;
+    }
+    else if(synchronisation == "None"){
+        useFrames = False;
+    }
+    else{
+        AssertErrorCondition(InitialisationError,"SharedMemoryDrv::ObjectLoadSetup: %s unknown Synchronisation %s. Use None or SeqLock",Name(),synchronisation.Buffer());
+        return False;
+    }
+    // Both the reader and the writer of an area must use the same number of slots
+    cdb.ReadInt32(numberOfSlots, "NumberOfSlots", 2);
+    if(numberOfSlots < 1){
+        AssertErrorCondition(InitialisationError,"SharedMemoryDrv::ObjectLoadSetup: %s NumberOfSlots must be > 0",Name());
+        return False;
+    }
+    FString ring;
+    cdb.ReadFString(ring, "Doorbell", "True");
+    doorbell = (ring == "True");
+
     if(readMemKey == -1 && writeMemKey == -1){
         AssertErrorCondition(InitialisationError,"SharedMemoryDrv::ObjectLoadSetup: either a read or a write key must be specified. Both are -1",Name());
         return False;
     }
 
     if(readMemKey != -1){
-        readMemSize = NumberOfInputs() *  sizeof(int32);
-        readMem     = (char *)SharedMemoryAlloc(readMemKey, readMemSize);
+        readMemSize    = NumberOfInputs() *  sizeof(int32);
+        int32 areaSize = readMemSize;
+        if(useFrames){
+            areaSize = SharedMemoryFrameBuffer::SegmentSize(readMemSize, numberOfSlots);
+        }
+        readMem     = (char *)SharedMemoryAlloc(readMemKey, areaSize);
         if(readMem == NULL){
-            AssertErrorCondition(InitialisationError,"SharedMemoryDrv::ObjectLoadSetup: failed to allocated %d bytes for the read memory",Name(),readMemSize);
+            AssertErrorCondition(InitialisationError,"SharedMemoryDrv::ObjectLoadSetup: failed to allocated %d bytes for the read memory",Name(),areaSize);
             return False;
         }
+        if(useFrames){
+            lastFrame = (int32 *)malloc(readMemSize);
+            nextFrame = (int32 *)malloc(readMemSize);
+            if((lastFrame == NULL) || (nextFrame == NULL)){
+                AssertErrorCondition(InitialisationError,"SharedMemoryDrv::ObjectLoadSetup: %s failed to allocate the frame buffers",Name());
+                return False;
+            }
+            memset(lastFrame, 0, readMemSize);
+            // The writer may not be running yet: GetData retries
+            AttachReadFrames();
+        }
     }
 
     if(writeMemKey != -1){
-        writeMemSize = NumberOfOutputs() *  sizeof(int32);
-        writeMem     = (char *)SharedMemoryAlloc(writeMemKey, writeMemSize);
+        writeMemSize   = NumberOfOutputs() *  sizeof(int32);
+        int32 areaSize = writeMemSize;
+        if(useFrames){
+            areaSize = SharedMemoryFrameBuffer::SegmentSize(writeMemSize, numberOfSlots);
+        }
+        writeMem     = (char *)SharedMemoryAlloc(writeMemKey, areaSize);
         if(writeMem == NULL){
-            AssertErrorCondition(InitialisationError,"SharedMemoryDrv::ObjectLoadSetup: failed to allocated %d bytes for the write memory",Name(),writeMemSize);
+            AssertErrorCondition(InitialisationError,"SharedMemoryDrv::ObjectLoadSetup: failed to allocated %d bytes for the write memory",Name(),areaSize);
+            return False;
+        }
+        if(useFrames && !writeFrames.Initialise(writeMem, writeMemSize, numberOfSlots)){
+            AssertErrorCondition(InitialisationError,"SharedMemoryDrv::ObjectLoadSetup: %s failed to initialise the write frames",Name());
             return False;
         }
     }
@@ -68,14 +113,88 @@ bool SharedMemoryDrv::ObjectLoadSetup(ConfigurationDataBase &info,StreamInterfac
  */
 int32 SharedMemoryDrv::GetData(uint32 usecTime, int32 *ibuffer, int32 bufferNumber){
     lastUsecTime = *ibuffer;
-    memcpy(ibuffer, readMem, readMemSize);
+    if(!useFrames){
+        memcpy(ibuffer, readMem, readMemSize);
+        return 1;
+    }
+
+    if(readFrames.IsValid() || AttachReadFrames()){
+        uint32 missed = 0;
+        SharedMemoryFrameStatus status = readFrames.Read(nextFrame, lastFrameCount, missed);
+        if(status == SMFNew){
+            int32 *temp  = lastFrame;
+            lastFrame    = nextFrame;
+            nextFrame    = temp;
+            missedFrames += missed;
+        }
+        else if(status == SMFTorn){
+            tornReads++;
+        }
+        else if(status == SMFDetached){
+            // Attached again, and the layout checked, in the next cycle
+            AssertErrorCondition(Warning,"SharedMemoryDrv::GetData: %s the writer changed the layout of the shared memory",Name());
+            readFrames.Detach();
+            layoutChanges++;
+            staleFrames++;
+        }
+        else{
+            staleFrames++;
+        }
+    }
+    else{
+        staleFrames++;
+    }
+    // On failure the last complete frame is repeated
+    memcpy(ibuffer, lastFrame, readMemSize);
     return 1;
 }
 
 bool SharedMemoryDrv::WriteData(uint32 usecTime, const int32* buffer){
+    if(useFrames){
+        writeFrames.Publish(buffer, doorbell);
+        return True;
+    }
     memcpy(writeMem, buffer, writeMemSize);
     return True;
 }
 
+bool SharedMemoryDrv::AttachReadFrames(){
+    if(!readFrames.Attach(readMem, readMemSize)){
+        failedAttaches++;
+        return False;
+    }
+    if(readFrames.NumberOfSlots() != (uint32)numberOfSlots){
+        // Retried by GetData in every cycle: only the first mismatch is logged
+        if(!slotMismatchReported){
+            AssertErrorCondition(FatalError,"SharedMemoryDrv::AttachReadFrames: %s the writer uses %d slots instead of %d",Name(),readFrames.NumberOfSlots(),numberOfSlots);
+            slotMismatchReported = True;
+        }
+        readFrames.Detach();
+        failedAttaches++;
+        return False;
+    }
+    slotMismatchReported = False;
+    lastFrameCount       = 0;
+    return True;
+}
+
+bool SharedMemoryDrv::ObjectDescription(StreamInterface &s,bool full,StreamInterface *er){
+    s.Printf("%s %s\n",ClassName(),Version());
+    s.Printf("Module Name --> %s\n",Name());
+    s.Printf("ReadMemKey               = %d\n",readMemKey);
+    s.Printf("WriteMemKey              = %d\n",writeMemKey);
+    s.Printf("Synchronisation          = %s\n",useFrames ? "SeqLock" : "None");
+    if(useFrames){
+        s.Printf("NumberOfSlots            = %d\n",numberOfSlots);
+        s.Printf("Frames written           = %u\n",writeFrames.FrameCount());
+        s.Printf("Stale frames             = %u\n",staleFrames);
+        s.Printf("Missed frames            = %u\n",missedFrames);
+        s.Printf("Torn reads               = %u\n",tornReads);
+        s.Printf("Failed attaches          = %u\n",failedAttaches);
+        s.Printf("Layout changes           = %u\n",layoutChanges);
+    }
+    return True;
+}
+
 OBJECTLOADREGISTER(SharedMemoryDrv, "$Id$")
 
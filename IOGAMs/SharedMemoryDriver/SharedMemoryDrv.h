@@ -29,11 +29,16 @@
  * @file
  * A driver which reads/writes values to a shared memory area.
  * If used as a time input source, it assumes that the first
- * 4 bytes are the time in microseconds
+ * 4 bytes are the time in microseconds.
+ * With Synchronisation = "SeqLock" the areas are laid out as described in
+ * SharedMemoryFrame.h: the writer never blocks and the reader always gets a
+ * complete frame, knowing if it is new, repeated or if frames were lost.
+ * Otherwise the values are copied to/from the area without any protection.
  */
 
 #include "System.h"
 #include "GenericAcqModule.h"
+#include "SharedMemoryFrame.h"
 
 OBJECT_DLL(SharedMemoryDrv)
 class SharedMemoryDrv:public GenericAcqModule{
@@ -68,6 +73,73 @@ private:
     int32 readMemSize;
     int32 writeMemSize;
 
+    /**
+     * True if the areas are protected by a seqlock
+     */
+    bool  useFrames;
+
+    /**
+     * Number of frames in the ring of the write memory
+     */
+    int32 numberOfSlots;
+
+    /**
+     * Wake up the readers waiting for a frame
+     */
+    bool  doorbell;
+
+    /**
+     * The framed read and write areas
+     */
+    SharedMemoryFrameBuffer readFrames;
+    SharedMemoryFrameBuffer writeFrames;
+
+    /**
+     * The last complete frame read and the buffer for the next one
+     */
+    int32 *lastFrame;
+    int32 *nextFrame;
+
+    /**
+     * FrameCount of the last frame read
+     */
+    uint32 lastFrameCount;
+
+    /**
+     * Reads which found no frame or the same frame of the previous read
+     */
+    uint32 staleFrames;
+
+    /**
+     * Frames published but never read
+     */
+    uint32 missedFrames;
+
+    /**
+     * Reads which could not get a consistent frame
+     */
+    uint32 tornReads;
+
+    /**
+     * Attempts to attach the read frames which failed
+     */
+    uint32 failedAttaches;
+
+    /**
+     * Times the writer reinitialised the read area with another layout
+     */
+    uint32 layoutChanges;
+
+    /**
+     * True once a slot mismatch has been logged, until the next attach succeeds
+     */
+    bool slotMismatchReported;
+
+    /**
+     * Attaches the read memory to the frames, if the writer has initialised it
+     */
+    bool AttachReadFrames();
+
 public:
     SharedMemoryDrv(){
         readMem      = NULL;
@@ -77,6 +149,18 @@ public:
         readMemSize  = 0;
         writeMemSize = 0;
         lastUsecTime = 0;
+        useFrames      = False;
+        numberOfSlots  = 2;
+        doorbell       = True;
+        lastFrame      = NULL;
+        nextFrame      = NULL;
+        lastFrameCount = 0;
+        staleFrames    = 0;
+        missedFrames   = 0;
+        tornReads      = 0;
+        failedAttaches = 0;
+        layoutChanges  = 0;
+        slotMismatchReported = False;
     }
 
     virtual ~SharedMemoryDrv(){
@@ -86,6 +170,12 @@ public:
         if(writeMem != NULL){
             SharedMemoryFree(writeMem);
         }
+        if(lastFrame != NULL){
+            free((void *&)lastFrame);
+        }
+        if(nextFrame != NULL){
+            free((void *&)nextFrame);
+        }
     }
 
     /**
@@ -93,6 +183,10 @@ public:
      */
     bool PulseStart(){
         lastUsecTime = 0;
+        staleFrames  = 0;
+        missedFrames = 0;
+        tornReads    = 0;
+        failedAttaches = 0;
         return True;
     }
 
@@ -121,11 +215,9 @@ public:
     bool ObjectLoadSetup(ConfigurationDataBase &info,StreamInterface *err);
 
     /**
-     * NOOP
+     * Prints the frame counters
      */
-    bool ObjectDescription(StreamInterface &s,bool full,StreamInterface *er){
-        return True;
-    }
+    bool ObjectDescription(StreamInterface &s,bool full,StreamInterface *er);
 
     /**
      * NOOP
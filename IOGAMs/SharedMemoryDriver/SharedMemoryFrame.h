@@ -0,0 +1,329 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+#if !defined (SHARED_MEMORY_FRAME)
+#define SHARED_MEMORY_FRAME
+
+/**
+ * @file
+ * Layout of a shared memory segment where one writer publishes frames to
+ * any number of readers, possibly in other processes.
+ * The segment holds a header followed by a ring of nOfSlots frames. Each slot
+ * has a sequence number which is odd while the writer fills it (seqlock), so
+ * that a reader detects a torn copy and retries. The frameCount in the header
+ * tells the readers whether the frame is new and how many frames were missed.
+ * The frameCount is also a futex: readers can sleep on it and are woken up by
+ * the writer, which never blocks.
+ * A writer restarted with another layout reinitialises the header: the readers
+ * check the layout in every read and must attach again when it changes.
+ * External processes can include this file to access the segment.
+ */
+
+#include "System.h"
+#include "HRT.h"
+#include "Sleep.h"
+#include "Atomic.h"
+
+#if defined(_LINUX)
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+/** Identifies an initialised segment */
+#define SMF_MAGIC            0x534D4652
+/** Version of the layout */
+#define SMF_VERSION          1
+/** Alignment of the header fields and of the slots */
+#define SMF_CACHE_LINE_SIZE  64
+/** Number of attempts of a reader to get a consistent frame */
+#define SMF_READ_RETRIES     16
+
+/** The segment header */
+struct SharedMemoryFrameHeader{
+    /** SMF_MAGIC once initialised by the writer */
+    volatile uint32 magic;
+    /** SMF_VERSION */
+    uint32          version;
+    /** Size of a frame in bytes */
+    uint32          frameSize;
+    /** Number of slots */
+    uint32          nOfSlots;
+    /** Distance between two slots in bytes */
+    uint32          slotSize;
+    /** Not used */
+    uint32          reserved[SMF_CACHE_LINE_SIZE / sizeof(uint32) - 5];
+    /** Number of frames published. Futex word of the doorbell */
+    volatile uint32 frameCount;
+    /** Number of readers sleeping on the doorbell */
+    volatile uint32 waiters;
+    /** Keeps the next slot in another cache line */
+    uint32          padding[SMF_CACHE_LINE_SIZE / sizeof(uint32) - 2];
+};
+
+/** The header of a slot, followed by the frame */
+struct SharedMemoryFrameSlot{
+    /** 2 * frameNumber + 1 while being written, 2 * frameNumber + 2 when complete */
+    volatile uint32 sequence;
+    /** Not used */
+    uint32          reserved;
+    /** HRT counter when the frame was published */
+    volatile int64  publishCounter;
+    /** Aligns the frame to a cache line */
+    uint32          padding[SMF_CACHE_LINE_SIZE / sizeof(uint32) - 4];
+};
+
+/** The result of a read */
+enum SharedMemoryFrameStatus{
+    /** No frame was published yet */
+    SMFEmpty = 0,
+    /** A frame not read before */
+    SMFNew   = 1,
+    /** The same frame of the previous read */
+    SMFStale = 2,
+    /** The writer kept on overwriting the frame during all the attempts */
+    SMFTorn  = 3,
+    /** The writer changed the layout of the segment. Nothing was read: Attach again */
+    SMFDetached = 4
+};
+
+class SharedMemoryFrameBuffer{
+private:
+    /** The segment header, NULL if not attached */
+    SharedMemoryFrameHeader *header;
+
+    /** The first slot */
+    char                    *slots;
+
+    /** The layout when initialised or attached. The segment is only accessed
+        through these values, never through the ones in the header */
+    uint32                   frameSize;
+    uint32                   nOfSlots;
+    uint32                   slotSize;
+
+    /** A slot */
+    inline SharedMemoryFrameSlot *Slot(uint32 frameNumber) const{
+        return (SharedMemoryFrameSlot *)(slots + (frameNumber % nOfSlots) * slotSize);
+    }
+
+    /** True if the header still describes the layout which was attached */
+    inline bool LayoutMatches() const{
+        return (header->magic == SMF_MAGIC) && (header->frameSize == frameSize) && (header->nOfSlots == nOfSlots) && (header->slotSize == slotSize);
+    }
+
+    /** Size of a slot */
+    static uint32 SlotSize(uint32 frameSize){
+        uint32 size = sizeof(SharedMemoryFrameSlot) + frameSize;
+        return ((size + SMF_CACHE_LINE_SIZE - 1) / SMF_CACHE_LINE_SIZE) * SMF_CACHE_LINE_SIZE;
+    }
+
+public:
+
+    SharedMemoryFrameBuffer(){
+        header    = NULL;
+        slots     = NULL;
+        frameSize = 0;
+        nOfSlots  = 0;
+        slotSize  = 0;
+    }
+
+    /** Size of the shared memory segment */
+    static uint32 SegmentSize(uint32 frameSize, uint32 nOfSlots){
+        return sizeof(SharedMemoryFrameHeader) + nOfSlots * SlotSize(frameSize);
+    }
+
+    /**
+     * Prepares the segment for writing. If the segment already has the same
+     * layout the frame numbering continues
+     * @param memory The segment, at least SegmentSize bytes
+     */
+    bool Initialise(void *memory, uint32 frameSize, uint32 nOfSlots){
+        if((memory == NULL) || (nOfSlots == 0)) return False;
+        header          = (SharedMemoryFrameHeader *)memory;
+        slots           = (char *)memory + sizeof(SharedMemoryFrameHeader);
+        this->frameSize = frameSize;
+        this->nOfSlots  = nOfSlots;
+        this->slotSize  = SlotSize(frameSize);
+        if((header->version == SMF_VERSION) && LayoutMatches()){
+            return True;
+        }
+        header->magic      = 0;
+        Atomic::FullBarrier();
+        header->version    = SMF_VERSION;
+        header->frameSize  = frameSize;
+        header->nOfSlots   = nOfSlots;
+        header->slotSize   = slotSize;
+        header->frameCount = 0;
+        header->waiters    = 0;
+        for(uint32 i = 0; i < nOfSlots; i++){
+            Slot(i)->sequence       = 0;
+            Slot(i)->publishCounter = 0;
+        }
+        Atomic::FullBarrier();
+        header->magic      = SMF_MAGIC;
+        return True;
+    }
+
+    /**
+     * Attaches a reader to the segment
+     * @return False if the writer has not initialised the segment yet or if the frame size differs
+     */
+    bool Attach(void *memory, uint32 frameSize){
+        header = NULL;
+        slots  = NULL;
+        SharedMemoryFrameHeader *h = (SharedMemoryFrameHeader *)memory;
+        if((h == NULL) || (h->magic != SMF_MAGIC) || (h->version != SMF_VERSION) || (h->frameSize != frameSize) || (h->nOfSlots == 0)){
+            return False;
+        }
+        this->frameSize = frameSize;
+        this->nOfSlots  = h->nOfSlots;
+        this->slotSize  = h->slotSize;
+        Atomic::Barrier();
+        // The writer may have been reinitialising the header
+        if((h->slotSize != SlotSize(frameSize)) || (h->magic != SMF_MAGIC) || (h->frameSize != frameSize) || (h->nOfSlots != nOfSlots)){
+            return False;
+        }
+        header = h;
+        slots  = (char *)memory + sizeof(SharedMemoryFrameHeader);
+        return True;
+    }
+
+    /** Detaches a reader */
+    void Detach(){
+        header = NULL;
+        slots  = NULL;
+    }
+
+    /** True if initialised or attached */
+    bool IsValid() const{
+        return (header != NULL);
+    }
+
+    /** Number of frames published */
+    uint32 FrameCount() const{
+        return (header == NULL) ? 0 : header->frameCount;
+    }
+
+    /** Number of slots */
+    uint32 NumberOfSlots() const{
+        return (header == NULL) ? 0 : nOfSlots;
+    }
+
+    /**
+     * Publishes a frame. Never blocks.
+     * @param frame frameSize bytes
+     * @param doorbell Wake up the readers sleeping in Wait
+     */
+    void Publish(const void *frame, bool doorbell = True){
+        uint32 frameNumber         = header->frameCount;
+        SharedMemoryFrameSlot *slot = Slot(frameNumber);
+        slot->sequence = 2 * frameNumber + 1;
+        Atomic::Barrier();
+        memcpy((char *)(slot + 1), frame, frameSize);
+        slot->publishCounter = HRT::HRTCounter();
+        Atomic::Barrier();
+        slot->sequence = 2 * frameNumber + 2;
+        Atomic::Barrier();
+        header->frameCount = frameNumber + 1;
+#if defined(_LINUX)
+        if(doorbell){
+            // The waiters counter must be read after frameCount is stored
+            Atomic::FullBarrier();
+            if(header->waiters > 0){
+                syscall(SYS_futex, &header->frameCount, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+            }
+        }
+#endif
+    }
+
+    /**
+     * Copies the latest complete frame. Never blocks the writer.
+     * @param frame Where to copy frameSize bytes. Not consistent if SMFTorn or SMFDetached is returned
+     * @param lastFrameCount The FrameCount of the previous read (0 if none). Updated on SMFNew
+     * @param missedFrames The frames published between the previous read and this one
+     * @param publishCounter If not NULL the HRT counter when the frame was published
+     */
+    SharedMemoryFrameStatus Read(void *frame, uint32 &lastFrameCount, uint32 &missedFrames, int64 *publishCounter = NULL) const{
+        missedFrames = 0;
+        for(int32 retry = 0; retry < SMF_READ_RETRIES; retry++){
+            // A restarted writer resets the sequence with a new layout
+            if(!LayoutMatches()) return SMFDetached;
+            Atomic::Barrier();
+            uint32 count = header->frameCount;
+            if(count == 0) return SMFEmpty;
+            Atomic::Barrier();
+            uint32 frameNumber          = count - 1;
+            SharedMemoryFrameSlot *slot = Slot(frameNumber);
+            uint32 sequence             = slot->sequence;
+            // The slot is being written or already reused for a later frame
+            if(sequence != 2 * frameNumber + 2) continue;
+            Atomic::Barrier();
+            memcpy(frame, (const char *)(slot + 1), frameSize);
+            int64 counter = slot->publishCounter;
+            Atomic::Barrier();
+            if(slot->sequence != sequence) continue;
+
+            if(publishCounter != NULL) *publishCounter = counter;
+            if(count == lastFrameCount) return SMFStale;
+            // Not counted if the writer was restarted
+            if((lastFrameCount != 0) && ((int32)(count - lastFrameCount) > 0)){
+                missedFrames = count - lastFrameCount - 1;
+            }
+            lastFrameCount = count;
+            return SMFNew;
+        }
+        return SMFTorn;
+    }
+
+    /**
+     * Waits for a frame after lastFrameCount
+     * @param msecTimeout Maximum time to wait
+     * @return True if a new frame is available
+     */
+    bool Wait(uint32 lastFrameCount, int32 msecTimeout){
+#if defined(_LINUX)
+        __sync_fetch_and_add(&header->waiters, 1);
+        int64 deadline = HRT::HRTCounter() + (int64)(msecTimeout * 1e-3 * HRT::HRTFrequency());
+        while(header->frameCount == lastFrameCount){
+            double left = (deadline - HRT::HRTCounter()) * HRT::HRTPeriod();
+            if(left <= 0) break;
+            struct timespec timeout;
+            timeout.tv_sec  = (time_t)left;
+            timeout.tv_nsec = (long)((left - timeout.tv_sec) * 1e9);
+            syscall(SYS_futex, &header->frameCount, FUTEX_WAIT, lastFrameCount, &timeout, NULL, 0);
+        }
+        __sync_fetch_and_sub(&header->waiters, 1);
+#else
+        int64 deadline = HRT::HRTCounter() + (int64)(msecTimeout * 1e-3 * HRT::HRTFrequency());
+        while((header->frameCount == lastFrameCount) && (HRT::HRTCounter() < deadline)){
+            SleepMsec(1);
+        }
+#endif
+        return (header->frameCount != lastFrameCount);
+    }
+};
+
+#endif
@@ -22,31 +22,102 @@
  *
 **/
 
+/**
+ * @file
+ * Reads the frames published by TestWrite (or by a SharedMemoryDrv with
+ * Synchronisation = SeqLock) until the last frame is received, and reports
+ * the frames missed, the stale and torn reads and the publication latency.
+ * The reader either polls the area continuously or sleeps on the doorbell.
+ * The writer must be started first.
+ */
+
 #include "Memory.h"
 #include "Sleep.h"
+#include "HRT.h"
+#include "SharedMemoryFrame.h"
+#include "RTLatencyHistogram.h"
 
-#define MEM_SIZE 64
+/** Value of the first word of the last frame */
+#define END_OF_TEST 0xFFFFFFFF
 
 int main(int argc, char **argv){
-    if(argc < 2){
-        printf("Usage: TestRead.ex key (as specified in cfg file) \n");
+    if(argc < 3){
+        printf("Usage: TestRead.ex key nOfWords [nOfSlots] [poll|wait]\n");
         return -1;
     }
 
-    int  key  = atoi(argv[1]);
-    char *mem = (char *)SharedMemoryAlloc(key, MEM_SIZE);
+    int    key      = atoi(argv[1]);
+    int32  nOfWords = atoi(argv[2]);
+    int32  nOfSlots = (argc > 3) ? atoi(argv[3]) : 2;
+    bool   wait     = (argc > 4) && (strcmp(argv[4], "wait") == 0);
+    if((nOfWords < 1) || (nOfSlots < 1)){
+        printf("nOfWords and nOfSlots must be > 0\n");
+        return -1;
+    }
+
+    uint32 frameSize = nOfWords * sizeof(int32);
+    char *mem = (char *)SharedMemoryAlloc(key, SharedMemoryFrameBuffer::SegmentSize(frameSize, nOfSlots));
     if(mem == NULL){
         printf("Failed to allocated shared memory with key: %d\n", key);
         return -1;
     }
-    char oldValue[4];
-    memcpy(oldValue, mem, 4);
-    printf("Going to wait for another process to write 4 bytes in the shared memory [%p]\n", mem);
-    while(memcmp(oldValue, mem, 4) == 0){
-        SleepSec(1.0);
+    SharedMemoryFrameBuffer frames;
+    printf("Going to wait for another process to publish frames of %d words in the shared memory [%p]\n", nOfWords, mem);
+    while(!frames.Attach(mem, frameSize)){
+        SleepMsec(10);
+    }
+    if(frames.NumberOfSlots() != (uint32)nOfSlots){
+        printf("The writer uses %u slots instead of %d\n", frames.NumberOfSlots(), nOfSlots);
+        SharedMemoryFree(mem);
+        return -1;
+    }
+
+    uint32 *frame = (uint32 *)malloc(frameSize);
+    RTLatencyHistogram latency;
+    // The frames of a previous test are ignored
+    uint32 lastFrameCount = frames.FrameCount();
+    uint32 newFrames      = 0;
+    uint32 missedFrames   = 0;
+    uint32 staleReads     = 0;
+    uint32 tornReads      = 0;
+    uint32 emptyReads     = 0;
+    int64  start          = 0;
+    while(1){
+        if(wait && !frames.Wait(lastFrameCount, 1000)){
+            continue;
+        }
+        uint32 missed         = 0;
+        int64  publishCounter = 0;
+        SharedMemoryFrameStatus status = frames.Read(frame, lastFrameCount, missed, &publishCounter);
+        int64 now = HRT::HRTCounter();
+        if(status == SMFNew){
+            if(frame[0] == END_OF_TEST) break;
+            if(newFrames == 0) start = now;
+            newFrames++;
+            missedFrames += missed;
+            latency.Add((uint32)((now - publishCounter) * HRT::HRTPeriod() * 1e9));
+        }
+        else if(status == SMFStale){
+            staleReads++;
+        }
+        else if(status == SMFTorn){
+            tornReads++;
+        }
+        else if(status == SMFDetached){
+            printf("The writer changed the layout of the shared memory\n");
+            break;
+        }
+        else{
+            emptyReads++;
+        }
     }
-    printf("Received (int version: %d) (float version: %f)\n", *((int32 *)mem), *((float *)mem));
+    double elapsed = (newFrames == 0) ? 0.0 : (HRT::HRTCounter() - start) * HRT::HRTPeriod();
+
+    printf("Read %u frames in %.3f s (%.0f frames/s) with the reader %s\n", newFrames, elapsed, (elapsed > 0) ? newFrames / elapsed : 0.0, wait ? "waiting on the doorbell" : "polling");
+    printf("Missed frames = %u, stale reads = %u, torn reads = %u, empty reads = %u\n", missedFrames, staleReads, tornReads, emptyReads);
+    printf("Latency (ns): p50 = %u p99 = %u p99.9 = %u max = %u\n", latency.Percentile(0.5), latency.Percentile(0.99), latency.Percentile(0.999), latency.Max());
+    free((void *&)frame);
     SharedMemoryFree(mem);
+    return 0;
 }
 
-
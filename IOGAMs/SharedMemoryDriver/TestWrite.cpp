@@ -22,30 +22,79 @@
  *
 **/
 
+/**
+ * @file
+ * Publishes frames in a shared memory area laid out as in SharedMemoryFrame.h
+ * (SharedMemoryDrv with Synchronisation = SeqLock) and measures the rate.
+ * Together with TestRead it measures the throughput and the latency between
+ * two processes. The first word of each frame is the frame number and the
+ * last frame (0xFFFFFFFF) tells the reader to stop.
+ */
+
 #include "Memory.h"
 #include "Sleep.h"
+#include "HRT.h"
+#include "SharedMemoryFrame.h"
 
-#define MEM_SIZE 64
+/** Value of the first word of the last frame */
+#define END_OF_TEST 0xFFFFFFFF
 
 int main(int argc, char **argv){
-    if(argc < 2){
-        printf("Usage: TestWrite.ex key floatvaluetowrite\n");
+    if(argc < 3){
+        printf("Usage: TestWrite.ex key nOfWords [rateHz (0 = as fast as possible)] [nOfFrames] [nOfSlots]\n");
+        return -1;
+    }
+
+    int    key       = atoi(argv[1]);
+    int32  nOfWords  = atoi(argv[2]);
+    double rateHz    = (argc > 3) ? atof(argv[3]) : 0.0;
+    uint32 nOfFrames = (argc > 4) ? atoi(argv[4]) : 1000000;
+    int32  nOfSlots  = (argc > 5) ? atoi(argv[5]) : 2;
+    if((nOfWords < 1) || (nOfSlots < 1)){
+        printf("nOfWords and nOfSlots must be > 0\n");
         return -1;
     }
 
-    int  key  = atoi(argv[1]);
-    char *mem = (char *)SharedMemoryAlloc(key, MEM_SIZE);
+    uint32 frameSize = nOfWords * sizeof(int32);
+    char *mem = (char *)SharedMemoryAlloc(key, SharedMemoryFrameBuffer::SegmentSize(frameSize, nOfSlots));
     if(mem == NULL){
         printf("Failed to allocated shared memory with key: %d\n", key);
         return -1;
     }
-    if(argc > 2){
-        printf("Going to write on memory mapped on key: %d at %p\n", key, mem);
-        //*((float *)mem) = atof(argv[2]);
-        while(1)
-        *((int32*)mem) = atoi(argv[2]);
+    SharedMemoryFrameBuffer frames;
+    frames.Initialise(mem, frameSize, nOfSlots);
+
+    uint32 *frame = (uint32 *)malloc(frameSize);
+    memset(frame, 0, frameSize);
+
+    printf("Publishing %u frames of %d words in %d slots on key %d at %.0f Hz\n", nOfFrames, nOfWords, nOfSlots, key, rateHz);
+    int64 period = 0;
+    if(rateHz > 0){
+        period = (int64)(HRT::HRTFrequency() / rateHz);
     }
+    int64 start = HRT::HRTCounter();
+    int64 next  = start;
+    for(uint32 i = 0; i < nOfFrames; i++){
+        if(period > 0){
+            next += period;
+            while(HRT::HRTCounter() < next);
+        }
+        frame[0] = i;
+        frame[nOfWords - 1] += 1;
+        frames.Publish(frame);
+    }
+    double elapsed = (HRT::HRTCounter() - start) * HRT::HRTPeriod();
+
+    // Repeated so that a reader polling slowly does not miss it
+    frame[0] = END_OF_TEST;
+    for(int32 i = 0; i < 10; i++){
+        frames.Publish(frame);
+        SleepMsec(10);
+    }
+
+    printf("Published %u frames in %.3f s: %.0f frames/s %.1f MB/s\n", nOfFrames, elapsed, nOfFrames / elapsed, nOfFrames * (double)frameSize / elapsed / 1e6);
+    free((void *&)frame);
     SharedMemoryFree(mem);
+    return 0;
 }
 
-
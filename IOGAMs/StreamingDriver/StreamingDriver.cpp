@@ -27,115 +27,106 @@
 #include "CDBExtended.h"
 
 void StreamingDriverConsumerThread(void *args){
-    StreamingDriver *streamingDriver    = (StreamingDriver *)args;
-    int32            idxCounter         = 0;
-    int32            startIdxCounter    = 0;
-    int32            memTransferCounter = 0;
-    uint32           transferPacketSize = 0;
-
-    double now  = 0;
-    double last = 0;
-    double send = 0; 
+    StreamingDriver *streamingDriver  = (StreamingDriver *)args;
+    int64            lastErrorCounter = 0;
 
     Threads::SetRealTimeClass();
 
     while(streamingDriver->consumerThreadIsAlive){
-        startIdxCounter = idxCounter;
-        while(streamingDriver->bufferLockStates[idxCounter] == streamingDriver->Unlocked && streamingDriver->bufferFreeStates[idxCounter] == streamingDriver->Full){
-            //Copy the data to the transfer buffer
-            memcpy(streamingDriver->transferBuffer + memTransferCounter * streamingDriver->memBufferSize, streamingDriver->memoryBuffer + idxCounter * streamingDriver->memBufferSize, streamingDriver->memBufferSize);
-            memTransferCounter++;
-            //packet is ready to go
-            if(memTransferCounter == streamingDriver->numberOfTransferBuffers){                
-                now  = HRT::HRTCounter() * HRT::HRTPeriod();
-                send = now - last;
-                last = now;
-                memcpy(streamingDriver->transferBuffer - sizeof(double), &send, sizeof(double));
-                //Send packet
-                transferPacketSize = streamingDriver->memBufferSize * streamingDriver->numberOfTransferBuffers + sizeof(double);
-                if(!streamingDriver->senderSocket.Write((const void *)(streamingDriver->transferBuffer - sizeof(double)), transferPacketSize)){
+        //The Reset must precede the check, so that a Post of the producer is never lost
+        streamingDriver->synchEventSem.Reset();
+        while(streamingDriver->QueuedCycles() >= (uint32)streamingDriver->numberOfTransferBuffers){
+            if(!streamingDriver->SendPacket()){
+                if((HRT::HRTCounter() - lastErrorCounter) * HRT::HRTPeriod() > 1){
                     CStaticAssertErrorCondition(Warning, "StreamingDriver::StreamingDriverConsumerThread. Could not write ready packet in socket!");
+                    lastErrorCounter = HRT::HRTCounter();
                 }
-                memTransferCounter = 0;
-            }
-
-            //Mark as free
-            if(Atomic::Exchange(&(streamingDriver->bufferFreeStates[idxCounter]), streamingDriver->Free) != streamingDriver->Full){
-                CStaticAssertErrorCondition(Warning, "StreamingDriver::StreamingDriverConsumerThread. Could not mark buffer index: %d as free!", idxCounter);
-            }
-
-            idxCounter++;
-            if(idxCounter == streamingDriver->numberOfBuffers){
-                idxCounter = 0;
-            }
-            //Full loop and still here? Is this a problem? To be decided
-            if((idxCounter == startIdxCounter) && (streamingDriver->numberOfBuffers > 1)){
-                CStaticAssertErrorCondition(Warning, "StreamingDriver::StreamingDriverConsumerThread. The consumer is likely under heavy stress. A full consuming loop was performed, and no empty buffers were found. idxCounter=%d", idxCounter);
-                idxCounter = streamingDriver->lastUnlockedBufferIndex;
-                break;
             }
+            //Give the cycles back to the producer
+            Atomic::Add(&streamingDriver->sentCycles, streamingDriver->numberOfTransferBuffers);
         }
 
         if(streamingDriver->consumerThreadIsAlive){
-            streamingDriver->synchEventSem.ResetWait();
+            streamingDriver->synchEventSem.Wait(SD_CONSUMER_TIMEOUT_MSEC);
         }
     }
     streamingDriver->consumerThreadIsAlive = True;
     CStaticAssertErrorCondition(Information, "StreamingDriver::StreamingDriverConsumerThread is exiting");
 }
 
-int StreamingDriver::GetNextUnlockedBufferIndexAndLock(){
-    lastUnlockedBufferIndex++;
-    if(lastUnlockedBufferIndex == numberOfBuffers){
-        lastUnlockedBufferIndex = 0;
+bool StreamingDriver::SendPacket(){
+    //The cycles may wrap around the end of the ring
+    int32 firstCycles  = numberOfBuffers - sendIndex;
+    if(firstCycles > numberOfTransferBuffers){
+        firstCycles = numberOfTransferBuffers;
     }
-    Atomic::Exchange(&bufferLockStates[lastUnlockedBufferIndex], Locked);
-    return lastUnlockedBufferIndex;
-}
+    int32 secondCycles = numberOfTransferBuffers - firstCycles;
+
+    packetHeader.sequence      = packetSequence++;
+    packetHeader.droppedCycles = droppedCycles;
 
+    char *firstData = memoryBuffer + sendIndex * memBufferSize;
+    sendIndex += numberOfTransferBuffers;
+    if(sendIndex >= numberOfBuffers){
+        sendIndex -= numberOfBuffers;
+    }
+
+    uint32 transferPacketSize = sizeof(StreamingDriverPacketHeader) + numberOfTransferBuffers * memBufferSize;
+#if defined(SD_USE_SENDMSG)
+    struct iovec iov[3];
+    iov[0].iov_base = (void *)&packetHeader;
+    iov[0].iov_len  = sizeof(StreamingDriverPacketHeader);
+    iov[1].iov_base = (void *)firstData;
+    iov[1].iov_len  = firstCycles * memBufferSize;
+    iov[2].iov_base = (void *)memoryBuffer;
+    iov[2].iov_len  = secondCycles * memBufferSize;
+
+    return senderSocket.BasicWriteGather(iov, (secondCycles > 0) ? 3 : 2, transferPacketSize);
+#else
+    memcpy(transferBuffer, &packetHeader, sizeof(StreamingDriverPacketHeader));
+    char *cycles = transferBuffer + sizeof(StreamingDriverPacketHeader);
+    memcpy(cycles, firstData, firstCycles * memBufferSize);
+    memcpy(cycles + firstCycles * memBufferSize, memoryBuffer, secondCycles * memBufferSize);
+    return senderSocket.Write((const void *)transferBuffer, transferPacketSize);
+#endif
+}
 
 bool StreamingDriver::WriteData(uint32 usecTime, const int32 *toWriteBuffer){
     // Get the last time mark
     lastUsecTime = usecTime;
     
-    //A free buffer index and lock the buffer
-    int32 unlockedBufferIndex = GetNextUnlockedBufferIndexAndLock();
-    if(unlockedBufferIndex == -1){
-        //No free buffer was found. Return True just not to stop the realtime thread
-        AssertErrorCondition(Warning,"StreamingDriver::WriteData: No free (unlocked) buffer was found. The number of configured buffers is: %d", numberOfBuffers);
-        return True;
-    }
-
-    if(bufferFreeStates[unlockedBufferIndex] == Full){
+    if(QueuedCycles() >= (uint32)numberOfBuffers){
+        //The consumer is late. Drop the cycle instead of overwriting the ones which are being sent
+        Atomic::Increment(&droppedCycles);
         lostBuffers++;
-        //We are running too fast and just overlaped the consumer thread
         if((HRT::HRTCounter() - lastWarningCounter) * HRT::HRTPeriod() > 1){
-            AssertErrorCondition(Warning, "StreamingDriver::WriteData: The system seems to be underdimensioned. Wrote over full buffers in the last second. Conf. buffers: %d Wrote over: %d", numberOfBuffers, lostBuffers);
+            AssertErrorCondition(Warning, "StreamingDriver::WriteData: The system seems to be underdimensioned. Dropped cycles in the last second. Conf. buffers: %d Dropped: %d", numberOfBuffers, lostBuffers);
             lostBuffers = 0;
             lastWarningCounter = HRT::HRTCounter();
         }
-        //Mark as free
-        Atomic::Exchange(&bufferFreeStates[unlockedBufferIndex], Free);
+        return True;
     }
 
-    //Local copy of the buffer
-    uint32 *copyBuffer = (uint32 *)(memoryBuffer + unlockedBufferIndex * memBufferSize);
+    //The cycle is written in place in the ring
+    uint32 *copyBuffer = (uint32 *)(memoryBuffer + writeIndex * memBufferSize);
 
     //Copy the time header    
     *copyBuffer = usecTime;
     copyBuffer++;
     //Copy the data
     memcpy(copyBuffer, toWriteBuffer, memBufferSize - sizeof(int32));
-   
-    //Mark as full
-    if(Atomic::Exchange(&bufferFreeStates[unlockedBufferIndex], Full) != Free){
-        AssertErrorCondition(Warning, "StreamingDriver::WriteData: Could not mark buffer index: %d as full!", unlockedBufferIndex);
+
+    writeIndex++;
+    if(writeIndex == numberOfBuffers){
+        writeIndex = 0;
     }
-    //Unlock the buffer
-    if(Atomic::Exchange(&bufferLockStates[unlockedBufferIndex], Unlocked) != Locked){
-        AssertErrorCondition(FatalError, "StreamingDriver::WriteData: Could not unlock buffer index: %d which was locked by me!", unlockedBufferIndex);
+    //Publish the cycle. The locked increment also orders the copy before it
+    Atomic::Increment(&writtenCycles);
+
+    //Wake the consumer only when a datagram is complete
+    if(QueuedCycles() == (uint32)numberOfTransferBuffers){
+        synchEventSem.Post();
     }
-    synchEventSem.Post();
 
     /** Trigger External Activities */
     for(int activity = 0; activity < nOfTriggeringServices; activity++){
@@ -192,13 +183,28 @@ bool StreamingDriver::ObjectLoadSetup(ConfigurationDataBase &info,StreamInterfac
 
     AssertErrorCondition(Information, "StreamingDriver::ObjectLoadSetup: %s Connected streaming socket to address: %s , port: %d", Name(), receiverUDPAddress.Buffer(), receiverUDPPort);
 
+    memBufferSize    = NumberOfOutputs() * sizeof(float) + sizeof(int32);
+
+    int32 maxTransferBuffers = (SD_MAX_DATAGRAM_SIZE - sizeof(StreamingDriverPacketHeader)) / memBufferSize;
+    if(maxTransferBuffers < 1){
+        AssertErrorCondition(InitialisationError, "StreamingDriver::ObjectLoadSetup: %s A cycle of %d bytes does not fit in a datagram", Name(), memBufferSize);
+        return False;
+    }
+    if(numberOfTransferBuffers > maxTransferBuffers){
+        AssertErrorCondition(Warning, "StreamingDriver::ObjectLoadSetup: %s %d cycles of %d bytes do not fit in a datagram. NumberOfTransferBuffers reduced to %d", Name(), numberOfTransferBuffers, memBufferSize, maxTransferBuffers);
+        numberOfTransferBuffers = maxTransferBuffers;
+    }
+    if(numberOfTransferBuffers < 1){
+        AssertErrorCondition(InitialisationError, "StreamingDriver::ObjectLoadSetup: %s NumberOfTransferBuffers must be positive", Name());
+        return False;
+    }
+
     if(numberOfTransferBuffers > numberOfBuffers){
         AssertErrorCondition(InitialisationError, "StreamingDriver::ObjectLoadSetup: NumberOfTransferBuffers must no be higher than NumberOfBuffers: %d > %d", numberOfTransferBuffers, numberOfBuffers);
         return False;
     }
 
     if(memoryBuffer != NULL) free((void *&)memoryBuffer);
-    memBufferSize    = NumberOfOutputs() * sizeof(float) + sizeof(int32);
     memoryBuffer     = (char *)malloc(memBufferSize * numberOfBuffers);
     if(memoryBuffer == NULL){
         AssertErrorCondition(InitialisationError,"StreamingDriver::ObjectLoadSetup: %s Failed allocating %d bytes for storing data",Name(), memBufferSize * numberOfBuffers);
@@ -207,53 +213,39 @@ bool StreamingDriver::ObjectLoadSetup(ConfigurationDataBase &info,StreamInterfac
     memset(memoryBuffer, 0, memBufferSize * numberOfBuffers);
     AssertErrorCondition(Information,"StreamingDriver::ObjectLoadSetup: %s Successfully allocated %d bytes for data storing divided in %d buffers",Name(), memBufferSize * numberOfBuffers, numberOfBuffers);
 
-
-    if(transferBuffer != NULL){
-        transferBuffer -= sizeof(double);
-        free((void *&)transferBuffer);        
-    }
-    transferBuffer     = (char *)malloc(memBufferSize * numberOfTransferBuffers + sizeof(double));
+#if !defined(SD_USE_SENDMSG)
+    if(transferBuffer != NULL) free((void *&)transferBuffer);
+    int32 transferBufferSize = sizeof(StreamingDriverPacketHeader) + memBufferSize * numberOfTransferBuffers;
+    transferBuffer     = (char *)malloc(transferBufferSize);
     if(transferBuffer  == NULL){
-        CStaticAssertErrorCondition(InitialisationError,"StreamingDriver::ObjectLoadSetup: %s Could not allocate: %d bytes for the transfer buffer. The consumer thread will NOT start", Name(), memBufferSize * numberOfTransferBuffers);
-    }
-    memset(transferBuffer, 0, memBufferSize * numberOfTransferBuffers + sizeof(double));
-    transferBuffer += sizeof(double);
-    AssertErrorCondition(Information,"StreamingDriver::ObjectLoadSetup: %s Successfully allocated %d bytes for data streaming divided in %d buffers",Name(), memBufferSize * numberOfTransferBuffers, numberOfTransferBuffers);
-
-
-    if(bufferLockStates != NULL) free((void *&)bufferLockStates);
-    bufferLockStates = (int32 *)malloc(numberOfBuffers * sizeof(int32));
-    if(bufferLockStates == NULL){
-        AssertErrorCondition(InitialisationError,"StreamingDriver::ObjectLoadSetup: %s Failed allocating %d bytes for the buffer locking semaphores" ,Name(), numberOfBuffers * sizeof(int32));
-        return False;
-    }
-    memset(bufferLockStates, 0, numberOfBuffers * sizeof(int32));
-
-
-    if(bufferFreeStates != NULL) free((void *&)bufferFreeStates);
-    bufferFreeStates = (int32 *)malloc(numberOfBuffers * sizeof(int32));
-    if(bufferFreeStates == NULL){
-        AssertErrorCondition(InitialisationError,"StreamingDriver::ObjectLoadSetup: %s Failed allocating %d bytes for the buffer locking semaphores" ,Name(), numberOfBuffers * sizeof(int32));
+        AssertErrorCondition(InitialisationError,"StreamingDriver::ObjectLoadSetup: %s Could not allocate: %d bytes for the transfer buffer", Name(), transferBufferSize);
         return False;
     }
-    memset(bufferFreeStates, 0, numberOfBuffers * sizeof(int32));
+    memset(transferBuffer, 0, transferBufferSize);
+#endif
+    AssertErrorCondition(Information,"StreamingDriver::ObjectLoadSetup: %s Each datagram carries %d cycles (%d bytes)",Name(), numberOfTransferBuffers, sizeof(StreamingDriverPacketHeader) + memBufferSize * numberOfTransferBuffers);
+
+    packetHeader.magic         = SD_PACKET_MAGIC;
+    packetHeader.sequence      = 0;
+    packetHeader.nOfCycles     = numberOfTransferBuffers;
+    packetHeader.cycleSize     = memBufferSize;
+    packetHeader.droppedCycles = 0;
+    packetHeader.reserved      = 0;
+
+    writtenCycles  = 0;
+    sentCycles     = 0;
+    droppedCycles  = 0;
+    writeIndex     = 0;
+    sendIndex      = 0;
+    packetSequence = 0;
 
     /** Begin the consumer thread*/
-    lastUnlockedBufferIndex = -1;
     consumerThreadID = Threads::BeginThread((ThreadFunctionType)StreamingDriverConsumerThread, this, THREADS_DEFAULT_STACKSIZE, Name(), XH_NotHandled, cpuMask);
 
     return True;
 }
 
 StreamingDriver::~StreamingDriver(){
-    if(memoryBuffer     != NULL) free((void *&)memoryBuffer);
-    if(bufferLockStates != NULL) free((void *&)bufferLockStates);
-    if(bufferFreeStates != NULL) free((void *&)bufferFreeStates);
-    if(transferBuffer != NULL){
-        transferBuffer -= sizeof(double);
-        free((void *&)transferBuffer);        
-    }
-    senderSocket.Close();
     consumerThreadIsAlive = False;
     synchEventSem.Post();
     int resetCounter = 0;
@@ -268,14 +260,18 @@ StreamingDriver::~StreamingDriver(){
     if(!consumerThreadIsAlive){
         AssertErrorCondition(InitialisationError,"StreamingDriver::~StreamingDriver(): Consumer thread did not exited in 1 seconds %s", Name());
     }
+    else{
+        //The consumer thread sends directly from the ring
+        if(memoryBuffer   != NULL) free((void *&)memoryBuffer);
+        if(transferBuffer != NULL) free((void *&)transferBuffer);
+    }
+    senderSocket.Close();
 }
 
 StreamingDriver::StreamingDriver(){
 
     memoryBuffer            = NULL;
     transferBuffer          = NULL;
-    bufferLockStates        = NULL;
-    bufferFreeStates        = NULL;
     
     memBufferSize           = 0;
     lastUsecTime            = 0;
@@ -284,7 +280,13 @@ StreamingDriver::StreamingDriver(){
     receiverUDPPort         = 0;
     cpuMask                 = 0;
 
-    lastUnlockedBufferIndex = -1;
+    writtenCycles           = 0;
+    sentCycles              = 0;
+    droppedCycles           = 0;
+    writeIndex              = 0;
+    sendIndex               = 0;
+    packetSequence          = 0;
+    memset(&packetHeader, 0, sizeof(packetHeader));
 
     lostBuffers             = 0;
     lastWarningCounter      = 0;
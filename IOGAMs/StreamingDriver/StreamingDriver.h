@@ -29,6 +29,15 @@
 #include "GenericAcqModule.h"
 #include "Atomic.h"
 #include "UDPSocket.h"
+#include "StreamingDriverPacket.h"
+
+#if defined(_LINUX) || defined(_SOLARIS) || defined(_MACOSX)
+/** The datagrams are gathered directly from the ring with sendmsg*/
+#define SD_USE_SENDMSG
+#endif
+
+/** Maximum time the consumer thread sleeps without checking the ring*/
+#define SD_CONSUMER_TIMEOUT_MSEC 100
 
 /** The streaming thread signature*/
 extern "C"{
@@ -43,23 +52,12 @@ OBJECT_DLL_STUFF(StreamingDriver)
 
 private:
 
-    /** The states used in the buffer lock*/
-    enum BufferLockStates{
-        Unlocked = 0,
-        Locked   = 1
-    };
-    
-    /** The states used in the buffer full array*/
-    enum BufferFullStates{
-        Free = 0,
-        Full = 1
-    };
-
-    /** Memory Buffer where data is stored in pages. For every cycle data is copied into this buffer*/
+    /** Ring of numberOfBuffers cycles. WriteData stores each cycle in place and the
+     * consumer thread sends numberOfTransferBuffers consecutive cycles per datagram,
+     * pointing sendmsg directly at the ring (no intermediate copy)*/
     char     *memoryBuffer;
 
-    /** This buffer is used by the consumer thread to store the data which is sent each time the numberOfTransferBuffers
-     * is reached*/
+    /** Used to gather the cycles of a datagram when scatter-gather sends are not available*/
     char     *transferBuffer;
     
     /** The number of buffers*/
@@ -71,16 +69,29 @@ private:
     /** The size of each buffer in bytes*/
     int32     memBufferSize;
 
-    /** Flags which control if a buffer is locked (for writing or reading)*/
-    int32    *bufferLockStates;
+    /** Number of cycles written in the ring (only incremented by WriteData)*/
+    volatile int32 writtenCycles;
+
+    /** Number of cycles sent (only incremented by the consumer thread). WriteData never
+     * overwrites the cycles in [sentCycles, writtenCycles)*/
+    volatile int32 sentCycles;
+
+    /** Slot where WriteData stores the next cycle*/
+    int32     writeIndex;
 
-    /** Flags which control if a buffer is full*/
-    int32    *bufferFreeStates;
+    /** Slot of the first cycle of the next datagram*/
+    int32     sendIndex;
 
-    /** The last unlocked buffer index found*/
-    int32     lastUnlockedBufferIndex;
+    /** Number of cycles dropped because the ring was full*/
+    volatile int32 droppedCycles;
 
-    /** The event sem which is used by the producer to wake the consumer thread*/
+    /** Sequence number of the next datagram*/
+    uint32    packetSequence;
+
+    /** Header of the datagrams*/
+    StreamingDriverPacketHeader packetHeader;
+
+    /** The event sem which is used by the producer to wake the consumer thread. Posted once per datagram*/
     EventSem  synchEventSem;
 
     /** Last time mark */
@@ -98,7 +109,7 @@ private:
     /** The CPU mask where the thread should be started*/
     int32     cpuMask;
 
-    /** The number of buffers lost (only used for the warnings)*/
+    /** The number of buffers lost since the last warning*/
     int32     lostBuffers;
 
     /** Counter value when the last warning was issued. The system will not send more than a warning per second*/
@@ -118,9 +129,14 @@ private:
         return time;
     }
 
-    /** Returns the index of the next unlocked buffer. If none
-     * is found, return -1*/
-    int GetNextUnlockedBufferIndexAndLock();
+    /** Number of cycles written and not yet sent*/
+    inline uint32 QueuedCycles(){
+        return (uint32)writtenCycles - (uint32)sentCycles;
+    }
+
+    /** Sends numberOfTransferBuffers cycles starting from sendIndex in one datagram*/
+    bool SendPacket();
+
 public:
     
     /** Constructor. */
@@ -0,0 +1,156 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Streams cycles from a StreamingDriver to a StreamingDriverReceiver in the same
+ * process (through the loopback) and reports the time spent in WriteData, the
+ * cycles dropped by the sender and the cycles lost or reordered on reception.
+ * The first signal of each cycle carries the cycle number.
+ * Usage: StreamingDriverBenchmark.ex [frequencyHz] [nOfSignals] [cyclesPerPacket] [seconds]
+ */
+
+#include "System.h"
+#include "FString.h"
+#include "ConfigurationDataBase.h"
+#include "RTLatencyHistogram.h"
+#include "StreamingDriver.h"
+#include "StreamingDriverReceiver.h"
+
+#include <time.h>
+
+/** Shared with the consumer thread */
+static StreamingDriverReceiver *receiver        = NULL;
+static int32                    nOfSignals      = 1000;
+static volatile bool            consumerRunning = True;
+static volatile int32           consumedCycles  = 0;
+static volatile int32           missingCycles   = 0;
+static volatile int32           outOfOrder      = 0;
+
+/** Consumes the received cycles as a synchronised real time thread would */
+static void ConsumerThread(void *args){
+    int32 *buffer        = (int32 *)malloc(nOfSignals * sizeof(int32));
+    int32  expectedCycle = 0;
+    while(consumerRunning){
+        if(!receiver->Poll()){
+            continue;
+        }
+        receiver->GetData(0, buffer);
+        int32 cycle = buffer[0];
+        if(cycle > expectedCycle){
+            missingCycles += cycle - expectedCycle;
+        }
+        else if(cycle < expectedCycle){
+            outOfOrder++;
+        }
+        expectedCycle = cycle + 1;
+        consumedCycles++;
+    }
+    free((void *&)buffer);
+    consumerRunning = True;
+}
+
+static bool Setup(GenericAcqModule &module, const char *name, const char *config){
+    FString text;
+    text.Printf("%s", config);
+    text.Seek(0);
+    ConfigurationDataBase cdb;
+    if(!cdb->ReadFromStream(text)){
+        printf("Could not parse the %s configuration\n", name);
+        return False;
+    }
+    module.SetObjectName(name);
+    return module.ObjectLoadSetup(cdb, NULL);
+}
+
+int main(int argc, char **argv){
+    int32 frequency       = (argc > 1) ? atoi(argv[1]) : 10000;
+    nOfSignals            = (argc > 2) ? atoi(argv[2]) : 1000;
+    int32 cyclesPerPacket = (argc > 3) ? atoi(argv[3]) : 16;
+    int32 seconds         = (argc > 4) ? atoi(argv[4]) : 5;
+    if((frequency < 1) || (nOfSignals < 1) || (cyclesPerPacket < 1) || (seconds < 1)){
+        printf("Usage: StreamingDriverBenchmark.ex [frequencyHz] [nOfSignals] [cyclesPerPacket] [seconds]\n");
+        return -1;
+    }
+
+    FString senderConfig;
+    senderConfig.Printf("NumberOfOutputs = %d\nNumberOfBuffers = 8192\nNumberOfTransferBuffers = %d\n"
+                        "ReceiverUDPPort = 14577\nReceiverUDPAddress = \"127.0.0.1\"\nCpuMask = 255\n", nOfSignals, cyclesPerPacket);
+    FString receiverConfig;
+    receiverConfig.Printf("NumberOfInputs = %d\nNumberOfBuffers = 8192\nNumberOfTransferBuffers = %d\n"
+                          "ReceiverUDPPort = 14577\nCpuMask = 255\nSynchronizationMethod = \"Synchronizing\"\n"
+                          "SynchronizingMSTimeout = 100\nSocketReceiveBufferSize = 8388608\n", nOfSignals, cyclesPerPacket);
+
+    receiver = new StreamingDriverReceiver();
+    StreamingDriver *sender = new StreamingDriver();
+    if(!Setup(*receiver, "Receiver", receiverConfig.Buffer()) || !Setup(*sender, "Sender", senderConfig.Buffer())){
+        printf("Setup failed\n");
+        return -1;
+    }
+    Threads::BeginThread((ThreadFunctionType)ConsumerThread, NULL, THREADS_DEFAULT_STACKSIZE, "Consumer", XH_NotHandled, 0xFF);
+
+    int32 *buffer = (int32 *)malloc(nOfSignals * sizeof(int32));
+    for(int32 i = 0; i < nOfSignals; i++){
+        buffer[i] = i;
+    }
+
+    RTLatencyHistogram writeTimes;
+    int32  nOfCycles = frequency * seconds;
+    int64  periodNs  = 1000000000LL / frequency;
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    int64  start     = HRT::HRTCounter();
+    for(int32 cycle = 0; cycle < nOfCycles; cycle++){
+        deadline.tv_nsec += periodNs;
+        while(deadline.tv_nsec >= 1000000000){
+            deadline.tv_nsec -= 1000000000;
+            deadline.tv_sec++;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+
+        buffer[0] = cycle;
+        int64 before = HRT::HRTCounter();
+        sender->WriteData((uint32)(cycle * (1000000 / frequency)), buffer);
+        writeTimes.Add((uint32)((HRT::HRTCounter() - before) * HRT::HRTPeriod() * 1E9));
+    }
+    double elapsed = (HRT::HRTCounter() - start) * HRT::HRTPeriod();
+    SleepMsec(500);
+
+    int32 received = consumedCycles;
+    printf("%d Hz x %d signals, %d cycles per datagram: %d cycles in %.2f s (%.1f MB/s)\n",
+           frequency, nOfSignals, cyclesPerPacket, nOfCycles, elapsed, nOfCycles * (nOfSignals + 1) * 4.0 / elapsed / 1E6);
+    printf("WriteData ns: p50 %u p99 %u p99.9 %u max %u\n",
+           writeTimes.Percentile(0.5), writeTimes.Percentile(0.99), writeTimes.Percentile(0.999), writeTimes.Max());
+    printf("received %d (%.2f%%) gaps %d out of order %d\n",
+           received, 100.0 * received / nOfCycles, (int32)missingCycles, (int32)outOfOrder);
+
+    consumerRunning = False;
+    while(!consumerRunning){
+        SleepMsec(10);
+    }
+    delete sender;
+    delete receiver;
+    free((void *&)buffer);
+    return 0;
+}
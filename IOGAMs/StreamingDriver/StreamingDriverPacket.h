@@ -0,0 +1,61 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Layout of the datagrams sent by the StreamingDriver to the StreamingDriverReceiver.
+ *
+ * Each datagram carries a StreamingDriverPacketHeader followed by nOfCycles cycles.
+ * A cycle is the usecTime (uint32) followed by the signals (one 32 bit word each),
+ * i.e. cycleSize = 4 * (1 + number of signals) bytes.
+ * The sequence is incremented for every datagram and lets the receiver detect
+ * lost and reordered datagrams. droppedCycles counts the cycles that the sender
+ * could not queue because its ring was full.
+ */
+#ifndef STREAMINGDRIVER_PACKET_H_
+#define STREAMINGDRIVER_PACKET_H_
+
+#include "System.h"
+
+/** Identifies the streaming datagrams ("MSD1") */
+#define SD_PACKET_MAGIC          0x3144534D
+/** Largest UDP payload */
+#define SD_MAX_DATAGRAM_SIZE     65507
+
+struct StreamingDriverPacketHeader{
+    /** SD_PACKET_MAGIC */
+    uint32 magic;
+    /** Datagram counter */
+    uint32 sequence;
+    /** Number of cycles which follow the header */
+    uint32 nOfCycles;
+    /** Size of each cycle in bytes */
+    uint32 cycleSize;
+    /** Total number of cycles dropped by the sender */
+    uint32 droppedCycles;
+    /** Not used */
+    uint32 reserved;
+};
+
+#endif /*STREAMINGDRIVER_PACKET_H_*/
@@ -26,19 +26,25 @@
 #include "StreamingDriverReceiver.h"
 #include "CDBExtended.h"
 
+#if defined(_LINUX) || defined(_SOLARIS) || defined(_MACOSX)
+#include <sys/socket.h>
+#endif
+
 void StreamingDriverReceiverThread(void *args){
-    StreamingDriverReceiver *streamingDriver    = (StreamingDriverReceiver *)args;
-    int32                    idxCounter         = 0;
-    int32                    startIdxCounter    = 0;
-    int32                    memTransferCounter = 0;
-    uint32                   transferPacketSize = 0;
+    StreamingDriverReceiver *streamingDriver = (StreamingDriverReceiver *)args;
+    //Used to discard the datagrams when the ring is full
+    char                    *spareSlot       = streamingDriver->packetRing + streamingDriver->numberOfPackets * streamingDriver->packetSize;
 
     Threads::SetHighClass();
 
     while(streamingDriver->receiverThreadIsAlive){
-        //Wait for new packets
-        transferPacketSize = streamingDriver->memBufferSize * streamingDriver->numberOfTransferBuffers + sizeof(double);
-        if(!streamingDriver->receiverSocket.Read(streamingDriver->transferBuffer, transferPacketSize)){
+        uint32 received = (uint32)streamingDriver->receivedPackets;
+        bool   full     = ((received - (uint32)streamingDriver->releasedPackets) >= (uint32)streamingDriver->numberOfPackets);
+        char  *slot     = full ? spareSlot : streamingDriver->Packet(received);
+
+        //Wait for new packets. The datagram is read directly in its slot
+        uint32 transferPacketSize = streamingDriver->packetSize;
+        if(!streamingDriver->receiverSocket.Read(slot, transferPacketSize)){
             CStaticAssertErrorCondition(Warning, "StreamingDriverReceiver::StreamingDriverReceiverThread. Could not read ready packet in socket!");
             continue;
         }
@@ -46,92 +52,141 @@ void StreamingDriverReceiverThread(void *args){
             break;
         }
 
-        int i = 0;
-        for(i=0; i<streamingDriver->numberOfTransferBuffers; i++){
-            //A free buffer index and lock the buffer
-            int32 unlockedBufferIndex = streamingDriver->GetNextUnlockedBufferIndexAndLock();
-            if(streamingDriver->bufferFreeStates[unlockedBufferIndex] == streamingDriver->Full){
-                //We are running too fast and just overlaped the consumer thread
-                streamingDriver->lostBuffers++;
-                if((HRT::HRTCounter() - streamingDriver->lastWarningCounter) * HRT::HRTPeriod() > 1){
-                    CStaticAssertErrorCondition(Warning, "StreamingDriverReceiver::StreamingDriverReceiverThread. The system seems to be underdimensioned. Wrote over full buffers in the last second. Conf. buffers: %d Wrote over: %d", streamingDriver->numberOfBuffers, streamingDriver->lostBuffers);
-                    streamingDriver->lastWarningCounter = HRT::HRTCounter();
-                    streamingDriver->lostBuffers = 0;
-                }
-                //Mark as free
-                Atomic::Exchange(&streamingDriver->bufferFreeStates[unlockedBufferIndex], streamingDriver->Free);
-                streamingDriver->lastReadIdx = unlockedBufferIndex;
-            }
-        
-            //Local copy of the buffer
-            uint32 *copyBuffer = (uint32 *)(streamingDriver->memoryBuffer + unlockedBufferIndex * streamingDriver->memBufferSize);
-            
-            //Copy the data
-            memcpy(copyBuffer, streamingDriver->transferBuffer + sizeof(double) + i * streamingDriver->memBufferSize, streamingDriver->memBufferSize);
-            streamingDriver->lastUsecTime = *copyBuffer;
-            //Mark as full
-            if(Atomic::Exchange(&streamingDriver->bufferFreeStates[unlockedBufferIndex], streamingDriver->Full) != streamingDriver->Free){
-                CStaticAssertErrorCondition(Warning, "StreamingDriverReceiver::StreamingDriverReceiverThread Could not mark buffer index: %d as full!", unlockedBufferIndex);
+        if(streamingDriver->ValidatePacket(slot, transferPacketSize)){
+            if(full){
+                //GetData is not consuming fast enough
+                streamingDriver->overrunPackets++;
             }
-            //Unlock the buffer
-            if(Atomic::Exchange(&streamingDriver->bufferLockStates[unlockedBufferIndex], streamingDriver->Unlocked) != streamingDriver->Locked){
-                CStaticAssertErrorCondition(FatalError, "StreamingDriverReceiver::WriteData: Could not unlock buffer index: %d which was locked by me!", unlockedBufferIndex);
+            else{
+                //Publish the datagram. The locked increment also orders the reception before it
+                Atomic::Increment(&streamingDriver->receivedPackets);
+                //Signal new buffers available
+                streamingDriver->synchEventSem.Post();
             }
-            //Signal new buffer available
-            streamingDriver->synchEventSem.Post();
         }
-        //Signal new buffer available
-        //streamingDriver->synchEventSem.Post();
+        streamingDriver->ReportLosses();
     }
     streamingDriver->receiverThreadIsAlive = True;
     CStaticAssertErrorCondition(Information, "StreamingDriverReceiver::StreamingDriverReceiverThread is exiting");
 }
 
-int StreamingDriverReceiver::GetNextUnlockedBufferIndexAndLock(){
-    lastUnlockedBufferIndex++;
-    if(lastUnlockedBufferIndex == numberOfBuffers){
-        lastUnlockedBufferIndex = 0;
+bool StreamingDriverReceiver::ValidatePacket(const char *packet, uint32 size){
+    const StreamingDriverPacketHeader *header = (const StreamingDriverPacketHeader *)packet;
+    if(size < sizeof(StreamingDriverPacketHeader)){
+        invalidPackets++;
+        return False;
+    }
+    if((header->magic != SD_PACKET_MAGIC) || (header->cycleSize != (uint32)memBufferSize) ||
+       (header->nOfCycles < 1) || (header->nOfCycles > (uint32)numberOfTransferBuffers) ||
+       (size != sizeof(StreamingDriverPacketHeader) + header->nOfCycles * header->cycleSize)){
+        invalidPackets++;
+        return False;
+    }
+
+    if(sequenceValid){
+        int32 gap = (int32)(header->sequence - expectedSequence);
+        //A sequence restarting from 0, or too old to be a datagram delayed in the
+        //network, comes from a restarted sender: follow it instead of discarding
+        //all its datagrams until it reaches the previous sequence
+        if(((header->sequence == 0) && (gap != 0)) || (gap < -numberOfPackets)){
+            resyncs++;
+            gap                   = 0;
+            reportedDroppedCycles = 0;
+        }
+        else if(gap < 0){
+            //Older than the last datagram, the cycles would be consumed out of order
+            reorderedPackets++;
+            return False;
+        }
+        lostPackets += gap;
+    }
+    sequenceValid       = True;
+    expectedSequence    = header->sequence + 1;
+    senderDroppedCycles = header->droppedCycles;
+    return True;
+}
+
+void StreamingDriverReceiver::ReportLosses(){
+    uint32 droppedCycles = senderDroppedCycles - reportedDroppedCycles;
+    if((lostPackets == 0) && (reorderedPackets == 0) && (resyncs == 0) && (overrunPackets == 0) && (invalidPackets == 0) && (droppedCycles == 0)){
+        return;
+    }
+    if((HRT::HRTCounter() - lastWarningCounter) * HRT::HRTPeriod() > 1){
+        CStaticAssertErrorCondition(Warning, "StreamingDriverReceiver::StreamingDriverReceiverThread. In the last second: lost packets: %d reordered: %d sequence restarts: %d overrun: %d invalid: %d cycles dropped by the sender: %d", lostPackets, reorderedPackets, resyncs, overrunPackets, invalidPackets, droppedCycles);
+        lastWarningCounter    = HRT::HRTCounter();
+        lostPackets           = 0;
+        reorderedPackets      = 0;
+        resyncs               = 0;
+        overrunPackets        = 0;
+        invalidPackets        = 0;
+        reportedDroppedCycles = senderDroppedCycles;
     }
-    Atomic::Exchange(&bufferLockStates[lastUnlockedBufferIndex], Locked);
-    return lastUnlockedBufferIndex;
 }
 
-int32 StreamingDriverReceiver::GetData(uint32 usecTime, int32 *buffer, int32 bufferNumber){
-    int32 *lbuffer = (int32 *)(memoryBuffer + memBufferSize * lastReadIdx);
-    int32 *rbuffer = buffer;
-/*    if(synchronizing){
-        rbuffer[0] = *lbuffer;
-        rbuffer[1] = buffer[0];
-
-        // Skip the packet sample number and sample time
-        rbuffer += 2;
-    }*/
-
-    memcpy(rbuffer, lbuffer + 1, memBufferSize - 1);
-    if(Atomic::Exchange(&bufferFreeStates[lastReadIdx], Free) != Full){
-        AssertErrorCondition(Warning, "StreamingDriver Could not mark buffer index: %d as free!", lastReadIdx);
+const uint32 *StreamingDriverReceiver::NextCycle(bool consume){
+    uint32 received = (uint32)receivedPackets;
+    Atomic::Barrier();
+    while(readPacket != received){
+        const StreamingDriverPacketHeader *header = (const StreamingDriverPacketHeader *)Packet(readPacket);
+        bool newerPackets = ((received - readPacket) > 1);
+        if((readCycle < header->nOfCycles) && (synchronizing || !newerPackets)){
+            if(!synchronizing){
+                //GetLatest: only the last cycle is of interest
+                readCycle = header->nOfCycles - 1;
+            }
+            const uint32 *cycle = (const uint32 *)((const char *)(header + 1) + readCycle * memBufferSize);
+            if(consume){
+                readCycle++;
+                Atomic::Barrier();
+                releasedPackets = readPacket;
+            }
+            return cycle;
+        }
+        readPacket++;
+        readCycle = 0;
     }
+    return NULL;
+}
 
-    lastReadIdx++;
-    if(lastReadIdx == numberOfBuffers){
-    	lastReadIdx = 0;
+int32 StreamingDriverReceiver::GetData(uint32 usecTime, int32 *buffer, int32 bufferNumber){
+    const uint32 *cycle = NextCycle(True);
+    if(cycle != NULL){
+        lastCycle    = cycle;
+        lastUsecTime = *cycle;
     }
+    //Nothing received yet
+    if(lastCycle == NULL){
+        memset(buffer, 0, memBufferSize - sizeof(int32));
+        return True;
+    }
+    //The datagram holding lastCycle is not overwritten until a newer cycle is consumed.
+    //Skip the time header
+    memcpy(buffer, lastCycle + 1, memBufferSize - sizeof(int32));
     return True;
 }
 
 bool StreamingDriverReceiver::Poll(){
-    if(bufferLockStates[lastReadIdx] == Unlocked && bufferFreeStates[lastReadIdx] == Full){
-        /** Trigger External Activities */
-        for(int activity = 0; activity < nOfTriggeringServices; activity++){
-            triggerService[activity].Trigger();
+    const uint32 *cycle = NextCycle(False);
+    if(cycle == NULL){
+        //Reset before checking again, so that a Post of the receiver thread is never lost
+        synchEventSem.Reset();
+        cycle = NextCycle(False);
+        if(cycle == NULL){
+            if(!synchEventSem.Wait(synchronizingMSTimeout)){
+                return False;
+            }
+            cycle = NextCycle(False);
+            if(cycle == NULL){
+                return False;
+            }
         }
-        return True;
     }
-    if(synchEventSem.ResetWait(synchronizingMSTimeout)){
-        return Poll();
+    lastUsecTime = *cycle;
+    /** Trigger External Activities */
+    for(int activity = 0; activity < nOfTriggeringServices; activity++){
+        triggerService[activity].Trigger();
     }
-
-    return False;
+    return True;
 }
 
 bool StreamingDriverReceiver::ObjectLoadSetup(ConfigurationDataBase &info,StreamInterface *err){
@@ -193,60 +248,67 @@ bool StreamingDriverReceiver::ObjectLoadSetup(ConfigurationDataBase &info,Stream
 
     AssertErrorCondition(Information, "StreamingDriverReceiver::ObjectLoadSetup: %s Streaming socket listening in port: %d", Name(), receiverUDPPort);
 
-    if(numberOfTransferBuffers > numberOfBuffers){
-        AssertErrorCondition(InitialisationError, "StreamingDriverReceiver::ObjectLoadSetup: NumberOfTransferBuffers must no be higher than NumberOfBuffers: %d > %d", numberOfTransferBuffers, numberOfBuffers);
+    memBufferSize    = NumberOfInputs() * sizeof(float) + sizeof(int32);
+
+    int32 maxTransferBuffers = (SD_MAX_DATAGRAM_SIZE - sizeof(StreamingDriverPacketHeader)) / memBufferSize;
+    if(maxTransferBuffers < 1){
+        AssertErrorCondition(InitialisationError, "StreamingDriverReceiver::ObjectLoadSetup: %s A cycle of %d bytes does not fit in a datagram", Name(), memBufferSize);
         return False;
     }
-
-    if(memoryBuffer != NULL) free((void *&)memoryBuffer);
-/*    if(synchronizing){
-        //Discard the packet counter and usectime . This is not arriving as signal
-        memBufferSize    = (NumberOfInputs() - 2) * sizeof(float) + sizeof(int32);
+    //Same limit applied by the StreamingDriver
+    if(numberOfTransferBuffers > maxTransferBuffers){
+        AssertErrorCondition(Warning, "StreamingDriverReceiver::ObjectLoadSetup: %s %d cycles of %d bytes do not fit in a datagram. NumberOfTransferBuffers reduced to %d", Name(), numberOfTransferBuffers, memBufferSize, maxTransferBuffers);
+        numberOfTransferBuffers = maxTransferBuffers;
     }
-    else{*/
-        memBufferSize    = NumberOfInputs() * sizeof(float) + sizeof(int32);
-//    }
-    memoryBuffer     = (char *)malloc(memBufferSize * numberOfBuffers);
-    if(memoryBuffer == NULL){
-        AssertErrorCondition(InitialisationError,"StreamingDriverReceiver::ObjectLoadSetup: %s Failed allocating %d bytes for storing data",Name(), memBufferSize * numberOfBuffers);
+    if(numberOfTransferBuffers < 1){
+        AssertErrorCondition(InitialisationError, "StreamingDriverReceiver::ObjectLoadSetup: %s NumberOfTransferBuffers must be positive", Name());
         return False;
-    }    
-    memset(memoryBuffer, 0, memBufferSize * numberOfBuffers);
-    AssertErrorCondition(Information,"StreamingDriverReceiver::ObjectLoadSetup: %s Successfully allocated %d bytes for data storing divided in %d buffers",Name(), memBufferSize * numberOfBuffers, numberOfBuffers);
-
-
-    if(transferBuffer != NULL) free((void *&)transferBuffer);
-    transferBuffer     = (char *)malloc(memBufferSize * numberOfTransferBuffers);
-    if(transferBuffer  == NULL){
-        CStaticAssertErrorCondition(InitialisationError,"StreamingDriverReceiver::ObjectLoadSetup: %s Could not allocate: %d bytes for the transfer buffer. The consumer thread will NOT start", Name(), memBufferSize * numberOfTransferBuffers);
     }
-    memset(transferBuffer, 0, memBufferSize * numberOfTransferBuffers);
-    AssertErrorCondition(Information,"StreamingDriverReceiver::ObjectLoadSetup: %s Successfully allocated %d bytes for data streaming divided in %d buffers",Name(), memBufferSize * numberOfTransferBuffers, numberOfTransferBuffers);
-
 
-    if(bufferLockStates != NULL) free((void *&)bufferLockStates);
-    bufferLockStates = (int32 *)malloc(numberOfBuffers * sizeof(int32));
-    if(bufferLockStates == NULL){
-        AssertErrorCondition(InitialisationError,"StreamingDriverReceiver::ObjectLoadSetup: %s Failed allocating %d bytes for the buffer locking semaphores" ,Name(), numberOfBuffers * sizeof(int32));
+    if(numberOfTransferBuffers > numberOfBuffers){
+        AssertErrorCondition(InitialisationError, "StreamingDriverReceiver::ObjectLoadSetup: NumberOfTransferBuffers must no be higher than NumberOfBuffers: %d > %d", numberOfTransferBuffers, numberOfBuffers);
         return False;
     }
-    memset(bufferLockStates, 0, numberOfBuffers * sizeof(int32));
 
+    //A power of two, so that the slot of a datagram does not change when the counters wrap
+    numberOfPackets = 2;
+    while(numberOfPackets * numberOfTransferBuffers < numberOfBuffers){
+        numberOfPackets *= 2;
+    }
+    packetSize = sizeof(StreamingDriverPacketHeader) + numberOfTransferBuffers * memBufferSize;
 
-    if(bufferFreeStates != NULL) free((void *&)bufferFreeStates);
-    bufferFreeStates = (int32 *)malloc(numberOfBuffers * sizeof(int32));
-    if(bufferFreeStates == NULL){
-        AssertErrorCondition(InitialisationError,"StreamingDriverReceiver::ObjectLoadSetup: %s Failed allocating %d bytes for the buffer locking semaphores" ,Name(), numberOfBuffers * sizeof(int32));
+    if(packetRing != NULL) free((void *&)packetRing);
+    packetRing     = (char *)malloc(packetSize * (numberOfPackets + 1));
+    if(packetRing == NULL){
+        AssertErrorCondition(InitialisationError,"StreamingDriverReceiver::ObjectLoadSetup: %s Failed allocating %d bytes for storing data",Name(), packetSize * (numberOfPackets + 1));
         return False;
+    }    
+    memset(packetRing, 0, packetSize * (numberOfPackets + 1));
+    AssertErrorCondition(Information,"StreamingDriverReceiver::ObjectLoadSetup: %s Successfully allocated %d bytes for data storing divided in %d packets of %d buffers",Name(), packetSize * (numberOfPackets + 1), numberOfPackets, numberOfTransferBuffers);
+
+    int32 socketBufferSize = 0;
+    cdb.ReadInt32(socketBufferSize, "SocketReceiveBufferSize", 0);
+#if defined(_LINUX) || defined(_SOLARIS) || defined(_MACOSX)
+    if(socketBufferSize > 0){
+        if(setsockopt(receiverSocket.Socket(), SOL_SOCKET, SO_RCVBUF, &socketBufferSize, sizeof(socketBufferSize)) < 0){
+            AssertErrorCondition(Warning,"StreamingDriverReceiver::ObjectLoadSetup: %s Could not set the socket receive buffer to %d bytes", Name(), socketBufferSize);
+        }
     }
-    memset(bufferFreeStates, 0, numberOfBuffers * sizeof(int32));
+#endif
+
+    receivedPackets       = 0;
+    releasedPackets       = 0;
+    readPacket            = 0;
+    readCycle             = 0;
+    lastCycle             = NULL;
+    sequenceValid         = False;
+    expectedSequence      = 0;
+    senderDroppedCycles   = 0;
+    reportedDroppedCycles = 0;
 
     /** Begin the consumer thread*/
-    lastUnlockedBufferIndex = -1;
     receiverThreadID = Threads::BeginThread((ThreadFunctionType)StreamingDriverReceiverThread, this, THREADS_DEFAULT_STACKSIZE, Name(), XH_NotHandled, cpuMask);
 
-    lastReadIdx = 0;
-    
     return True;
 }
 
@@ -274,19 +336,15 @@ StreamingDriverReceiver::~StreamingDriverReceiver(){
         AssertErrorCondition(FatalError,"StreamingDriverReceiver::~StreamingDriverReceiver(): Consumer thread did not exited in 1 seconds %s", Name());
     }
     else{
-        if(memoryBuffer     != NULL) free((void *&)memoryBuffer);
-        if(bufferLockStates != NULL) free((void *&)bufferLockStates);
-        if(bufferFreeStates != NULL) free((void *&)bufferFreeStates);
-        if(transferBuffer   != NULL) free((void *&)transferBuffer);
+        if(packetRing != NULL) free((void *&)packetRing);
     }
 }
 
 StreamingDriverReceiver::StreamingDriverReceiver(){
 
-    memoryBuffer            = NULL;
-    transferBuffer          = NULL;
-    bufferLockStates        = NULL;
-    bufferFreeStates        = NULL;
+    packetRing              = NULL;
+    numberOfPackets         = 0;
+    packetSize              = 0;
     
     memBufferSize           = 0;
     lastUsecTime            = 0;
@@ -294,12 +352,23 @@ StreamingDriverReceiver::StreamingDriverReceiver(){
     numberOfTransferBuffers = 0;
     receiverUDPPort         = 0;
     cpuMask                 = 0;
-    lastReadIdx             = 0;
 
-    lostBuffers             = 0;
+    receivedPackets         = 0;
+    releasedPackets         = 0;
+    readPacket              = 0;
+    readCycle               = 0;
+    lastCycle               = NULL;
+
+    expectedSequence        = 0;
+    sequenceValid           = False;
+    senderDroppedCycles     = 0;
+    reportedDroppedCycles   = 0;
+    lostPackets             = 0;
+    reorderedPackets        = 0;
+    resyncs                 = 0;
+    overrunPackets          = 0;
+    invalidPackets          = 0;
     lastWarningCounter      = 0;
-    
-    lastUnlockedBufferIndex = -1;
 
     synchronizing           = False;
     synchronizingMSTimeout  = 0;
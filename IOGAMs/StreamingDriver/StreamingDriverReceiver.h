@@ -29,6 +29,7 @@
 #include "GenericAcqModule.h"
 #include "Atomic.h"
 #include "UDPSocket.h"
+#include "StreamingDriverPacket.h"
 
 /** The streaming thread signature*/
 extern "C"{
@@ -43,42 +44,68 @@ OBJECT_DLL_STUFF(StreamingDriverReceiver)
 
 private:
 
-    /** The states used in the buffer lock*/
-    enum BufferLockStates{
-        Unlocked = 0,
-        Locked   = 1
-    };
-    
-    /** The states used in the buffer full array*/
-    enum BufferFullStates{
-        Free = 0,
-        Full = 1
-    };
-
-    /** Memory Buffer where data is stored in pages. For every cycle data is copied into this buffer*/
-    char     *memoryBuffer;
-
-    /** This buffer is used by the receiver thread to store the data which is sent each time the numberOfTransferBuffers
-     * is reached*/
-    char     *transferBuffer;
-    
+    /** Ring of numberOfPackets (a power of two) datagrams (plus a spare slot used to discard the datagrams
+     * when the ring is full). The receiver thread reads each datagram directly in its
+     * slot and the cycles are consumed in place by GetData*/
+    char     *packetRing;
+
+    /** The number of datagrams in the ring*/
+    int32     numberOfPackets;
+
+    /** The size of a slot of the ring: header plus numberOfTransferBuffers cycles*/
+    int32     packetSize;
+
     /** The number of buffers*/
     int32     numberOfBuffers;
 
-    /** The number of buffers which is to be sent by each consumer packet*/
+    /** The maximum number of buffers in each received packet*/
     int32     numberOfTransferBuffers; 
 
     /** The size of each buffer in bytes*/
     int32     memBufferSize;
 
-    /** Flags which control if a buffer is locked (for writing or reading)*/
-    int32    *bufferLockStates;
+    /** Number of datagrams stored in the ring (only incremented by the receiver thread)*/
+    volatile int32 receivedPackets;
+
+    /** Datagrams before this one can be overwritten. The datagram holding the last
+     * cycle returned by GetData is never overwritten (only written by GetData)*/
+    volatile int32 releasedPackets;
+
+    /** The datagram being consumed by GetData*/
+    uint32    readPacket;
+
+    /** The next cycle of readPacket to be consumed*/
+    uint32    readCycle;
+
+    /** The last cycle returned by GetData*/
+    const uint32 *lastCycle;
+
+    /** Sequence number expected in the next datagram*/
+    uint32    expectedSequence;
+
+    /** True when the first datagram was received*/
+    bool      sequenceValid;
 
-    /** Flags which control if a buffer is full*/
-    int32    *bufferFreeStates;
+    /** Dropped cycles reported by the sender in the last datagram*/
+    uint32    senderDroppedCycles;
 
-    /** The last unlocked buffer index found*/
-    int32     lastUnlockedBufferIndex;
+    /** Value of senderDroppedCycles in the last warning*/
+    uint32    reportedDroppedCycles;
+
+    /** Number of datagrams lost in the network*/
+    int32     lostPackets;
+
+    /** Number of datagrams arrived out of order (discarded)*/
+    int32     reorderedPackets;
+
+    /** Number of times the sequence was restarted (e.g. the sender was restarted)*/
+    int32     resyncs;
+
+    /** Number of datagrams discarded because the ring was full*/
+    int32     overrunPackets;
+
+    /** Number of invalid datagrams*/
+    int32     invalidPackets;
 
     /** The event sem which is used by the receiver to wake the Poll*/
     EventSem  synchEventSem;
@@ -101,18 +128,12 @@ private:
     /** The UDP socket to send the data*/
     UDPSocket receiverSocket;
 
-    /** The last index read by the GetData*/
-    int32     lastReadIdx;
-
     /** This is true if the driver is also assumed to be a timing source*/
     bool      synchronizing;
 
     /** Timeout when synchronizing*/
     int32     synchronizingMSTimeout;
 
-    /** The number of buffers lost (only used for the warnings)*/
-    int32     lostBuffers;
-
     /** Counter value when the last warning was issued. The system will not send more than a warning per second*/
     int64     lastWarningCounter; 
 
@@ -124,9 +145,24 @@ private:
         return time;
     }
 
-    /** Returns the index of the next unlocked buffer. If none
-     * is found, return -1*/
-    int GetNextUnlockedBufferIndexAndLock();
+    /** The slot of a datagram*/
+    inline char *Packet(uint32 packet){
+        return packetRing + (packet % numberOfPackets) * packetSize;
+    }
+
+    /** Checks the header and the sequence number of a datagram.
+        @return False if the datagram must be discarded */
+    bool ValidatePacket(const char *packet, uint32 size);
+
+    /** Issues (at most once per second) the warnings about the lost datagrams*/
+    void ReportLosses();
+
+    /**
+     * Finds the next cycle to be consumed. In GetLatest mode the older cycles are skipped.
+     * @param consume If True the cycle is consumed and the older datagrams are released
+     * @return NULL if there are no new cycles
+     */
+    const uint32 *NextCycle(bool consume);
 public:
     
     /** Constructor. */
@@ -0,0 +1,196 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+#include "UDPBatchSocket.h"
+#include "ErrorManagement.h"
+
+#include <errno.h>
+#if defined(_LINUX)
+#include <unistd.h>
+#endif
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+UDPBatchSocket::UDPBatchSocket(){
+    socketFd       = -1;
+    batchSize      = 0;
+    packetByteSize = 0;
+    packets        = NULL;
+    packetSizes    = NULL;
+    nOfQueued      = 0;
+    hasDestination = False;
+#if defined(_LINUX)
+    messages       = NULL;
+    iovecs         = NULL;
+#endif
+}
+
+void UDPBatchSocket::CleanUp(){
+    if(packets != NULL)     free((void *&)packets);
+    if(packetSizes != NULL) free((void *&)packetSizes);
+#if defined(_LINUX)
+    if(messages != NULL)    free((void *&)messages);
+    if(iovecs != NULL)      free((void *&)iovecs);
+#endif
+    batchSize = 0;
+    nOfQueued = 0;
+}
+
+bool UDPBatchSocket::Init(int32 fd, uint32 packetSize, uint32 packetsPerCall){
+    CleanUp();
+    if((packetSize == 0) || (packetsPerCall == 0)) return False;
+
+    socketFd       = fd;
+    batchSize      = packetsPerCall;
+    packetByteSize = packetSize;
+    packets        = (char *)malloc(batchSize * packetByteSize);
+    packetSizes    = (uint32 *)malloc(batchSize * sizeof(uint32));
+    bool ok = (packets != NULL) && (packetSizes != NULL);
+#if defined(_LINUX)
+    messages       = (struct mmsghdr *)malloc(batchSize * sizeof(struct mmsghdr));
+    iovecs         = (struct iovec *)malloc(batchSize * sizeof(struct iovec));
+    ok = ok && (messages != NULL) && (iovecs != NULL);
+    if(ok){
+        memset(messages, 0, batchSize * sizeof(struct mmsghdr));
+        for(uint32 i = 0; i < batchSize; i++){
+            iovecs[i].iov_base            = packets + i * packetByteSize;
+            iovecs[i].iov_len             = packetByteSize;
+            messages[i].msg_hdr.msg_iov    = &iovecs[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+        }
+    }
+#endif
+    if(!ok){
+        CStaticAssertErrorCondition(InitialisationError, "UDPBatchSocket::Init: failed allocating %d packets of %d bytes", packetsPerCall, packetSize);
+        CleanUp();
+    }
+    return ok;
+}
+
+void UDPBatchSocket::SetDestination(InternetAddress &address){
+    memset(&destination, 0, sizeof(destination));
+    destination.sin_family      = AF_INET;
+    destination.sin_port        = htons((uint16)address.Port());
+    destination.sin_addr.s_addr = address.HostNumber();
+    hasDestination              = True;
+#if defined(_LINUX)
+    for(uint32 i = 0; i < batchSize; i++){
+        messages[i].msg_hdr.msg_name    = &destination;
+        messages[i].msg_hdr.msg_namelen = sizeof(destination);
+    }
+#endif
+}
+
+int32 UDPBatchSocket::Receive(){
+#if defined(_LINUX)
+    for(uint32 i = 0; i < batchSize; i++){
+        iovecs[i].iov_len            = packetByteSize;
+        messages[i].msg_hdr.msg_flags = 0;
+    }
+    int ret = -1;
+    do{
+        // MSG_WAITFORONE blocks for the first packet only
+        ret = recvmmsg(socketFd, messages, batchSize, MSG_WAITFORONE, NULL);
+    }while((ret < 0) && (errno == EINTR));
+    if(ret < 0) return -1;
+    for(int i = 0; i < ret; i++){
+        // A truncated datagram is reported as too large
+        packetSizes[i] = ((messages[i].msg_hdr.msg_flags & MSG_TRUNC) != 0) ? (packetByteSize + 1) : messages[i].msg_len;
+    }
+    return ret;
+#else
+    int ret = recv(socketFd, packets, packetByteSize, 0);
+    if(ret < 0) return -1;
+    packetSizes[0] = ret;
+    return 1;
+#endif
+}
+
+bool UDPBatchSocket::Queue(uint32 size){
+#if defined(_LINUX)
+    iovecs[nOfQueued].iov_len = size;
+#else
+    packetSizes[nOfQueued] = size;
+#endif
+    nOfQueued++;
+    if(nOfQueued >= batchSize) return Flush();
+    return True;
+}
+
+bool UDPBatchSocket::Flush(){
+    uint32 sent = 0;
+#if defined(_LINUX)
+    while(sent < nOfQueued){
+        int ret = sendmmsg(socketFd, messages + sent, nOfQueued - sent, 0);
+        if(ret < 0){
+            if(errno == EINTR) continue;
+            break;
+        }
+        sent += ret;
+    }
+#else
+    while(sent < nOfQueued){
+        int ret = 0;
+        if(hasDestination){
+            ret = sendto(socketFd, packets + sent * packetByteSize, packetSizes[sent], 0, (struct sockaddr *)&destination, sizeof(destination));
+        }
+        else{
+            ret = send(socketFd, packets + sent * packetByteSize, packetSizes[sent], 0);
+        }
+        if(ret < 0) break;
+        sent++;
+    }
+#endif
+    bool ok = (sent == nOfQueued);
+    nOfQueued = 0;
+    return ok;
+}
+
+void UDPBatchSocket::CopySwap32(uint32 *destination, const uint32 *source, uint32 nOfWords){
+    uint32 i = 0;
+#if defined(__SSSE3__)
+    const __m128i mask = _mm_set_epi8(12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3);
+    for(; i + 4 <= nOfWords; i += 4){
+        __m128i x = _mm_loadu_si128((const __m128i *)(source + i));
+        _mm_storeu_si128((__m128i *)(destination + i), _mm_shuffle_epi8(x, mask));
+    }
+#elif defined(__SSE2__)
+    for(; i + 4 <= nOfWords; i += 4){
+        __m128i x = _mm_loadu_si128((const __m128i *)(source + i));
+        // Swap the bytes of each 16 bit half, then the two halves
+        x = _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+        x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+        x = _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128((__m128i *)(destination + i), x);
+    }
+#endif
+    for(; i < nOfWords; i++){
+        uint32 x = source[i];
+        destination[i] = (x >> 24) | ((x >> 8) & 0x0000FF00) | ((x << 8) & 0x00FF0000) | (x << 24);
+    }
+}
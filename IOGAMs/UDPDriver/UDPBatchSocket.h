@@ -0,0 +1,137 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file Moves several UDP packets per system call.
+ * On Linux the packets are received with recvmmsg and sent with sendmmsg,
+ * elsewhere one recv/send per packet is used.
+ */
+#if !defined (_UDP_BATCH_SOCKET)
+#define _UDP_BATCH_SOCKET
+
+#include "System.h"
+#include "InternetAddress.h"
+
+#if defined(_LINUX)
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
+
+class UDPBatchSocket{
+private:
+    /** The socket */
+    int32              socketFd;
+
+    /** Maximum number of packets per call */
+    uint32             batchSize;
+
+    /** Size of the packet buffers */
+    uint32             packetByteSize;
+
+    /** The packet buffers */
+    char              *packets;
+
+    /** Size of each received packet */
+    uint32            *packetSizes;
+
+    /** Number of packets waiting in the transmission batch */
+    uint32             nOfQueued;
+
+    /** The destination of the packets sent */
+    struct sockaddr_in destination;
+
+    /** False if the socket is connected */
+    bool               hasDestination;
+
+#if defined(_LINUX)
+    /** The message headers */
+    struct mmsghdr    *messages;
+
+    /** One iovec per packet */
+    struct iovec      *iovecs;
+#endif
+
+public:
+
+    UDPBatchSocket();
+
+    ~UDPBatchSocket(){
+        CleanUp();
+    }
+
+    /** Frees the buffers */
+    void CleanUp();
+
+    /**
+     * Allocates the buffers
+     * @param fd A bound (receiver) or connected (transmitter) UDP socket
+     * @param packetSize The maximum packet size
+     * @param packetsPerCall The maximum number of packets per system call
+     */
+    bool Init(int32 fd, uint32 packetSize, uint32 packetsPerCall);
+
+    /**
+     * Waits for at least one packet and receives all those already queued by the kernel, up to the batch size
+     * @return The number of packets received, -1 on error
+     */
+    int32 Receive();
+
+    /** Sets the destination of the packets sent */
+    void SetDestination(InternetAddress &address);
+
+    /** A received packet */
+    inline const char *Packet(uint32 index) const{
+        return packets + index * packetByteSize;
+    }
+
+    /** The size of a received packet */
+    inline uint32 PacketSize(uint32 index) const{
+        return packetSizes[index];
+    }
+
+    /** The buffer of the next packet to be sent */
+    inline char *NextTransmitPacket(){
+        return packets + nOfQueued * packetByteSize;
+    }
+
+    /**
+     * Adds the packet returned by NextTransmitPacket to the batch. The batch
+     * is sent when full
+     * @param size Size of the packet
+     */
+    bool Queue(uint32 size);
+
+    /** Sends the queued packets */
+    bool Flush();
+
+    /** Number of packets waiting to be sent */
+    uint32 Queued() const{
+        return nOfQueued;
+    }
+
+    /** Copies nOfWords 32 bit words swapping the bytes of each of them */
+    static void CopySwap32(uint32 *destination, const uint32 *source, uint32 nOfWords);
+};
+
+#endif
@@ -28,11 +28,6 @@
 #include "CDBExtended.h"
 #include "FastPollingMutexSem.h"
 
-struct UDPMsgHeaderStruct{
-    unsigned int nSampleNumber; // the sample number since the last t=0
-    unsigned int nSampleTime;   // the sample time
-};
-
 /**
  * Enable System Acquisition
  */
@@ -95,6 +90,11 @@ bool  UDPDrv::Init(){
     packetNumber                        = 0;
     freshPacket                         = False;
     applyEndianity                      = True;
+    highRateMode                        = False;
+    batchSize                           = 1;
+    stalePacketCount                    = 0;
+    receiveCalls                        = 0;
+    receivedPackets                     = 0;
 
     destinationServerAddress.SetSize(0);
     destinationServerAddress            = -1;
@@ -166,6 +166,21 @@ bool UDPDrv::ObjectLoadSetup(ConfigurationDataBase &info,StreamInterface *err){
     }
     cpuMask = 0xFFFF;
 
+    FString highRate;
+    cdb.ReadFString(highRate, "HighRateMode", "False");
+    highRateMode = (highRate == "True");
+    // The receiver reads the packets already queued by the kernel, the transmitter
+    // groups the packets of BatchSize cycles in a single system call
+    if(!cdb.ReadInt32(batchSize, "BatchSize", (moduleType == UDP_MODULE_RECEIVER) ? 32 : 1)){
+        if(highRateMode){
+            AssertErrorCondition(Warning,"UDPDrv::ObjectLoadSetup: %s BatchSize was not specified. Using default: %d",Name(),batchSize);
+        }
+    }
+    if(batchSize < 1){
+        AssertErrorCondition(InitialisationError,"UDPDrv::ObjectLoadSetup: %s BatchSize must be > 0",Name());
+        return False;
+    }
+
     if(!socket.Open()){
         AssertErrorCondition(InitialisationError, "UDPDrv::EnableAcquisition: failed to open socket");
         return False;
@@ -198,6 +213,14 @@ bool UDPDrv::ObjectLoadSetup(ConfigurationDataBase &info,StreamInterface *err){
             AssertErrorCondition(InitialisationError,"UDPDrv::ObjectLoadSetup: malloc outputPacket");
             return False;        	
         }
+        if(highRateMode){
+            if(!batchSocket.Init(socket.Socket(), packetByteSize, batchSize)){
+                AssertErrorCondition(InitialisationError,"UDPDrv::ObjectLoadSetup: %s failed to initialise the batched socket",Name());
+                socket.Close();
+                return False;
+            }
+            batchSocket.SetDestination(socket.Destination());
+        }
     }
     else{
         if(numberOfInputChannels < 2){
@@ -253,6 +276,23 @@ bool UDPDrv::ObjectLoadSetup(ConfigurationDataBase &info,StreamInterface *err){
             }
         }
         packetByteSize = numberOfInputChannels*sizeof(int32);
+
+        if(highRateMode){
+            int32 ringSize = 8;
+            cdb.ReadInt32(ringSize, "RingSize", 8);
+            if(!packetRing.Init(numberOfInputChannels, ringSize)){
+                AssertErrorCondition(InitialisationError,"UDPDrv::ObjectLoadSetup: %s failed allocating the packet ring",Name());
+                socket.Close();
+                return False;
+            }
+            if(!batchSocket.Init(socket.Socket(), packetByteSize, batchSize)){
+                AssertErrorCondition(InitialisationError,"UDPDrv::ObjectLoadSetup: %s failed to initialise the batched socket",Name());
+                socket.Close();
+                return False;
+            }
+            stalePacketCount = 0;
+        }
+
         if(!socket.SetBlocking(True)){
             AssertErrorCondition(InitialisationError, "UDPDrv::EnableAcquisition: Failed to set UDP socket as blocking");
             socket.Close();
@@ -306,6 +346,26 @@ int32 UDPDrv::GetData(uint32 usecTime, int32 *buffer, int32 bufferNumber) {
         return -1;
     }
 
+    if(highRateMode) {
+        // Copy the latest packet of the ring, without locking the receiver
+        UDPMsgHeaderStruct *p = (UDPMsgHeaderStruct *)buffer;
+        uint32 packetCount = packetRing.ReadLatest((uint32 *)buffer);
+        if(packetCount == 0) {
+            memset(buffer, 0, packetByteSize);
+        }
+        if((packetCount == 0) || (packetCount == stalePacketCount)) {
+            p->nSampleNumber = 0xFFFFFFFF;
+            previousPacketTooOldErrorCounter++;
+        }
+        else if(abs((int32)(usecTime-p->nSampleTime)) > maxDataAgeUsec) {
+            // Packet too old
+            p->nSampleNumber = 0xFFFFFFFF;
+            previousPacketTooOldErrorCounter++;
+            stalePacketCount = packetCount;
+        }
+        return 1;
+    }
+
     // Make sure that, while writeBuffer is being
     // used to update globalReadBuffer, it is not being
     // changed in the receiver thread callback
@@ -321,7 +381,7 @@ int32 UDPDrv::GetData(uint32 usecTime, int32 *buffer, int32 bufferNumber) {
     // Check data age
     uint32 sampleNo = header->nSampleNumber;
     if(freshPacket) {
-        if(abs(usecTime-header->nSampleTime) > maxDataAgeUsec) {
+        if(abs((int32)(usecTime-header->nSampleTime)) > maxDataAgeUsec) {
             // Packet too old
             // return the last received data and put 0xFFFFFFFF as nSampleNumber
             sampleNo = 0xFFFFFFFF;
@@ -366,14 +426,25 @@ bool UDPDrv::WriteData(uint32 usecTime, const int32 *buffer){
     }
     uint32  size         = packetByteSize;
     uint32 *packetToSend = (uint32 *)outputPacket;
-    // Set the packet content
+    if(highRateMode){
+        packetToSend = (uint32 *)batchSocket.NextTransmitPacket();
+    }
+    // Add the header and set the packet content
+    packetToSend[0] = packetNumber++;
+    packetToSend[1] = usecTime;
+#if defined(INTEL_BYTE_ORDER)
+    UDPBatchSocket::CopySwap32(packetToSend, packetToSend, 2);
+    UDPBatchSocket::CopySwap32(packetToSend + 2, (const uint32 *)buffer, numberOfOutputChannels);
+#else
     memcpy(packetToSend + 2, buffer, numberOfOutputChannels * sizeof(uint32));
-    // Add the header
-    *packetToSend       = packetNumber++;
-    *(packetToSend + 1) = usecTime;
-    int32 i             = 0;
-    for(i=0; i<(numberOfOutputChannels + 2); i++){
-        Endianity::ToMotorola(packetToSend[i]);
+#endif
+    if(highRateMode){
+        // Sent when BatchSize packets are queued
+        if(!batchSocket.Queue(size)){
+            AssertErrorCondition(FatalError,"UDPDrv::WriteData: %s. Send socket error",Name());
+            return False;
+        }
+        return True;
     }
     // Send packet
     if(!socket.Write(packetToSend, size)){
@@ -434,6 +505,8 @@ bool UDPDrv::ObjectDescription(StreamInterface &s,bool full,StreamInterface *err
     s.Printf("Module Name --> %s\n",Name());
     s.Printf("MaxDataAgeUsec           = %d\n",maxDataAgeUsec);
     s.Printf("MaxNOfLostPackets        = %d\n",maxNOfLostPackets);
+    s.Printf("HighRateMode             = %s\n",highRateMode ? "True" : "False");
+    s.Printf("BatchSize                = %d\n",batchSize);
     // Module Type
     switch (moduleType){
         case UDP_MODULE_RECEIVER:
@@ -457,6 +530,68 @@ void ReceiverCallback(void* userData){
 }
 
 
+/**
+ * CheckPacket
+ */
+void UDPDrv::CheckPacket(const UDPMsgHeaderStruct &header){
+    if(producerUsecPeriod != -1) {
+        int64 counter = HRT::HRTCounter();
+        /// Allow for a 10% deviation from the specified producer usec period
+        if(abs((int32)((uint32)((counter-lastCounter)*HRT::HRTPeriod()*1000000)-(uint32)((header.nSampleNumber-originalNSampleNumber)*producerUsecPeriod))) > 0.1*producerUsecPeriod) {
+            deviationErrorCounter++;
+        }
+        originalNSampleNumber = header.nSampleNumber;
+        lastCounter = counter;
+    }
+
+    // If is the first packet doesn't do any check on nSampleNumber
+    if(lastPacketID != 0xFFFFFFFF) {
+        // Checks nSampleNumber
+        // Warning if a reset has happened and too much packet had been lost
+        // nSampleNumber has been casted to int32 to prevent wrong casting from compiler
+        if((int32)(header.nSampleNumber)-lastPacketID < 0) {
+            if((int32)(header.nSampleNumber) > maxNOfLostPackets) {
+                rolloverErrorCounter++;
+            }
+        } else {
+            // nSampleNumber has been casted to int32 to prevent wrong casting from compiler
+            if(((int32)(header.nSampleNumber)-lastPacketID) > 1) {
+                // Warning if a packet is lost
+                lostPacketErrorCounter++;
+                lostPacketErrorCounterAux++;
+            } else if(((int32)(header.nSampleNumber)-lastPacketID) == 0) {
+                // Warning if nSampleNumber in packet hasn't changed
+                samePacketErrorCounter++;
+            } else if(lostPacketErrorCounter > 0) {
+                recoveryCounter++;
+                // Reset error counter
+                lostPacketErrorCounter = 0;
+            }
+        }
+    }
+
+    // Update lastPacketID
+    lastPacketID       = header.nSampleNumber;
+    lastPacketUsecTime = header.nSampleTime;
+}
+
+/**
+ * CopyFromNetwork
+ */
+void UDPDrv::CopyFromNetwork(uint32 *destination, const uint32 *source, uint32 nOfWords){
+#if defined(INTEL_BYTE_ORDER)
+    bool swap = applyEndianity;
+#else
+    bool swap = !applyEndianity;
+#endif
+    if(swap) {
+        UDPBatchSocket::CopySwap32(destination, source, nOfWords);
+    }
+    else {
+        memcpy(destination, source, nOfWords*sizeof(uint32));
+    }
+}
+
 /**
  * RecCallback
  */
@@ -513,6 +648,32 @@ void UDPDrv::RecCallback(void* arg){
             lastCounterTime = currentCounterTime;
         }
 
+        if(highRateMode) {
+            int32 nOfPackets = batchSocket.Receive();
+            if(nOfPackets < 0) {
+                AssertErrorCondition(FatalError, "UDPDrv::RecCallback: Failed reading data. Thread is going to return");
+                return;
+            }
+            receiveCalls++;
+            receivedPackets += nOfPackets;
+            for(int32 n = 0 ; n < nOfPackets ; n++) {
+                if(batchSocket.PacketSize(n) != packetByteSize) {
+                    sizeMismatchErrorCounter++;
+                    continue;
+                }
+                uint32 *slot = packetRing.BeginWrite();
+                CopyFromNetwork(slot, (const uint32 *)batchSocket.Packet(n), packetByteSize/sizeof(int32));
+                UDPMsgHeaderStruct header = *(UDPMsgHeaderStruct *)slot;
+                packetRing.EndWrite();
+
+                CheckPacket(header);
+                for(int i = 0 ; i < nOfTriggeringServices ; i++) {
+                    triggerService[i].Trigger();
+                }
+            }
+            continue;
+        }
+
         // Read the data
         uint32 readBytes = packetByteSize;
         if(!socket.Read(dataSource, readBytes)){
@@ -527,12 +688,7 @@ void UDPDrv::RecCallback(void* arg){
         }
 
         // Copy dataSource in the write only buffer; does endianity swap
-        if(applyEndianity) {
-            Endianity::MemCopyFromMotorola((uint32 *)dataBuffer[writeBuffer],(uint32 *)dataSource,packetByteSize/sizeof(int32));
-        }
-        else {
-            Endianity::MemCopyFromIntel((uint32 *)dataBuffer[writeBuffer],(uint32 *)dataSource,packetByteSize/sizeof(int32));
-        }
+        CopyFromNetwork(dataBuffer[writeBuffer], (const uint32 *)dataSource, packetByteSize/sizeof(int32));
 
         // Checks if packets have been lost
         UDPMsgHeaderStruct *header = (UDPMsgHeaderStruct *)dataBuffer[writeBuffer];
@@ -549,45 +705,7 @@ void UDPDrv::RecCallback(void* arg){
         // Unlock resource
         mux.FastUnLock();
 
-        if(producerUsecPeriod != -1) {
-            int64 counter = HRT::HRTCounter();
-            /// Allow for a 10% deviation from the specified producer usec period
-            if(abs((uint32)((counter-lastCounter)*HRT::HRTPeriod()*1000000)-(uint32)((header->nSampleNumber-originalNSampleNumber)*producerUsecPeriod)) > 0.1*producerUsecPeriod) {
-                deviationErrorCounter++;
-            }
-            originalNSampleNumber = header->nSampleNumber;
-            lastCounter = counter;
-        }
-
-        // If is the first packet doesn't do any check on nSampleNumber
-        if(lastPacketID != 0xFFFFFFFF) {
-            // Checks nSampleNumber
-            // Warning if a reset has happened and too much packet had been lost
-            // nSampleNumber has been casted to int32 to prevent wrong casting from compiler
-            if((int32)(header->nSampleNumber)-lastPacketID < 0) {
-                if((int32)(header->nSampleNumber) > maxNOfLostPackets) {
-                    rolloverErrorCounter++;
-                }
-            } else {
-                // nSampleNumber has been casted to int32 to prevent wrong casting from compiler
-                if(((int32)(header->nSampleNumber)-lastPacketID) > 1) {
-                    // Warning if a packet is lost
-                    lostPacketErrorCounter++;
-                    lostPacketErrorCounterAux++;
-                } else if(((int32)(header->nSampleNumber)-lastPacketID) == 0) {
-                    // Warning if nSampleNumber in packet hasn't changed
-                    samePacketErrorCounter++;
-                } else if(lostPacketErrorCounter > 0) {
-                    recoveryCounter++;
-                    // Reset error counter
-                    lostPacketErrorCounter = 0;
-                }
-            }
-        }
-
-        // Update lastPacketID
-        lastPacketID       = header->nSampleNumber;
-        lastPacketUsecTime = header->nSampleTime;
+        CheckPacket(*header);
 
         // If the module is also a timing source call the Trigger() method of
         // the time service object
@@ -621,11 +739,18 @@ bool UDPDrv::ProcessHttpMessage(HttpStream &hStream) {
         hStream.Printf("<h2 align=\"center\">MaxNOfLostPackets = %d</h2>\n", maxNOfLostPackets);
         hStream.Printf("<h2 align=\"center\">CPU mask = 0x%x</h2>\n", cpuMask);
         hStream.Printf("<h2 align=\"center\">Thread priority = %d</h2>\n", receiverThreadPriority);
+        if(highRateMode) {
+            float packetsPerCall = (receiveCalls > 0) ? ((float)receivedPackets / receiveCalls) : 0.0;
+            hStream.Printf("<h2 align=\"center\">High rate mode: BatchSize = %d, RingSize = %d, packets per call = %.2f</h2>\n", batchSize, packetRing.NumberOfSlots(), packetsPerCall);
+        }
     } else if(moduleType == UDP_MODULE_TRANSMITTER) {
         hStream.Printf("<h2 align=\"center\">Output channels = %d</h2>\n", numberOfOutputChannels);
+        if(highRateMode) {
+            hStream.Printf("<h2 align=\"center\">High rate mode: BatchSize = %d</h2>\n", batchSize);
+        }
     }
 
-    if(moduleType == UDP_MODULE_RECEIVER) {
+    if((moduleType == UDP_MODULE_RECEIVER) && !highRateMode) {
         /* Data table */
         hStream.Printf("<table border=\"1\" align=\"center\">\n");
         hStream.Printf("<tr>\n");
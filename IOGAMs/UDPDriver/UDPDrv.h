@@ -34,6 +34,8 @@
 #include "System.h"
 #include "GenericAcqModule.h"
 #include "UDPSocket.h"
+#include "UDPBatchSocket.h"
+#include "UDPPacketRing.h"
 
 /// Number buffers for data storage
 static const int32 nOfDataBuffers = 3;
@@ -42,6 +44,11 @@ OBJECT_DLL(UDPDrv)
 // Callback declaration
  void ReceiverCallback(void *userData);
 
+struct UDPMsgHeaderStruct{
+    unsigned int nSampleNumber; // the sample number since the last t=0
+    unsigned int nSampleTime;   // the sample time
+};
+
 // If the driver is to be used as a receiver or as a transmitter
 enum UDPDrvModuleType{
     UDP_MODULE_UNDEFINED   = -1,
@@ -71,6 +78,19 @@ private:
     /** bool to flag if packet is fresh */
     bool                   freshPacket;
 
+    /** If True the packets are moved in batches (recvmmsg/sendmmsg) and the
+        receiver publishes them in a lock-free ring */
+    bool                   highRateMode;
+
+    /** Maximum number of packets per system call in high rate mode */
+    int32                  batchSize;
+
+    /** The batched socket used in high rate mode */
+    UDPBatchSocket         batchSocket;
+
+    /** Copies a packet converting it from the network endianity */
+    void                   CopyFromNetwork(uint32 *destination, const uint32 *source, uint32 nOfWords);
+
     /**   Init all module entries */
     bool                   Init();
 
@@ -82,6 +102,22 @@ private:
     /** Triple buffer for receiver type module */
     uint32                 *dataBuffer[nOfDataBuffers];
 
+    /** The received packets in high rate mode */
+    UDPPacketRing           packetRing;
+
+    /** The last packet of the ring which was found too old by GetData */
+    uint32                  stalePacketCount;
+
+    /** Number of recvmmsg calls in high rate mode */
+    uint32                  receiveCalls;
+
+    /** Number of packets received by the recvmmsg calls */
+    uint32                  receivedPackets;
+
+    /** Checks the sequence number and the period of a received packet and
+        updates the monitoring counters */
+    void CheckPacket(const UDPMsgHeaderStruct &header);
+
     /** Index of the write only buffer.
         The next write only buffer index is equal to (writeBuffer+1)%3
         The read only buffer index is equal to (writeBuffer+2)%3 */
@@ -0,0 +1,221 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file Loopback benchmark of the UDPDrv transport.
+ * Sends packets to localhost and measures the received packets per second
+ * (unpaced sender) and the one-way latency (paced sender), both with one
+ * system call per packet (as the UDPDrv without HighRateMode) and with
+ * recvmmsg/sendmmsg batches.
+ * Usage: UDPDrvBenchmark.ex [nOfPackets] [packetWords] [batchSize] [pacedRateHz] [port]
+ */
+#include "System.h"
+#include "UDPSocket.h"
+#include "Threads.h"
+#include "HRT.h"
+#include "Endianity.h"
+#include "UDPBatchSocket.h"
+#include "RTLatencyHistogram.h"
+
+/** Sequence number of the packets which stop the receiver */
+static const uint32 endOfTestMarker = 0xFFFFFFFF;
+
+struct BenchmarkParameters{
+    uint32              nOfPackets;
+    uint32              packetWords;
+    uint32              batchSize;
+    bool                batched;
+    UDPSocket          *receiver;
+    volatile bool       receiverReady;
+    volatile bool       receiverDone;
+    uint32              receivedPackets;
+    int64               firstCounter;
+    int64               lastCounter;
+    RTLatencyHistogram  latency;
+};
+
+/** Stores the time of a received packet and its latency */
+static void AccountPacket(BenchmarkParameters &p, const uint32 *packet, int64 now){
+    if(p.receivedPackets == 0) p.firstCounter = now;
+    p.lastCounter = now;
+    p.receivedPackets++;
+    int64 sent = 0;
+    memcpy(&sent, packet + 2, sizeof(int64));
+    p.latency.Add((uint32)((now - sent) * HRT::HRTPeriod() * 1e9));
+}
+
+static void ReceiverThread(void *args){
+    BenchmarkParameters &p = *(BenchmarkParameters *)args;
+    uint32  packetByteSize = p.packetWords * sizeof(uint32);
+    uint32 *packet         = (uint32 *)malloc(packetByteSize);
+    UDPBatchSocket batchSocket;
+    if(p.batched) batchSocket.Init(p.receiver->Socket(), packetByteSize, p.batchSize);
+    p.receiverReady = True;
+
+    bool running = True;
+    while(running){
+        if(p.batched){
+            int32 n = batchSocket.Receive();
+            if(n < 0) break;
+            int64 now = HRT::HRTCounter();
+            for(int32 i = 0; i < n; i++){
+                if(batchSocket.PacketSize(i) != packetByteSize) continue;
+                UDPBatchSocket::CopySwap32(packet, (const uint32 *)batchSocket.Packet(i), p.packetWords);
+                if(packet[0] == endOfTestMarker){
+                    running = False;
+                    break;
+                }
+                AccountPacket(p, packet, now);
+            }
+        }
+        else{
+            uint32 readBytes = packetByteSize;
+            if(!p.receiver->Read(packet, readBytes)) break;
+            int64 now = HRT::HRTCounter();
+            if(readBytes != packetByteSize) continue;
+            Endianity::MemCopyFromMotorola(packet, packet, p.packetWords);
+            if(packet[0] == endOfTestMarker) break;
+            AccountPacket(p, packet, now);
+        }
+    }
+    free((void *&)packet);
+    p.receiverDone = True;
+}
+
+/** Builds the packet number sequence, as the UDPDrv transmitter does */
+static void FillPacket(uint32 *packet, const uint32 *payload, uint32 packetWords, uint32 sequence, bool batched){
+    packet[0] = sequence;
+    packet[1] = 0;
+    int64 now = HRT::HRTCounter();
+    memcpy(packet + 2, &now, sizeof(int64));
+    memcpy(packet + 4, payload + 4, (packetWords - 4) * sizeof(uint32));
+    if(batched){
+        UDPBatchSocket::CopySwap32(packet, packet, packetWords);
+    }
+    else{
+        for(uint32 i = 0; i < packetWords; i++) Endianity::ToMotorola(packet[i]);
+    }
+}
+
+/** Runs one test. pacedRateHz = 0 sends as fast as possible */
+static bool RunTest(const char *title, uint32 port, uint32 nOfPackets, uint32 packetWords, uint32 batchSize, bool batched, uint32 pacedRateHz){
+    UDPSocket receiver;
+    UDPSocket sender;
+    if(!receiver.Open() || !receiver.Listen(port) || !receiver.SetBlocking(True)){
+        printf("Failed to open the receiver socket in port %d\n", port);
+        return False;
+    }
+    if(!sender.Open() || !sender.Connect("localhost", port)){
+        printf("Failed to connect to localhost:%d\n", port);
+        return False;
+    }
+
+    BenchmarkParameters p;
+    p.nOfPackets      = nOfPackets;
+    p.packetWords     = packetWords;
+    p.batchSize       = batchSize;
+    p.batched         = batched;
+    p.receiver        = &receiver;
+    p.receiverReady   = False;
+    p.receiverDone    = False;
+    p.receivedPackets = 0;
+    p.firstCounter    = 0;
+    p.lastCounter     = 0;
+
+    Threads::BeginThread(ReceiverThread, &p, THREADS_DEFAULT_STACKSIZE, "UDPBenchmarkReceiver");
+    while(!p.receiverReady) SleepMsec(1);
+    SleepMsec(10);
+
+    uint32  packetByteSize = packetWords * sizeof(uint32);
+    uint32 *payload        = (uint32 *)malloc(packetByteSize);
+    uint32 *packet         = (uint32 *)malloc(packetByteSize);
+    for(uint32 i = 0; i < packetWords; i++) payload[i] = i;
+
+    UDPBatchSocket batchSocket;
+    if(batched){
+        batchSocket.Init(sender.Socket(), packetByteSize, pacedRateHz > 0 ? 1 : batchSize);
+        batchSocket.SetDestination(sender.Destination());
+    }
+
+    int64 period = (pacedRateHz > 0) ? (HRT::HRTFrequency() / pacedRateHz) : 0;
+    int64 next   = HRT::HRTCounter();
+    int64 start  = next;
+    for(uint32 n = 0; n < nOfPackets; n++){
+        if(period > 0){
+            next += period;
+            while(HRT::HRTCounter() < next);
+        }
+        if(batched){
+            FillPacket((uint32 *)batchSocket.NextTransmitPacket(), payload, packetWords, n, True);
+            batchSocket.Queue(packetByteSize);
+        }
+        else{
+            FillPacket(packet, payload, packetWords, n, False);
+            sender.Write(packet, packetByteSize);
+        }
+    }
+    if(batched) batchSocket.Flush();
+    double sendTime = (HRT::HRTCounter() - start) * HRT::HRTPeriod();
+
+    // Stop the receiver. Repeated in case the marker is dropped
+    for(int i = 0; (i < 100) && !p.receiverDone; i++){
+        FillPacket(packet, payload, packetWords, endOfTestMarker, False);
+        sender.Write(packet, packetByteSize);
+        SleepMsec(10);
+    }
+
+    double receiveTime = (p.lastCounter - p.firstCounter) * HRT::HRTPeriod();
+    printf("%-24s sent %8.0f pkt/s, received %8.0f pkt/s, lost %5.2f%%, latency (usec) p50 %8.1f p99 %8.1f max %8.1f\n",
+           title,
+           nOfPackets / sendTime,
+           (receiveTime > 0) ? (p.receivedPackets / receiveTime) : 0.0,
+           100.0 * (nOfPackets - p.receivedPackets) / nOfPackets,
+           p.latency.Percentile(0.5) * 1e-3,
+           p.latency.Percentile(0.99) * 1e-3,
+           p.latency.Max() * 1e-3);
+
+    free((void *&)payload);
+    free((void *&)packet);
+    sender.Close();
+    receiver.Close();
+    return p.receiverDone;
+}
+
+int main(int argc, char **argv){
+    uint32 nOfPackets  = (argc > 1) ? atoi(argv[1]) : 200000;
+    uint32 packetWords = (argc > 2) ? atoi(argv[2]) : 64;
+    uint32 batchSize   = (argc > 3) ? atoi(argv[3]) : 32;
+    uint32 pacedRateHz = (argc > 4) ? atoi(argv[4]) : 10000;
+    uint32 port        = (argc > 5) ? atoi(argv[5]) : 14600;
+    if(packetWords < 4) packetWords = 4;
+    if(batchSize < 1)   batchSize   = 1;
+
+    printf("%d packets of %d bytes, batch size %d, paced rate %d Hz\n", nOfPackets, (int32)(packetWords * sizeof(uint32)), batchSize, pacedRateHz);
+    RunTest("single, unpaced",  port, nOfPackets, packetWords, batchSize, False, 0);
+    RunTest("batched, unpaced", port, nOfPackets, packetWords, batchSize, True,  0);
+    uint32 pacedPackets = (pacedRateHz > 0) ? pacedRateHz : 1;
+    RunTest("single, paced",    port, pacedPackets, packetWords, batchSize, False, pacedRateHz);
+    RunTest("batched, paced",   port, pacedPackets, packetWords, batchSize, True,  pacedRateHz);
+    return 0;
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file Lock-free ring of the packets received by the UDPDrv.
+ * A single writer (the receiver thread) fills the slots in order and a reader
+ * (the real-time thread) copies the latest complete packet. Each slot has a
+ * sequence number which is odd while the slot is being written; the reader
+ * retries if the sequence changed during its copy. The writer never waits.
+ */
+#if !defined (_UDP_PACKET_RING)
+#define _UDP_PACKET_RING
+
+#include "System.h"
+#include "Atomic.h"
+
+class UDPPacketRing{
+private:
+    /** The packets, slotWords each */
+    uint32           *slots;
+
+    /** The sequence number of each slot */
+    volatile uint32  *sequences;
+
+    /** Size of a packet in 32 bit words */
+    uint32            slotWords;
+
+    /** Number of slots (power of two) */
+    uint32            nOfSlots;
+
+    /** Number of packets written since the ring was initialised */
+    volatile uint32   writeCount;
+
+public:
+
+    UDPPacketRing(){
+        slots      = NULL;
+        sequences  = NULL;
+        slotWords  = 0;
+        nOfSlots   = 0;
+        writeCount = 0;
+    }
+
+    ~UDPPacketRing(){
+        CleanUp();
+    }
+
+    /** Frees the slots */
+    void CleanUp(){
+        if(slots != NULL)     free((void *&)slots);
+        if(sequences != NULL) free((void *&)sequences);
+        slots      = NULL;
+        sequences  = NULL;
+        nOfSlots   = 0;
+        writeCount = 0;
+    }
+
+    /**
+     * Allocates the slots
+     * @param words Size of a packet in 32 bit words
+     * @param minimumSlots Rounded up to a power of two
+     */
+    bool Init(uint32 words, uint32 minimumSlots){
+        CleanUp();
+        nOfSlots = 2;
+        while(nOfSlots < minimumSlots) nOfSlots <<= 1;
+        slotWords = words;
+        slots     = (uint32 *)malloc(nOfSlots * slotWords * sizeof(uint32));
+        sequences = (volatile uint32 *)malloc(nOfSlots * sizeof(uint32));
+        if((slots == NULL) || (sequences == NULL)){
+            CleanUp();
+            return False;
+        }
+        memset(slots, 0, nOfSlots * slotWords * sizeof(uint32));
+        for(uint32 i = 0; i < nOfSlots; i++) sequences[i] = 0;
+        return True;
+    }
+
+    /** Number of slots */
+    uint32 NumberOfSlots() const{
+        return nOfSlots;
+    }
+
+    /** Number of packets written */
+    uint32 WriteCount() const{
+        return writeCount;
+    }
+
+    /** The slot to be filled by the writer. Must be followed by EndWrite */
+    inline uint32 *BeginWrite(){
+        uint32 index = writeCount & (nOfSlots - 1);
+        sequences[index]++;
+        Atomic::Barrier();
+        return slots + index * slotWords;
+    }
+
+    /** Publishes the slot returned by BeginWrite */
+    inline void EndWrite(){
+        uint32 index = writeCount & (nOfSlots - 1);
+        Atomic::Barrier();
+        sequences[index]++;
+        Atomic::Barrier();
+        writeCount++;
+    }
+
+    /**
+     * Copies the latest published packet
+     * @param destination Where to copy slotWords words
+     * @return The number of the packet (the WriteCount when it was published), 0 if no packet was published
+     */
+    uint32 ReadLatest(uint32 *destination) const{
+        while(True){
+            uint32 count = writeCount;
+            if(count == 0) return 0;
+            uint32 index = (count - 1) & (nOfSlots - 1);
+            Atomic::Barrier();
+            uint32 sequence = sequences[index];
+            if((sequence & 0x1) != 0) continue;
+            Atomic::Barrier();
+            memcpy(destination, slots + index * slotWords, slotWords * sizeof(uint32));
+            Atomic::Barrier();
+            // The slot was not rewritten during the copy and still holds packet count
+            if((sequences[index] == sequence) && ((writeCount - count) < nOfSlots)) return count;
+        }
+    }
+
+    /** The last published packet, without copy. Only for monitoring */
+    const uint32 *Latest() const{
+        if(writeCount == 0) return NULL;
+        return slots + ((writeCount - 1) & (nOfSlots - 1)) * slotWords;
+    }
+};
+
+#endif
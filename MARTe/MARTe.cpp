@@ -29,6 +29,7 @@
 #include "FString.h"
 #include "Console.h"
 #include "ConfigurationDataBase.h"
+#include "CDBSnapshot.h"
 #include "LoggerService.h"
 #include "GlobalObjectDataBase.h"
 #include "Sleep.h"
@@ -146,8 +147,23 @@ extern "C"{
         config.Close();
         cfg_buffer.Seek(0);
 
+        // A binary snapshot saved from the same text is loaded instead of parsing it
+        FString snapshotFile;
+        snapshotFile.Printf("%s.cdbs", fName);
+        uint64 cfgChecksum = CDBSnapshot::Checksum(cfg_buffer.Buffer(), cfg_buffer.Size());
+        bool fromSnapshot = False;
+
         ConfigurationDataBase cdb;
-        cdb->ReadFromStream(cfg_buffer);
+        {
+            CDBSnapshot snapshot;
+            if(snapshot.Open(snapshotFile.Buffer(), cfgChecksum, cfg_buffer.Size())){
+                fromSnapshot = snapshot.Load(cdb);
+                if(!fromSnapshot) cdb->CleanUp();
+            }
+        }
+        if(!fromSnapshot){
+            cdb->ReadFromStream(cfg_buffer);
+        }
 
         CDBExtended info(cdb);
  
@@ -173,6 +189,25 @@ extern "C"{
         LSSetRemoteLogger(logAddress.Buffer(),logPort);
         LSStartService();
 
+        // Messages formatted by the logger thread instead of the caller
+        FString deferredLogging;
+        info.ReadFString(deferredLogging,"DeferredLogging","False");
+        if(deferredLogging == "True"){
+            LSSetDeferredLogging(True);
+        }
+
+        // Saves the snapshot used by the next start
+        FString configurationSnapshot;
+        info.ReadFString(configurationSnapshot,"ConfigurationSnapshot","False");
+        if(fromSnapshot){
+            CStaticAssertErrorCondition(Information, "InitGlobalContainer:: Configuration loaded from the snapshot %s", snapshotFile.Buffer());
+        }
+        else if(configurationSnapshot == "True"){
+            if(CDBSnapshot::Save(cdb, snapshotFile.Buffer(), cfgChecksum, cfg_buffer.Size())){
+                CStaticAssertErrorCondition(Information, "InitGlobalContainer:: Configuration snapshot saved in %s", snapshotFile.Buffer());
+            }
+        }
+
         CStaticAssertErrorCondition(Information, "InitGlobalContainer:: Loading MARTe with file %s \n", fName);
 
         if(!GetGlobalObjectDataBase()->ObjectLoadSetup(cdb,NULL)){
@@ -0,0 +1,405 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they
+   will be approved by the European Commission - subsequent
+   versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the
+   Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in
+   writing, software distributed under the Licence is
+   distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+   express or implied.
+ * See the Licence for the specific language governing
+   permissions and limitations under the Licence.
+ *
+ * $Id$
+ *
+**/
+
+#include "RealTimeThread.h"
+#include "GAMScheduler.h"
+#include "CDBExtended.h"
+#include "DDBInterface.h"
+#include "MessageDeliveryRequest.h"
+#include "Sleep.h"
+#include "Atomic.h"
+#include "HRT.h"
+
+void GAMSchedulerWorkerThread(GAMSchedulerWorker &worker){
+    GAMScheduler &scheduler = *(worker.scheduler);
+    Threads::SetRealTimeClass();
+    Threads::SetPriorityLevel(scheduler.priority);
+
+    uint32 lastSequence     = scheduler.stageSequence;
+    int64  idleStart        = HRT::HRTCounter();
+    worker.doneSequence     = lastSequence;
+    worker.isThreadRunning  = True;
+
+    while(!scheduler.stopWorkers){
+        uint32 sequence = scheduler.stageSequence;
+        if(sequence == lastSequence){
+            if((HRT::HRTCounter() - idleStart) < scheduler.workerSpinTicks) continue;
+            // No stage for a while (e.g. between pulses): sleep instead of holding the CPU
+            worker.wakeSem.Reset();
+            worker.sleeping = 1;
+            // Publish the flag before the last check of the sequence
+            Atomic::FullBarrier();
+            if((scheduler.stageSequence == lastSequence) && !scheduler.stopWorkers){
+                worker.wakeSem.Wait();
+            }
+            worker.sleeping = 0;
+            idleStart       = HRT::HRTCounter();
+            continue;
+        }
+        Atomic::FullBarrier();
+        scheduler.RunTasks(scheduler.currentStage, worker.executor);
+        Atomic::FullBarrier();
+        worker.doneSequence = sequence;
+        lastSequence        = sequence;
+        idleStart           = HRT::HRTCounter();
+    }
+
+    worker.isThreadRunning = False;
+}
+
+GAMScheduler::GAMScheduler(){
+    stageSequence  = 0;
+    currentStage   = 0;
+    stopWorkers    = False;
+    modules        = NULL;
+    nOfModules     = 0;
+    nOfWorkers     = 0;
+    nOfExecutors   = 1;
+    nOfStages      = 0;
+    moduleStage    = NULL;
+    moduleExecutor = NULL;
+    moduleOk       = NULL;
+    taskList       = NULL;
+    taskStart      = NULL;
+    workers        = NULL;
+    priority       = 0;
+    workerSpinTicks = 0;
+}
+
+void GAMScheduler::WakeWorkers(){
+    // Make sure that the new sequence is visible before checking if the workers sleep
+    Atomic::FullBarrier();
+    for(int32 w = 0; w < nOfWorkers; w++){
+        if(workers[w].sleeping) workers[w].wakeSem.Post();
+    }
+}
+
+bool GAMScheduler::RunTasks(int32 stage, int32 executor){
+    int32 entry = stage * nOfExecutors + executor;
+    for(int32 t = taskStart[entry]; t < taskStart[entry + 1]; t++){
+        int32 m     = taskList[t];
+        moduleOk[m] = modules[m].Execute();
+        if(!moduleOk[m]) return False;
+    }
+    return True;
+}
+
+/** Checks if the DDB areas of two GAMs are accessed in a conflicting way */
+static bool GAMSInterfacesConflict(GAM &first, GAM &second){
+    LinkedListable *firstList = first.InterfacesList();
+    while(firstList != NULL){
+        DDBInterface *firstInterface = dynamic_cast<DDBInterface *>(firstList);
+        firstList = firstList->Next();
+        if(firstInterface == NULL) continue;
+        const DDBInterfaceAccessMode &firstMode = firstInterface->GetInterfaceDescriptor().AccessMode();
+        bool firstWrites = firstMode.CheckMask(DDB_WriteMode) || firstMode.CheckMask(DDB_PatchMode);
+        bool firstReads  = firstMode.CheckMask(DDB_ReadMode);
+
+        LinkedListable *secondList = second.InterfacesList();
+        while(secondList != NULL){
+            DDBInterface *secondInterface = dynamic_cast<DDBInterface *>(secondList);
+            secondList = secondList->Next();
+            if(secondInterface == NULL) continue;
+            const DDBInterfaceAccessMode &secondMode = secondInterface->GetInterfaceDescriptor().AccessMode();
+            bool secondWrites = secondMode.CheckMask(DDB_WriteMode) || secondMode.CheckMask(DDB_PatchMode);
+            bool secondReads  = secondMode.CheckMask(DDB_ReadMode);
+
+            // Two readers never conflict
+            if(!((firstWrites && (secondReads || secondWrites)) || (firstReads && secondWrites))) continue;
+            if(firstInterface->SharesDDBMemory(*secondInterface)) return True;
+        }
+    }
+    return False;
+}
+
+/** True if the GAM synchronises the cycle: its driver says so, or it is
+    the first online GAM and uses a driver (where MARTe expects the timing input) */
+static bool IsSynchronizingGAM(int32 module, GCReference &driver){
+    if(!driver.IsValid()) return False;
+    if(module == 0) return True;
+    GCRTemplate<GenericAcqModule> acqModule = driver;
+    return (acqModule.IsValid() && acqModule->IsSynchronizing());
+}
+
+bool GAMScheduler::Conflict(int32 first, int32 second, FString *isolatedGAMs, int32 nOfIsolatedGAMs){
+    GCRTemplate<GAM> firstGAM  = modules[first].Reference();
+    GCRTemplate<GAM> secondGAM = modules[second].Reference();
+
+    if(strcmp(firstGAM->Name(), secondGAM->Name()) == 0) return True;
+    for(int32 i = 0; i < nOfIsolatedGAMs; i++){
+        if(isolatedGAMs[i] == firstGAM->Name())  return True;
+        if(isolatedGAMs[i] == secondGAM->Name()) return True;
+    }
+
+    // The GAMs of a driver are executed in the configured order
+    GCReference firstDriver  = firstGAM->AcquisitionModule();
+    GCReference secondDriver = secondGAM->AcquisitionModule();
+    if(firstDriver.IsValid() && (firstDriver == secondDriver)) return True;
+
+    // The synchronising GAM runs alone: the other GAMs may depend on the cycle
+    // timing without reading its signals
+    if(IsSynchronizingGAM(first, firstDriver))   return True;
+    if(IsSynchronizingGAM(second, secondDriver)) return True;
+
+    return GAMSInterfacesConflict(*(firstGAM.operator->()), *(secondGAM.operator->()));
+}
+
+bool GAMScheduler::BuildSchedule(FString *isolatedGAMs, int32 nOfIsolatedGAMs){
+    moduleStage    = new int32[nOfModules];
+    moduleExecutor = new int32[nOfModules];
+    moduleOk       = new bool[nOfModules];
+    taskList       = new int32[nOfModules];
+    if((moduleStage == NULL) || (moduleExecutor == NULL) || (moduleOk == NULL) || (taskList == NULL)) return False;
+
+    // A module runs after all the previous modules it conflicts with
+    nOfStages = 0;
+    int32 i;
+    int32 j;
+    for(j = 0; j < nOfModules; j++){
+        moduleStage[j] = 0;
+        moduleOk[j]    = True;
+        for(i = 0; i < j; i++){
+            if(moduleStage[i] + 1 <= moduleStage[j]) continue;
+            if(Conflict(i, j, isolatedGAMs, nOfIsolatedGAMs)) moduleStage[j] = moduleStage[i] + 1;
+        }
+        if(moduleStage[j] + 1 > nOfStages) nOfStages = moduleStage[j] + 1;
+    }
+
+    // Round robin the modules of each stage, the first one goes to the real time thread
+    int32 nOfEntries = nOfStages * nOfExecutors;
+    taskStart = new int32[nOfEntries + 1];
+    if(taskStart == NULL) return False;
+    int32 s;
+    for(s = 0; s < nOfStages; s++){
+        int32 n = 0;
+        for(j = 0; j < nOfModules; j++){
+            if(moduleStage[j] != s) continue;
+            moduleExecutor[j] = n % nOfExecutors;
+            n++;
+        }
+    }
+
+    int32 t = 0;
+    for(int32 e = 0; e < nOfEntries; e++){
+        taskStart[e] = t;
+        for(j = 0; j < nOfModules; j++){
+            if((moduleStage[j] * nOfExecutors + moduleExecutor[j]) == e) taskList[t++] = j;
+        }
+    }
+    taskStart[nOfEntries] = t;
+
+    return True;
+}
+
+bool GAMScheduler::Initialise(ExecutionModule *modules, int32 nOfModules, ConfigurationDataBase &info, int32 threadPriority, const char *ownerName){
+    CleanUp();
+
+    CDBExtended cdb(info);
+    int32 workersRequested = 0;
+    if(!cdb.ReadInt32(workersRequested, "NumberOfWorkers")){
+        CStaticAssertErrorCondition(InitialisationError, "GAMScheduler::Initialise: %s: NumberOfWorkers was not specified", ownerName);
+        return False;
+    }
+    if(workersRequested < 0){
+        CStaticAssertErrorCondition(InitialisationError, "GAMScheduler::Initialise: %s: NumberOfWorkers must be positive", ownerName);
+        return False;
+    }
+    cdb.ReadInt32(priority, "WorkerPriority", threadPriority);
+    int32 workerSpinUsec = 100;
+    cdb.ReadInt32(workerSpinUsec, "WorkerSpinUsec", 100);
+    if(workerSpinUsec < 0) workerSpinUsec = 0;
+    workerSpinTicks = (int64)(workerSpinUsec * 1e-6 * HRT::HRTFrequency());
+
+    if((workersRequested == 0) || (nOfModules < 2)){
+        CStaticAssertErrorCondition(Information, "GAMScheduler::Initialise: %s: The online GAMs will be executed sequentially", ownerName);
+        return True;
+    }
+
+    this->modules    = modules;
+    this->nOfModules = nOfModules;
+    nOfExecutors     = workersRequested + 1;
+
+    int32 *workerCPUs = new int32[workersRequested];
+    int32 w;
+    // 0 leaves the CPU choice to the operating system
+    for(w = 0; w < workersRequested; w++) workerCPUs[w] = 0;
+    int32 arrayDimension = 1;
+    int32 arraySize[1];
+    arraySize[0] = 0;
+    if(cdb->GetArrayDims(arraySize, arrayDimension, "WorkerCPUs")){
+        if(arraySize[0] != workersRequested){
+            CStaticAssertErrorCondition(InitialisationError, "GAMScheduler::Initialise: %s: WorkerCPUs must have NumberOfWorkers (%d) elements", ownerName, workersRequested);
+            delete[] workerCPUs;
+            CleanUp();
+            return False;
+        }
+        cdb.ReadInt32Array(workerCPUs, arraySize, arrayDimension, "WorkerCPUs");
+    }
+    else{
+        CStaticAssertErrorCondition(Warning, "GAMScheduler::Initialise: %s: WorkerCPUs was not specified. The real time workers are not pinned", ownerName);
+    }
+
+    FString *isolatedGAMs    = NULL;
+    int32    nOfIsolatedGAMs = 0;
+    arraySize[0] = 0;
+    if(cdb->GetArrayDims(arraySize, arrayDimension, "IsolatedGAMs")){
+        nOfIsolatedGAMs = arraySize[0];
+        isolatedGAMs    = new FString[nOfIsolatedGAMs];
+        if(!cdb.ReadFStringArray(isolatedGAMs, arraySize, arrayDimension, "IsolatedGAMs")){
+            CStaticAssertErrorCondition(InitialisationError, "GAMScheduler::Initialise: %s: Failed reading IsolatedGAMs", ownerName);
+            delete[] isolatedGAMs;
+            delete[] workerCPUs;
+            CleanUp();
+            return False;
+        }
+    }
+
+    bool ok = BuildSchedule(isolatedGAMs, nOfIsolatedGAMs);
+    if(isolatedGAMs != NULL) delete[] isolatedGAMs;
+    if(!ok){
+        CStaticAssertErrorCondition(InitialisationError, "GAMScheduler::Initialise: %s: Failed building the schedule", ownerName);
+        delete[] workerCPUs;
+        CleanUp();
+        return False;
+    }
+
+    if(nOfStages == nOfModules){
+        CStaticAssertErrorCondition(Warning, "GAMScheduler::Initialise: %s: All the online GAMs depend on each other. Executing them sequentially", ownerName);
+        delete[] workerCPUs;
+        CleanUp();
+        return True;
+    }
+
+    // Start the workers
+    stopWorkers   = False;
+    stageSequence = 0;
+    workers       = new GAMSchedulerWorker[workersRequested];
+    nOfWorkers    = workersRequested;
+    for(w = 0; w < nOfWorkers; w++){
+        FString threadName;
+        threadName.Printf("%sWorker%d", ownerName, w + 1);
+        workers[w].scheduler = this;
+        workers[w].executor  = w + 1;
+        workers[w].cpuMask   = workerCPUs[w];
+        workers[w].threadID  = Threads::BeginThread((void (__thread_decl *)(void *))GAMSchedulerWorkerThread, &workers[w], THREADS_DEFAULT_STACKSIZE, threadName.Buffer(), XH_NotHandled, workers[w].cpuMask);
+        int32 sleepCount = 0;
+        while((!workers[w].isThreadRunning) && (sleepCount++ < 100)) SleepMsec(10);
+        if(!workers[w].isThreadRunning){
+            CStaticAssertErrorCondition(InitialisationError, "GAMScheduler::Initialise: %s: Failed starting worker %d", ownerName, w + 1);
+            delete[] workerCPUs;
+            CleanUp();
+            return False;
+        }
+    }
+    delete[] workerCPUs;
+
+    CStaticAssertErrorCondition(Information, "GAMScheduler::Initialise: %s: %d online GAMs scheduled in %d stages over %d executors", ownerName, nOfModules, nOfStages, nOfExecutors);
+    return True;
+}
+
+void GAMScheduler::CleanUp(){
+    if(workers != NULL){
+        stopWorkers = True;
+        WakeWorkers();
+        for(int32 w = 0; w < nOfWorkers; w++){
+            for(int i = 0; ((i < 100) && (workers[w].isThreadRunning)); i++) SleepMsec(10);
+            if(workers[w].isThreadRunning) Threads::Kill(workers[w].threadID);
+        }
+        delete[] workers;
+        workers = NULL;
+    }
+    if(moduleStage    != NULL) delete[] moduleStage;
+    if(moduleExecutor != NULL) delete[] moduleExecutor;
+    if(moduleOk       != NULL) delete[] moduleOk;
+    if(taskList       != NULL) delete[] taskList;
+    if(taskStart      != NULL) delete[] taskStart;
+    moduleStage    = NULL;
+    moduleExecutor = NULL;
+    moduleOk       = NULL;
+    taskList       = NULL;
+    taskStart      = NULL;
+    modules        = NULL;
+    nOfModules     = 0;
+    nOfWorkers     = 0;
+    nOfExecutors   = 1;
+    nOfStages      = 0;
+}
+
+int32 GAMScheduler::Execute(){
+    for(int32 s = 0; s < nOfStages; s++){
+        bool parallel = (taskStart[s * nOfExecutors + 1] != taskStart[(s + 1) * nOfExecutors]);
+        if(!parallel){
+            // Only the real time thread has work in this stage
+            if(RunTasks(s, 0)) continue;
+        }
+        else{
+            currentStage = s;
+            Atomic::FullBarrier();
+            uint32 sequence = stageSequence + 1;
+            stageSequence   = sequence;
+            WakeWorkers();
+            RunTasks(s, 0);
+
+            // Every worker acknowledges each stage, so that none can miss one
+            for(int32 w = 0; w < nOfWorkers; w++){
+                while(workers[w].doneSequence != sequence){
+                }
+            }
+            Atomic::FullBarrier();
+        }
+
+        int32 failed = -1;
+        for(int32 t = taskStart[s * nOfExecutors]; t < taskStart[(s + 1) * nOfExecutors]; t++){
+            int32 m = taskList[t];
+            if(!moduleOk[m]){
+                if((failed < 0) || (m < failed)) failed = m;
+                moduleOk[m] = True;
+            }
+        }
+        if(failed >= 0) return failed;
+    }
+    return -1;
+}
+
+void GAMScheduler::ProcessHttpMessage(HttpStream &hStream){
+    hStream.Printf("<H2>Parallel Schedule</H2>\n");
+    if(!IsEnabled()){
+        hStream.Printf("<P>Online GAMs executed sequentially</P>\n");
+        return;
+    }
+    hStream.Printf("<P>%d stages over %d executors (executor 0 is the real time thread)</P>\n", nOfStages, nOfExecutors);
+    hStream.Printf("<TABLE CLASS=\"bltable\">\n");
+    hStream.Printf("<TR><TH>N</TH><TH>Name</TH><TH>Stage</TH><TH>Executor</TH></TR>\n");
+    for(int32 i = 0; i < nOfModules; i++){
+        hStream.Printf("<TR><TD>%d</TD><TD>%s</TD><TD>%d</TD><TD>%d</TD></TR>\n", i, modules[i].Reference()->Name(), moduleStage[i], moduleExecutor[i]);
+    }
+    hStream.Printf("</TABLE>\n");
+    hStream.Printf("<TABLE CLASS=\"bltable\">\n");
+    hStream.Printf("<TR><TH>Worker</TH><TH>CPU Mask</TH></TR>\n");
+    for(int32 w = 0; w < nOfWorkers; w++){
+        hStream.Printf("<TR><TD>%d</TD><TD>0x%x</TD></TR>\n", workers[w].executor, workers[w].cpuMask);
+    }
+    hStream.Printf("</TABLE>\n");
+}
+
@@ -0,0 +1,215 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they
+   will be approved by the European Commission - subsequent
+   versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the
+   Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in
+   writing, software distributed under the Licence is
+   distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+   express or implied.
+ * See the Licence for the specific language governing
+   permissions and limitations under the Licence.
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Executes the online GAMs of a RealTimeThread on a set of pinned worker
+ * threads. The GAMs are grouped in stages: two GAMs are placed in different
+ * stages when one of them writes a DDB area the other reads or writes, when
+ * both use the same driver, or when one of them is the synchronising GAM.
+ * The GAMs of a stage run concurrently, stages run in order and are separated
+ * by a barrier. The result is therefore identical to the sequential execution.
+ * Between stages the workers poll for WorkerSpinUsec and then sleep until the
+ * real time thread releases the next stage.
+ */
+#ifndef _GAM_SCHEDULER_H_
+#define _GAM_SCHEDULER_H_
+
+#include "Object.h"
+#include "ConfigurationDataBase.h"
+#include "Threads.h"
+#include "EventSem.h"
+#include "HttpStream.h"
+
+class ExecutionModule;
+class GAMScheduler;
+
+/** Size used to keep the worker synchronisation words in separate cache lines */
+#define GAMS_CACHE_LINE_SIZE 64
+
+/** A worker thread of the GAMScheduler */
+class GAMSchedulerWorker{
+public:
+    /** The sequence number of the last completed stage */
+    volatile uint32     doneSequence;
+
+    /** Keeps the doneSequence of the workers in separate cache lines */
+    char                padding[GAMS_CACHE_LINE_SIZE - sizeof(uint32)];
+
+    /** The scheduler which owns the worker */
+    GAMScheduler       *scheduler;
+
+    /** The executor number (0 is the real time thread itself) */
+    int32               executor;
+
+    /** CPU mask where the worker runs */
+    int32               cpuMask;
+
+    /** The thread identifier */
+    TID                 threadID;
+
+    /** True while the thread is alive */
+    volatile bool       isThreadRunning;
+
+    /** Set by the worker before sleeping on wakeSem */
+    volatile int32      sleeping;
+
+    /** Posted by the real time thread to wake a sleeping worker */
+    EventSem            wakeSem;
+
+    GAMSchedulerWorker(){
+        doneSequence    = 0;
+        scheduler       = NULL;
+        executor        = 0;
+        cpuMask         = 0;
+        threadID        = 0;
+        isThreadRunning = False;
+        sleeping        = 0;
+        wakeSem.Create();
+        wakeSem.Reset();
+    }
+
+    ~GAMSchedulerWorker(){
+        wakeSem.Close();
+    }
+};
+
+class GAMScheduler{
+private:
+    /** Allows the worker threads to run the stages */
+    friend void GAMSchedulerWorkerThread(GAMSchedulerWorker &worker);
+
+    /** The sequence number of the stage being executed. Incremented by the
+        real time thread to release the workers */
+    volatile uint32     stageSequence;
+
+    /** Keeps the stageSequence in its own cache line */
+    char                padding[GAMS_CACHE_LINE_SIZE - sizeof(uint32)];
+
+    /** The stage being executed */
+    volatile int32      currentStage;
+
+    /** Requests the workers to terminate */
+    volatile bool       stopWorkers;
+
+    /** The modules being scheduled (owned by the RealTimeThread) */
+    ExecutionModule    *modules;
+
+    /** Number of modules */
+    int32               nOfModules;
+
+    /** Number of worker threads, the real time thread is not included */
+    int32               nOfWorkers;
+
+    /** Number of executors (nOfWorkers + 1) */
+    int32               nOfExecutors;
+
+    /** Number of stages */
+    int32               nOfStages;
+
+    /** The stage of each module */
+    int32              *moduleStage;
+
+    /** The executor of each module */
+    int32              *moduleExecutor;
+
+    /** The execution result of each module in the current cycle */
+    bool               *moduleOk;
+
+    /** The module indexes sorted by stage and by executor */
+    int32              *taskList;
+
+    /** Start of the tasks of (stage, executor) in taskList. The
+        nOfStages * nOfExecutors + 1 entry marks the end of the list */
+    int32              *taskStart;
+
+    /** The worker threads */
+    GAMSchedulerWorker *workers;
+
+    /** Priority of the worker threads */
+    int32               priority;
+
+    /** How long an idle worker polls for the next stage before sleeping, in HRT ticks */
+    int64               workerSpinTicks;
+
+    /** Executes the tasks assigned to an executor in a stage.
+        @return False if one of the modules failed */
+    bool RunTasks(int32 stage, int32 executor);
+
+    /** Wakes the workers sleeping on their wakeSem */
+    void WakeWorkers();
+
+    /** Checks if module second must wait for module first */
+    bool Conflict(int32 first, int32 second, FString *isolatedGAMs, int32 nOfIsolatedGAMs);
+
+    /** Computes the stages and the executor of each module */
+    bool BuildSchedule(FString *isolatedGAMs, int32 nOfIsolatedGAMs);
+
+public:
+
+    GAMScheduler();
+
+    ~GAMScheduler(){
+        CleanUp();
+    }
+
+    /** Builds the schedule and starts the workers.
+        The configuration database shall be positioned on the ParallelScheduler node:
+        NumberOfWorkers = 2
+        WorkerCPUs      = {4 8}
+        WorkerPriority  = 32
+        WorkerSpinUsec  = 100
+        IsolatedGAMs    = {"Collection"}
+        The workers are real time threads: WorkerCPUs should place them on
+        CPUs which are not needed by the other threads.
+        Must be called after the DDB interfaces of the modules have been linked.
+        @param modules The online execution modules
+        @param nOfModules The number of modules
+        @param info The configuration
+        @param threadPriority The default priority of the workers
+        @param ownerName The name of the RealTimeThread, used in the error messages
+        @return True if the scheduler is running
+    */
+    bool Initialise(ExecutionModule *modules, int32 nOfModules, ConfigurationDataBase &info, int32 threadPriority, const char *ownerName);
+
+    /** Stops the workers and frees the schedule. */
+    void CleanUp();
+
+    /** True if the modules are to be executed by the scheduler */
+    bool IsEnabled() const{
+        return (nOfWorkers > 0);
+    }
+
+    /** Executes one cycle of the modules.
+        The stages after a failing one are not executed.
+        @return -1 if all the modules succeeded, otherwise the lowest index of the failing modules
+    */
+    int32 Execute();
+
+    /** Prints the schedule as an html table */
+    void ProcessHttpMessage(HttpStream &hStream);
+};
+
+#endif
+
@@ -137,16 +137,45 @@ public:
         relativeUsecTimePoint[entry] = deltaT * hrtPeriod;
         absoluteUsecTimePoint[entry] = (trigger->GetInternalCycleTickTime())*hrtPeriod;
 
+        UpdateCycleTime(hrtPeriod);
+
+        return True;
+    }
+
+    /** Compute performance for entry k from a measurement taken elsewhere
+        (e.g. by a worker of the parallel GAM scheduler).
+        @param entry The module number to monitor
+        @param startCounter The HRT counter when the module started
+        @param durationCounts The module execution time in HRT counts
+        @param return True if everything was ok. False if entry is out of range.
+    */
+    bool StorePerformance(int entry, int64 startCounter, int64 durationCounts){
+        if(cycleTime == NULL) return False;
+        if((entry < 0 ) || (entry >= numberOfEntries)) return False;
+        float hrtPeriod = HRT::HRTPeriod();
+        int64 elapsedSinceEnd = HRT::HRTCounter() - (startCounter + durationCounts);
+        relativeUsecTimePoint[entry] = durationCounts * hrtPeriod;
+        absoluteUsecTimePoint[entry] = (trigger->GetInternalCycleTickTime() - elapsedSinceEnd)*hrtPeriod;
+
+        UpdateCycleTime(hrtPeriod);
+
+        return True;
+    }
+
+private:
+
+    /** Updates the time base and the cycle time when a new cycle started */
+    void UpdateCycleTime(float hrtPeriod){
         int64 newCycleStartTickTime = trigger->GetLastProcessorTickTime();
         if(previousCycleStartTickTime < newCycleStartTickTime){
             *timeBase                  = trigger->GetPeriodUsecTime();
             *cycleTime                 = (newCycleStartTickTime - previousCycleStartTickTime)*hrtPeriod;
             previousCycleStartTickTime =  newCycleStartTickTime;
         }
-
-        return True;
     }
 
+public:
+
     /** Signals a new performance measurament cycle*/
     void StartGAMMeasureCounter(){
         GAMexecutionStartTimeCounter = HRT::HRTCounter();
@@ -0,0 +1,178 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they
+   will be approved by the European Commission - subsequent
+   versions of the EUPL (the "Licence");
+ * You may not use this work except in compliance with the
+   Licence.
+ * You may obtain a copy of the Licence at:
+ *
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in
+   writing, software distributed under the Licence is
+   distributed on an "AS IS" basis,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+   express or implied.
+ * See the Licence for the specific language governing
+   permissions and limitations under the Licence.
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Fixed size log-linear histogram of latencies in nanoseconds.
+ * Each power of two is split in RTLH_SUB_BUCKETS linear buckets, so that
+ * the relative error of the reported percentiles is below 1/RTLH_SUB_BUCKETS.
+ * Only one thread (the real time thread) may call Add and Reset. Any other
+ * thread can take a consistent copy with Snapshot, without locking the writer.
+ */
+#ifndef _RT_LATENCY_HISTOGRAM_H_
+#define _RT_LATENCY_HISTOGRAM_H_
+
+#include "System.h"
+#include "Atomic.h"
+
+/** Number of bits of the linear part of each bucket */
+#define RTLH_SUB_BUCKET_BITS    4
+/** Number of linear buckets per power of two */
+#define RTLH_SUB_BUCKETS        (1 << RTLH_SUB_BUCKET_BITS)
+/** Total number of buckets to cover the uint32 range */
+#define RTLH_NUMBER_OF_BUCKETS  ((32 - RTLH_SUB_BUCKET_BITS + 1) * RTLH_SUB_BUCKETS)
+
+class RTLatencyHistogram{
+private:
+    /** Odd while the writer is updating the histogram */
+    volatile uint32 sequence;
+
+    /** Number of samples */
+    uint32          numberOfSamples;
+
+    /** Smallest sample */
+    uint32          minValue;
+
+    /** Largest sample */
+    uint32          maxValue;
+
+    /** The bucket counters */
+    uint32          counts[RTLH_NUMBER_OF_BUCKETS];
+
+    /** Clears the counters (the sequence is not touched) */
+    void Clear(){
+        numberOfSamples = 0;
+        minValue        = 0xFFFFFFFF;
+        maxValue        = 0;
+        for(int i = 0; i < RTLH_NUMBER_OF_BUCKETS; i++) counts[i] = 0;
+    }
+
+public:
+
+    RTLatencyHistogram(){
+        sequence = 0;
+        Clear();
+    }
+
+    /** The bucket where value is counted */
+    static inline uint32 BucketIndex(uint32 value){
+        if(value < RTLH_SUB_BUCKETS) return value;
+#if defined(__GNUC__)
+        int32 msb = 31 - __builtin_clz(value);
+#else
+        int32 msb = 31;
+        while((value & (1u << msb)) == 0) msb--;
+#endif
+        int32 shift = msb - RTLH_SUB_BUCKET_BITS;
+        return ((shift + 1) << RTLH_SUB_BUCKET_BITS) + ((value >> shift) & (RTLH_SUB_BUCKETS - 1));
+    }
+
+    /** The largest value counted in a bucket */
+    static inline uint32 BucketUpperBound(uint32 index){
+        if(index < RTLH_SUB_BUCKETS) return index;
+        int32  shift = (index >> RTLH_SUB_BUCKET_BITS) - 1;
+        uint32 lower = (RTLH_SUB_BUCKETS + (index & (RTLH_SUB_BUCKETS - 1))) << shift;
+        return lower + ((1u << shift) - 1);
+    }
+
+    /** Adds a sample. Real time thread only. */
+    inline void Add(uint32 value){
+        sequence++;
+        Atomic::Barrier();
+        counts[BucketIndex(value)]++;
+        numberOfSamples++;
+        if(value < minValue) minValue = value;
+        if(value > maxValue) maxValue = value;
+        Atomic::Barrier();
+        sequence++;
+    }
+
+    /** Clears all the samples. Real time thread only. */
+    void Reset(){
+        sequence++;
+        Atomic::Barrier();
+        Clear();
+        Atomic::Barrier();
+        sequence++;
+    }
+
+    /** Copies the histogram while the writer may be updating it.
+        @param copy Where to store the copy
+        @return False if a consistent copy could not be taken
+    */
+    bool Snapshot(RTLatencyHistogram &copy) const{
+        for(int retry = 0; retry < 16; retry++){
+            uint32 before = sequence;
+            if((before & 0x1) != 0) continue;
+            Atomic::Barrier();
+            copy.numberOfSamples = numberOfSamples;
+            copy.minValue        = minValue;
+            copy.maxValue        = maxValue;
+            for(int i = 0; i < RTLH_NUMBER_OF_BUCKETS; i++) copy.counts[i] = counts[i];
+            Atomic::Barrier();
+            if(sequence == before) return True;
+        }
+        return False;
+    }
+
+    /** Number of samples */
+    uint32 NumberOfSamples() const{
+        return numberOfSamples;
+    }
+
+    /** Smallest sample, 0 if there are no samples */
+    uint32 Min() const{
+        return (numberOfSamples == 0) ? 0 : minValue;
+    }
+
+    /** Largest sample */
+    uint32 Max() const{
+        return maxValue;
+    }
+
+    /** The value below which a fraction of the samples lies.
+        @param fraction In the range [0, 1], e.g. 0.999
+        @return An upper bound of the percentile, 0 if there are no samples
+    */
+    uint32 Percentile(double fraction) const{
+        if(numberOfSamples == 0) return 0;
+        uint32 target = (uint32)(fraction * numberOfSamples + 0.5);
+        if(target == 0)              target = 1;
+        if(target > numberOfSamples) target = numberOfSamples;
+        uint32 cumulative = 0;
+        for(uint32 i = 0; i < RTLH_NUMBER_OF_BUCKETS; i++){
+            cumulative += counts[i];
+            if(cumulative >= target){
+                uint32 value = BucketUpperBound(i);
+                if(value > maxValue) value = maxValue;
+                if(value < minValue) value = minValue;
+                return value;
+            }
+        }
+        return maxValue;
+    }
+};
+
+#endif
+
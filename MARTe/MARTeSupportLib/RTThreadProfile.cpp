@@ -0,0 +1,240 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+#include "RTThreadProfile.h"
+#include "CDBExtended.h"
+#include "ProcessorType.h"
+#include "File.h"
+
+#include <stdlib.h>
+
+#if defined(_LINUX)
+#include <sys/mman.h>
+#include <sched.h>
+#include <pthread.h>
+#endif
+
+/** Read by PrefaultStack so that the compiler keeps the stack writes */
+static volatile char rttpStackSink = 0;
+
+RTThreadProfile::RTThreadProfile(){
+    enabled           = False;
+    policy            = RTTP_DEFAULT;
+    schedulerPriority = 0;
+    cpuMask           = 0;
+    reserveCPUs       = False;
+    lockMemory        = False;
+    stackSize         = THREADS_DEFAULT_STACKSIZE;
+    prefaultStackSize = 0;
+    prefaultBuffers   = False;
+}
+
+/** True for "True", "true", "Yes" and "1" */
+static bool RTTPIsTrue(FString &value){
+    return ((value == "True") || (value == "true") || (value == "Yes") || (value == "1"));
+}
+
+uint32 RTThreadProfile::IsolatedCPUs(){
+    uint32 mask = 0;
+#if defined(_LINUX)
+    File isolated;
+    if(!isolated.OpenRead("/sys/devices/system/cpu/isolated")){
+        return 0;
+    }
+    char   list[256];
+    uint32 size = sizeof(list) - 1;
+    if(!isolated.Read(list, size)){
+        size = 0;
+    }
+    list[size] = 0;
+    isolated.Close();
+
+    // The list is in the form 2-3,6
+    char *p = list;
+    while((*p >= '0') && (*p <= '9')){
+        int32 first = strtol(p, &p, 10);
+        int32 last  = first;
+        if(*p == '-'){
+            p++;
+            last = strtol(p, &p, 10);
+        }
+        for(int32 cpu = first; (cpu <= last) && (cpu < 32); cpu++){
+            mask |= (1u << cpu);
+        }
+        if(*p == ','){
+            p++;
+        }
+    }
+#endif
+    return mask;
+}
+
+bool RTThreadProfile::ObjectLoadSetup(ConfigurationDataBase &info, int32 threadPriority, int32 runOnCPU, const char *ownerName){
+    CDBExtended cdb(info);
+    enabled = True;
+
+    FString value;
+    cdb.ReadFString(value, "SchedulerPolicy", "Default");
+    if(value == "FIFO"){
+        policy = RTTP_FIFO;
+    }
+    else if(value == "RR"){
+        policy = RTTP_RR;
+    }
+    else if(value == "Default"){
+        policy = RTTP_DEFAULT;
+    }
+    else{
+        CStaticAssertErrorCondition(InitialisationError, "RTThreadProfile::ObjectLoadSetup: %s: Unknown SchedulerPolicy %s. Use FIFO, RR or Default", ownerName, value.Buffer());
+        return False;
+    }
+
+    cdb.ReadInt32(schedulerPriority, "SchedulerPriority", threadPriority * 99 / 31);
+    if((policy != RTTP_DEFAULT) && ((schedulerPriority < 1) || (schedulerPriority > 99))){
+        CStaticAssertErrorCondition(InitialisationError, "RTThreadProfile::ObjectLoadSetup: %s: SchedulerPriority must be in [1, 99]", ownerName);
+        return False;
+    }
+
+    cpuMask = runOnCPU;
+    value   = "";
+    cdb.ReadFString(value, "CPUs", "");
+    if(value == "Isolated"){
+        cpuMask = IsolatedCPUs();
+        if(cpuMask == 0){
+            CStaticAssertErrorCondition(InitialisationError, "RTThreadProfile::ObjectLoadSetup: %s: CPUs = Isolated but the kernel has no isolated CPUs (isolcpus)", ownerName);
+            return False;
+        }
+    }
+    else if(value.Size() > 0){
+        int32 mask = 0;
+        cdb.ReadInt32(mask, "CPUs", runOnCPU);
+        cpuMask = mask;
+    }
+
+    cdb.ReadFString(value, "ReserveCPUs", "False");
+    reserveCPUs = RTTPIsTrue(value);
+    if(reserveCPUs && (cpuMask == 0)){
+        CStaticAssertErrorCondition(InitialisationError, "RTThreadProfile::ObjectLoadSetup: %s: ReserveCPUs requires the CPUs (or RunOnCPU) to be specified", ownerName);
+        return False;
+    }
+
+    cdb.ReadFString(value, "LockMemory", "False");
+    lockMemory = RTTPIsTrue(value);
+
+    cdb.ReadInt32(stackSize, "StackSize", THREADS_DEFAULT_STACKSIZE);
+    cdb.ReadInt32(prefaultStackSize, "PrefaultStackSize", 0);
+    // Leave room for the frames of the thread start up and of PrefaultStack itself
+    if((prefaultStackSize < 0) || (prefaultStackSize > stackSize - 2 * RTTP_STACK_CHUNK_SIZE)){
+        CStaticAssertErrorCondition(InitialisationError, "RTThreadProfile::ObjectLoadSetup: %s: PrefaultStackSize must be in [0, StackSize - %d]", ownerName, 2 * RTTP_STACK_CHUNK_SIZE);
+        return False;
+    }
+
+    cdb.ReadFString(value, "PrefaultBuffers", "False");
+    prefaultBuffers = RTTPIsTrue(value);
+
+    CStaticAssertErrorCondition(Information, "RTThreadProfile::ObjectLoadSetup: %s: policy %d priority %d CPUs 0x%x reserved %d lock memory %d stack %d (prefault %d) prefault buffers %d",
+                                ownerName, policy, schedulerPriority, cpuMask, reserveCPUs, lockMemory, stackSize, prefaultStackSize, prefaultBuffers);
+    return True;
+}
+
+bool RTThreadProfile::ApplyToProcess(const char *ownerName){
+    if(!enabled){
+        return True;
+    }
+
+    bool ok = True;
+    if(lockMemory){
+#if defined(_LINUX)
+        if(mlockall(MCL_CURRENT | MCL_FUTURE) != 0){
+            CStaticAssertErrorCondition(Warning, "RTThreadProfile::ApplyToProcess: %s: mlockall failed. Check the RLIMIT_MEMLOCK or the CAP_IPC_LOCK capability", ownerName);
+            ok = False;
+        }
+#else
+        CStaticAssertErrorCondition(Warning, "RTThreadProfile::ApplyToProcess: %s: LockMemory is not supported on this platform", ownerName);
+#endif
+    }
+
+    if(reserveCPUs){
+        ProcessorType::SetReservedCPUs(ProcessorType::GetReservedCPUs() | cpuMask);
+        Threads::ApplyReservedCPUs();
+    }
+    return ok;
+}
+
+bool RTThreadProfile::ApplyToThread(int32 threadPriority, const char *ownerName){
+    bool ok = True;
+    if(policy == RTTP_DEFAULT){
+        Threads::SetRealTimeClass();
+        Threads::SetPriorityLevel(threadPriority);
+    }
+    else{
+#if defined(_LINUX)
+        sched_param param;
+        param.sched_priority = schedulerPriority;
+        int err = pthread_setschedparam(pthread_self(), (policy == RTTP_FIFO) ? SCHED_FIFO : SCHED_RR, &param);
+        if(err != 0){
+            CStaticAssertErrorCondition(Warning, "RTThreadProfile::ApplyToThread: %s: Failed setting the scheduling policy (error %d). Check the CAP_SYS_NICE capability", ownerName, err);
+            Threads::SetRealTimeClass();
+            Threads::SetPriorityLevel(threadPriority);
+            ok = False;
+        }
+#else
+        CStaticAssertErrorCondition(Warning, "RTThreadProfile::ApplyToThread: %s: SchedulerPolicy is not supported on this platform", ownerName);
+        Threads::SetRealTimeClass();
+        Threads::SetPriorityLevel(threadPriority);
+#endif
+    }
+
+    if(prefaultStackSize > 0){
+        PrefaultStack(prefaultStackSize);
+    }
+    return ok;
+}
+
+void RTThreadProfile::Prefault(void *buffer, int32 size){
+    if((buffer == NULL) || (size <= 0)){
+        return;
+    }
+    volatile char *p   = (volatile char *)buffer;
+    volatile char *end = p + size;
+    // A write is needed: a read only maps the zero page
+    for(; p < end; p += RTTP_STACK_CHUNK_SIZE){
+        *p = *p;
+    }
+    end--;
+    *end = *end;
+}
+
+void RTThreadProfile::PrefaultStack(int32 size){
+    volatile char chunk[RTTP_STACK_CHUNK_SIZE];
+    for(int32 i = 0; i < RTTP_STACK_CHUNK_SIZE; i += 64){
+        chunk[i] = 0;
+    }
+    rttpStackSink = chunk[0];
+    if(size > RTTP_STACK_CHUNK_SIZE){
+        PrefaultStack(size - RTTP_STACK_CHUNK_SIZE);
+    }
+    // Prevents the tail call optimisation, which would reuse the frame
+    rttpStackSink = chunk[RTTP_STACK_CHUNK_SIZE - 1];
+}
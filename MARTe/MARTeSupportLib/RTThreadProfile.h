@@ -0,0 +1,145 @@
+/*
+ * Copyright 2011 EFDA | European Fusion Development Agreement
+ *
+ * Licensed under the EUPL, Version 1.1 or - as soon they 
+   will be approved by the European Commission - subsequent  
+   versions of the EUPL (the "Licence"); 
+ * You may not use this work except in compliance with the 
+   Licence. 
+ * You may obtain a copy of the Licence at: 
+ *  
+ * http://ec.europa.eu/idabc/eupl
+ *
+ * Unless required by applicable law or agreed to in 
+   writing, software distributed under the Licence is 
+   distributed on an "AS IS" basis, 
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either 
+   express or implied. 
+ * See the Licence for the specific language governing 
+   permissions and limitations under the Licence. 
+ *
+ * $Id$
+ *
+**/
+
+/**
+ * @file
+ * Real time profile of a RealTimeThread: scheduling policy, CPU set,
+ * memory locking and prefaulting of the stack and of the buffers.
+ * Page faults and the other threads sharing the CPU are the main sources
+ * of the worst case jitter once the GAMs are deterministic. The profile
+ * removes them before the pulse starts instead of paying them in the
+ * first cycles.
+ */
+#ifndef _RT_THREAD_PROFILE_H_
+#define _RT_THREAD_PROFILE_H_
+
+#include "System.h"
+#include "ConfigurationDataBase.h"
+#include "Threads.h"
+
+/** Scheduling policies of the real time thread */
+enum RTThreadSchedulerPolicy{
+    /** ThreadPriority through Threads::SetPriorityLevel (legacy behaviour) */
+    RTTP_DEFAULT = 0,
+    /** SCHED_FIFO with SchedulerPriority */
+    RTTP_FIFO    = 1,
+    /** SCHED_RR with SchedulerPriority */
+    RTTP_RR      = 2
+};
+
+/** Size of the chunks used to prefault the stack */
+#define RTTP_STACK_CHUNK_SIZE 4096
+
+class RTThreadProfile{
+private:
+    /** True if a RealTimeProfile was configured */
+    bool                    enabled;
+
+    /** The scheduling policy */
+    RTThreadSchedulerPolicy policy;
+
+    /** The operating system priority (1-99) used with RTTP_FIFO and RTTP_RR */
+    int32                   schedulerPriority;
+
+    /** The CPUs where the real time thread runs */
+    uint32                  cpuMask;
+
+    /** Keep the other BaseLib2 threads off cpuMask */
+    bool                    reserveCPUs;
+
+    /** Lock the current and future memory of the process */
+    bool                    lockMemory;
+
+    /** The stack size of the real time thread */
+    int32                   stackSize;
+
+    /** The number of bytes of stack touched when the thread starts */
+    int32                   prefaultStackSize;
+
+    /** Touch the DDB and the interface buffers before the pulse */
+    bool                    prefaultBuffers;
+
+    /** Reads the CPUs isolated by the kernel (isolcpus)
+        @return 0 if there are no isolated CPUs */
+    static uint32           IsolatedCPUs();
+
+public:
+
+    RTThreadProfile();
+
+    /** Reads the profile. The configuration database shall be positioned on the
+        RealTimeProfile node:
+        SchedulerPolicy   = "FIFO"        (FIFO, RR or Default)
+        SchedulerPriority = 80            (1-99)
+        CPUs              = 0x4           (a mask or "Isolated")
+        ReserveCPUs       = "True"
+        LockMemory        = "True"
+        StackSize         = 1048576
+        PrefaultStackSize = 524288
+        PrefaultBuffers   = "True"
+        @param info The configuration
+        @param threadPriority The ThreadPriority of the RealTimeThread (0-31)
+        @param runOnCPU The RunOnCPU of the RealTimeThread, used if CPUs is not specified
+        @param ownerName The name of the RealTimeThread, used in the error messages
+        @return False if the profile is not valid
+    */
+    bool ObjectLoadSetup(ConfigurationDataBase &info, int32 threadPriority, int32 runOnCPU, const char *ownerName);
+
+    /** True if a RealTimeProfile was configured */
+    bool IsEnabled() const{
+        return enabled;
+    }
+
+    /** The CPUs where the real time thread is to be started */
+    uint32 CPUMask() const{
+        return cpuMask;
+    }
+
+    /** The stack size of the real time thread */
+    int32 StackSize() const{
+        return stackSize;
+    }
+
+    /** True if the buffers are to be prefaulted before the pulse */
+    bool PrefaultBuffersEnabled() const{
+        return (enabled && prefaultBuffers);
+    }
+
+    /** Locks the memory and reserves the CPUs. Called before starting the real time thread.
+        @param ownerName Used in the error messages */
+    bool ApplyToProcess(const char *ownerName);
+
+    /** Sets the scheduling policy and prefaults the stack. Called by the real time thread.
+        @param threadPriority The ThreadPriority used with the RTTP_DEFAULT policy
+        @param ownerName Used in the error messages */
+    bool ApplyToThread(int32 threadPriority, const char *ownerName);
+
+    /** Writes every page of a buffer, without changing its contents */
+    static void Prefault(void *buffer, int32 size);
+
+    /** Touches size bytes of the stack of the calling thread */
+    static void PrefaultStack(int32 size);
+};
+
+#endif
@@ -184,6 +184,10 @@ RealTimeThread::RealTimeThread(){
     offlineModules              = NULL;
     safetyModules               = NULL;
     initialisingModules         = NULL;
+    onlineGAMHistograms         = NULL;
+    lastPulsingCycleTick        = 0;
+    nsecPerHRTCount             = HRT::HRTPeriod() * 1e9;
+    resetStatisticsOnPulse      = True;
 
     nOfOnlineGams               = 0;
     nOfOfflineGams              = 0;
@@ -211,8 +215,7 @@ void RTAppThread(RealTimeThread &rTThread){
 }
 
 void RealTimeThread::RTThread(){
-    Threads::SetRealTimeClass();
-    Threads::SetPriorityLevel(priority);
+    profile.ApplyToThread(priority, Name());
     isThreadRunning = True;
 
     AssertErrorCondition(Information,"RealTimeThread::RTThread: RTThread Started");
@@ -237,6 +240,12 @@ void RealTimeThread::RTThread(){
         else if(smStatus == SM_PREPULSE){
             pulsingCycleCount = 0;
             prepulseCycleCount++;
+            lastPulsingCycleTick = 0;
+            if(resetStatisticsOnPulse){
+                cycleTimeHistogram.Reset();
+                cycleJitterHistogram.Reset();
+                for(int i = 0; i < nOfOnlineGams; i++) onlineGAMHistograms[i].Reset();
+            }
             rtStatus = RTAPP_READY;
             for(int i = 0; i < nOfOnlineGams; i++){
                 if(!onlineModules[i].Reference()->Execute(GAMPrepulse)){
@@ -273,16 +282,30 @@ void RealTimeThread::RTThread(){
         else if(smStatus == SM_PULSING){
             if(rtStatus == RTAPP_READY){
                 pulsingCycleCount++;
-                for(int i = 0; i < nOfOnlineGams; i++){
-                    performanceMonitor.StartGAMMeasureCounter();
-                    if(!onlineModules[i].Execute()){
-                        AssertErrorCondition(FatalError,"RealTimeThread::%s : Online GAM %s failed during pulsing. Setting RT-state to safety",Name(),onlineModules[i].Reference()->GamName());
+                int64 cycleStartCounter = HRT::HRTCounter();
+                if(scheduler.IsEnabled()){
+                    int32 failed = scheduler.Execute();
+                    for(int i = 0; i < nOfOnlineGams; i++){
+                        performanceMonitor.StorePerformance(i, onlineModules[i].lastExecutionTimeCounts, onlineModules[i].lastAmountOfExecTimeCounts);
+                    }
+                    if(failed >= 0){
+                        AssertErrorCondition(FatalError,"RealTimeThread::%s : Online GAM %s failed during pulsing. Setting RT-state to safety",Name(),onlineModules[failed].Reference()->GamName());
                         rtStatus = RTAPP_SAFETY;
-                        break;
                     }
-                    performanceMonitor.StorePerformance(i);
+                }
+                else{
+                    for(int i = 0; i < nOfOnlineGams; i++){
+                        performanceMonitor.StartGAMMeasureCounter();
+                        if(!onlineModules[i].Execute()){
+                            AssertErrorCondition(FatalError,"RealTimeThread::%s : Online GAM %s failed during pulsing. Setting RT-state to safety",Name(),onlineModules[i].Reference()->GamName());
+                            rtStatus = RTAPP_SAFETY;
+                            break;
+                        }
+                        performanceMonitor.StorePerformance(i);
+                    }
                 }
                 performanceInterface->Write();
+                UpdateLatencyStatistics(cycleStartCounter);
             }
             else{
                 //Safety
@@ -333,6 +356,22 @@ void RealTimeThread::RTThread(){
     return;
 }
 
+/** Prints a row with the percentiles of an histogram */
+static void PrintLatencyStatistics(HttpStream &hStream, const char *name, const RTLatencyHistogram &histogram){
+    RTLatencyHistogram snapshot;
+    if(!histogram.Snapshot(snapshot)){
+        hStream.Printf("<TR><TD>%s</TD><TD COLSPAN=\"6\">Busy</TD></TR>\n", name);
+        return;
+    }
+    hStream.Printf("<TR><TD>%s</TD><TD>%u</TD><TD>%.3f</TD><TD>%.3f</TD><TD>%.3f</TD><TD>%.3f</TD><TD>%.3f</TD></TR>\n", name,
+                   snapshot.NumberOfSamples(),
+                   snapshot.Min() * 1e-3,
+                   snapshot.Percentile(0.5) * 1e-3,
+                   snapshot.Percentile(0.99) * 1e-3,
+                   snapshot.Percentile(0.999) * 1e-3,
+                   snapshot.Max() * 1e-3);
+}
+
 bool RealTimeThread::ProcessHttpMessage(HttpStream &hStream){
     hStream.SSPrintf("OutputHttpOtions.Content-Type","text/html");
     hStream.keepAlive = False;
@@ -412,6 +451,21 @@ bool RealTimeThread::ProcessHttpMessage(HttpStream &hStream){
     }
     hStream.Printf("</TABLE>\n");
 
+    hStream.Printf("<H2>Online Latency Statistics (usec)</H2>\n");
+    hStream.Printf("<P>Reset at each pulse = %s</P>\n", resetStatisticsOnPulse ? "True" : "False");
+    hStream.Printf("<TABLE CLASS=\"bltable\">\n");
+    hStream.Printf("<TR><TH>Name</TH><TH>Samples</TH><TH>Min</TH><TH>p50</TH><TH>p99</TH><TH>p99.9</TH><TH>Max</TH></TR>\n");
+    PrintLatencyStatistics(hStream, "Cycle Time", cycleTimeHistogram);
+    PrintLatencyStatistics(hStream, "Cycle Jitter", cycleJitterHistogram);
+    if(onlineGAMHistograms != NULL){
+        for(i = 0; i < nOfOnlineGams; i++){
+            PrintLatencyStatistics(hStream, onlineModules[i].Reference()->Name(), onlineGAMHistograms[i]);
+        }
+    }
+    hStream.Printf("</TABLE>\n");
+
+    scheduler.ProcessHttpMessage(hStream);
+
     hStream.Printf("<H2>Safety GAMs</H2>\n");
     hStream.Printf("<TABLE CLASS=\"bltable\">\n");
     hStream.Printf("<TR><TH>N</TH><TH>Name</TH><TH>Last Time Executed</TH><TH>Last Time Duration</TH></TR>\n");
@@ -474,6 +528,10 @@ bool RealTimeThread::PulseStart(){
         return False;
     }
 
+    if(profile.PrefaultBuffersEnabled()){
+        PrefaultBuffers();
+    }
+
     if (!smStatus.Request(SM_PREPULSE, SM_PULSING)) {
         AssertErrorCondition(FatalError,"RealTimeThread::Check: Failed requesting state change of the StateMachineStatus to status SM_PREPULSE waiting for SM_PULSING");
         return False;
@@ -506,6 +564,12 @@ bool RealTimeThread::PostPulse(){
 
 bool RealTimeThread::CleanRealTimeThread(){
     realTimeThreadCleanSem.Lock();
+    //Stop the workers before the modules are destroyed
+    scheduler.CleanUp();
+    if(onlineGAMHistograms != NULL){
+        delete[] onlineGAMHistograms;
+        onlineGAMHistograms = NULL;
+    }
     //Free Local Structures
     if(onlineModules        != NULL){
         // Remove local copies of GAMs
@@ -794,6 +858,18 @@ bool RealTimeThread::HandleLevel1Message(ConfigurationDataBase &info){
         return False;
     }
 
+    if(!CreateScheduler(info)) {
+        AssertErrorCondition(FatalError, "RealTimeThread::HandleLevel1Message: %s: Unable to create the parallel scheduler", Name());
+        CleanRealTimeThread();
+        return False;
+    }
+
+    if(!CreateLatencyStatistics()) {
+        AssertErrorCondition(FatalError, "RealTimeThread::HandleLevel1Message: %s: Unable to allocate the latency statistics", Name());
+        CleanRealTimeThread();
+        return False;
+    }
+
     // Initialise performance monitor activities
     performanceMonitor.Initialise(nOfOnlineGams, performanceInterface->Buffer(), trigger);
 
@@ -831,7 +907,17 @@ bool RealTimeThread::Start(){
 
     stopThread = False;
 
-    threadID = Threads::BeginThread((void (__thread_decl *)(void *))RTAppThread,this,THREADS_DEFAULT_STACKSIZE, Name(),XH_NotHandled, runOnCPU);
+    int32  stackSize = THREADS_DEFAULT_STACKSIZE;
+    uint32 cpuMask   = runOnCPU;
+    if(profile.IsEnabled()){
+        if(!profile.ApplyToProcess(Name())){
+            AssertErrorCondition(Warning,"RealTimeThread::Start: %s: The RealTimeProfile could not be fully applied", Name());
+        }
+        stackSize = profile.StackSize();
+        cpuMask   = profile.CPUMask();
+    }
+
+    threadID = Threads::BeginThread((void (__thread_decl *)(void *))RTAppThread,this,stackSize, Name(),XH_NotHandled, cpuMask);
     // Waits for thread
     while(!isThreadRunning)   SleepMsec(10);
 
@@ -915,6 +1001,20 @@ bool RealTimeThread::ObjectLoadSetup(ConfigurationDataBase &info,StreamInterface
         return False;
     }
 
+    profile = RTThreadProfile();
+    if(cdb->Move("RealTimeProfile")){
+        bool ok = profile.ObjectLoadSetup(cdb, priority, runOnCPU, Name());
+        cdb->MoveToFather();
+        if(!ok){
+            AssertErrorCondition(InitialisationError,"RealTimeThread::ObjectLoadSetup: %s: Invalid RealTimeProfile", Name());
+            return False;
+        }
+    }
+
+    FString resetStatistics;
+    cdb.ReadFString(resetStatistics, "ResetStatisticsOnPulse", "True");
+    resetStatisticsOnPulse = ((resetStatistics == "True") || (resetStatistics == "Yes") || (resetStatistics == "1"));
+
     int32  timeOutRequest = 0;
     if(!cdb.ReadInt32(timeOutRequest,"RTStatusChangeMsecTimeout")){
         timeOutRequest    = 20;
@@ -1175,6 +1275,18 @@ bool RealTimeThread::ObjectLoadSetup(ConfigurationDataBase &info,StreamInterface
         return False;
     }
 
+    if(!CreateScheduler(info)) {
+        AssertErrorCondition(FatalError, "RealTimeThread::ObjectLoadSetup: %s: Unable to create the parallel scheduler", Name());
+        CleanRealTimeThread();
+        return False;
+    }
+
+    if(!CreateLatencyStatistics()) {
+        AssertErrorCondition(FatalError, "RealTimeThread::ObjectLoadSetup: %s: Unable to allocate the latency statistics", Name());
+        CleanRealTimeThread();
+        return False;
+    }
+
     rtStatus = RTAPP_READY;
     smStatus = SM_IDLE;
 
@@ -1555,3 +1667,72 @@ bool RealTimeThread::CreatePerformanceMonitors4Gams(ConfigurationDataBase &info)
 }
 
 OBJECTLOADREGISTER(RealTimeThread,"$Id$")
+
+bool RealTimeThread::CreateScheduler(ConfigurationDataBase &info) {
+    CDBExtended cdb(info);
+    if(!cdb->Move("ParallelScheduler")) {
+        return True;
+    }
+
+    bool ok = scheduler.Initialise(onlineModules, nOfOnlineGams, cdb, priority, Name());
+    cdb->MoveToFather();
+    return ok;
+}
+
+void RealTimeThread::PrefaultBuffers() {
+    if(ddb.IsValid()) {
+        RTThreadProfile::Prefault(ddb->Buffer(), ddb->BufferSize());
+    }
+
+    for(int o = 0; o < Size(); o++) {
+        GCRTemplate<GAM> gam = Find(o);
+        if(!gam.IsValid()) continue;
+        LinkedListable *interfaces = gam->InterfacesList();
+        while(interfaces != NULL) {
+            DDBInterface *ddbi = dynamic_cast<DDBInterface *>(interfaces);
+            interfaces = interfaces->Next();
+            if(ddbi == NULL) continue;
+            RTThreadProfile::Prefault(ddbi->Buffer(), ddbi->BufferWordSize() * sizeof(int32));
+        }
+    }
+}
+
+bool RealTimeThread::CreateLatencyStatistics() {
+    if(onlineGAMHistograms != NULL) delete[] onlineGAMHistograms;
+    onlineGAMHistograms = NULL;
+    cycleTimeHistogram.Reset();
+    cycleJitterHistogram.Reset();
+    lastPulsingCycleTick = 0;
+    if(nOfOnlineGams == 0) {
+        return True;
+    }
+
+    onlineGAMHistograms = new RTLatencyHistogram[nOfOnlineGams];
+    return (onlineGAMHistograms != NULL);
+}
+
+/** Converts HRT counts to nanoseconds saturating at the histogram range */
+static inline uint32 RTTCountsToNsec(int64 counts, double nsecPerHRTCount){
+    if(counts <= 0) return 0;
+    double nsec = counts * nsecPerHRTCount;
+    if(nsec >= 4294967295.0) return 0xFFFFFFFF;
+    return (uint32)nsec;
+}
+
+void RealTimeThread::UpdateLatencyStatistics(int64 cycleStartCounter) {
+    int64 cycleTick = trigger->GetLastProcessorTickTime();
+    if((lastPulsingCycleTick != 0) && (cycleTick > lastPulsingCycleTick)) {
+        uint32 cycleNsec  = RTTCountsToNsec(cycleTick - lastPulsingCycleTick, nsecPerHRTCount);
+        uint32 periodNsec = trigger->GetUsecPeriod() * 1000;
+        cycleTimeHistogram.Add(cycleNsec);
+        cycleJitterHistogram.Add((cycleNsec > periodNsec) ? (cycleNsec - periodNsec) : (periodNsec - cycleNsec));
+    }
+    lastPulsingCycleTick = cycleTick;
+
+    if(onlineGAMHistograms == NULL) return;
+    for(int i = 0; i < nOfOnlineGams; i++) {
+        // Skip the GAMs not executed in this cycle because of a failure
+        if(onlineModules[i].lastExecutionTimeCounts < cycleStartCounter) continue;
+        onlineGAMHistograms[i].Add(RTTCountsToNsec(onlineModules[i].lastAmountOfExecTimeCounts, nsecPerHRTCount));
+    }
+}
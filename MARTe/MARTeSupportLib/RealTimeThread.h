@@ -46,6 +46,9 @@
 #include "TimeTriggeringServiceInterface.h"
 #include "GenericAcqModule.h"
 #include "HttpInterface.h"
+#include "GAMScheduler.h"
+#include "RTLatencyHistogram.h"
+#include "RTThreadProfile.h"
 
 class RealTimeThread;
 
@@ -198,6 +201,50 @@ private:
 
     bool                                            CreatePerformanceMonitors4Gams(ConfigurationDataBase &info);
 
+private:
+
+    /** Executes the online GAMs on several cores when ParallelScheduler is specified */
+    GAMScheduler                                    scheduler;
+
+    /** Builds the parallel schedule of the online GAMs. Must be called after the DDB links are created */
+    bool                                            CreateScheduler(ConfigurationDataBase &info);
+
+private:
+
+    /** Execution time histograms of the online GAMs (nanoseconds) */
+    RTLatencyHistogram                             *onlineGAMHistograms;
+
+    /** Histogram of the pulsing cycle time (nanoseconds) */
+    RTLatencyHistogram                              cycleTimeHistogram;
+
+    /** Histogram of the distance of the cycle time from the nominal period (nanoseconds) */
+    RTLatencyHistogram                              cycleJitterHistogram;
+
+    /** Trigger tick of the previous pulsing cycle. 0 before the first cycle */
+    int64                                           lastPulsingCycleTick;
+
+    /** Conversion factor from HRT counts to nanoseconds */
+    double                                          nsecPerHRTCount;
+
+    /** If True the histograms are cleared at each PREPULSE */
+    bool                                            resetStatisticsOnPulse;
+
+    /** Allocates the histograms of the online GAMs */
+    bool                                            CreateLatencyStatistics();
+
+    /** Adds the samples of the last pulsing cycle to the histograms.
+        @param cycleStartCounter HRT counter before the first online GAM was executed
+      */
+    void                                            UpdateLatencyStatistics(int64 cycleStartCounter);
+
+private:
+
+    /** Scheduling, CPU set and memory settings of the real time thread (RealTimeProfile) */
+    RTThreadProfile                                 profile;
+
+    /** Touches the DDB and the GAM interface buffers so that the first cycles do not page fault */
+    void                                            PrefaultBuffers();
+
 private:
 
     /** The Time and Triggering Service. */
@@ -373,11 +420,13 @@ public:
 
     virtual ~RealTimeThread(){
         Stop();
+        scheduler.CleanUp();
         if(onlineModules        != NULL) delete[] onlineModules;
         if(offlineModules       != NULL) delete[] offlineModules;  
         if(safetyModules        != NULL) delete[] safetyModules;
         if(initialisingModules  != NULL) delete[] initialisingModules;        
         if(performanceInterface != NULL) delete   performanceInterface;
+        if(onlineGAMHistograms  != NULL) delete[] onlineGAMHistograms;
 
         realTimeThreadCleanSem.Close();
     }